@@ -0,0 +1,134 @@
+#!/usr/bin/env bash
+# Crash/restart stress of the consumer cursors (consumer_cursors.h) and the retention they gate (frame_retention.h)
+# across processes: a producer writes a frame every millisecond and reclaims down to STRESS_KEEP frames against the
+# live cursors, while several consumers read and acknowledge the frames as fast as they come, one at a time is killed
+# (SIGKILL, mid-write or not) and restarted, capture's scan runs alongside, and one consumer with a short lease is
+# stopped past its lease so the scan reports it lapsed. Fails if a frame was reclaimed ahead of a live cursor, a cursor
+# ever moved back, a restarted consumer did not resume live from exactly its last cursor on disk, a stalled consumer
+# was not reported lapsed or did not come back live, a cursor file was left unreadable, or nothing was reclaimed or
+# held back at all.
+#
+#   scripts/cursor-stress.sh [BIN_DIR]
+#
+# BIN_DIR holds hots_cursors (default src/game-capture/build/bin/Release). STRESS_SECONDS (default 10),
+# STRESS_CONSUMERS (default 4) and STRESS_KEEP (default 32) size the run.
+set -euo pipefail
+
+bin="${1:-$(dirname "$0")/../src/game-capture/build/bin/Release}"
+seconds="${STRESS_SECONDS:-10}"
+consumers="${STRESS_CONSUMERS:-4}"
+keep="${STRESS_KEEP:-32}"
+
+work="$(mktemp -d)"
+cur="$work/cursors"
+frames="$work/frames"
+logs="$work/logs"
+mkdir -p "$cur" "$frames" "$logs"
+
+declare -A pid maxseen
+trap 'kill -9 "${pid[@]}" 2>/dev/null || true; rm -rf "$work"' EXIT
+
+fail() {
+    echo "FAIL: $*" >&2
+    exit 1
+}
+
+cursors() { "$bin/hots_cursors" --dir "$cur" "$@"; }
+
+start() {  # NAME LEASE_MS
+    : >"$logs/$1.out"
+    "$bin/hots_cursors" --dir "$cur" --frames "$frames" consume "$1" "$2" >>"$logs/$1.out" 2>&1 &
+    pid[$1]=$!
+}
+
+# A consumer reports a frame reclaimed ahead of its live cursor and exits; the producer only exits on an I/O error
+check_frames() {
+    if grep -h MISSING "$logs"/*.out >&2; then
+        fail "a frame was reclaimed ahead of a live cursor"
+    fi
+    kill -0 "${pid[producer]}" 2>/dev/null || fail "the producer exited: $(cat "$logs/producer.log")"
+}
+
+# Every cursor on disk as "name seq", and no cursor lower than the highest seen for it before
+check_list() {
+    local name seq
+    while read -r name seq; do
+        seq="${seq#seq=}"
+        ((seq >= ${maxseen[$name]:-0})) || fail "$name moved back from ${maxseen[$name]} to $seq"
+        maxseen[$name]=$seq
+    done < <(cursors list | awk '{print $1, $2}')
+}
+
+seq_on_disk() { cursors list | awk -v n="$1" '$1 == n {sub("seq=", "", $2); print $2}'; }
+is_live() { cursors list | awk -v n="$1" '$1 == n && $NF == "live" {found = 1} END {exit !found}'; }
+
+"$bin/hots_cursors" --dir "$cur" --frames "$frames" retain "$keep" >"$logs/producer.log" 2>&1 &
+pid[producer]=$!
+sleep 0.1
+for i in $(seq 0 $((consumers - 1))); do
+    start "c$i" 60000
+done
+start stall 300
+sleep 0.5
+
+restarts=0
+stalls=0
+end=$((SECONDS + seconds))
+
+while ((SECONDS < end)); do
+    check_list
+    check_frames
+    cursors scan >>"$logs/scan.out"
+
+    victim="c$((RANDOM % consumers))"
+    sleep "0.0$((RANDOM % 10))"
+    kill -9 "${pid[$victim]}"
+    wait "${pid[$victim]}" 2>/dev/null || true
+
+    before="$(seq_on_disk "$victim")"
+    [ -n "$before" ] || fail "$victim's cursor is missing or unreadable after a kill"
+    ((before >= ${maxseen[$victim]:-0})) || fail "$victim's cursor moved back to $before across a kill"
+
+    start "$victim" 60000
+    for _ in $(seq 50); do
+        grep -q resumed "$logs/$victim.out" && break
+        sleep 0.05
+    done
+    line="$(grep resumed "$logs/$victim.out")" || fail "$victim did not restart"
+    [[ "$line" == *"seq=$before (live)" ]] || fail "$victim expected to resume live at $before: $line"
+    restarts=$((restarts + 1))
+
+    if ((restarts % 5 == 0)); then
+        kill -STOP "${pid[stall]}"
+        sleep 0.5
+        cursors scan | grep -q "^expired stall " || fail "the scan kept a cursor whose lease had lapsed"
+        kill -CONT "${pid[stall]}"
+        for _ in $(seq 50); do
+            is_live stall && break
+            sleep 0.02
+        done
+        is_live stall || fail "the stalled consumer did not come back live"
+        stalls=$((stalls + 1))
+    fi
+done
+
+check_list
+check_frames
+kill -9 "${pid[@]}" 2>/dev/null || true
+wait 2>/dev/null || true
+
+# "produced N reclaimed R retained K held in H scans", every 1000 frames
+read -r produced reclaimed held < <(awk '{p = $2; r = $4; h = $9} END {print p + 0, r + 0, h + 0}' "$logs/producer.log")
+((reclaimed > 0)) || fail "the producer never reclaimed a frame"
+((held > 0)) || fail "no cursor ever held a frame back"
+
+files=$(find "$cur" -name '*.cursor' | wc -l)
+listed=$(cursors list | wc -l)
+((files == listed)) || fail "$files cursor files but only $listed readable"
+
+acks=0
+for name in "${!maxseen[@]}"; do
+    acks=$((acks + maxseen[$name]))
+done
+echo "ok: $restarts kills and restarts, $stalls lapsed leases reported and renewed, $acks acks, $files cursors;" \
+    "$produced frames produced, $reclaimed reclaimed, held back in $held scans"
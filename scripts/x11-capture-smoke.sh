@@ -0,0 +1,43 @@
+#!/usr/bin/env bash
+# Headless check of the X11 capture backend: starts Xvfb, draws into a test client window (with still periods and a
+# resize) and captures it, once paced and once on change. Fails if capture found no frames, returned frame numbers
+# out of order, or changed a frame while it was still supposed to be held.
+#
+#   scripts/x11-capture-smoke.sh [BIN_DIR]
+#
+# BIN_DIR holds hots_x11cap and hots_x11_testclient (default src/game-capture/build/bin/Release). Needs Xvfb (exits 2
+# without it). With SMOKE_REQUIRE_DAMAGE=1 it also fails unless capture found unchanged frames through XDamage, i.e.
+# the binaries were built against libXdamage.
+set -euo pipefail
+
+bin="${1:-$(dirname "$0")/../src/game-capture/build/bin/Release}"
+display=":${SMOKE_DISPLAY:-97}"
+
+if ! command -v Xvfb >/dev/null; then
+    echo "Xvfb not found: install it (Debian/Ubuntu: xvfb) to run this check" >&2
+    exit 2
+fi
+
+log="$(mktemp)"
+Xvfb "$display" -screen 0 1280x720x24 -nolisten tcp &
+xvfb=$!
+client=
+trap 'kill $client $xvfb 2>/dev/null || true; rm -f "$log"' EXIT
+export DISPLAY="$display"
+
+for _ in $(seq 50); do
+    [ -e "/tmp/.X11-unix/X${display#:}" ] && break
+    sleep 0.1
+done
+[ -e "/tmp/.X11-unix/X${display#:}" ] || { echo "Xvfb did not start on $display" >&2; exit 1; }
+
+"$bin/hots_x11_testclient" --fps 30 --still-every 45 --still-ms 700 --resize-at 120 &
+client=$!
+sleep 0.5
+
+"$bin/hots_x11cap" --pid "$client" --seconds 3 --interval-ms 20 --marker | tee "$log"
+if [ "${SMOKE_REQUIRE_DAMAGE:-0}" = 1 ] && ! grep -q "found by XDamage" "$log"; then
+    echo "capture did not use XDamage (built without libXdamage?)" >&2
+    exit 1
+fi
+"$bin/hots_x11cap" --title "heroes of the storm" --seconds 3 --interval-ms 0 --marker
@@ -0,0 +1,736 @@
+// hots_aggregator: receives shipped frames from capture nodes (see ship.h for the protocol).
+//
+//   hots_aggregator --listen host:port --store dir [--serve host:port] [--memory-mb N] [--queue N] [--retain-days D]
+//
+// Layout: <store>/<node>/<epoch>/frames/<name> for completed files, <store>/<node>/<epoch>/incoming/<seq>.part for
+// the transfer in progress and <store>/<node>/<epoch>/ship.state holding the last completed seq. A file only moves
+// into frames/ after its crc32 matches and it has been fsynced, so the RESUME sent on reconnect never claims more
+// than survived a crash of the aggregator itself. frames.log beside them lists "seq unix_ms name hash" per
+// completed frame and rebuilds the FrameHub index on startup.
+//
+// Frame files are content-addressed (BlobStore): frames/<name> is a hard link into <store>/.blobs (node names cannot
+// start with a dot, so it never collides with a node directory). Loading screens
+// and other identical frames shipped by many sessions are stored once. With --retain-days, epochs that have not
+// received a frame for that long are deleted every hour and blobs nothing links to any more are collected.
+//
+// With --serve, consumers subscribe to the merged stream of every node (protocol in ship.h, queuing in frame_hub.h).
+#include "blob_store.h"
+#include "checksum.h"
+#include "frame_hub.h"
+#include "image_pyramid.h"
+#include "fs_util.h"
+#include "lz.h"
+#include "net.h"
+#include "ship.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <optional>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+constexpr int kIoTimeoutMs = 30000;
+
+fs::path g_store;
+std::unique_ptr<FrameHub> g_hub;
+std::unique_ptr<BlobStore> g_blobs;
+
+// One live connection per node: a reconnecting node evicts its previous (probably dead) connection
+struct NodeSlot
+{
+    std::mutex busy;
+    Socket* active = nullptr;
+};
+
+std::mutex g_nodesMutex;
+std::map<std::string, std::shared_ptr<NodeSlot>> g_nodes;
+
+void note(const std::string& peer, const char* fmt, const std::string& detail = {})
+{
+    fprintf(stderr, "[%s] ", peer.c_str());
+    fprintf(stderr, fmt, detail.c_str());
+    fputc('\n', stderr);
+}
+
+FILE* open_file(const fs::path& p, const char* mode)
+{
+#ifdef _WIN32
+    std::wstring wmode(mode, mode + strlen(mode));
+    return _wfopen(p.wstring().c_str(), wmode.c_str());
+#else
+    return fopen(p.c_str(), mode);
+#endif
+}
+
+struct EpochState
+{
+    std::string node;
+    uint64_t epoch = 0;
+    fs::path dir;
+    bool hasComplete = false;
+    uint64_t lastComplete = 0;
+    bool hasPartial = false;
+    uint64_t partialSeq = 0;
+    uint64_t partialOffset = 0;
+
+    fs::path part(uint64_t seq) const { return dir / "incoming" / (std::to_string(seq) + ".part"); }
+
+    void load()
+    {
+        std::error_code ec;
+        fs::create_directories(dir / "frames", ec);
+        fs::create_directories(dir / "incoming", ec);
+
+        if (FILE* f = open_file(dir / "ship.state", "rb"))
+        {
+            unsigned long long seq = 0;
+            hasComplete = fscanf(f, "last_complete=%llu", &seq) == 1;
+            lastComplete = seq;
+            fclose(f);
+        }
+
+        // Keep the newest part beyond last_complete; anything else is stale
+        std::vector<fs::path> parts;
+        for (const auto& e : fs::directory_iterator(dir / "incoming", ec))
+            parts.push_back(e.path());
+
+        for (const auto& p : parts)
+        {
+            uint64_t seq = std::strtoull(p.stem().string().c_str(), nullptr, 10);
+
+            if (p.extension() == ".part" && (!hasComplete || seq > lastComplete) && (!hasPartial || seq > partialSeq))
+            {
+                hasPartial = true;
+                partialSeq = seq;
+            }
+        }
+
+        for (const auto& p : parts)
+            if (!hasPartial || p != part(partialSeq))
+                fs::remove(p, ec);
+
+        if (hasPartial)
+            partialOffset = fs::file_size(part(partialSeq), ec);
+    }
+
+    bool save(uint64_t seq)
+    {
+        auto tmp = dir / "ship.state.tmp";
+        FILE* f = open_file(tmp, "wb");
+
+        if (!f)
+            return false;
+
+        bool ok = fprintf(f, "last_complete=%llu\n", static_cast<unsigned long long>(seq)) > 0;
+        ok = fclose(f) == 0 && ok && sync_file(tmp);
+
+        std::error_code ec;
+        fs::rename(tmp, dir / "ship.state", ec);
+        sync_dir(dir);
+
+        if (ok && !ec)
+        {
+            hasComplete = true;
+            lastComplete = seq;
+        }
+
+        return ok && !ec;
+    }
+
+    void record(uint64_t seq, int64_t unixMs, const std::string& name, const Hash128& hash)
+    {
+        if (FILE* f = open_file(dir / "frames.log", "ab"))
+        {
+            fprintf(f, "%llu %lld %s %s\n", static_cast<unsigned long long>(seq), static_cast<long long>(unixMs),
+                    name.c_str(), hash.hex().c_str());
+            fclose(f);
+        }
+    }
+};
+
+bool read_file(const fs::path& p, std::vector<uint8_t>& out)
+{
+    FILE* f = open_file(p, "rb");
+
+    if (!f)
+        return false;
+
+    std::error_code ec;
+    out.resize(static_cast<size_t>(fs::file_size(p, ec)));
+    bool ok = !ec && fread(out.data(), 1, out.size(), f) == out.size();
+    fclose(f);
+    return ok;
+}
+
+// Indexes everything earlier runs received; frame bytes stay on disk until a subscriber asks
+size_t load_index()
+{
+    size_t n = 0;
+    std::error_code ec;
+
+    for (const auto& nodeDir : fs::directory_iterator(g_store, ec))
+    {
+        if (!ship::valid_name(nodeDir.path().filename().string(), 64))
+            continue;  // .blobs
+
+        for (const auto& epochDir : fs::directory_iterator(nodeDir.path(), ec))
+        {
+            FILE* f = open_file(epochDir.path() / "frames.log", "rb");
+
+            if (!f)
+                continue;
+
+            unsigned long long seq;
+            long long unixMs;
+            char name[256];
+
+            while (fscanf(f, "%llu %lld %255s%*[^\n]", &seq, &unixMs, name) == 3)
+            {
+                FrameHub::Frame frame;
+                frame.node = nodeDir.path().filename().string();
+                frame.epoch = std::strtoull(epochDir.path().filename().string().c_str(), nullptr, 10);
+                frame.seq = seq;
+                frame.unixMs = unixMs;
+                frame.path = epochDir.path() / "frames" / name;
+                frame.level = pyramid_level_of(name);
+                g_hub->publish(std::move(frame), {});
+                ++n;
+            }
+
+            fclose(f);
+        }
+    }
+
+    return n;
+}
+
+bool send_ack(Socket& s, uint64_t seq, uint64_t offset, bool complete)
+{
+    ship::Writer w;
+    w.u64(seq);
+    w.u64(offset);
+    w.u8(complete ? 1 : 0);
+    return ship::send(s, ship::Msg::Ack, w.data());
+}
+
+// The transfer currently being received on a connection
+struct Incoming
+{
+    bool open = false;
+    uint64_t seq = 0;
+    uint64_t size = 0;
+    uint64_t offset = 0;
+    uint64_t lastAck = 0;
+    int64_t unixMs = 0;
+    uint32_t crc = 0;
+    std::string name;
+    FILE* f = nullptr;
+
+    void close()
+    {
+        if (f)
+            fclose(f);
+        f = nullptr;
+        open = false;
+    }
+};
+
+// Re-reads what a previous connection left in the .part so the END crc can cover the whole file
+bool seed_crc(const fs::path& p, uint64_t n, uint32_t& crc)
+{
+    FILE* f = open_file(p, "rb");
+
+    if (!f)
+        return n == 0;
+
+    std::vector<uint8_t> buf(1 << 16);
+    crc = 0;
+
+    while (n > 0)
+    {
+        size_t want = static_cast<size_t>(std::min<uint64_t>(buf.size(), n));
+
+        if (fread(buf.data(), 1, want, f) != want)
+            break;
+
+        crc = crc32_update(crc, buf.data(), want);
+        n -= want;
+    }
+
+    fclose(f);
+    return n == 0;
+}
+
+bool receive(Socket& s, const std::string& peer, EpochState& st)
+{
+    Incoming in;
+    ship::Msg type;
+    std::vector<uint8_t> payload;
+    std::vector<uint8_t> raw(ship::kChunkBytes);
+
+    struct Closer
+    {
+        Incoming& in;
+        ~Closer() { in.close(); }
+    } closer{in};
+
+    while (ship::recv(s, type, payload))
+    {
+        ship::Reader r(payload.data(), payload.size());
+
+        if (type == ship::Msg::File)
+        {
+            in.close();
+            in.seq = r.u64();
+            in.size = r.u64();
+            uint64_t start = r.u64();
+            in.name = r.str();
+            in.unixMs = static_cast<int64_t>(r.u64());
+
+            if (!r.ok() || !ship::valid_name(in.name, 128))
+                return false;
+
+            auto part = st.part(in.seq);
+            std::error_code ec;
+
+            // Resuming is only valid from exactly what the RESUME offered; anything else restarts the file
+            bool resume = start > 0 && st.hasPartial && st.partialSeq == in.seq && st.partialOffset == start &&
+                          start <= in.size;
+
+            if (start > 0 && !resume)
+                return false;
+
+            for (const auto& e : fs::directory_iterator(st.dir / "incoming", ec))
+                if (e.path() != part)
+                    fs::remove(e.path(), ec);
+
+            in.crc = 0;
+            if (resume && !seed_crc(part, start, in.crc))
+            {
+                fs::remove(part, ec);
+                return false;
+            }
+
+            in.f = open_file(part, resume ? "ab" : "wb");
+            in.offset = in.lastAck = start;
+            in.open = in.f != nullptr;
+            st.hasPartial = false;
+
+            if (!in.open)
+                return false;
+
+            continue;
+        }
+
+        if (type == ship::Msg::Chunk)
+        {
+            auto codec = static_cast<ship::Codec>(r.u8());
+            uint32_t rawLen = r.u32();
+            const uint8_t* body = r.bytes(r.remaining());
+
+            if (!in.open || !r.ok() || rawLen > raw.size() || rawLen > in.size - in.offset)
+                return false;
+
+            const uint8_t* data = body;
+            size_t bodyLen = payload.size() - 5;
+
+            if (codec == ship::Codec::Lz)
+            {
+                if (!lz_decompress(body, bodyLen, raw.data(), rawLen))
+                    return false;
+                data = raw.data();
+            }
+            else if (codec != ship::Codec::Raw || bodyLen != rawLen)
+            {
+                return false;
+            }
+
+            if (fwrite(data, 1, rawLen, in.f) != rawLen)
+                return false;
+
+            in.crc = crc32_update(in.crc, data, rawLen);
+            in.offset += rawLen;
+
+            if (in.offset - in.lastAck >= ship::kAckEvery)
+            {
+                in.lastAck = in.offset;
+                if (!send_ack(s, in.seq, in.offset, false))
+                    return false;
+            }
+
+            continue;
+        }
+
+        if (type == ship::Msg::End)
+        {
+            uint32_t crc = r.u32();
+
+            if (!in.open || !r.ok())
+                return false;
+
+            auto part = st.part(in.seq);
+            bool ok = fclose(in.f) == 0;
+            in.f = nullptr;
+            in.open = false;
+
+            std::error_code ec;
+
+            if (!ok || in.offset != in.size || crc != in.crc)
+            {
+                note(peer, "crc mismatch, discarding %s", in.name);
+                fs::remove(part, ec);
+                return false;
+            }
+
+            auto dest = st.dir / "frames" / in.name;
+
+            if (!sync_file(part))
+                return false;
+
+            auto stored = g_blobs->put(part, dest);
+
+            if (!stored.ok || ((in.seq > st.lastComplete || !st.hasComplete) && !st.save(in.seq)))
+                return false;
+
+            if (!send_ack(s, in.seq, in.size, true))
+                return false;
+
+            st.record(in.seq, in.unixMs, in.name, stored.hash);
+
+            FrameHub::Frame frame{st.node, st.epoch, in.seq, in.unixMs, dest, in.size, nullptr};
+            frame.level = pyramid_level_of(in.name);
+            std::vector<uint8_t> data;
+            if (g_hub->has_subscribers() && !read_file(dest, data))
+                data.clear();
+            g_hub->publish(std::move(frame), std::move(data));
+
+            continue;
+        }
+
+        return false;
+    }
+
+    return true;
+}
+
+void serve(Socket s, std::string peer)
+{
+    s.set_timeouts(kIoTimeoutMs);
+    s.set_nodelay();
+
+    ship::Msg type;
+    std::vector<uint8_t> payload;
+
+    if (!ship::recv(s, type, payload) || type != ship::Msg::Hello)
+        return;
+
+    ship::Reader r(payload.data(), payload.size());
+    uint32_t version = r.u32();
+    std::string node = r.str();
+    uint64_t epoch = r.u64();
+
+    if (!r.ok() || version != ship::kVersion || !ship::valid_name(node, 64))
+    {
+        note(peer, "rejected hello from %s", node);
+        return;
+    }
+
+    peer += "/" + node;
+
+    std::shared_ptr<NodeSlot> slot;
+    {
+        std::lock_guard<std::mutex> lock(g_nodesMutex);
+        auto& p = g_nodes[node];
+        if (!p)
+            p = std::make_shared<NodeSlot>();
+        slot = p;
+
+        if (slot->active)
+            slot->active->shutdown_both();
+    }
+
+    std::lock_guard<std::mutex> busy(slot->busy);
+    {
+        std::lock_guard<std::mutex> lock(g_nodesMutex);
+        slot->active = &s;
+    }
+
+    EpochState st;
+    st.node = node;
+    st.epoch = epoch;
+    st.dir = g_store / node / std::to_string(epoch);
+    st.load();
+
+    ship::Writer resume;
+    resume.u8(st.hasComplete ? 1 : 0);
+    resume.u64(st.lastComplete);
+    resume.u8(st.hasPartial ? 1 : 0);
+    resume.u64(st.partialSeq);
+    resume.u64(st.partialOffset);
+
+    note(peer, "connected, resume %s",
+         (st.hasComplete ? "after " + std::to_string(st.lastComplete) : std::string("from start")) +
+             (st.hasPartial ? ", seq " + std::to_string(st.partialSeq) + " at " + std::to_string(st.partialOffset)
+                            : std::string()));
+
+    bool clean = ship::send(s, ship::Msg::Resume, resume.data()) && receive(s, peer, st);
+    note(peer, clean ? "disconnected%s" : "protocol error, closed%s");
+
+    std::lock_guard<std::mutex> lock(g_nodesMutex);
+    if (slot->active == &s)
+        slot->active = nullptr;
+}
+
+// Subscriber connection: one `subscribe` line, then FRAME messages until either side goes away
+void serve_subscriber(Socket s, std::string peer)
+{
+    s.set_timeouts(kIoTimeoutMs);
+    s.set_nodelay();
+
+    std::string line;
+    char c;
+    while (line.size() < 512 && s.recv_all(&c, 1) && c != '\n')
+        line += c;
+
+    std::string node;
+    std::optional<int64_t> fromMs;
+    int level = 0;
+    bool ok = line.rfind("subscribe", 0) == 0;
+
+    for (size_t pos = line.find(' '); ok && pos != std::string::npos;)
+    {
+        size_t end = line.find(' ', pos + 1);
+        std::string arg = line.substr(pos + 1, end == std::string::npos ? std::string::npos : end - pos - 1);
+        pos = end;
+
+        if (!arg.empty() && arg.back() == '\r')
+            arg.pop_back();
+
+        if (arg.rfind("node=", 0) == 0)
+            node = arg.substr(5);
+        else if (arg.rfind("from_ms=", 0) == 0)
+            fromMs = std::strtoll(arg.c_str() + 8, nullptr, 10);
+        else if (arg.rfind("level=", 0) == 0)
+        {
+            level = static_cast<int>(std::strtol(arg.c_str() + 6, nullptr, 10));
+            ok = arg.size() == 7 && level >= 0 && level <= ImagePyramid::kMaxLevels;
+        }
+        else if (!arg.empty())
+            ok = false;
+    }
+
+    if (!ok || (!node.empty() && !ship::valid_name(node, 64)))
+    {
+        note(peer, "bad subscribe line: %s", line);
+        return;
+    }
+
+    auto sub = g_hub->subscribe(node, fromMs, level);
+    note(peer, "subscribed to %s", node.empty() ? std::string("all nodes") : node);
+
+    std::vector<uint8_t> disk;
+
+    for (;;)
+    {
+        auto f = sub->next(std::chrono::milliseconds(1000));
+
+        if (!f)
+        {
+            // Idle: a subscriber only ever reads, so anything readable here is its disconnect
+            if (s.wait_readable(0) != 0)
+                break;
+            continue;
+        }
+
+        const std::vector<uint8_t>* data = f->data.get();
+
+        if (!data)
+        {
+            if (!read_file(f->path, disk))
+                continue;
+            data = &disk;
+        }
+
+        ship::Writer meta;
+        meta.str(f->node);
+        meta.u64(f->epoch);
+        meta.u64(f->seq);
+        meta.u64(static_cast<uint64_t>(f->unixMs));
+        meta.str(f->path.filename().string());
+
+        // Header and metadata in one write; the frame bytes go straight from the shared buffer
+        std::vector<uint8_t> head;
+        auto total = static_cast<uint32_t>(meta.data().size() + data->size());
+        for (int i = 0; i < 4; ++i)
+            head.push_back(static_cast<uint8_t>(total >> (8 * i)));
+        head.push_back(static_cast<uint8_t>(ship::Msg::Frame));
+        head.insert(head.end(), meta.data().begin(), meta.data().end());
+
+        if (!s.send_all(head.data(), head.size()) || !s.send_all(data->data(), data->size()))
+            break;
+    }
+
+    note(peer, "unsubscribed, dropped %s", std::to_string(sub->dropped()));
+    g_hub->unsubscribe(sub);
+}
+
+// Deletes epochs that have not completed a frame within `maxAge`, then the blobs only they referenced
+void apply_retention(std::chrono::hours maxAge)
+{
+    auto cutoff = fs::file_time_type::clock::now() - maxAge;
+    std::vector<std::pair<std::string, fs::path>> expired;
+    std::error_code ec;
+
+    for (const auto& nodeDir : fs::directory_iterator(g_store, ec))
+    {
+        std::string node = nodeDir.path().filename().string();
+
+        if (!ship::valid_name(node, 64))
+            continue;
+
+        for (const auto& epochDir : fs::directory_iterator(nodeDir.path(), ec))
+        {
+            auto log = epochDir.path() / "frames.log";
+            auto t = fs::last_write_time(fs::exists(log, ec) ? log : epochDir.path(), ec);
+
+            if (!ec && t < cutoff)
+                expired.emplace_back(node, epochDir.path());
+        }
+    }
+
+    for (const auto& [node, dir] : expired)
+    {
+        // A node still shipping into an old epoch holds its slot; leave it for the next pass
+        std::shared_ptr<NodeSlot> slot;
+        {
+            std::lock_guard<std::mutex> lock(g_nodesMutex);
+            auto it = g_nodes.find(node);
+            if (it != g_nodes.end())
+                slot = it->second;
+        }
+
+        std::unique_lock<std::mutex> busy;
+        if (slot)
+        {
+            busy = std::unique_lock<std::mutex>(slot->busy, std::try_to_lock);
+            if (!busy.owns_lock())
+                continue;
+        }
+
+        fs::remove_all(dir, ec);
+        g_hub->forget(node, std::strtoull(dir.filename().string().c_str(), nullptr, 10));
+    }
+
+    auto gc = g_blobs->collect();
+    fprintf(stderr, "hots_aggregator: retention expired %zu epochs, removed %zu of %zu blobs (%llu bytes)\n",
+            expired.size(), gc.removed, gc.scanned, static_cast<unsigned long long>(gc.bytesFreed));
+}
+
+void accept_loop(Socket& server, void (*handler)(Socket, std::string), const char* prefix)
+{
+    for (uint64_t n = 0;; ++n)
+    {
+        Socket client = server.accept_client();
+
+        if (!client.valid())
+            continue;
+
+        std::thread(handler, std::move(client), prefix + std::to_string(n)).detach();
+    }
+}
+
+int usage()
+{
+    fprintf(stderr, "usage: hots_aggregator --listen host:port --store dir [--serve host:port] [--memory-mb N] "
+                    "[--queue N] [--retain-days D]\n");
+    return 2;
+}
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    std::string listen;
+    std::string serveAt;
+    FrameHub::Config hubCfg;
+    long retainDays = 0;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string a = argv[i];
+
+        if (a == "--listen" && i + 1 < argc)
+            listen = argv[++i];
+        else if (a == "--store" && i + 1 < argc)
+            g_store = argv[++i];
+        else if (a == "--serve" && i + 1 < argc)
+            serveAt = argv[++i];
+        else if (a == "--memory-mb" && i + 1 < argc)
+            hubCfg.memoryBudget = std::strtoull(argv[++i], nullptr, 10) << 20;
+        else if (a == "--retain-days" && i + 1 < argc)
+            retainDays = std::strtol(argv[++i], nullptr, 10);
+        else if (a == "--queue" && i + 1 < argc)
+            hubCfg.maxQueue = std::max<size_t>(1, std::strtoull(argv[++i], nullptr, 10));
+        else
+            return usage();
+    }
+
+    std::string host;
+    uint16_t port = 0;
+    std::string serveHost;
+    uint16_t servePort = 0;
+
+    if (g_store.empty() || !parse_endpoint(listen, host, port) ||
+        (!serveAt.empty() && !parse_endpoint(serveAt, serveHost, servePort)))
+        return usage();
+
+    g_hub = std::make_unique<FrameHub>(hubCfg);
+    g_blobs = std::make_unique<BlobStore>(g_store / ".blobs");
+    size_t indexed = load_index();
+
+    std::string error;
+    Socket server = Socket::listen_on(host, port, error);
+    Socket subscribers;
+
+    if (server.valid() && !serveAt.empty())
+        subscribers = Socket::listen_on(serveHost, servePort, error);
+
+    if (!server.valid() || (!serveAt.empty() && !subscribers.valid()))
+    {
+        fprintf(stderr, "hots_aggregator: cannot listen (%s)\n", error.c_str());
+        return 1;
+    }
+
+    fprintf(stderr, "hots_aggregator: nodes on port %u, subscribers on port %u, store %s (%zu frames indexed)\n",
+            server.local_port(), subscribers.valid() ? subscribers.local_port() : 0, g_store.string().c_str(),
+            indexed);
+
+    if (retainDays > 0)
+    {
+        std::thread(
+            [retainDays]
+            {
+                for (;;)
+                {
+                    apply_retention(std::chrono::hours(24 * retainDays));
+                    std::this_thread::sleep_for(std::chrono::hours(1));
+                }
+            })
+            .detach();
+    }
+
+    if (subscribers.valid())
+        std::thread([&subscribers] { accept_loop(subscribers, serve_subscriber, "sub"); }).detach();
+
+    accept_loop(server, serve, "conn");
+}
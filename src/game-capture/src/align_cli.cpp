@@ -0,0 +1,170 @@
+// hots_align: loads an alignment map (or a recording of raw alignment inputs) and answers lookups against it.
+//
+//   hots_align <file> [--seq N]... [--loop L]... [--out compact.map] [--expect file.expect]
+//
+// Prints the knot counts, then one line per lookup. --out writes the fitted map, which turns a recording into the
+// form capture persists. --expect checks the map against the true game loop of every frame:
+//   max_seq_error <loops>   bound on |loop_at_seq(seq) - loop|
+//   max_loop_error <loops>  bound on |loop - the true loop of seq_at_loop(loop)|
+//   seq <seq> <loop|none>   frame seq showed `loop` (none: before the replay started)
+// and exits 1 if a lookup is missing, unexpected or out of bounds (fixtures/alignment holds recorded ones).
+#include "alignment_map.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+static int usage()
+{
+    fprintf(stderr, "usage: hots_align <file> [--seq N]... [--loop L]... [--out compact.map] [--expect file.expect]\n");
+    return 2;
+}
+
+static void print_errors(const char* what, std::vector<double> errors, double bound)
+{
+    if (errors.empty())
+        return;
+    std::sort(errors.begin(), errors.end());
+    printf("%s: %zu lookups, error p50 %.1f p99 %.1f max %.1f loops (bound %.1f)\n", what, errors.size(),
+           errors[errors.size() / 2], errors[errors.size() * 99 / 100], errors.back(), bound);
+}
+
+static bool check_expected(const AlignmentMap& map, const char* path)
+{
+    std::ifstream in(path);
+    if (!in)
+    {
+        fprintf(stderr, "cannot read %s\n", path);
+        return false;
+    }
+
+    double maxSeqError = 0, maxLoopError = 0;
+    std::map<uint64_t, std::optional<double>> truth;
+    std::string line;
+
+    while (std::getline(in, line))
+    {
+        unsigned long long seq;
+        double v;
+        char word[16];
+
+        if (sscanf(line.c_str(), "max_seq_error %lf", &v) == 1)
+            maxSeqError = v;
+        else if (sscanf(line.c_str(), "max_loop_error %lf", &v) == 1)
+            maxLoopError = v;
+        else if (sscanf(line.c_str(), "seq %llu %lf", &seq, &v) == 2)
+            truth[seq] = v;
+        else if (sscanf(line.c_str(), "seq %llu %15s", &seq, word) == 2 && std::string(word) == "none")
+            truth[seq] = std::nullopt;
+    }
+
+    size_t failures = 0;
+    std::vector<double> seqErrors, loopErrors;
+    // Loops the map places after the last frame have no frame to find
+    auto lastLoop = truth.empty() ? std::nullopt : map.loop_at_seq(truth.rbegin()->first);
+
+    for (const auto& [seq, loop] : truth)
+    {
+        auto got = map.loop_at_seq(seq);
+        if (got.has_value() != loop.has_value())
+        {
+            if (failures++ < 10)
+                printf("FAIL seq %llu -> %s, expected %s\n", (unsigned long long)seq, got ? "a loop" : "none",
+                       loop ? "a loop" : "none");
+            continue;
+        }
+        if (!loop)
+            continue;
+        seqErrors.push_back(std::fabs(*got - *loop));
+        if (seqErrors.back() > maxSeqError && failures++ < 10)
+            printf("FAIL seq %llu -> loop %.1f, expected %.1f\n", (unsigned long long)seq, *got, *loop);
+
+        // The frame found for a loop must itself have shown a loop close to it
+        auto back = map.seq_at_loop(*loop);
+        if (!back && lastLoop && *loop > *lastLoop)
+            continue;
+        auto shown = back ? truth.find(*back) : truth.end();
+        if (shown == truth.end() || !shown->second)
+        {
+            if (failures++ < 10)
+                printf("FAIL loop %.1f -> no frame with a known loop\n", *loop);
+            continue;
+        }
+        loopErrors.push_back(std::fabs(*shown->second - *loop));
+        if (loopErrors.back() > maxLoopError && failures++ < 10)
+            printf("FAIL loop %.1f -> seq %llu, which showed loop %.1f\n", *loop, (unsigned long long)*back,
+                   *shown->second);
+    }
+
+    print_errors("seq -> loop", seqErrors, maxSeqError);
+    print_errors("loop -> seq", loopErrors, maxLoopError);
+    printf("%zu frames expected, %zu failures\n", truth.size(), failures);
+    return !truth.empty() && failures == 0;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+        return usage();
+
+    AlignmentMap map;
+
+    if (!map.load(argv[1]))
+    {
+        fprintf(stderr, "cannot read %s\n", argv[1]);
+        return 1;
+    }
+
+    printf("frame_knots=%zu loop_knots=%zu rejected=%llu\n", map.frames().knots().size(), map.loops().knots().size(),
+           (unsigned long long)map.rejected());
+
+    for (int i = 2; i < argc; ++i)
+    {
+        std::string a = argv[i];
+
+        if (i + 1 >= argc)
+            return usage();
+
+        if (a == "--seq")
+        {
+            uint64_t seq = std::strtoull(argv[++i], nullptr, 10);
+            auto loop = map.loop_at_seq(seq);
+            if (loop)
+                printf("seq %llu -> loop %.1f\n", (unsigned long long)seq, *loop);
+            else
+                printf("seq %llu -> none\n", (unsigned long long)seq);
+        }
+        else if (a == "--loop")
+        {
+            double loop = std::atof(argv[++i]);
+            auto seq = map.seq_at_loop(loop);
+            if (seq)
+                printf("loop %.1f -> seq %llu\n", loop, (unsigned long long)*seq);
+            else
+                printf("loop %.1f -> none\n", loop);
+        }
+        else if (a == "--expect")
+        {
+            if (!check_expected(map, argv[++i]))
+                return 1;
+        }
+        else if (a == "--out")
+        {
+            if (!map.save(argv[++i]))
+            {
+                fprintf(stderr, "cannot write %s\n", argv[i]);
+                return 1;
+            }
+        }
+        else
+            return usage();
+    }
+
+    return 0;
+}
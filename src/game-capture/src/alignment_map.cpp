@@ -0,0 +1,288 @@
+#include "alignment_map.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+namespace fs = std::filesystem;
+
+static FILE* open_file(const fs::path& p, const char* mode)
+{
+#ifdef _WIN32
+    std::wstring wmode(mode, mode + strlen(mode));
+    return _wfopen(p.wstring().c_str(), wmode.c_str());
+#else
+    return fopen(p.c_str(), mode);
+#endif
+}
+
+bool PiecewiseLinear::append(int64_t x, double y)
+{
+    if (knots_.empty())
+    {
+        knots_.push_back({x, y});
+        return true;
+    }
+
+    if (x <= knots_.back().x)
+        return false;
+
+    // Extend the open segment while one slope still fits every point in it
+    if (open_)
+    {
+        const Knot& s = knots_[knots_.size() - 2];
+        double dx = static_cast<double>(x - s.x);
+        double lo = std::max(lo_, (y - tol_ - s.y) / dx);
+        double hi = std::min(hi_, (y + tol_ - s.y) / dx);
+
+        if (lo <= hi)
+        {
+            lo_ = lo;
+            hi_ = hi;
+            knots_.back() = {x, s.y + std::clamp((y - s.y) / dx, lo, hi) * dx};
+            return true;
+        }
+    }
+
+    // Otherwise the provisional knot becomes fixed and a new segment starts from it
+    const Knot& s = knots_.back();
+
+    if (y + tol_ < s.y)
+        return false;
+
+    open_segment(x, y);
+    return true;
+}
+
+void PiecewiseLinear::open_segment(int64_t x, double y)
+{
+    const Knot s = knots_.back();
+    double dx = static_cast<double>(x - s.x);
+
+    lo_ = std::max(0.0, (y - tol_ - s.y) / dx);
+    hi_ = (y + tol_ - s.y) / dx;
+    knots_.push_back({x, s.y + std::clamp((y - s.y) / dx, lo_, hi_) * dx});
+    open_ = true;
+}
+
+std::optional<double> PiecewiseLinear::at(int64_t x) const
+{
+    if (knots_.empty() || x < knots_.front().x || x > knots_.back().x)
+        return std::nullopt;
+
+    auto it = std::upper_bound(knots_.begin(), knots_.end(), x, [](int64_t v, const Knot& k) { return v < k.x; });
+
+    if (it == knots_.end())
+        return knots_.back().y;
+
+    const Knot& a = *(it - 1);
+    const Knot& b = *it;
+    return a.y + (b.y - a.y) * static_cast<double>(x - a.x) / static_cast<double>(b.x - a.x);
+}
+
+std::optional<double> PiecewiseLinear::inverse(double y) const
+{
+    if (knots_.empty() || y < knots_.front().y || y > knots_.back().y)
+        return std::nullopt;
+
+    auto it = std::lower_bound(knots_.begin(), knots_.end(), y, [](const Knot& k, double v) { return k.y < v; });
+
+    if (it == knots_.begin())
+        return static_cast<double>(it->x);
+
+    const Knot& a = *(it - 1);
+    const Knot& b = *it;
+    return static_cast<double>(a.x) + (y - a.y) / (b.y - a.y) * static_cast<double>(b.x - a.x);
+}
+
+AlignmentMap::AlignmentMap() : AlignmentMap(Config{}) {}
+
+AlignmentMap::AlignmentMap(Config cfg) : cfg_(cfg), frames_(cfg.frameToleranceTicks), loops_(cfg.loopTolerance) {}
+
+void AlignmentMap::add_frame(uint64_t seq, int64_t ticks)
+{
+    if (frames_.append(static_cast<int64_t>(seq), static_cast<double>(ticks)))
+        ++revision_;
+}
+
+bool AlignmentMap::mark_start(int64_t ticks)
+{
+    loops_ = PiecewiseLinear(cfg_.loopTolerance);
+    return add_reading_at(ticks, 0.0);
+}
+
+bool AlignmentMap::add_reading(uint64_t seq, double loop)
+{
+    auto ticks = ticks_at_seq(seq);
+
+    if (!ticks)
+    {
+        ++rejected_;
+        return false;
+    }
+
+    return add_reading_at(*ticks, loop);
+}
+
+bool AlignmentMap::add_reading_at(int64_t ticks, double loop)
+{
+    if (!loops_.empty())
+    {
+        const auto& last = loops_.knots().back();
+        double seconds = static_cast<double>(ticks - last.x) / kTicksPerSecond;
+
+        if (loop > last.y + seconds * kLoopsPerSecond * kMaxPlaybackSpeed + cfg_.loopTolerance)
+        {
+            ++rejected_;
+            return false;
+        }
+    }
+
+    if (loop < 0.0 || !loops_.append(ticks, loop))
+    {
+        ++rejected_;
+        return false;
+    }
+
+    ++revision_;
+    return true;
+}
+
+std::optional<int64_t> AlignmentMap::ticks_at_seq(uint64_t seq) const
+{
+    auto t = frames_.at(static_cast<int64_t>(seq));
+    if (!t)
+        return std::nullopt;
+    return std::llround(*t);
+}
+
+std::optional<double> AlignmentMap::loop_at_ticks(int64_t ticks) const
+{
+    if (loops_.empty() || ticks < loops_.knots().front().x)
+        return std::nullopt;
+
+    const auto& last = loops_.knots().back();
+    double loop = ticks <= last.x ? *loops_.at(ticks)
+                                  : last.y + static_cast<double>(ticks - last.x) * kLoopsPerSecond / kTicksPerSecond;
+
+    if (endLoop_ && loop > static_cast<double>(*endLoop_))
+        return std::nullopt;
+
+    return loop;
+}
+
+std::optional<double> AlignmentMap::loop_at_seq(uint64_t seq) const
+{
+    auto ticks = ticks_at_seq(seq);
+    return ticks ? loop_at_ticks(*ticks) : std::nullopt;
+}
+
+std::optional<uint64_t> AlignmentMap::seq_at_loop(double loop) const
+{
+    if (loops_.empty() || (endLoop_ && loop > static_cast<double>(*endLoop_)))
+        return std::nullopt;
+
+    const auto& last = loops_.knots().back();
+    std::optional<double> ticks =
+        loop <= last.y ? loops_.inverse(loop)
+                       : static_cast<double>(last.x) + (loop - last.y) / kLoopsPerSecond * kTicksPerSecond;
+
+    if (!ticks)
+        return std::nullopt;
+
+    // Nearest frame: the fit is monotone, so invert it at the tick and round the fractional sequence
+    const auto& knots = frames_.knots();
+    if (knots.empty() || *ticks < knots.front().y - cfg_.frameToleranceTicks ||
+        *ticks > knots.back().y + cfg_.frameToleranceTicks)
+        return std::nullopt;
+
+    auto seq = frames_.inverse(std::clamp(*ticks, knots.front().y, knots.back().y));
+    if (!seq)
+        return std::nullopt;
+
+    return static_cast<uint64_t>(std::llround(*seq));
+}
+
+std::string AlignmentMap::serialize() const
+{
+    std::string out = "# hots alignment v1\n";
+    char line[96];
+
+    if (endLoop_)
+    {
+        snprintf(line, sizeof(line), "end_loop %" PRIu64 "\n", *endLoop_);
+        out += line;
+    }
+
+    for (const auto& k : frames_.knots())
+    {
+        snprintf(line, sizeof(line), "frame %" PRId64 " %lld\n", k.x, std::llround(k.y));
+        out += line;
+    }
+
+    for (const auto& k : loops_.knots())
+    {
+        snprintf(line, sizeof(line), "loop %" PRId64 " %.3f\n", k.x, k.y);
+        out += line;
+    }
+
+    return out;
+}
+
+bool AlignmentMap::save(const fs::path& p) const
+{
+    std::string text = serialize();
+    auto tmp = p;
+    tmp += ".tmp";
+
+    FILE* f = open_file(tmp, "wb");
+    if (!f)
+        return false;
+
+    bool ok = fwrite(text.data(), 1, text.size(), f) == text.size();
+    ok = fclose(f) == 0 && ok;
+
+    std::error_code ec;
+    if (ok)
+        fs::rename(tmp, p, ec);
+    if (!ok || ec)
+    {
+        fs::remove(tmp, ec);
+        return false;
+    }
+
+    return true;
+}
+
+bool AlignmentMap::load(const fs::path& p)
+{
+    FILE* f = open_file(p, "rb");
+    if (!f)
+        return false;
+
+    char line[256];
+
+    while (fgets(line, sizeof(line), f))
+    {
+        long long a = 0;
+        double b = 0.0;
+        unsigned long long u = 0;
+
+        if (sscanf(line, "frame %lld %lf", &a, &b) == 2)
+            add_frame(static_cast<uint64_t>(a), std::llround(b));
+        else if (sscanf(line, "loop %lld %lf", &a, &b) == 2)
+            add_reading_at(a, b);
+        else if (sscanf(line, "reading %lld %lf", &a, &b) == 2)
+            add_reading(static_cast<uint64_t>(a), b);
+        else if (sscanf(line, "start %lld", &a) == 1)
+            mark_start(a);
+        else if (sscanf(line, "end_loop %llu", &u) == 1)
+            set_end_loop(u);
+    }
+
+    bool ok = !ferror(f);
+    fclose(f);
+    return ok;
+}
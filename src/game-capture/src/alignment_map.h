@@ -0,0 +1,115 @@
+// Maps captured frames to replay game loops, so detections can be lined up with replay events.
+//
+// Two monotone piecewise-linear functions are built as frames are written:
+//   frames: seq   -> capture time (SystemRelativeTime, 100 ns ticks), one point per saved frame
+//   loops:  ticks -> game loop, from the replay start (loop 0) and in-game timer readings
+// Each keeps only the knots needed to stay within a tolerance of every point it was given (a "swing door" fit: the
+// open segment keeps the range of slopes that satisfies all of its points and is closed when that range is empty),
+// so a steady 1 fps session or a replay playing at constant speed costs a handful of knots. Lookups in either
+// direction are a binary search over knots.
+//
+// Past the last loop knot, up to the replay's last loop, game time is taken to advance at the nominal 16 loops per
+// second. Frames before the replay start have no game loop.
+//
+// Persisted form (text, one knot per line, rewritten atomically):
+//   # hots alignment v1
+//   end_loop <loop>
+//   frame <seq> <ticks>
+//   loop <ticks> <loop>
+// load() replays any file in that grammar, plus "start <ticks>" and "reading <seq> <loop>" lines, through the same
+// fitting code, so a recording of raw inputs loads the same way as a saved map.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Nondecreasing y(x), appended in increasing x and kept within `tolerance` of every appended point.
+class PiecewiseLinear
+{
+public:
+    struct Knot
+    {
+        int64_t x = 0;
+        double y = 0.0;
+    };
+
+    explicit PiecewiseLinear(double tolerance) : tol_(tolerance) {}
+
+    // False (and nothing changes) if x does not increase or y falls more than the tolerance below the fit.
+    bool append(int64_t x, double y);
+
+    // Interpolated value inside [first knot, last knot].
+    std::optional<double> at(int64_t x) const;
+    // Smallest x inside the knot range where the fit reaches y.
+    std::optional<double> inverse(double y) const;
+
+    const std::vector<Knot>& knots() const { return knots_; }
+    bool empty() const { return knots_.empty(); }
+
+private:
+    void open_segment(int64_t x, double y);
+
+    double tol_;
+    std::vector<Knot> knots_;  // the last knot is provisional while its segment is open
+    bool open_ = false;        // knots_.back() ends a segment that may still be extended
+    double lo_ = 0.0;          // feasible slope range of the open segment
+    double hi_ = 0.0;
+};
+
+class AlignmentMap
+{
+public:
+    static constexpr int64_t kTicksPerSecond = 10'000'000;
+    static constexpr double kLoopsPerSecond = 16.0;
+    static constexpr double kMaxPlaybackSpeed = 8.0;  // the replay UI goes up to 8x; faster timer jumps are misreads
+
+    struct Config
+    {
+        double frameToleranceTicks = kTicksPerSecond / 60.0;  // a compositor frame at 60 Hz
+        double loopTolerance = kLoopsPerSecond;               // the in-game timer shows whole seconds
+    };
+
+    AlignmentMap();
+    explicit AlignmentMap(Config cfg);
+
+    void add_frame(uint64_t seq, int64_t ticks);
+
+    // Game loop 0 was on screen at `ticks`. A later start (the replay was restarted) discards the loop knots.
+    bool mark_start(int64_t ticks);
+    // The in-game timer read `loop` on frame `seq` (or at `ticks`). False if the reading contradicts the map: earlier
+    // than its last knot, running backwards, or faster than kMaxPlaybackSpeed.
+    bool add_reading(uint64_t seq, double loop);
+    bool add_reading_at(int64_t ticks, double loop);
+
+    // Last loop of the replay (its header's elapsed game loops); later capture time maps to no loop.
+    void set_end_loop(uint64_t loop) { endLoop_ = loop; }
+
+    std::optional<int64_t> ticks_at_seq(uint64_t seq) const;
+    std::optional<double> loop_at_ticks(int64_t ticks) const;
+    std::optional<double> loop_at_seq(uint64_t seq) const;
+    // Frame closest to where the replay showed `loop`.
+    std::optional<uint64_t> seq_at_loop(double loop) const;
+
+    const PiecewiseLinear& frames() const { return frames_; }
+    const PiecewiseLinear& loops() const { return loops_; }
+    uint64_t rejected() const { return rejected_; }
+    // Bumped by every accepted input; lets the writer skip unchanged maps.
+    uint64_t revision() const { return revision_; }
+
+    std::string serialize() const;
+    bool save(const std::filesystem::path& p) const;  // temp file + rename
+    // Replays `p` line by line. Returns false if it cannot be read; unknown lines are skipped.
+    bool load(const std::filesystem::path& p);
+
+private:
+    Config cfg_;
+    PiecewiseLinear frames_;
+    PiecewiseLinear loops_;
+    std::optional<uint64_t> endLoop_;
+    uint64_t rejected_ = 0;
+    uint64_t revision_ = 0;
+};
@@ -0,0 +1,483 @@
+#include "async.h"
+
+#include "log.h"
+
+#include <algorithm>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+namespace detail
+{
+bool WaitState::complete(WaitResult r)
+{
+    int expected = kPending;
+
+    if (!result.compare_exchange_strong(expected, static_cast<int>(r), std::memory_order_acq_rel))
+        return false;
+
+    reactor->post(handle);
+    return true;
+}
+
+WaitAwaiterBase::WaitAwaiterBase(Reactor& reactor, std::stop_token stop)
+    : state_(std::make_shared<WaitState>()), stop_(std::move(stop))
+{
+    state_->reactor = &reactor;
+}
+
+void WaitAwaiterBase::arm(std::coroutine_handle<> h)
+{
+    state_->handle = h;
+
+    // May complete immediately if stop was already requested; the resume is still deferred to the reactor loop
+    if (stop_.stop_possible())
+        onStop_.emplace(stop_, Cancel{state_});
+}
+}  // namespace detail
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+void AsyncEvent::set()
+{
+    std::shared_ptr<detail::WaitState> waiter;
+    {
+        std::lock_guard<std::mutex> lock(m_);
+        if (waiter_ && !waiter_->done())
+            waiter = std::move(waiter_);
+        else
+            signaled_ = true;
+        waiter_.reset();
+    }
+
+    if (waiter && !waiter->complete(WaitResult::Signaled))
+    {
+        // Lost the race to a timeout/cancel: keep the signal for the next wait
+        std::lock_guard<std::mutex> lock(m_);
+        signaled_ = true;
+    }
+}
+
+bool AsyncEvent::Awaiter::await_ready() noexcept
+{
+    std::lock_guard<std::mutex> lock(ev_.m_);
+
+    if (!ev_.signaled_)
+        return false;
+
+    ev_.signaled_ = false;
+    state_->result = static_cast<int>(WaitResult::Signaled);
+    return true;
+}
+
+void AsyncEvent::Awaiter::await_suspend(std::coroutine_handle<> h)
+{
+    state_->handle = h;
+    {
+        std::lock_guard<std::mutex> lock(ev_.m_);
+        ev_.waiter_ = state_;
+    }
+
+    if (deadline_)
+        state_->reactor->add_timer(*deadline_, state_);
+
+    arm(h);
+}
+
+WaitResult AsyncEvent::Awaiter::await_resume() noexcept
+{
+    std::lock_guard<std::mutex> lock(ev_.m_);
+
+    if (ev_.waiter_ == state_)
+        ev_.waiter_.reset();
+
+    return static_cast<WaitResult>(state_->result.load());
+}
+
+Task<> JoinHandle::join(Reactor& reactor)
+{
+    while (state_ && !state_->finished.load())
+        co_await state_->done.wait(reactor);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+namespace
+{
+// Fire-and-forget driver owning a spawned Task for its whole life.
+struct Detached
+{
+    struct promise_type
+    {
+        Detached get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+};
+
+Detached drive(Task<> task, const char* name, std::shared_ptr<JoinHandle::State> state, size_t* live)
+{
+    try
+    {
+        co_await task;
+    }
+    catch (const std::exception& e)
+    {
+        log_event<Ev::TaskFailed>(name, e.what());
+    }
+    catch (...)
+    {
+        log_event<Ev::TaskFailed>(name, "unknown");
+    }
+
+    --*live;
+    state->finished = true;
+    state->done.set();
+}
+}  // namespace
+
+JoinHandle Reactor::spawn(Task<> task, const char* name)
+{
+    auto state = std::make_shared<JoinHandle::State>();
+    ++live_;
+    drive(std::move(task), name, state, &live_);
+    return JoinHandle(std::move(state));
+}
+
+void Reactor::post(std::coroutine_handle<> h)
+{
+    bool wasEmpty;
+    {
+        std::lock_guard<std::mutex> lock(postM_);
+        wasEmpty = posted_.empty();
+        posted_.push_back(h);
+    }
+
+    // A non-empty queue already has a wake-up outstanding
+    if (wasEmpty)
+        signal_os();
+}
+
+void Reactor::add_timer(Clock::time_point deadline, std::shared_ptr<detail::WaitState> state)
+{
+    timers_.push(Timer{deadline, std::move(state)});
+}
+
+void Reactor::drain_posted()
+{
+    std::vector<std::coroutine_handle<>> batch;
+
+    while (true)
+    {
+        {
+            std::lock_guard<std::mutex> lock(postM_);
+            batch.swap(posted_);
+        }
+
+        if (batch.empty())
+            return;
+
+        for (auto h : batch)
+            h.resume();
+
+        batch.clear();
+    }
+}
+
+void Reactor::fire_timers()
+{
+    auto now = Clock::now();
+
+    while (!timers_.empty() && (timers_.top().deadline <= now || timers_.top().state->done()))
+    {
+        auto state = timers_.top().state;
+        timers_.pop();
+        state->complete(WaitResult::Timeout);
+    }
+}
+
+void Reactor::run()
+{
+    while (true)
+    {
+        drain_posted();
+        fire_timers();
+
+        {
+            std::lock_guard<std::mutex> lock(postM_);
+            if (!posted_.empty())
+                continue;
+        }
+
+        if (live_ == 0)
+            return;
+
+        std::chrono::milliseconds timeout{-1};
+
+        if (!timers_.empty())
+        {
+            auto wait = timers_.top().deadline - Clock::now();
+            // Round up so we never wake just before the deadline and spin
+            timeout = std::max(std::chrono::milliseconds(0),
+                               std::chrono::ceil<std::chrono::milliseconds>(wait));
+        }
+
+        wait_os(timeout);
+        wakeups_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void Reactor::SleepAwaiter::await_suspend(std::coroutine_handle<> h)
+{
+    reactor_.add_timer(deadline_, state_);
+    arm(h);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+#ifdef _WIN32
+
+static constexpr ULONG_PTR kWakeKey = 1;
+static constexpr ULONG_PTR kIoKey = 2;
+
+Reactor::Reactor()
+{
+    iocp_ = CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 1);
+}
+
+Reactor::~Reactor()
+{
+    if (iocp_)
+        CloseHandle(iocp_);
+}
+
+void Reactor::signal_os()
+{
+    PostQueuedCompletionStatus(iocp_, 0, kWakeKey, nullptr);
+}
+
+void Reactor::wait_os(std::chrono::milliseconds timeout)
+{
+    OVERLAPPED_ENTRY entries[16];
+    ULONG n = 0;
+    DWORD ms = timeout.count() < 0 ? INFINITE : static_cast<DWORD>(timeout.count());
+
+    if (!GetQueuedCompletionStatusEx(iocp_, entries, 16, &n, ms, FALSE))
+        return;
+
+    for (ULONG i = 0; i < n; ++i)
+    {
+        if (entries[i].lpCompletionKey != kIoKey || !entries[i].lpOverlapped)
+            continue;
+
+        auto* op = static_cast<IoAwaiter::Op*>(entries[i].lpOverlapped);
+        DWORD bytes = 0;
+        IoResult r;
+        // Translate the NTSTATUS in Internal to a Win32 error the same way GetOverlappedResult does
+        if (!GetOverlappedResult(op->owner->h_, op, &bytes, FALSE))
+            r.error = GetLastError();
+        r.bytes = entries[i].dwNumberOfBytesTransferred;
+        op->owner->result_ = r;
+        op->handle.resume();
+    }
+}
+
+bool Reactor::associate(HANDLE h)
+{
+    return CreateIoCompletionPort(h, iocp_, kIoKey, 0) == iocp_;
+}
+
+bool Reactor::IoAwaiter::await_suspend(std::coroutine_handle<> h)
+{
+    op_.handle = h;
+    op_.owner = this;
+
+    if (!start_(&op_))
+    {
+        DWORD err = GetLastError();
+
+        if (err != ERROR_IO_PENDING)
+        {
+            result_.error = err;
+            return false;
+        }
+    }
+
+    if (stop_.stop_possible())
+        onStop_.emplace(stop_, Cancel{h_, &op_});
+
+    return true;
+}
+
+static void CALLBACK on_process_exit(PVOID ctx, BOOLEAN /*timedOut*/)
+{
+    static_cast<detail::WaitState*>(ctx)->complete(WaitResult::Signaled);
+}
+
+void Reactor::ProcessExitAwaiter::await_suspend(std::coroutine_handle<> h)
+{
+    registered_ = state_;
+    state_->handle = h;
+
+    if (!RegisterWaitForSingleObject(&wait_, process_, on_process_exit, registered_.get(), INFINITE,
+                                     WT_EXECUTEONLYONCE))
+    {
+        wait_ = nullptr;
+        state_->complete(WaitResult::Signaled);  // treat an unwaitable handle as exited
+    }
+
+    arm(h);
+}
+
+Reactor::ProcessExitAwaiter::~ProcessExitAwaiter()
+{
+    // INVALID_HANDLE_VALUE waits for an in-flight callback, after which `registered_` may be released
+    if (wait_)
+        UnregisterWaitEx(wait_, INVALID_HANDLE_VALUE);
+}
+
+#else
+
+Reactor::Reactor()
+{
+    if (pipe(wakePipe_) == 0)
+    {
+        for (int fd : wakePipe_)
+        {
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+            fcntl(fd, F_SETFD, FD_CLOEXEC);
+        }
+    }
+}
+
+Reactor::~Reactor()
+{
+    for (int fd : wakePipe_)
+    {
+        if (fd >= 0)
+            close(fd);
+    }
+}
+
+void Reactor::signal_os()
+{
+    char b = 1;
+    [[maybe_unused]] auto n = write(wakePipe_[1], &b, 1);
+}
+
+void Reactor::wait_os(std::chrono::milliseconds timeout)
+{
+    // Drop waits that were cancelled or timed out
+    fdWaits_.erase(std::remove_if(fdWaits_.begin(), fdWaits_.end(), [](const FdWait& w) { return w.state->done(); }),
+                   fdWaits_.end());
+
+    std::vector<pollfd> fds;
+    fds.reserve(fdWaits_.size() + 1);
+    fds.push_back({wakePipe_[0], POLLIN, 0});
+
+    for (const auto& w : fdWaits_)
+        fds.push_back({w.fd, w.events, 0});
+
+    int n = poll(fds.data(), fds.size(), static_cast<int>(timeout.count()));
+
+    if (n <= 0)
+        return;
+
+    if (fds[0].revents)
+    {
+        char buf[64];
+        while (read(wakePipe_[0], buf, sizeof(buf)) > 0)
+        {
+        }
+    }
+
+    // Complete ready waits; fds[i + 1] corresponds to fdWaits_[i]
+    std::vector<FdWait> still;
+    still.reserve(fdWaits_.size());
+
+    for (size_t i = 0; i < fdWaits_.size(); ++i)
+    {
+        if (fds[i + 1].revents)
+            fdWaits_[i].state->complete(WaitResult::Signaled);
+        else
+            still.push_back(std::move(fdWaits_[i]));
+    }
+
+    fdWaits_.swap(still);
+}
+
+void Reactor::FdAwaiter::await_suspend(std::coroutine_handle<> h)
+{
+    reactor_.fdWaits_.push_back({fd_, events_, state_});
+    arm(h);
+}
+
+Reactor::FdAwaiter Reactor::readable(int fd, std::stop_token stop)
+{
+    return FdAwaiter(*this, fd, POLLIN, std::move(stop));
+}
+
+Reactor::FdAwaiter Reactor::writable(int fd, std::stop_token stop)
+{
+    return FdAwaiter(*this, fd, POLLOUT, std::move(stop));
+}
+
+#endif
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+ThreadPool::ThreadPool(size_t workers, std::function<void()> threadInit)
+{
+    workers = std::max<size_t>(1, workers);
+
+    for (size_t i = 0; i < workers; ++i)
+    {
+        workers_.emplace_back(
+            [this, threadInit]
+            {
+                if (threadInit)
+                    threadInit();
+
+                while (true)
+                {
+                    std::coroutine_handle<> h;
+                    {
+                        std::unique_lock<std::mutex> lock(m_);
+                        cv_.wait(lock, [&] { return stop_ || !queue_.empty(); });
+                        if (queue_.empty())
+                            return;
+                        h = queue_.front();
+                        queue_.pop_front();
+                    }
+                    h.resume();
+                }
+            });
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+
+    for (auto& t : workers_)
+        t.join();
+}
+
+void ThreadPool::enqueue(std::coroutine_handle<> h)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_);
+        queue_.push_back(h);
+    }
+    cv_.notify_one();
+}
@@ -0,0 +1,490 @@
+// Minimal C++20 coroutine runtime for the capture service.
+//
+// One Reactor thread owns all waiting: timers, events (frame arrived / control commands), process exit and I/O
+// completions (IOCP on Windows, poll() readiness elsewhere). Blocking work hops onto the ThreadPool with
+// `co_await pool.schedule()` and back with `co_await reactor.schedule()`. The reactor only wakes when something is
+// due, so an idle service costs no periodic wake-ups beyond its own timers.
+//
+// Cancellation is structured through std::stop_token: every wait takes a token and completes with
+// WaitResult::Cancelled once stop is requested. Parents request stop on their children and co_await their
+// JoinHandles before returning.
+//
+// Rule: awaitables other than schedule() must be awaited on the reactor thread.
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <stop_token>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+// ---------------------------------------------------------------------------------------------------------------------
+// Task<T>: lazily started, awaited exactly once, resumes its awaiter by symmetric transfer.
+
+template <typename T = void>
+class Task;
+
+namespace detail
+{
+struct PromiseBase
+{
+    std::coroutine_handle<> continuation = std::noop_coroutine();
+    std::exception_ptr error;
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+
+    struct FinalAwaiter
+    {
+        bool await_ready() noexcept { return false; }
+        template <typename P>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<P> h) noexcept
+        {
+            return h.promise().continuation;
+        }
+        void await_resume() noexcept {}
+    };
+
+    FinalAwaiter final_suspend() noexcept { return {}; }
+    void unhandled_exception() noexcept { error = std::current_exception(); }
+};
+
+template <typename T>
+struct Promise : PromiseBase
+{
+    std::optional<T> value;
+
+    Task<T> get_return_object() noexcept;
+    template <typename U>
+    void return_value(U&& v)
+    {
+        value.emplace(std::forward<U>(v));
+    }
+    T result()
+    {
+        if (error)
+            std::rethrow_exception(error);
+        return std::move(*value);
+    }
+};
+
+template <>
+struct Promise<void> : PromiseBase
+{
+    Task<void> get_return_object() noexcept;
+    void return_void() noexcept {}
+    void result()
+    {
+        if (error)
+            std::rethrow_exception(error);
+    }
+};
+}  // namespace detail
+
+template <typename T>
+class [[nodiscard]] Task
+{
+public:
+    using promise_type = detail::Promise<T>;
+    using Handle = std::coroutine_handle<promise_type>;
+
+    Task() = default;
+    explicit Task(Handle h) : h_(h) {}
+    Task(Task&& o) noexcept : h_(std::exchange(o.h_, {})) {}
+    Task& operator=(Task&& o) noexcept
+    {
+        if (this != &o)
+        {
+            if (h_)
+                h_.destroy();
+            h_ = std::exchange(o.h_, {});
+        }
+        return *this;
+    }
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+    ~Task()
+    {
+        if (h_)
+            h_.destroy();
+    }
+
+    bool await_ready() const noexcept { return !h_ || h_.done(); }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiter) noexcept
+    {
+        h_.promise().continuation = awaiter;
+        return h_;
+    }
+    T await_resume() { return h_.promise().result(); }
+
+private:
+    Handle h_;
+};
+
+namespace detail
+{
+template <typename T>
+Task<T> Promise<T>::get_return_object() noexcept
+{
+    return Task<T>{std::coroutine_handle<Promise<T>>::from_promise(*this)};
+}
+
+inline Task<void> Promise<void>::get_return_object() noexcept
+{
+    return Task<void>{std::coroutine_handle<Promise<void>>::from_promise(*this)};
+}
+}  // namespace detail
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+enum class WaitResult
+{
+    Signaled,
+    Timeout,
+    Cancelled
+};
+
+class Reactor;
+
+namespace detail
+{
+// One suspended wait. Several sources (timer, event, stop token, OS callback) may race to complete it; the first
+// compare-exchange on `result` wins and posts the coroutine back to the reactor.
+struct WaitState
+{
+    static constexpr int kPending = -1;
+
+    Reactor* reactor = nullptr;
+    std::coroutine_handle<> handle;
+    std::atomic<int> result{kPending};
+
+    bool complete(WaitResult r);
+    bool done() const { return result.load(std::memory_order_acquire) != kPending; }
+};
+
+// Shared scaffolding for the reactor's awaitables: stop-token cancellation plus the WaitState.
+class WaitAwaiterBase
+{
+public:
+    WaitAwaiterBase(Reactor& reactor, std::stop_token stop);
+
+    bool await_ready() const noexcept { return false; }
+    WaitResult await_resume() noexcept { return static_cast<WaitResult>(state_->result.load()); }
+
+protected:
+    void arm(std::coroutine_handle<> h);
+
+    std::shared_ptr<WaitState> state_;
+    std::stop_token stop_;
+
+private:
+    struct Cancel
+    {
+        std::shared_ptr<WaitState> state;
+        void operator()() const { state->complete(WaitResult::Cancelled); }
+    };
+
+    std::optional<std::stop_callback<Cancel>> onStop_;
+};
+}  // namespace detail
+
+// Auto-reset event with a single waiter. set() may be called from any thread (e.g. the WGC FrameArrived callback).
+class AsyncEvent
+{
+public:
+    void set();
+
+    class Awaiter : public detail::WaitAwaiterBase
+    {
+    public:
+        Awaiter(AsyncEvent& ev, Reactor& reactor, std::optional<std::chrono::steady_clock::time_point> deadline,
+                std::stop_token stop)
+            : WaitAwaiterBase(reactor, std::move(stop)), ev_(ev), deadline_(deadline)
+        {
+        }
+
+        bool await_ready() noexcept;
+        void await_suspend(std::coroutine_handle<> h);
+        WaitResult await_resume() noexcept;
+
+    private:
+        AsyncEvent& ev_;
+        std::optional<std::chrono::steady_clock::time_point> deadline_;
+    };
+
+    Awaiter wait(Reactor& reactor, std::stop_token stop = {}) { return Awaiter(*this, reactor, std::nullopt, stop); }
+    Awaiter wait_until(Reactor& reactor, std::chrono::steady_clock::time_point deadline, std::stop_token stop = {})
+    {
+        return Awaiter(*this, reactor, deadline, stop);
+    }
+
+private:
+    std::mutex m_;
+    bool signaled_ = false;
+    std::shared_ptr<detail::WaitState> waiter_;
+};
+
+// Completion of a spawned task; co_await join() for structured shutdown.
+class JoinHandle
+{
+public:
+    struct State
+    {
+        std::atomic<bool> finished{false};
+        AsyncEvent done;
+    };
+
+    JoinHandle() = default;
+    explicit JoinHandle(std::shared_ptr<State> s) : state_(std::move(s)) {}
+
+    bool finished() const { return !state_ || state_->finished.load(); }
+    Task<> join(Reactor& reactor);
+
+private:
+    std::shared_ptr<State> state_;
+};
+
+class Reactor
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    Reactor();
+    ~Reactor();
+
+    Reactor(const Reactor&) = delete;
+    Reactor& operator=(const Reactor&) = delete;
+
+    // Starts `task` immediately (on the calling thread until its first suspension) and keeps run() alive until it
+    // finishes. Exceptions escaping the task are logged.
+    JoinHandle spawn(Task<> task, const char* name);
+
+    // Runs the loop on the calling thread until every spawned task has finished.
+    void run();
+
+    // Thread-safe: resume `h` on the reactor thread.
+    void post(std::coroutine_handle<> h);
+
+    // Number of times the loop returned from the OS wait (idle cost metric).
+    uint64_t wakeups() const { return wakeups_.load(std::memory_order_relaxed); }
+
+    // co_await reactor.schedule(): continue on the reactor thread (e.g. after work on the ThreadPool).
+    auto schedule()
+    {
+        struct Awaiter
+        {
+            Reactor& r;
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> h) { r.post(h); }
+            void await_resume() const noexcept {}
+        };
+        return Awaiter{*this};
+    }
+
+    class SleepAwaiter : public detail::WaitAwaiterBase
+    {
+    public:
+        SleepAwaiter(Reactor& r, Clock::time_point deadline, std::stop_token stop)
+            : WaitAwaiterBase(r, std::move(stop)), reactor_(r), deadline_(deadline)
+        {
+        }
+        void await_suspend(std::coroutine_handle<> h);
+
+    private:
+        Reactor& reactor_;
+        Clock::time_point deadline_;
+    };
+
+    // Completes with Timeout at the deadline, or Cancelled.
+    SleepAwaiter sleep_until(Clock::time_point deadline, std::stop_token stop = {})
+    {
+        return SleepAwaiter(*this, deadline, stop);
+    }
+    SleepAwaiter sleep_for(Clock::duration d, std::stop_token stop = {})
+    {
+        return SleepAwaiter(*this, Clock::now() + d, stop);
+    }
+
+#ifdef _WIN32
+    class ProcessExitAwaiter : public detail::WaitAwaiterBase
+    {
+    public:
+        ProcessExitAwaiter(Reactor& r, HANDLE process, std::stop_token stop)
+            : WaitAwaiterBase(r, std::move(stop)), process_(process)
+        {
+        }
+        ~ProcessExitAwaiter();
+        void await_suspend(std::coroutine_handle<> h);
+
+    private:
+        HANDLE process_;
+        HANDLE wait_ = nullptr;
+        std::shared_ptr<detail::WaitState> registered_;
+    };
+
+    // Completes with Signaled when `process` (opened with SYNCHRONIZE) exits, or Cancelled.
+    ProcessExitAwaiter process_exit(HANDLE process, std::stop_token stop = {})
+    {
+        return ProcessExitAwaiter(*this, process, stop);
+    }
+
+    // Associates an overlapped handle with the reactor's completion port.
+    bool associate(HANDLE h);
+
+    struct IoResult
+    {
+        DWORD error = ERROR_SUCCESS;
+        DWORD bytes = 0;
+    };
+
+    // Overlapped I/O completion. `start` issues the call with the supplied OVERLAPPED and returns its BOOL result;
+    // stop requests CancelIoEx the operation, which then completes with ERROR_OPERATION_ABORTED.
+    class IoAwaiter
+    {
+    public:
+        IoAwaiter(HANDLE h, std::function<BOOL(OVERLAPPED*)> start, std::stop_token stop)
+            : h_(h), start_(std::move(start)), stop_(std::move(stop))
+        {
+        }
+
+        bool await_ready() const noexcept { return false; }
+        // Returns false (no suspension) when the call failed synchronously and no completion packet will follow
+        bool await_suspend(std::coroutine_handle<> h);
+        IoResult await_resume() noexcept { return result_; }
+
+        // Filled by the reactor when the completion packet arrives
+        struct Op : OVERLAPPED
+        {
+            std::coroutine_handle<> handle;
+            IoAwaiter* owner;
+        };
+
+    private:
+        friend class Reactor;
+
+        struct Cancel
+        {
+            HANDLE h;
+            OVERLAPPED* ov;
+            void operator()() const { CancelIoEx(h, ov); }
+        };
+
+        HANDLE h_;
+        std::function<BOOL(OVERLAPPED*)> start_;
+        std::stop_token stop_;
+        Op op_{};
+        IoResult result_{};
+        std::optional<std::stop_callback<Cancel>> onStop_;
+    };
+
+    IoAwaiter io(HANDLE h, std::function<BOOL(OVERLAPPED*)> start, std::stop_token stop = {})
+    {
+        return IoAwaiter(h, std::move(start), std::move(stop));
+    }
+#else
+    class FdAwaiter : public detail::WaitAwaiterBase
+    {
+    public:
+        FdAwaiter(Reactor& r, int fd, short events, std::stop_token stop)
+            : WaitAwaiterBase(r, std::move(stop)), reactor_(r), fd_(fd), events_(events)
+        {
+        }
+        void await_suspend(std::coroutine_handle<> h);
+
+    private:
+        Reactor& reactor_;
+        int fd_;
+        short events_;
+    };
+
+    // Readiness of a non-blocking descriptor: Signaled when readable/writable (or hung up), or Cancelled.
+    FdAwaiter readable(int fd, std::stop_token stop = {});
+    FdAwaiter writable(int fd, std::stop_token stop = {});
+#endif
+
+    // Reactor thread only: completes `state` with Timeout at `deadline` unless something else completes it first.
+    void add_timer(Clock::time_point deadline, std::shared_ptr<detail::WaitState> state);
+
+private:
+    struct Timer
+    {
+        Clock::time_point deadline;
+        std::shared_ptr<detail::WaitState> state;
+        bool operator>(const Timer& o) const { return deadline > o.deadline; }
+    };
+
+    void drain_posted();
+    void fire_timers();
+    // Blocks in the OS until a post, an I/O event or `timeout` (negative = infinite).
+    void wait_os(std::chrono::milliseconds timeout);
+    void signal_os();
+
+    std::mutex postM_;
+    std::vector<std::coroutine_handle<>> posted_;
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> timers_;
+    size_t live_ = 0;
+    std::atomic<uint64_t> wakeups_{0};
+
+#ifdef _WIN32
+    HANDLE iocp_ = nullptr;
+#else
+    struct FdWait
+    {
+        int fd;
+        short events;
+        std::shared_ptr<detail::WaitState> state;
+    };
+    std::vector<FdWait> fdWaits_;
+    int wakePipe_[2] = {-1, -1};
+#endif
+};
+
+// Fixed worker pool for blocking work (BMP encode/write, fsync).
+class ThreadPool
+{
+public:
+    // `threadInit`, if set, runs first on every worker thread (e.g. to pin it to a set of CPUs).
+    explicit ThreadPool(size_t workers, std::function<void()> threadInit = {});
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // co_await pool.schedule(): continue on a worker thread.
+    auto schedule()
+    {
+        struct Awaiter
+        {
+            ThreadPool& p;
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> h) { p.enqueue(h); }
+            void await_resume() const noexcept {}
+        };
+        return Awaiter{*this};
+    }
+
+    size_t size() const { return workers_.size(); }
+
+private:
+    void enqueue(std::coroutine_handle<> h);
+
+    std::mutex m_;
+    std::condition_variable cv_;
+    std::deque<std::coroutine_handle<>> queue_;
+    bool stop_ = false;
+    std::vector<std::thread> workers_;
+};
@@ -0,0 +1,122 @@
+#include "blob_store.h"
+
+#include "fs_util.h"
+
+#include <cstdio>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+bool hash_file(const fs::path& p, Hash128& out)
+{
+#ifdef _WIN32
+    FILE* f = _wfopen(p.wstring().c_str(), L"rb");
+#else
+    FILE* f = fopen(p.c_str(), "rb");
+#endif
+
+    if (!f)
+        return false;
+
+    Hash128Builder b;
+    std::vector<unsigned char> buf(1 << 20);
+    size_t got;
+
+    while ((got = fread(buf.data(), 1, buf.size(), f)) > 0)
+        b.update(buf.data(), got);
+
+    bool ok = !ferror(f);
+    fclose(f);
+
+    if (ok)
+        out = b.finish();
+
+    return ok;
+}
+
+BlobStore::BlobStore(fs::path root) : root_(std::move(root)) {}
+
+fs::path BlobStore::blob_path(const Hash128& h, const fs::path& ext) const
+{
+    std::string hex = h.hex();
+    auto p = root_ / hex.substr(0, 2) / hex;
+    p += ext;
+    return p;
+}
+
+BlobStore::PutResult BlobStore::put(const fs::path& src, const fs::path& ref)
+{
+    PutResult r;
+
+    if (!hash_file(src, r.hash))
+        return r;
+
+    auto blob = blob_path(r.hash, src.extension() == ".part" ? ref.extension() : src.extension());
+    std::error_code ec;
+
+    std::lock_guard<std::mutex> lock(m_);
+
+    if (fs::exists(blob, ec))
+    {
+        fs::remove(src, ec);
+        r.deduplicated = true;
+    }
+    else
+    {
+        fs::create_directories(blob.parent_path(), ec);
+        fs::rename(src, blob, ec);
+
+        if (ec)
+            return r;
+
+        sync_dir(blob.parent_path());
+    }
+
+    fs::remove(ref, ec);
+    fs::create_hard_link(blob, ref, ec);
+
+    if (ec)
+    {
+        ec.clear();
+        fs::copy_file(blob, ref, ec);
+    }
+
+    if (ec)
+        return r;
+
+    sync_dir(ref.parent_path());
+    r.ok = true;
+    return r;
+}
+
+BlobStore::GcResult BlobStore::collect()
+{
+    GcResult r;
+    std::error_code ec;
+
+    std::lock_guard<std::mutex> lock(m_);
+    std::vector<std::pair<fs::path, uint64_t>> garbage;
+
+    for (const auto& e : fs::recursive_directory_iterator(root_, ec))
+    {
+        if (!e.is_regular_file(ec))
+            continue;
+
+        ++r.scanned;
+
+        // Only the store's own link left: no session references it
+        if (fs::hard_link_count(e.path(), ec) == 1 && !ec)
+            garbage.emplace_back(e.path(), e.file_size(ec));
+    }
+
+    for (const auto& [p, size] : garbage)
+    {
+        if (fs::remove(p, ec))
+        {
+            ++r.removed;
+            r.bytesFreed += size;
+        }
+    }
+
+    return r;
+}
@@ -0,0 +1,48 @@
+// Content-addressed frame storage for hots_aggregator.
+//
+// Each distinct frame file is stored once as <root>/<2 hex>/<32 hex><ext>, named by its 128-bit content hash.
+// Session directories reference blobs through hard links, so existing readers of <node>/<epoch>/frames keep
+// working and the filesystem link count is the reference count: a blob whose only link is its own store entry is
+// garbage. collect() removes those, after retention has deleted the session directories that referenced them.
+// Filesystems without hard links fall back to a copy, which stays correct but does not deduplicate.
+#pragma once
+
+#include "checksum.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+
+class BlobStore
+{
+public:
+    explicit BlobStore(std::filesystem::path root);
+
+    struct PutResult
+    {
+        bool ok = false;
+        bool deduplicated = false;  // an identical blob already existed; `src` was discarded
+        Hash128 hash;
+    };
+
+    // Moves `src` into the store (or drops it when the content is already there) and makes `ref` refer to the
+    // blob. `src` must already be durable; the blob and reference directory entries are synced here.
+    PutResult put(const std::filesystem::path& src, const std::filesystem::path& ref);
+
+    struct GcResult
+    {
+        size_t scanned = 0;
+        size_t removed = 0;
+        uint64_t bytesFreed = 0;
+    };
+    GcResult collect();
+
+    std::filesystem::path blob_path(const Hash128& h, const std::filesystem::path& ext) const;
+
+private:
+    std::filesystem::path root_;
+    std::mutex m_;  // put and collect must not interleave: collect could delete a blob put is about to link
+};
+
+// Streams `p` through Hash128Builder. Returns false if it cannot be read completely.
+bool hash_file(const std::filesystem::path& p, Hash128& out);
@@ -0,0 +1,57 @@
+#include "bmp_reader.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+bool load_bmp(const std::filesystem::path& p, BmpImage& out)
+{
+    FILE* f = fopen(p.string().c_str(), "rb");
+    if (!f)
+        return false;
+
+    std::vector<uint8_t> file;
+    uint8_t chunk[1 << 16];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0)
+        file.insert(file.end(), chunk, chunk + n);
+    fclose(f);
+
+    if (file.size() < 54 || file[0] != 'B' || file[1] != 'M')
+        return false;
+
+    auto u32 = [&](size_t at)
+    {
+        uint32_t v;
+        memcpy(&v, file.data() + at, 4);
+        return v;
+    };
+    uint32_t offset = u32(10);
+    int width = static_cast<int>(u32(18));
+    int height = static_cast<int>(u32(22));
+    int bpp = file[28] | file[29] << 8;
+    bool topDown = height < 0;
+    height = std::abs(height);
+
+    if ((bpp != 24 && bpp != 32) || width <= 0 || height == 0 || u32(30) != 0)
+        return false;
+
+    size_t srcStride = (static_cast<size_t>(width) * (bpp / 8) + 3) & ~size_t(3);
+    if (offset + srcStride * height > file.size())
+        return false;
+
+    out.width = width;
+    out.height = height;
+    out.bgra.assign(static_cast<size_t>(width) * height * 4, 255);
+
+    for (int y = 0; y < height; ++y)
+    {
+        const uint8_t* src = file.data() + offset + srcStride * (topDown ? y : height - 1 - y);
+        uint8_t* dst = out.bgra.data() + static_cast<size_t>(y) * width * 4;
+
+        for (int x = 0; x < width; ++x, src += bpp / 8, dst += 4)
+            memcpy(dst, src, 3);
+    }
+
+    return true;
+}
@@ -0,0 +1,16 @@
+// Reads back the BMPs capture writes, for the offline tools that replay saved frames.
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+struct BmpImage
+{
+    int width = 0;
+    int height = 0;
+    std::vector<uint8_t> bgra;  // top-down, tightly packed, alpha 255
+};
+
+// 24- or 32-bit uncompressed BMP (what capture writes), either row order. False if `p` is anything else.
+bool load_bmp(const std::filesystem::path& p, BmpImage& out);
@@ -0,0 +1,165 @@
+#include "checksum.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+uint32_t crc32_update(uint32_t crc, const void* data, size_t n)
+{
+    static const auto table = []
+    {
+        std::array<uint32_t, 256> t{};
+        for (uint32_t i = 0; i < 256; ++i)
+        {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k)
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t[i] = c;
+        }
+        return t;
+    }();
+
+    uint32_t c = ~crc;
+    auto* p = static_cast<const unsigned char*>(data);
+
+    for (size_t i = 0; i < n; ++i)
+        c = table[(c ^ p[i]) & 0xFF] ^ (c >> 8);
+
+    return ~c;
+}
+
+namespace
+{
+constexpr uint64_t kC1 = 0x87c37b91114253d5ull;
+constexpr uint64_t kC2 = 0x4cf5ad432745937full;
+
+inline uint64_t rotl(uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+inline uint64_t fmix(uint64_t k)
+{
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdull;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53ull;
+    k ^= k >> 33;
+    return k;
+}
+
+inline uint64_t load_le(const unsigned char* p, size_t n)
+{
+    uint64_t v = 0;
+    for (size_t i = 0; i < n; ++i)
+        v |= uint64_t(p[i]) << (8 * i);
+    return v;
+}
+}  // namespace
+
+std::string Hash128::hex() const
+{
+    static const char digits[] = "0123456789abcdef";
+    std::string s(32, '0');
+
+    for (int i = 0; i < 16; ++i)
+    {
+        s[15 - i] = digits[(lo >> (4 * i)) & 0xF];
+        s[31 - i] = digits[(hi >> (4 * i)) & 0xF];
+    }
+
+    return s;
+}
+
+void Hash128Builder::block(const unsigned char* p)
+{
+    uint64_t k1;
+    uint64_t k2;
+    memcpy(&k1, p, 8);  // little-endian hosts only, like the rest of the on-disk formats
+    memcpy(&k2, p + 8, 8);
+
+    k1 *= kC1;
+    k1 = rotl(k1, 31);
+    k1 *= kC2;
+    h1_ ^= k1;
+    h1_ = rotl(h1_, 27);
+    h1_ += h2_;
+    h1_ = h1_ * 5 + 0x52dce729;
+
+    k2 *= kC2;
+    k2 = rotl(k2, 33);
+    k2 *= kC1;
+    h2_ ^= k2;
+    h2_ = rotl(h2_, 31);
+    h2_ += h1_;
+    h2_ = h2_ * 5 + 0x38495ab5;
+}
+
+void Hash128Builder::update(const void* data, size_t n)
+{
+    auto* p = static_cast<const unsigned char*>(data);
+    total_ += n;
+
+    if (tailLen_ > 0)
+    {
+        size_t take = std::min(n, sizeof(tail_) - tailLen_);
+        memcpy(tail_ + tailLen_, p, take);
+        tailLen_ += take;
+        p += take;
+        n -= take;
+
+        if (tailLen_ < sizeof(tail_))
+            return;
+
+        block(tail_);
+        tailLen_ = 0;
+    }
+
+    for (; n >= 16; p += 16, n -= 16)
+        block(p);
+
+    memcpy(tail_, p, n);
+    tailLen_ = n;
+}
+
+Hash128 Hash128Builder::finish() const
+{
+    uint64_t h1 = h1_;
+    uint64_t h2 = h2_;
+
+    if (tailLen_ > 8)
+    {
+        uint64_t k2 = load_le(tail_ + 8, tailLen_ - 8);
+        k2 *= kC2;
+        k2 = rotl(k2, 33);
+        k2 *= kC1;
+        h2 ^= k2;
+    }
+
+    if (tailLen_ > 0)
+    {
+        uint64_t k1 = load_le(tail_, std::min<size_t>(tailLen_, 8));
+        k1 *= kC1;
+        k1 = rotl(k1, 31);
+        k1 *= kC2;
+        h1 ^= k1;
+    }
+
+    h1 ^= total_;
+    h2 ^= total_;
+    h1 += h2;
+    h2 += h1;
+    h1 = fmix(h1);
+    h2 = fmix(h2);
+    h1 += h2;
+    h2 += h1;
+
+    return Hash128{h1, h2};
+}
+
+Hash128 hash128(const void* data, size_t n)
+{
+    Hash128Builder b;
+    b.update(data, n);
+    return b.finish();
+}
@@ -0,0 +1,39 @@
+// CRC-32 (IEEE, zlib-compatible) used by the frame index and frame shipping, and the 128-bit content hash that keys
+// the aggregator's blob store (MurmurHash3 x64_128, public domain, computed incrementally).
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Continues `crc` over `data`; start with 0.
+uint32_t crc32_update(uint32_t crc, const void* data, size_t n);
+
+struct Hash128
+{
+    uint64_t lo = 0;  // h1
+    uint64_t hi = 0;  // h2
+
+    std::string hex() const;  // 32 lowercase hex digits, h1 then h2 (the usual MurmurHash3 rendering)
+    bool operator==(const Hash128&) const = default;
+};
+
+class Hash128Builder
+{
+public:
+    explicit Hash128Builder(uint64_t seed = 0) : h1_(seed), h2_(seed) {}
+
+    void update(const void* data, size_t n);
+    Hash128 finish() const;
+
+private:
+    void block(const unsigned char* p);
+
+    uint64_t h1_;
+    uint64_t h2_;
+    uint64_t total_ = 0;
+    unsigned char tail_[16];
+    size_t tailLen_ = 0;
+};
+
+Hash128 hash128(const void* data, size_t n);
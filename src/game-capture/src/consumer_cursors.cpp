@@ -0,0 +1,228 @@
+#include "consumer_cursors.h"
+
+#include "fs_util.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <random>
+
+namespace
+{
+constexpr std::string_view kExt = ".cursor";
+constexpr std::string_view kTmpExt = ".tmp";
+// A temporary file this old was left by a writer that crashed between write and rename
+constexpr auto kStaleTmp = std::chrono::minutes(1);
+
+std::filesystem::path cursor_path(const std::filesystem::path& dir, std::string_view name)
+{
+    return dir / (std::string(name) + std::string(kExt));
+}
+
+std::optional<ConsumerCursor> parse_cursor(std::string_view name, const std::string& text)
+{
+    unsigned long long seq = 0;
+    long long lease = 0, renewed = 0;
+
+    if (sscanf(text.c_str(), "seq=%llu lease_ms=%lld renewed_ms=%lld", &seq, &lease, &renewed) != 3 || lease <= 0)
+        return std::nullopt;
+
+    ConsumerCursor c;
+    c.name = name;
+    c.seq = seq;
+    c.lease = std::chrono::milliseconds(lease);
+    c.renewedUnixMs = renewed;
+    return c;
+}
+}  // namespace
+
+bool valid_consumer_name(std::string_view name)
+{
+    if (name.empty() || name.size() > 64 || name[0] == '.')
+        return false;
+
+    return std::all_of(name.begin(), name.end(),
+                       [](char c)
+                       {
+                           return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+                                  c == '.' || c == '_' || c == '-';
+                       });
+}
+
+std::optional<ConsumerCursor> read_cursor(const std::filesystem::path& dir, std::string_view name)
+{
+    std::ifstream in(cursor_path(dir, name));
+    std::string line;
+
+    if (!in || !std::getline(in, line))
+        return std::nullopt;
+
+    return parse_cursor(name, line);
+}
+
+bool write_cursor(const std::filesystem::path& dir, const ConsumerCursor& c, bool sync)
+{
+    if (!valid_consumer_name(c.name))
+        return false;
+
+    std::error_code ec;
+    std::filesystem::create_directories(dir, ec);
+
+    // Unique per writer, so a consumer restarting while its old process still runs cannot interleave with it
+    thread_local std::mt19937_64 rng{std::random_device{}()};
+    auto final = cursor_path(dir, c.name);
+    auto tmp = final;
+    std::string suffix = ".";
+    suffix += std::to_string(rng() & 0xffffffff);
+    suffix += kTmpExt;
+    tmp += suffix;
+
+    {
+        std::ofstream out(tmp, std::ios::trunc);
+        out << "seq=" << c.seq << " lease_ms=" << c.lease.count() << " renewed_ms=" << c.renewedUnixMs << "\n";
+        out.close();
+
+        if (!out || (sync && !sync_file(tmp)))
+        {
+            std::filesystem::remove(tmp, ec);
+            return false;
+        }
+    }
+
+    std::filesystem::rename(tmp, final, ec);
+
+    if (ec)
+    {
+        std::filesystem::remove(final, ec);
+        std::filesystem::rename(tmp, final, ec);
+    }
+
+    if (ec)
+    {
+        std::filesystem::remove(tmp, ec);
+        return false;
+    }
+
+    if (sync)
+        sync_dir(dir);
+    return true;
+}
+
+std::vector<ConsumerCursor> list_cursors(const std::filesystem::path& dir)
+{
+    std::vector<ConsumerCursor> out;
+    std::error_code ec;
+
+    for (auto it = std::filesystem::directory_iterator(dir, ec); !ec && it != std::filesystem::directory_iterator();
+         it.increment(ec))
+    {
+        // Renamed into place whole, so an unreadable cursor was removed since the listing: skip it
+        if (it->path().extension() == kExt)
+            if (auto c = read_cursor(dir, it->path().stem().string()))
+                out.push_back(std::move(*c));
+    }
+
+    std::sort(out.begin(), out.end(), [](const auto& a, const auto& b) { return a.name < b.name; });
+    return out;
+}
+
+int64_t unix_ms_now()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+CursorLease::CursorLease(std::filesystem::path dir, std::string name, std::chrono::milliseconds lease,
+                         uint64_t fromSeq)
+    : dir_(std::move(dir))
+{
+    cursor_.name = std::move(name);
+    cursor_.lease = lease;
+    cursor_.seq = fromSeq;
+}
+
+bool CursorLease::open()
+{
+    if (!valid_consumer_name(cursor_.name) || cursor_.lease.count() <= 0)
+        return false;
+
+    int64_t now = unix_ms_now();
+    auto existing = read_cursor(dir_, cursor_.name);
+    resumed_ = existing && !existing->expired(now);
+
+    // A lapsed cursor still records how far this consumer got; frames after it may be gone, though
+    if (existing)
+        cursor_.seq = existing->seq;
+
+    cursor_.renewedUnixMs = now;
+    return write_cursor(dir_, cursor_);
+}
+
+bool CursorLease::ack(uint64_t seq)
+{
+    cursor_.seq = std::max(cursor_.seq, seq);
+    return renew();
+}
+
+bool CursorLease::renew()
+{
+    cursor_.renewedUnixMs = unix_ms_now();
+    return write_cursor(dir_, cursor_);
+}
+
+void CursorLease::release()
+{
+    std::error_code ec;
+    std::filesystem::remove(cursor_path(dir_, cursor_.name), ec);
+}
+
+CursorTable::CursorTable(std::filesystem::path dir) : dir_(std::move(dir))
+{
+}
+
+CursorTable::Scan CursorTable::scan(int64_t nowUnixMs)
+{
+    Scan out;
+    std::error_code ec;
+    auto fsNow = std::filesystem::file_time_type::clock::now();
+
+    for (auto it = std::filesystem::directory_iterator(dir_, ec); !ec && it != std::filesystem::directory_iterator();
+         it.increment(ec))
+    {
+        std::error_code tec;
+        auto mtime = std::filesystem::last_write_time(it->path(), tec);
+        if (it->path().extension() == kTmpExt && !tec && fsNow - mtime > kStaleTmp)
+            std::filesystem::remove(it->path(), tec);
+    }
+
+    // A lapsed cursor stays on disk: removing it here could remove one its consumer renewed since it was read
+    std::vector<std::string> lapsed;
+    for (auto& c : list_cursors(dir_))
+    {
+        if (c.expired(nowUnixMs))
+        {
+            if (std::find(lapsed_.begin(), lapsed_.end(), c.name) == lapsed_.end())
+                out.expired.push_back(c);
+            lapsed.push_back(std::move(c.name));
+            continue;
+        }
+
+        bool known = std::any_of(live_.begin(), live_.end(), [&](const auto& l) { return l.name == c.name; });
+        if (!known)
+            out.registered.push_back(c);
+        out.live.push_back(std::move(c));
+    }
+
+    live_ = out.live;
+    lapsed_ = std::move(lapsed);
+    return out;
+}
+
+std::optional<uint64_t> CursorTable::floor() const
+{
+    if (live_.empty())
+        return std::nullopt;
+
+    return std::min_element(live_.begin(), live_.end(), [](const auto& a, const auto& b) { return a.seq < b.seq; })
+        ->seq;
+}
@@ -0,0 +1,104 @@
+// Durable consumer cursors with leases (sessions/current/state/cursors), so capture knows which frames every reader
+// is done with.
+//
+// A consumer (inference, the camera controller, a dataset exporter, ...) registers under a name and acknowledges
+// frames in sequence order: its cursor is the highest frame seq it no longer needs. Each cursor is one small text
+// file, <name>.cursor, holding
+//   seq=<last acknowledged seq> lease_ms=<lease> renewed_ms=<unix ms of the last write>
+// and rewritten whole (temporary file, fsync, rename) on every ack or renewal, so a reader sees the old cursor or
+// the new one, never a torn one, and a consumer that crashes resumes from its last ack. Any process can take part:
+// writing the file in that format is all registration takes.
+//
+// The lease is the consumer's promise to write again within lease_ms. capture scans the directory, and a cursor
+// whose lease has lapsed is left out of the floor: it no longer holds frames back, so a consumer that died cannot
+// stall retention. Its file stays (only the consumer removes it, by release()). A consumer that was only slow is live
+// again once it writes again; frames reclaimed meanwhile are gone, and it should carry on from the oldest frame still
+// present.
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct ConsumerCursor
+{
+    std::string name;
+    uint64_t seq = 0;  // last acknowledged frame
+    std::chrono::milliseconds lease{0};
+    int64_t renewedUnixMs = 0;
+
+    bool expired(int64_t nowUnixMs) const { return nowUnixMs - renewedUnixMs > lease.count(); }
+};
+
+// Cursor names become file names: [A-Za-z0-9._-], no leading dot, <= 64 characters.
+bool valid_consumer_name(std::string_view name);
+
+// Reads <dir>/<name>.cursor; nullopt if it is missing or malformed.
+std::optional<ConsumerCursor> read_cursor(const std::filesystem::path& dir, std::string_view name);
+
+// Replaces <dir>/<name>.cursor with `c` (durably when `sync`). Returns false on I/O errors.
+bool write_cursor(const std::filesystem::path& dir, const ConsumerCursor& c, bool sync = true);
+
+// Every readable cursor in `dir`, expired or not, by name. Changes nothing.
+std::vector<ConsumerCursor> list_cursors(const std::filesystem::path& dir);
+
+int64_t unix_ms_now();
+
+// Consumer side: one registration, kept alive by ack() and renew(). Not thread-safe.
+class CursorLease
+{
+public:
+    // Continues from the cursor on disk under `name`, if there is one (even with its lease lapsed), else `fromSeq`.
+    CursorLease(std::filesystem::path dir, std::string name, std::chrono::milliseconds lease, uint64_t fromSeq = 0);
+
+    // Registers (writes the cursor). False if the name is invalid or the file cannot be written.
+    bool open();
+    // Moves the cursor forward to `seq` (never back) and renews the lease.
+    bool ack(uint64_t seq);
+    // Rewrites the cursor unchanged; call at least every lease / 3 when there is nothing to acknowledge.
+    bool renew();
+    // Unregisters: removes the cursor so it holds nothing back.
+    void release();
+
+    uint64_t seq() const { return cursor_.seq; }
+    // open() found the cursor still live, so no frame after it has been reclaimed.
+    bool resumed() const { return resumed_; }
+
+private:
+    std::filesystem::path dir_;
+    ConsumerCursor cursor_;
+    bool resumed_ = false;
+};
+
+// Producer side: the set of registered cursors as of the last scan.
+class CursorTable
+{
+public:
+    explicit CursorTable(std::filesystem::path dir);
+
+    struct Scan
+    {
+        std::vector<ConsumerCursor> live;
+        std::vector<ConsumerCursor> registered;  // live now but not at the previous scan
+        std::vector<ConsumerCursor> expired;     // lease lapsed since the previous scan; no longer in the floor
+    };
+
+    // Reads every cursor; those whose lease has lapsed are left out of `live` and the floor, but not removed. Stale
+    // temporary files are cleaned up.
+    Scan scan(int64_t nowUnixMs);
+
+    // Lowest live cursor as of the last scan: every frame at or below it has been acknowledged by all live consumers.
+    // nullopt when nobody is registered.
+    std::optional<uint64_t> floor() const;
+
+    const std::filesystem::path& dir() const { return dir_; }
+
+private:
+    std::filesystem::path dir_;
+    std::vector<ConsumerCursor> live_;
+    std::vector<std::string> lapsed_;  // names of the cursors lapsed at the last scan
+};
@@ -0,0 +1,126 @@
+#include "consumer_lag.h"
+
+#include "log.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+static std::chrono::milliseconds env_ms(const char* name, std::chrono::milliseconds fallback)
+{
+    const char* v = std::getenv(name);
+
+    if (!v || !*v)
+        return fallback;
+
+    long long ms = std::atoll(v);
+    return ms > 0 ? std::chrono::milliseconds(ms) : fallback;
+}
+
+ConsumerLag::Config ConsumerLag::Config::from_env()
+{
+    Config cfg;
+    cfg.maxLag = env_ms("CAPTURE_MAX_LAG_MS", cfg.maxLag);
+    cfg.maxInterval = env_ms("CAPTURE_MAX_INTERVAL_MS", cfg.maxInterval);
+    return cfg;
+}
+
+ConsumerLag::ConsumerLag(std::filesystem::path stateDir, Config cfg)
+    : heartbeat_(stateDir / "heartbeat_detection.json"), cfg_(cfg)
+{
+}
+
+void ConsumerLag::emitted(uint64_t seq, std::filesystem::path sidecar, Clock::time_point at)
+{
+    if (!alive_)
+        return;
+
+    pending_.push_back({seq, std::move(sidecar), at});
+
+    if (pending_.size() > kMaxPending)
+        pending_.pop_front();
+}
+
+int64_t ConsumerLag::oldest_age_ms(Clock::time_point now) const
+{
+    if (pending_.empty())
+        return 0;
+
+    return std::chrono::duration_cast<std::chrono::milliseconds>(now - pending_.front().at).count();
+}
+
+std::optional<uint64_t> ConsumerLag::oldest_pending() const
+{
+    if (!alive_ || pending_.empty())
+        return std::nullopt;
+
+    return pending_.front().seq;
+}
+
+bool ConsumerLag::probe_alive(Clock::time_point now)
+{
+    // The heartbeat is rewritten every ~2s; re-stat it at most once per second
+    if (now - lastAliveProbe_ < std::chrono::seconds(1))
+        return alive_;
+
+    lastAliveProbe_ = now;
+
+    std::error_code ec;
+    auto mtime = std::filesystem::last_write_time(heartbeat_, ec);
+    bool alive = !ec && std::filesystem::file_time_type::clock::now() - mtime < cfg_.heartbeatStale;
+
+    if (alive != alive_)
+    {
+        if (alive)
+            log_event<Ev::ConsumerAttached>(heartbeat_);
+        else
+            log_event<Ev::ConsumerDetached>(heartbeat_);
+        if (!alive)
+            pending_.clear();
+    }
+
+    alive_ = alive;
+    return alive_;
+}
+
+ConsumerLag::Clock::duration ConsumerLag::next_interval(Clock::time_point now, Clock::duration base)
+{
+    if (interval_ < base)
+        interval_ = base;
+
+    if (!probe_alive(now))
+    {
+        interval_ = base;
+        return interval_;
+    }
+
+    // Sidecars are written in frame order, so stop at the first frame not yet acknowledged
+    std::error_code ec;
+    while (!pending_.empty() && std::filesystem::exists(pending_.front().sidecar, ec))
+    {
+        lastAckLatencyMs_ = std::chrono::duration_cast<std::chrono::milliseconds>(now - pending_.front().at).count();
+        pending_.pop_front();
+    }
+
+    auto age = std::chrono::milliseconds(oldest_age_ms(now));
+
+    // One step per elapsed interval, so early wake-ups (control commands) don't compound the backoff
+    if (now - lastAdapt_ < interval_)
+        return interval_;
+
+    lastAdapt_ = now;
+    auto previous = interval_;
+    Clock::duration ceiling = std::max<Clock::duration>(base, cfg_.maxInterval);
+
+    if (age > cfg_.maxLag)
+        interval_ = std::min<Clock::duration>(interval_ * 2, ceiling);
+    else if (age < cfg_.maxLag / 2)
+        interval_ = std::max<Clock::duration>(interval_ / 2, base);
+
+    if (interval_ != previous)
+    {
+        log_event<Ev::EmitRateAdapted>(std::chrono::duration_cast<std::chrono::milliseconds>(interval_).count(),
+                                       pending_.size(), age.count(), cfg_.maxLag.count());
+    }
+
+    return interval_;
+}
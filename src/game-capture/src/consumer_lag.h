@@ -0,0 +1,65 @@
+// Consumer-lag-driven emit rate.
+//
+// hero-inference acknowledges a frame by writing state/detections/<stem>.detections.json. The saver registers each
+// frame it emits, probes for those sidecars oldest-first, and stretches the save interval while the oldest
+// unacknowledged frame is older than the capture-to-decision bound (CAPTURE_MAX_LAG_MS). Once the consumer catches
+// up the interval steps back down to the base rate. With no live consumer (heartbeat_detection.json missing or
+// stale) nothing is tracked and the base rate applies.
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <optional>
+
+class ConsumerLag
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Config
+    {
+        std::chrono::milliseconds maxLag{3000};       // CAPTURE_MAX_LAG_MS
+        std::chrono::milliseconds maxInterval{8000};  // CAPTURE_MAX_INTERVAL_MS
+        std::chrono::seconds heartbeatStale{10};
+
+        static Config from_env();
+    };
+
+    ConsumerLag(std::filesystem::path stateDir, Config cfg);
+
+    void emitted(uint64_t seq, std::filesystem::path sidecar, Clock::time_point at);
+
+    // Probes acknowledgements and returns the interval to use for the next emit (>= base).
+    Clock::duration next_interval(Clock::time_point now, Clock::duration base);
+
+    uint64_t lag_frames() const { return pending_.size(); }
+    // Seq of the oldest frame hero-inference has yet to acknowledge, while it is alive: frame retention must not
+    // delete it or anything after it. At most kMaxPending frames are held this way.
+    std::optional<uint64_t> oldest_pending() const;
+    int64_t oldest_age_ms(Clock::time_point now) const;
+    int64_t last_ack_latency_ms() const { return lastAckLatencyMs_; }
+    bool consumer_alive() const { return alive_; }
+
+private:
+    struct Pending
+    {
+        uint64_t seq;
+        std::filesystem::path sidecar;
+        Clock::time_point at;
+    };
+
+    static constexpr size_t kMaxPending = 4096;
+
+    bool probe_alive(Clock::time_point now);
+
+    std::filesystem::path heartbeat_;
+    Config cfg_;
+    std::deque<Pending> pending_;
+    Clock::duration interval_{};
+    Clock::time_point lastAliveProbe_{};
+    Clock::time_point lastAdapt_{};
+    bool alive_ = false;
+    int64_t lastAckLatencyMs_ = 0;
+};
@@ -0,0 +1,574 @@
+#include "control.h"
+
+#include "log.h"
+#include "paths.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+static constexpr double kMaxBurstFps = 60.0;
+static constexpr double kMaxBurstSeconds = 600.0;
+static constexpr size_t kMaxLineLength = 256;
+
+const char* control_op_name(ControlOp op)
+{
+    switch (op)
+    {
+    case ControlOp::Pause:
+        return "pause";
+    case ControlOp::Resume:
+        return "resume";
+    case ControlOp::Burst:
+        return "burst";
+    case ControlOp::Snapshot:
+        return "snapshot";
+    case ControlOp::Flush:
+        return "flush";
+    case ControlOp::Align:
+        return "align";
+    case ControlOp::Stats:
+        return "stats";
+    default:
+        return "unknown";
+    }
+}
+
+static std::vector<std::string_view> split_words(std::string_view line)
+{
+    std::vector<std::string_view> words;
+    size_t i = 0;
+
+    while (i < line.size())
+    {
+        while (i < line.size() && (line[i] == ' ' || line[i] == '\t' || line[i] == '\r'))
+            ++i;
+
+        size_t start = i;
+
+        while (i < line.size() && line[i] != ' ' && line[i] != '\t' && line[i] != '\r')
+            ++i;
+
+        if (i > start)
+            words.push_back(line.substr(start, i - start));
+    }
+
+    return words;
+}
+
+static bool parse_double(std::string_view s, double& out)
+{
+    std::string tmp(s);
+    char* end = nullptr;
+    out = std::strtod(tmp.c_str(), &end);
+    return end && *end == '\0' && end != tmp.c_str();
+}
+
+bool parse_control_command(std::string_view line, ControlCommand& out, std::string& error)
+{
+    auto words = split_words(line);
+
+    if (words.empty())
+    {
+        error = "empty_command";
+        return false;
+    }
+
+    out = ControlCommand{};
+
+    for (size_t i = 0; i < static_cast<size_t>(ControlOp::Count); ++i)
+    {
+        auto op = static_cast<ControlOp>(i);
+
+        if (words[0] != control_op_name(op))
+            continue;
+
+        out.op = op;
+
+        if (op == ControlOp::Burst)
+        {
+            if (words.size() != 3 || !parse_double(words[1], out.fps) || !parse_double(words[2], out.seconds))
+            {
+                error = "usage: burst <fps> <seconds>";
+                return false;
+            }
+            if (!(out.fps > 0.0 && out.fps <= kMaxBurstFps) || !(out.seconds > 0.0 && out.seconds <= kMaxBurstSeconds))
+            {
+                error = "burst_out_of_range";
+                return false;
+            }
+            return true;
+        }
+
+        if (op == ControlOp::Align)
+        {
+            if (words.size() == 2 && words[1] == "start")
+            {
+                out.alignStart = true;
+                return true;
+            }
+            double seq = 0.0;
+            if (words.size() != 3 || !parse_double(words[1], seq) || !parse_double(words[2], out.loop))
+            {
+                error = "usage: align start | align <seq> <loop>";
+                return false;
+            }
+            if (!(seq >= 0.0 && seq == static_cast<double>(static_cast<uint64_t>(seq))) || !(out.loop >= 0.0))
+            {
+                error = "align_out_of_range";
+                return false;
+            }
+            out.seq = static_cast<uint64_t>(seq);
+            return true;
+        }
+
+        if (words.size() != 1)
+        {
+            error = "unexpected_arguments";
+            return false;
+        }
+        return true;
+    }
+
+    error = "unknown_command";
+    return false;
+}
+
+void CaptureControl::apply(const ControlCommand& cmd)
+{
+    auto now = Clock::now();
+    auto idx = static_cast<size_t>(cmd.op);
+
+    {
+        std::lock_guard<std::mutex> lock(m_);
+        issued_[idx] = now;
+
+        switch (cmd.op)
+        {
+        case ControlOp::Pause:
+            paused_ = true;
+            awaiting_[static_cast<size_t>(ControlOp::Resume)] = false;
+            break;
+        case ControlOp::Resume:
+            paused_ = false;
+            awaiting_[static_cast<size_t>(ControlOp::Pause)] = false;
+            break;
+        case ControlOp::Burst:
+            burstFps_ = cmd.fps;
+            burstUntil_ = now + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(cmd.seconds));
+            break;
+        case ControlOp::Snapshot:
+            snapshotPending_ = true;
+            break;
+        case ControlOp::Flush:
+            flushPending_ = true;
+            break;
+        case ControlOp::Align:
+            alignPending_.push_back(AlignInput{cmd.alignStart, cmd.seq, cmd.loop, now});
+            break;
+        default:
+            return;
+        }
+
+        awaiting_[idx] = true;
+    }
+
+    wake();
+    log_event<Ev::ControlCommand>(control_op_name(cmd.op), cmd.fps, cmd.seconds);
+}
+
+CaptureControl::Clock::duration CaptureControl::save_interval(Clock::time_point now, Clock::duration normal) const
+{
+    std::lock_guard<std::mutex> lock(m_);
+
+    if (burstFps_ > 0.0 && now < burstUntil_)
+        return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / burstFps_));
+
+    return normal;
+}
+
+bool CaptureControl::bursting(Clock::time_point now) const
+{
+    std::lock_guard<std::mutex> lock(m_);
+    return burstFps_ > 0.0 && now < burstUntil_;
+}
+
+bool CaptureControl::take_flush()
+{
+    std::lock_guard<std::mutex> lock(m_);
+    bool pending = flushPending_;
+    flushPending_ = false;
+    return pending;
+}
+
+std::vector<AlignInput> CaptureControl::take_align()
+{
+    std::lock_guard<std::mutex> lock(m_);
+    return std::exchange(alignPending_, {});
+}
+
+void CaptureControl::set_notifier(std::function<void()> notify)
+{
+    std::lock_guard<std::mutex> lock(m_);
+    notify_ = std::move(notify);
+}
+
+void CaptureControl::wake()
+{
+    std::function<void()> notify;
+    {
+        std::lock_guard<std::mutex> lock(m_);
+        notify = notify_;
+    }
+
+    if (notify)
+        notify();
+}
+
+void CaptureControl::ack(ControlOp op)
+{
+    auto idx = static_cast<size_t>(op);
+
+    if (!awaiting_[idx].load(std::memory_order_relaxed))
+        return;
+
+    Clock::time_point issued;
+    {
+        std::lock_guard<std::mutex> lock(m_);
+
+        if (!awaiting_[idx].exchange(false))
+            return;
+
+        issued = issued_[idx];
+
+        if (op == ControlOp::Snapshot)
+            snapshotPending_ = false;
+    }
+
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - issued).count();
+    latencyUs_[idx] = static_cast<int64_t>(us);
+    log_event<Ev::ControlEffect>(control_op_name(op), us);
+}
+
+std::string CaptureControl::stats_line() const
+{
+    auto now = Clock::now();
+    double burstFps = 0.0;
+    long long burstRemainingMs = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_);
+        if (burstFps_ > 0.0 && now < burstUntil_)
+        {
+            burstFps = burstFps_;
+            burstRemainingMs = std::chrono::duration_cast<std::chrono::milliseconds>(burstUntil_ - now).count();
+        }
+    }
+
+    char buf[512];
+    snprintf(buf, sizeof(buf),
+             "ok state=%s paused=%d burst_fps=%.2f burst_remaining_ms=%lld frame_events=%llu gpu_copies=%llu "
+             "frames_saved=%llu snapshots=%llu flushes=%llu emit_interval_ms=%lld lag_frames=%llu lag_ms=%lld "
+             "ack_latency_ms=%lld",
+             stats_.capturing.load() ? "capturing" : "waiting", paused() ? 1 : 0, burstFps, burstRemainingMs,
+             (unsigned long long)stats_.frameEvents.load(), (unsigned long long)stats_.gpuCopies.load(),
+             (unsigned long long)stats_.framesSaved.load(), (unsigned long long)stats_.snapshots.load(),
+             (unsigned long long)stats_.flushes.load(), (long long)stats_.emitIntervalMs.load(),
+             (unsigned long long)stats_.lagFrames.load(), (long long)stats_.lagMs.load(),
+             (long long)stats_.ackLatencyMs.load());
+
+    std::string line = buf;
+
+    snprintf(buf, sizeof(buf),
+             " pool_buffers=%u refresh_hz=%.2f frames_delivered=%llu dropped_frames=%llu idle_gaps=%llu "
+             "reactor_wakeups=%llu",
+             stats_.poolBuffers.load(), stats_.gaps.refresh_hz(), (unsigned long long)stats_.gaps.delivered(),
+             (unsigned long long)stats_.gaps.dropped(), (unsigned long long)stats_.gaps.idle_gaps(),
+             (unsigned long long)stats_.reactorWakeups.load());
+    line += buf;
+
+    snprintf(buf, sizeof(buf), " ship_acked_files=%llu ship_raw_bytes=%llu ship_wire_bytes=%llu ship_backlog=%llu",
+             (unsigned long long)stats_.shipAckedFiles.load(), (unsigned long long)stats_.shipRawBytes.load(),
+             (unsigned long long)stats_.shipWireBytes.load(), (unsigned long long)stats_.shipBacklog.load());
+    line += buf;
+
+    snprintf(buf, sizeof(buf), " align_frame_knots=%llu align_loop_knots=%llu align_rejected=%llu",
+             (unsigned long long)stats_.alignFrameKnots.load(), (unsigned long long)stats_.alignLoopKnots.load(),
+             (unsigned long long)stats_.alignRejected.load());
+    line += buf;
+
+    snprintf(buf, sizeof(buf), " io_bytes=%llu io_bytes_per_s=%llu io_delayed_chunks=%llu io_queue_max_us=%lld",
+             (unsigned long long)stats_.ioBytes.load(), (unsigned long long)stats_.ioBytesPerSec.load(),
+             (unsigned long long)stats_.ioDelayedChunks.load(), (long long)stats_.ioQueueMaxUs.load());
+    line += buf;
+
+    snprintf(buf, sizeof(buf), " sharpness=%llu frames_deferred=%llu", (unsigned long long)stats_.sharpness.load(),
+             (unsigned long long)stats_.framesDeferred.load());
+    line += buf;
+
+    snprintf(buf, sizeof(buf), " retained_frames=%llu reclaimed_frames=%llu retention_held=%llu",
+             (unsigned long long)stats_.retainedFrames.load(), (unsigned long long)stats_.reclaimedFrames.load(),
+             (unsigned long long)stats_.retentionHeld.load());
+    line += buf;
+
+    snprintf(buf, sizeof(buf), " jpeg_quality=%llu jpeg_bytes=%llu jpeg_target_bytes=%llu",
+             (unsigned long long)stats_.jpegQuality.load(), (unsigned long long)stats_.jpegBytes.load(),
+             (unsigned long long)stats_.jpegTargetBytes.load());
+    line += buf;
+
+    snprintf(buf, sizeof(buf), " video_written=%llu video_duplicated=%llu video_dropped=%llu video_skipped=%llu",
+             (unsigned long long)stats_.videoWritten.load(), (unsigned long long)stats_.videoDuplicated.load(),
+             (unsigned long long)stats_.videoDropped.load(), (unsigned long long)stats_.videoSkipped.load());
+    line += buf;
+    line += " consumers=" + stats_.consumers();
+    line += " drop_hist=" + stats_.gaps.histogram();
+
+    for (size_t i = 0; i < kOps; ++i)
+    {
+        auto op = static_cast<ControlOp>(i);
+
+        if (op == ControlOp::Stats)
+            continue;
+
+        snprintf(buf, sizeof(buf), " %s_latency_us=%lld", control_op_name(op),
+                 static_cast<long long>(latencyUs_[i].load()));
+        line += buf;
+    }
+
+    return line;
+}
+
+std::string handle_control_line(CaptureControl& control, std::string_view line)
+{
+    ControlCommand cmd;
+    std::string error;
+
+    if (!parse_control_command(line, cmd, error))
+        return "err " + error;
+
+    if (cmd.op == ControlOp::Stats)
+        return control.stats_line();
+
+    control.apply(cmd);
+
+    return std::string("ok ") + control_op_name(cmd.op);
+}
+
+std::string control_endpoint()
+{
+#ifdef _WIN32
+    const char* pipe = std::getenv("CAPTURE_CONTROL_PIPE");
+    return pipe ? pipe : "\\\\.\\pipe\\hots_capture";
+#else
+    const char* sock = std::getenv("CAPTURE_CONTROL_SOCKET");
+    return sock ? std::string(sock) : (state_dir() / "capture.sock").string();
+#endif
+}
+
+// Splits buffered input into lines and returns the replies for every complete one, newline-terminated.
+static std::string take_replies(std::string& pending, const ControlHandler& handler)
+{
+    std::string out;
+    size_t pos;
+
+    while ((pos = pending.find('\n')) != std::string::npos)
+    {
+        std::string_view line(pending.data(), pos);
+
+        if (!line.empty() && line.back() == '\r')
+            line.remove_suffix(1);
+
+        out += handler(line);
+        out += '\n';
+        pending.erase(0, pos + 1);
+    }
+
+    if (pending.size() > kMaxLineLength)
+    {
+        pending.clear();
+        out += "err line_too_long\n";
+    }
+
+    return out;
+}
+
+#ifdef _WIN32
+
+Task<> serve_control(Reactor& reactor, ControlHandler handler, std::stop_token stop)
+{
+    std::string ep = control_endpoint();
+    std::wstring name(ep.begin(), ep.end());
+
+    log_event<Ev::ControlListening>(ep);
+
+    while (!stop.stop_requested())
+    {
+        HANDLE pipe = CreateNamedPipeW(name.c_str(), PIPE_ACCESS_DUPLEX | FILE_FLAG_OVERLAPPED,
+                                       PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS, 1,
+                                       4096, 4096, 0, nullptr);
+
+        if (pipe == INVALID_HANDLE_VALUE || !reactor.associate(pipe))
+        {
+            log_event<Ev::ControlPipeFail>(GetLastError());
+            if (pipe != INVALID_HANDLE_VALUE)
+                CloseHandle(pipe);
+            co_await reactor.sleep_for(std::chrono::seconds(2), stop);
+            continue;
+        }
+
+        auto conn = co_await reactor.io(pipe, [&](OVERLAPPED* ov) { return ConnectNamedPipe(pipe, ov); }, stop);
+
+        if (conn.error == ERROR_SUCCESS || conn.error == ERROR_PIPE_CONNECTED)
+        {
+            std::string pending;
+            char buf[256];
+
+            while (!stop.stop_requested())
+            {
+                auto rd = co_await reactor.io(
+                    pipe, [&](OVERLAPPED* ov) { return ReadFile(pipe, buf, sizeof(buf), nullptr, ov); }, stop);
+
+                if (rd.error != ERROR_SUCCESS || rd.bytes == 0)
+                    break;
+
+                pending.append(buf, rd.bytes);
+                std::string out = take_replies(pending, handler);
+
+                if (out.empty())
+                    continue;
+
+                auto wr = co_await reactor.io(
+                    pipe, [&](OVERLAPPED* ov) { return WriteFile(pipe, out.data(), (DWORD)out.size(), nullptr, ov); },
+                    stop);
+
+                if (wr.error != ERROR_SUCCESS || wr.bytes != out.size())
+                    break;
+            }
+        }
+
+        DisconnectNamedPipe(pipe);
+        CloseHandle(pipe);
+    }
+}
+
+#else
+
+static void set_nonblocking(int fd)
+{
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+}
+
+static Task<bool> write_all(Reactor& reactor, int fd, const std::string& data, std::stop_token stop)
+{
+#ifdef MSG_NOSIGNAL
+    constexpr int kFlags = MSG_NOSIGNAL;
+#else
+    constexpr int kFlags = 0;
+#endif
+    size_t off = 0;
+
+    while (off < data.size())
+    {
+        ssize_t n = send(fd, data.data() + off, data.size() - off, kFlags);
+
+        if (n > 0)
+        {
+            off += static_cast<size_t>(n);
+            continue;
+        }
+
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+        {
+            if (co_await reactor.writable(fd, stop) != WaitResult::Signaled)
+                co_return false;
+            continue;
+        }
+
+        co_return false;
+    }
+
+    co_return true;
+}
+
+Task<> serve_control(Reactor& reactor, ControlHandler handler, std::stop_token stop)
+{
+    std::string path = control_endpoint();
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+
+    if (path.size() >= sizeof(addr.sun_path))
+    {
+        log_event<Ev::ControlSocketPathTooLong>(path);
+        co_return;
+    }
+
+    memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    if (fd < 0)
+    {
+        log_event<Ev::ControlSocketFail>();
+        co_return;
+    }
+
+    set_nonblocking(fd);
+    unlink(path.c_str());
+
+    if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(fd, 4) != 0)
+    {
+        log_event<Ev::ControlBindFail>(path);
+        close(fd);
+        co_return;
+    }
+
+    log_event<Ev::ControlListening>(path);
+
+    while (co_await reactor.readable(fd, stop) == WaitResult::Signaled)
+    {
+        int client = accept(fd, nullptr, nullptr);
+
+        if (client < 0)
+            continue;
+
+        set_nonblocking(client);
+
+        std::string pending;
+        char buf[256];
+
+        while (co_await reactor.readable(client, stop) == WaitResult::Signaled)
+        {
+            ssize_t n = read(client, buf, sizeof(buf));
+
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+                continue;
+            if (n <= 0)
+                break;
+
+            pending.append(buf, static_cast<size_t>(n));
+            std::string out = take_replies(pending, handler);
+
+            if (!out.empty() && !co_await write_all(reactor, client, out, stop))
+                break;
+        }
+
+        close(client);
+    }
+
+    close(fd);
+    unlink(path.c_str());
+}
+
+#endif
@@ -0,0 +1,184 @@
+// Runtime control channel for hots_capture.
+//
+// Transport: named pipe \\.\pipe\hots_capture on Windows (override with CAPTURE_CONTROL_PIPE), Unix domain socket
+// sessions/current/state/capture.sock elsewhere (override with CAPTURE_CONTROL_SOCKET). One client at a time,
+// newline-terminated ASCII commands, exactly one reply line per command ("ok ..." or "err <reason>"):
+//
+//   pause                  keep the capture session warm but stop GPU copies and saves
+//   resume                 undo pause
+//   burst <fps> <seconds>  temporarily raise the save rate (fps in (0, 60], seconds in (0, 600])
+//   snapshot               write the next compositor frame full-res (lossless BMP) to sessions/current/snapshots
+//   flush                  fsync every frame written since the previous flush
+//   align start            the replay's first game loop is on screen now (see alignment_map.h)
+//   align <seq> <loop>     the in-game timer on frame <seq> showed game loop <loop>
+//   stats                  counters as key=value pairs
+//
+// Commands are acknowledged as soon as they are queued. The time from receipt until the capture loop first acts on
+// a command is logged as control_effect and reported by stats as <cmd>_latency_us.
+#pragma once
+
+#include "async.h"
+#include "frame_gaps.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <stop_token>
+#include <string>
+#include <string_view>
+#include <vector>
+
+enum class ControlOp
+{
+    Pause,
+    Resume,
+    Burst,
+    Snapshot,
+    Flush,
+    Align,
+    Stats,
+    Count
+};
+
+struct ControlCommand
+{
+    ControlOp op = ControlOp::Stats;
+    double fps = 0.0;
+    double seconds = 0.0;
+    bool alignStart = false;
+    uint64_t seq = 0;
+    double loop = 0.0;
+};
+
+// An align command waiting for the save loop, stamped with when it arrived
+struct AlignInput
+{
+    bool start = false;
+    uint64_t seq = 0;
+    double loop = 0.0;
+    std::chrono::steady_clock::time_point at;
+};
+
+// Parses one protocol line. Returns false and fills `error` for unknown or malformed commands.
+bool parse_control_command(std::string_view line, ControlCommand& out, std::string& error);
+
+const char* control_op_name(ControlOp op);
+
+// Counters shared by the capture callback, the saver and the control channel.
+struct CaptureStats
+{
+    std::atomic<bool> capturing{false};
+    std::atomic<uint64_t> frameEvents{0};
+    std::atomic<uint64_t> gpuCopies{0};
+    std::atomic<uint64_t> framesSaved{0};
+    std::atomic<uint64_t> snapshots{0};
+    std::atomic<uint64_t> flushes{0};
+    std::atomic<uint64_t> lagFrames{0};
+    std::atomic<int64_t> lagMs{0};
+    std::atomic<int64_t> ackLatencyMs{0};
+    std::atomic<int64_t> emitIntervalMs{0};
+    std::atomic<uint32_t> poolBuffers{0};
+    std::atomic<uint64_t> reactorWakeups{0};
+    std::atomic<uint64_t> shipAckedFiles{0};
+    std::atomic<uint64_t> shipRawBytes{0};
+    std::atomic<uint64_t> shipWireBytes{0};
+    std::atomic<uint64_t> shipBacklog{0};
+    std::atomic<uint64_t> alignFrameKnots{0};
+    std::atomic<uint64_t> alignLoopKnots{0};
+    std::atomic<uint64_t> alignRejected{0};
+    std::atomic<uint64_t> ioBytes{0};
+    std::atomic<uint64_t> ioBytesPerSec{0};  // over the last rate interval
+    std::atomic<uint64_t> ioDelayedChunks{0};
+    std::atomic<int64_t> ioQueueMaxUs{0};
+    std::atomic<uint64_t> sharpness{0};       // score of the last frame read back, rounded
+    std::atomic<uint64_t> framesDeferred{0};  // read back but passed over for a sharper frame
+    std::atomic<uint64_t> retainedFrames{0};
+    std::atomic<uint64_t> reclaimedFrames{0};
+    std::atomic<uint64_t> retentionHeld{0};    // over CAPTURE_RETAIN_FRAMES but still needed by a consumer
+    std::atomic<uint64_t> jpegQuality{0};      // of the last JPEG frame (CAPTURE_FRAME_FORMAT=jpeg)
+    std::atomic<uint64_t> jpegBytes{0};        // size of the last JPEG frame
+    std::atomic<uint64_t> jpegTargetBytes{0};  // its budget; 0 at a fixed quality
+    std::atomic<uint64_t> videoWritten{0};     // frames sent to the video encoder (CAPTURE_VIDEO_CMD)
+    std::atomic<uint64_t> videoDuplicated{0};  // of those, repeats of the previous frame
+    std::atomic<uint64_t> videoDropped{0};     // converted but replaced before they were sent
+    std::atomic<uint64_t> videoSkipped{0};     // ticks lost while the encoder was behind
+
+    // Live consumer cursors as "name:lag_frames:age_ms,..." (consumer_cursors.h)
+    void set_consumers(std::string s)
+    {
+        std::lock_guard<std::mutex> lock(consumersM_);
+        consumers_ = std::move(s);
+    }
+    std::string consumers() const
+    {
+        std::lock_guard<std::mutex> lock(consumersM_);
+        return consumers_;
+    }
+
+    FrameGapTracker gaps;
+
+private:
+    mutable std::mutex consumersM_;
+    std::string consumers_;
+};
+
+// Command state consumed by the capture loop. The producer is the control server task; consumers are the
+// FrameArrived callback and the save loop.
+class CaptureControl
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit CaptureControl(CaptureStats& stats) : stats_(stats) {}
+
+    void apply(const ControlCommand& cmd);
+
+    bool paused() const { return paused_.load(std::memory_order_relaxed); }
+    bool snapshot_pending() const { return snapshotPending_.load(std::memory_order_relaxed); }
+
+    // Save interval in effect at `now`: the burst interval while a burst is active, `normal` otherwise.
+    Clock::duration save_interval(Clock::time_point now, Clock::duration normal) const;
+    bool bursting(Clock::time_point now) const;
+
+    bool take_flush();
+    std::vector<AlignInput> take_align();
+
+    // Called after every applied command and on wake(); the capture service points this at its AsyncEvent.
+    void set_notifier(std::function<void()> notify);
+    void wake();
+
+    // Records the first observed effect of a pending command (cheap no-op when nothing is pending).
+    void ack(ControlOp op);
+
+    std::string stats_line() const;
+
+private:
+    static constexpr size_t kOps = static_cast<size_t>(ControlOp::Count);
+
+    CaptureStats& stats_;
+    std::atomic<bool> paused_{false};
+    std::atomic<bool> snapshotPending_{false};
+    std::atomic<bool> awaiting_[kOps]{};
+    std::atomic<int64_t> latencyUs_[kOps]{};
+
+    mutable std::mutex m_;
+    std::function<void()> notify_;
+    Clock::time_point issued_[kOps]{};
+    double burstFps_ = 0.0;
+    Clock::time_point burstUntil_{};
+    bool flushPending_ = false;
+    std::vector<AlignInput> alignPending_;
+};
+
+// Parses and executes one protocol line against `control`, returning the reply line (without newline).
+std::string handle_control_line(CaptureControl& control, std::string_view line);
+
+using ControlHandler = std::function<std::string(std::string_view line)>;
+
+// Pipe name (Windows) or socket path (POSIX) the control server listens on.
+std::string control_endpoint();
+
+// Serves the control protocol on the reactor until `stop` is requested. One client at a time.
+Task<> serve_control(Reactor& reactor, ControlHandler handler, std::stop_token stop);
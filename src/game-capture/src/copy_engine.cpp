@@ -0,0 +1,198 @@
+#include "copy_engine.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HOTS_COPY_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+constexpr size_t kPage = 4096;
+
+void fence()
+{
+#ifdef HOTS_COPY_SSE2
+    _mm_sfence();
+#endif
+}
+}  // namespace
+
+void copy_streaming(void* dst, const void* src, size_t n)
+{
+#ifdef HOTS_COPY_SSE2
+    auto* d = static_cast<uint8_t*>(dst);
+    auto* s = static_cast<const uint8_t*>(src);
+
+    size_t head = std::min(n, (16 - (reinterpret_cast<uintptr_t>(d) & 15)) & 15);
+    memcpy(d, s, head);
+    d += head;
+    s += head;
+    n -= head;
+
+    for (; n >= 64; n -= 64, d += 64, s += 64)
+    {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 16));
+        __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 32));
+        __m128i e = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 48));
+        _mm_stream_si128(reinterpret_cast<__m128i*>(d), a);
+        _mm_stream_si128(reinterpret_cast<__m128i*>(d + 16), b);
+        _mm_stream_si128(reinterpret_cast<__m128i*>(d + 32), c);
+        _mm_stream_si128(reinterpret_cast<__m128i*>(d + 48), e);
+    }
+
+    for (; n >= 16; n -= 16, d += 16, s += 16)
+        _mm_stream_si128(reinterpret_cast<__m128i*>(d), _mm_loadu_si128(reinterpret_cast<const __m128i*>(s)));
+
+    memcpy(d, s, n);
+#else
+    memcpy(dst, src, n);
+#endif
+}
+
+CopyEngine::Config CopyEngine::Config::from_env()
+{
+    Config c;
+
+    if (const char* v = std::getenv("CAPTURE_COPY_THREADS"))
+        c.threads = static_cast<size_t>(std::clamp(std::atoi(v), 1, 8));
+    if (const char* v = std::getenv("CAPTURE_COPY_NT"))
+        c.nonTemporal = std::atoi(v) != 0;
+
+    return c;
+}
+
+CopyEngine::CopyEngine(Config cfg, std::function<void()> threadInit) : cfg_(cfg)
+{
+    for (size_t i = 1; i < cfg_.threads; ++i)
+    {
+        helpers_.emplace_back(
+            [this, threadInit]
+            {
+                if (threadInit)
+                    threadInit();
+
+                uint64_t seen = 0;
+
+                while (true)
+                {
+                    Job job;
+                    {
+                        std::unique_lock<std::mutex> lock(m_);
+                        cv_.wait(lock, [&] { return stop_ || generation_ != seen; });
+                        if (stop_)
+                            return;
+                        seen = generation_;
+                        job = job_;
+                    }
+
+                    run_chunks(job);
+
+                    std::lock_guard<std::mutex> lock(m_);
+                    if (--active_ == 0)
+                        done_.notify_one();
+                }
+            });
+    }
+}
+
+CopyEngine::~CopyEngine()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+
+    for (auto& t : helpers_)
+        t.join();
+}
+
+void CopyEngine::copy(void* dst, size_t dstPitch, const void* src, size_t srcPitch, size_t rowBytes, size_t rows)
+{
+    Job job;
+    job.dst = static_cast<uint8_t*>(dst);
+    job.src = static_cast<const uint8_t*>(src);
+    job.dstPitch = dstPitch;
+    job.srcPitch = srcPitch;
+    job.rowBytes = rowBytes;
+    job.rows = rows;
+    job.flat = dstPitch == rowBytes && srcPitch == rowBytes;
+
+    // A small copy is left in the cache for whoever reads it next
+    size_t bytes = rowBytes * rows;
+    job.streaming = cfg_.nonTemporal && bytes >= cfg_.minParallelBytes;
+    std::unique_lock<std::mutex> busy(busy_, std::defer_lock);
+    bool parallel = !helpers_.empty() && bytes >= cfg_.minParallelBytes && busy.try_lock();
+
+    // Several chunks per thread, so one that is descheduled mid-copy does not hold up the rest
+    size_t target = parallel ? cfg_.threads * 4 : 1;
+
+    if (job.flat)
+    {
+        job.skew = reinterpret_cast<uintptr_t>(job.dst) % kPage;
+        job.chunkSize = std::max(kPage, (bytes / target + kPage - 1) / kPage * kPage);
+        job.chunks = (bytes + job.skew + job.chunkSize - 1) / job.chunkSize;
+    }
+    else
+    {
+        job.chunkSize = std::max<size_t>(1, (rows + target - 1) / target);
+        job.chunks = (rows + job.chunkSize - 1) / job.chunkSize;
+    }
+
+    if (!parallel)
+    {
+        for (size_t i = 0; i < job.chunks; ++i)
+            run_chunk(job, i);
+        fence();
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_);
+        job_ = job;
+        next_ = 0;
+        active_ = helpers_.size();
+        ++generation_;
+    }
+    cv_.notify_all();
+
+    run_chunks(job);
+
+    std::unique_lock<std::mutex> lock(m_);
+    done_.wait(lock, [&] { return active_ == 0; });
+}
+
+void CopyEngine::run_chunks(const Job& job)
+{
+    for (size_t i = next_.fetch_add(1); i < job.chunks; i = next_.fetch_add(1))
+        run_chunk(job, i);
+
+    // Streaming stores are weakly ordered; make this thread's visible before it reports the copy done
+    fence();
+}
+
+void CopyEngine::run_chunk(const Job& job, size_t index) const
+{
+    auto copy = job.streaming ? copy_streaming : [](void* d, const void* s, size_t n) { memcpy(d, s, n); };
+
+    if (job.flat)
+    {
+        size_t bytes = job.rowBytes * job.rows;
+        size_t begin = index == 0 ? 0 : index * job.chunkSize - job.skew;
+        size_t end = std::min(bytes, (index + 1) * job.chunkSize - job.skew);
+        if (begin < end)
+            copy(job.dst + begin, job.src + begin, end - begin);
+        return;
+    }
+
+    size_t first = index * job.chunkSize;
+    size_t last = std::min(job.rows, first + job.chunkSize);
+
+    for (size_t r = first; r < last; ++r)
+        copy(job.dst + r * job.dstPitch, job.src + r * job.srcPitch, job.rowBytes);
+}
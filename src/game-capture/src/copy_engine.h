@@ -0,0 +1,82 @@
+// Frame-sized copies (GPU readback into a worker buffer) split across helper threads, with streaming stores.
+//
+// A copy is cut into chunks that each thread claims in turn; the calling thread works on chunks too, so a one-thread
+// engine is just the caller. When both sides are contiguous the copy is cut at 4 KB boundaries of the destination,
+// otherwise at row boundaries, which is how pitched sources (RowPitch > width * 4) are handled.
+//
+// With nonTemporal set, 16-byte aligned destination runs are written with SSE2 streaming stores (x86/x64): they skip
+// reading the destination lines into the cache first and do not evict what the other threads are working on. Other
+// targets, and copies under minParallelBytes (which run on the caller alone), use memcpy per row instead. Stores are
+// fenced before copy() returns.
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class CopyEngine
+{
+public:
+    struct Config
+    {
+        size_t threads = 2;                  // including the caller; CAPTURE_COPY_THREADS
+        bool nonTemporal = true;             // CAPTURE_COPY_NT
+        size_t minParallelBytes = 1u << 20;  // smaller copies run on the caller alone
+
+        static Config from_env();
+    };
+
+    // `threadInit`, if set, runs first on every helper thread (e.g. to pin it to a set of CPUs).
+    explicit CopyEngine(Config cfg, std::function<void()> threadInit = {});
+    ~CopyEngine();
+
+    CopyEngine(const CopyEngine&) = delete;
+    CopyEngine& operator=(const CopyEngine&) = delete;
+
+    // Copies `rows` rows of `rowBytes` bytes from `src` (rows `srcPitch` apart) to `dst` (rows `dstPitch` apart) and
+    // returns once all of it is written. Safe to call from several threads: while one copy owns the helpers, others
+    // run on their own caller.
+    void copy(void* dst, size_t dstPitch, const void* src, size_t srcPitch, size_t rowBytes, size_t rows);
+
+    const Config& config() const { return cfg_; }
+
+private:
+    struct Job
+    {
+        uint8_t* dst = nullptr;
+        const uint8_t* src = nullptr;
+        size_t dstPitch = 0;
+        size_t srcPitch = 0;
+        size_t rowBytes = 0;
+        size_t rows = 0;
+        bool flat = false;       // one contiguous run of rowBytes * rows bytes
+        bool streaming = false;  // streaming stores: nonTemporal and at least minParallelBytes
+        size_t skew = 0;         // flat: dst's offset into its 4 KB page, so chunk edges land on page boundaries
+        size_t chunks = 0;
+        size_t chunkSize = 0;    // bytes (flat) or rows per chunk
+    };
+
+    void run_chunks(const Job& job);
+    void run_chunk(const Job& job, size_t index) const;
+
+    Config cfg_;
+    std::mutex busy_;  // held by the copy that owns the helpers
+
+    std::mutex m_;
+    std::condition_variable cv_;
+    std::condition_variable done_;
+    Job job_;
+    uint64_t generation_ = 0;
+    size_t active_ = 0;  // helpers still working on the current generation
+    bool stop_ = false;
+    std::atomic<size_t> next_{0};
+    std::vector<std::thread> helpers_;
+};
+
+// Copies `n` bytes, using streaming stores for the 16-byte aligned part of `dst` where available. Not fenced.
+void copy_streaming(void* dst, const void* src, size_t n);
@@ -0,0 +1,262 @@
+#include "cpu_topology.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <set>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sched.h>
+#endif
+
+namespace
+{
+std::vector<int> class_cpus(const CpuTopology& topo, bool lowest)
+{
+    if (!topo.hybrid())
+        return {};
+
+    auto [lo, hi] = std::minmax_element(topo.cpus.begin(), topo.cpus.end(), [](const auto& a, const auto& b)
+                                        { return a.efficiencyClass < b.efficiencyClass; });
+    int want = lowest ? lo->efficiencyClass : hi->efficiencyClass;
+
+    std::vector<int> out;
+    for (const auto& c : topo.cpus)
+        if (c.efficiencyClass == want)
+            out.push_back(c.id);
+    return out;
+}
+
+#ifndef _WIN32
+std::optional<std::string> read_line(const std::filesystem::path& p)
+{
+    std::ifstream in(p);
+    std::string line;
+    if (!in || !std::getline(in, line))
+        return std::nullopt;
+    return line;
+}
+
+int read_int(const std::filesystem::path& p, int fallback)
+{
+    auto line = read_line(p);
+    return line ? std::atoi(line->c_str()) : fallback;
+}
+#endif
+}  // namespace
+
+bool CpuTopology::hybrid() const
+{
+    return std::any_of(cpus.begin(), cpus.end(),
+                       [this](const auto& c) { return c.efficiencyClass != cpus.front().efficiencyClass; });
+}
+
+size_t CpuTopology::cores() const
+{
+    std::set<int> distinct;
+    for (const auto& c : cpus)
+        distinct.insert(c.core);
+    return distinct.size();
+}
+
+std::vector<int> CpuTopology::efficiency_cpus() const
+{
+    return class_cpus(*this, true);
+}
+
+std::vector<int> CpuTopology::performance_cpus() const
+{
+    return class_cpus(*this, false);
+}
+
+#ifndef _WIN32
+CpuTopology read_sysfs_topology(const std::filesystem::path& devices)
+{
+    CpuTopology topo;
+    auto cpuDir = devices / "system" / "cpu";
+    auto online = read_line(cpuDir / "online");
+    auto ids = online ? parse_cpu_list(*online) : std::nullopt;
+
+    if (!ids)
+        return topo;
+
+    std::vector<int> capacities;
+
+    for (int id : *ids)
+    {
+        auto dir = cpuDir / ("cpu" + std::to_string(id));
+        LogicalCpu c;
+        c.id = id;
+        int package = read_int(dir / "topology" / "physical_package_id", 0);
+        c.core = package << 16 | read_int(dir / "topology" / "core_id", id);
+        c.efficiencyClass = read_int(dir / "cpu_capacity", 0);
+        capacities.push_back(c.efficiencyClass);
+        topo.cpus.push_back(c);
+    }
+
+    // Intel hybrid parts list their E-cores under the cpu_atom PMU; otherwise rank Arm capacities into classes
+    if (auto atom = read_line(devices / "cpu_atom" / "cpus"))
+    {
+        auto eCores = parse_cpu_list(*atom).value_or(std::vector<int>{});
+        for (auto& c : topo.cpus)
+            c.efficiencyClass = std::find(eCores.begin(), eCores.end(), c.id) == eCores.end() ? 1 : 0;
+    }
+    else
+    {
+        std::sort(capacities.begin(), capacities.end());
+        capacities.erase(std::unique(capacities.begin(), capacities.end()), capacities.end());
+        for (auto& c : topo.cpus)
+            c.efficiencyClass = static_cast<int>(
+                std::lower_bound(capacities.begin(), capacities.end(), c.efficiencyClass) - capacities.begin());
+    }
+
+    return topo;
+}
+#endif
+
+CpuTopology detect_cpu_topology()
+{
+#ifdef _WIN32
+    CpuTopology topo;
+    ULONG len = 0;
+    GetSystemCpuSetInformation(nullptr, 0, &len, GetCurrentProcess(), 0);
+    std::vector<uint8_t> buf(len);
+
+    if (len == 0 || !GetSystemCpuSetInformation(reinterpret_cast<PSYSTEM_CPU_SET_INFORMATION>(buf.data()), len, &len,
+                                                GetCurrentProcess(), 0))
+        return topo;
+
+    for (ULONG off = 0; off < len;)
+    {
+        auto* info = reinterpret_cast<const SYSTEM_CPU_SET_INFORMATION*>(buf.data() + off);
+        off += info->Size;
+
+        if (info->Type != CpuSetInformation)
+            continue;
+
+        LogicalCpu c;
+        c.id = info->CpuSet.Group * 64 + info->CpuSet.LogicalProcessorIndex;
+        c.core = info->CpuSet.Group << 8 | info->CpuSet.CoreIndex;
+        c.efficiencyClass = info->CpuSet.EfficiencyClass;
+        c.osId = info->CpuSet.Id;
+        topo.cpus.push_back(c);
+    }
+
+    std::sort(topo.cpus.begin(), topo.cpus.end(), [](const auto& a, const auto& b) { return a.id < b.id; });
+    return topo;
+#else
+    return read_sysfs_topology("/sys/devices");
+#endif
+}
+
+std::optional<std::vector<int>> resolve_cpu_spec(std::string_view spec, const CpuTopology& topo)
+{
+    if (spec.empty() || spec == "any")
+        return std::vector<int>{};
+    if (spec == "efficiency")
+        return topo.efficiency_cpus();
+    if (spec == "performance")
+        return topo.performance_cpus();
+
+    auto cpus = parse_cpu_list(spec);
+    if (!cpus)
+        return std::nullopt;
+
+    // Ids the machine does not have are dropped rather than failing the whole placement
+    auto known = [&](int id)
+    { return std::any_of(topo.cpus.begin(), topo.cpus.end(), [id](const auto& c) { return c.id == id; }); };
+    std::erase_if(*cpus, [&](int id) { return !known(id); });
+    return cpus;
+}
+
+bool place_current_thread(const std::vector<int>& cpus, const CpuTopology& topo)
+{
+    if (cpus.empty())
+        return true;
+
+#ifdef _WIN32
+    std::vector<ULONG> ids;
+    for (const auto& c : topo.cpus)
+        if (std::find(cpus.begin(), cpus.end(), c.id) != cpus.end())
+            ids.push_back(c.osId);
+
+    return !ids.empty() && SetThreadSelectedCpuSets(GetCurrentThread(), ids.data(), static_cast<ULONG>(ids.size()));
+#else
+    (void)topo;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int id : cpus)
+        if (id >= 0 && id < CPU_SETSIZE)
+            CPU_SET(id, &set);
+
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+#endif
+}
+
+std::string format_cpu_list(const std::vector<int>& cpus)
+{
+    std::vector<int> sorted = cpus;
+    std::sort(sorted.begin(), sorted.end());
+    sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+
+    std::string out;
+    for (size_t i = 0; i < sorted.size();)
+    {
+        size_t j = i;
+        while (j + 1 < sorted.size() && sorted[j + 1] == sorted[j] + 1)
+            ++j;
+
+        if (!out.empty())
+            out += ',';
+        out += std::to_string(sorted[i]);
+        if (j > i)
+            out += '-' + std::to_string(sorted[j]);
+        i = j + 1;
+    }
+
+    return out;
+}
+
+std::optional<std::vector<int>> parse_cpu_list(std::string_view text)
+{
+    std::vector<int> out;
+
+    while (!text.empty() && (text.back() == '\n' || text.back() == '\r' || text.back() == ' '))
+        text.remove_suffix(1);
+
+    if (text.empty())
+        return std::nullopt;
+
+    for (size_t pos = 0; pos <= text.size();)
+    {
+        size_t end = text.find(',', pos);
+        if (end == std::string_view::npos)
+            end = text.size();
+
+        std::string range(text.substr(pos, end - pos));
+        char* rest = nullptr;
+        long lo = std::strtol(range.c_str(), &rest, 10);
+        long hi = lo;
+
+        if (rest == range.c_str())
+            return std::nullopt;
+        if (*rest == '-')
+        {
+            const char* hiStart = rest + 1;
+            hi = std::strtol(hiStart, &rest, 10);
+            if (rest == hiStart)
+                return std::nullopt;
+        }
+        if (*rest != '\0' || lo < 0 || hi < lo || hi >= 4096)
+            return std::nullopt;
+
+        for (long id = lo; id <= hi; ++id)
+            out.push_back(static_cast<int>(id));
+
+        pos = end + 1;
+    }
+
+    return out;
+}
@@ -0,0 +1,53 @@
+// Logical CPU layout and thread placement, so capture's background work stays off the cores the game renders on.
+//
+// On hybrid CPUs every logical CPU has an efficiency class: E-cores the lowest, P-cores the highest (the Windows
+// convention). Linux reads it from /sys/devices/cpu_atom (Intel hybrid) or ranks cpu_capacity (Arm big.LITTLE);
+// Windows reads the CPU sets the system reports. Machines with a single class report 0 everywhere.
+//
+// Placement specs (CAPTURE_WORKER_CPUS, CAPTURE_HANDOFF_CPUS):
+//   any           no restriction
+//   efficiency    the lowest-class CPUs on a hybrid machine, no restriction otherwise
+//   performance   the highest-class CPUs on a hybrid machine, no restriction otherwise
+//   0-3,8         explicit logical CPU ids (as in /proc/cpuinfo or Task Manager)
+// Linux pins with sched_setaffinity; Windows assigns CPU sets, which the scheduler treats as a strong preference
+// rather than a hard mask.
+#pragma once
+
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct LogicalCpu
+{
+    int id = 0;               // logical CPU number
+    int core = 0;             // physical core, unique across packages
+    int efficiencyClass = 0;  // higher is faster
+    unsigned osId = 0;        // Windows CPU set id
+};
+
+struct CpuTopology
+{
+    std::vector<LogicalCpu> cpus;  // ordered by id
+
+    bool hybrid() const;
+    size_t cores() const;
+    std::vector<int> efficiency_cpus() const;   // lowest class; empty unless hybrid
+    std::vector<int> performance_cpus() const;  // highest class; empty unless hybrid
+};
+
+CpuTopology detect_cpu_topology();
+#ifndef _WIN32
+// Topology from a sysfs tree rooted at `devices` (normally /sys/devices).
+CpuTopology read_sysfs_topology(const std::filesystem::path& devices);
+#endif
+
+// CPUs a placement spec selects; empty means no restriction, nullopt a malformed spec.
+std::optional<std::vector<int>> resolve_cpu_spec(std::string_view spec, const CpuTopology& topo);
+// Restricts the calling thread to `cpus` (no-op when empty). False if the OS refused.
+bool place_current_thread(const std::vector<int>& cpus, const CpuTopology& topo);
+
+// "0-3,8" form of a CPU list, and back (nullopt if malformed).
+std::string format_cpu_list(const std::vector<int>& cpus);
+std::optional<std::vector<int>> parse_cpu_list(std::string_view text);
@@ -0,0 +1,233 @@
+// hots_cursors: lists and updates consumer cursors (consumer_cursors.h), for consumers written as scripts and for
+// checking what is holding retention back.
+//
+//   hots_cursors [--dir D] list                     name, seq, lease, time since renewal, expired or live
+//   hots_cursors [--dir D] ack NAME SEQ [LEASE_MS]  registers NAME or moves it forward to SEQ (lease 30000 ms)
+//   hots_cursors [--dir D] renew NAME [LEASE_MS]    keeps NAME's lease alive without moving it
+//   hots_cursors [--dir D] release NAME             unregisters NAME
+//   hots_cursors [--dir D] scan                     capture's side: reports lapsed cursors, prints the floor
+//   hots_cursors [--dir D] consume NAME [LEASE_MS]  resumes NAME and acknowledges seq + 1 as fast as it can until
+//                                                   killed (scripts/cursor-stress.sh)
+//   hots_cursors [--dir D] --frames F retain KEEP   a stand-in for capture: writes empty frames into F, one every
+//                                                   millisecond, and reclaims them with FrameRetention against the
+//                                                   live cursors in D, until killed
+//
+// D defaults to <base>/sessions/current/state/cursors. Exits 1 if a cursor cannot be written.
+//
+// With --frames, consume reads each frame before acknowledging it, as a real consumer would: it waits for the frame
+// to be written and exits 3 if it was reclaimed while its cursor was live. Missing frames are skipped instead after
+// the consumer resumed lapsed or new, or let its own lease lapse (within kLapseGrace), since retention may have
+// reclaimed past it then.
+#include "consumer_cursors.h"
+#include "frame_retention.h"
+#include "paths.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+using Clock = std::chrono::steady_clock;
+
+// How long a consumer that let its lease lapse still expects frames after its cursor to be missing: a scan that left
+// it out of the floor may reclaim shortly after it wrote again
+constexpr auto kLapseGrace = std::chrono::seconds(1);
+
+static fs::path frame_path(const fs::path& framesDir, uint64_t seq)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "frame_%08llu.bmp", (unsigned long long)seq);
+    return framesDir / name;
+}
+
+// The newest frame the producer has written (0 before the first), published by renaming a temporary file over it
+static uint64_t newest_frame(const fs::path& framesDir)
+{
+    std::ifstream in(framesDir / "newest");
+    unsigned long long seq = 0;
+    in >> seq;
+    return seq;
+}
+
+static int retain(const fs::path& dir, const fs::path& framesDir, size_t keep)
+{
+    std::error_code ec;
+    fs::create_directories(framesDir, ec);
+    FrameRetention retention({keep});
+    CursorTable table(dir);
+    size_t reclaimed = 0, heldScans = 0;
+
+    for (uint64_t seq = 1;; ++seq)
+    {
+        auto path = frame_path(framesDir, seq);
+        if (!std::ofstream(path) || !(std::ofstream(framesDir / "newest.tmp") << seq))
+            return 1;
+        fs::rename(framesDir / "newest.tmp", framesDir / "newest", ec);
+        if (ec)
+            return 1;
+        retention.add(seq, {path});
+
+        if (seq % 10 == 0)
+        {
+            table.scan(unix_ms_now());
+            auto r = retention.reclaim(table.floor());
+            reclaimed += r.frames;
+            heldScans += r.held > 0;
+        }
+        if (seq % 1000 == 0)
+        {
+            printf("produced %llu reclaimed %zu retained %zu held in %zu scans\n", (unsigned long long)seq,
+                   reclaimed, retention.size(), heldScans);
+            fflush(stdout);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+static int consume(CursorLease& lease, const std::string& name, std::chrono::milliseconds leaseMs,
+                   const fs::path& framesDir)
+{
+    // Lapsed as far as a scan can tell: the cursor on disk was stamped more than a lease ago, less a margin for the
+    // clocks' millisecond rounding
+    const auto lapseAfter = leaseMs - std::chrono::milliseconds(5);
+    auto stamped = Clock::now();
+    auto tolerateUntil = lease.resumed() ? Clock::time_point{} : stamped + kLapseGrace;
+
+    auto ack = [&](uint64_t seq)
+    {
+        auto now = Clock::now();
+        if (now - stamped > lapseAfter)
+            tolerateUntil = now + kLapseGrace;
+        stamped = now;
+        return seq ? lease.ack(seq) : lease.renew();
+    };
+
+    for (uint64_t next = lease.seq() + 1;;)
+    {
+        if (next > newest_frame(framesDir))
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+            if (Clock::now() - stamped > leaseMs / 3 && !ack(0))
+                return 1;
+            continue;
+        }
+
+        bool present = fs::exists(frame_path(framesDir, next));
+        auto now = Clock::now();
+        if (!present && now >= tolerateUntil && now - stamped <= lapseAfter)
+        {
+            printf("MISSING %s seq=%llu reclaimed while its cursor at %llu was live\n", name.c_str(),
+                   (unsigned long long)next, (unsigned long long)lease.seq());
+            return 3;
+        }
+        // A frame reclaimed past a lapsed cursor is skipped without writing, on to the oldest one still present
+        if (present && !ack(next))
+            return 1;
+        ++next;
+    }
+}
+
+static int usage()
+{
+    fprintf(stderr, "usage: hots_cursors [--dir D] [--frames F] list | ack NAME SEQ [LEASE_MS] | "
+                    "renew NAME [LEASE_MS] | release NAME | scan | consume NAME [LEASE_MS] | retain KEEP\n");
+    return 2;
+}
+
+int main(int argc, char** argv)
+{
+    fs::path dir, framesDir;
+    std::vector<std::string> args;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string a = argv[i];
+
+        if (a == "--dir" && i + 1 < argc)
+            dir = argv[++i];
+        else if (a == "--frames" && i + 1 < argc)
+            framesDir = argv[++i];
+        else if (a.rfind("--", 0) == 0)
+            return usage();
+        else
+            args.push_back(a);
+    }
+
+    if (args.empty())
+        return usage();
+    if (dir.empty())
+        dir = state_dir() / "cursors";
+
+    const std::string& cmd = args[0];
+    auto leaseArg = [&](size_t i)
+    { return std::chrono::milliseconds(i < args.size() ? std::atoll(args[i].c_str()) : 30000); };
+
+    if (cmd == "list" && args.size() == 1)
+    {
+        int64_t now = unix_ms_now();
+        for (const auto& c : list_cursors(dir))
+            printf("%-24s seq=%llu lease_ms=%lld age_ms=%lld %s\n", c.name.c_str(), (unsigned long long)c.seq,
+                   (long long)c.lease.count(), (long long)(now - c.renewedUnixMs), c.expired(now) ? "expired" : "live");
+        return 0;
+    }
+
+    if (cmd == "scan" && args.size() == 1)
+    {
+        CursorTable table(dir);
+        auto s = table.scan(unix_ms_now());
+        for (const auto& c : s.expired)
+            printf("expired %s seq=%llu\n", c.name.c_str(), (unsigned long long)c.seq);
+        if (auto floor = table.floor())
+            printf("floor=%llu live=%zu\n", (unsigned long long)*floor, s.live.size());
+        else
+            printf("floor=none live=0\n");
+        return 0;
+    }
+
+    if (cmd == "retain" && args.size() == 2 && !framesDir.empty())
+        return retain(dir, framesDir, static_cast<size_t>(std::strtoull(args[1].c_str(), nullptr, 10)));
+
+    if (args.size() < 2 || !valid_consumer_name(args[1]))
+        return usage();
+
+    if (cmd == "ack" && (args.size() == 3 || args.size() == 4))
+    {
+        CursorLease lease(dir, args[1], leaseArg(3));
+        return lease.open() && lease.ack(std::strtoull(args[2].c_str(), nullptr, 10)) ? 0 : 1;
+    }
+
+    if (cmd == "renew" && (args.size() == 2 || args.size() == 3))
+    {
+        CursorLease lease(dir, args[1], leaseArg(2));
+        return lease.open() ? 0 : 1;
+    }
+
+    if (cmd == "consume" && (args.size() == 2 || args.size() == 3))
+    {
+        CursorLease lease(dir, args[1], leaseArg(2));
+        if (!lease.open())
+            return 1;
+        printf("%s resumed at seq=%llu (%s)\n", args[1].c_str(), (unsigned long long)lease.seq(),
+               lease.resumed() ? "live" : "lapsed or new");
+        fflush(stdout);
+        if (!framesDir.empty())
+            return consume(lease, args[1], leaseArg(2), framesDir);
+        while (lease.ack(lease.seq() + 1))
+        {
+        }
+        return 1;
+    }
+
+    if (cmd == "release" && args.size() == 2)
+    {
+        CursorLease(dir, args[1], std::chrono::milliseconds(1)).release();
+        return 0;
+    }
+
+    return usage();
+}
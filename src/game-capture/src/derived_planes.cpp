@@ -0,0 +1,233 @@
+#include "derived_planes.h"
+
+#include "image_pyramid.h"
+#include "yuv_convert.h"
+
+#include <algorithm>
+#include <cstring>
+
+PlanePool::PlanePool(size_t maxIdle) : maxIdle_(maxIdle) {}
+
+std::vector<uint8_t> PlanePool::acquire(size_t bytes)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_);
+
+        // Smallest idle buffer that fits, so large planes do not end up holding small ones' requests
+        auto best = idle_.end();
+        for (auto it = idle_.begin(); it != idle_.end(); ++it)
+            if (it->capacity() >= bytes && (best == idle_.end() || it->capacity() < best->capacity()))
+                best = it;
+
+        if (best != idle_.end())
+        {
+            std::vector<uint8_t> buf = std::move(*best);
+            *best = std::move(idle_.back());
+            idle_.pop_back();
+            ++reuses_;
+            buf.resize(bytes);
+            return buf;
+        }
+
+        ++allocations_;
+    }
+
+    return std::vector<uint8_t>(bytes);
+}
+
+void PlanePool::release(std::vector<uint8_t> buf)
+{
+    if (buf.capacity() == 0)
+        return;
+
+    std::lock_guard<std::mutex> lock(m_);
+
+    if (idle_.size() < maxIdle_)
+        idle_.push_back(std::move(buf));
+}
+
+PlanePool::Stats PlanePool::stats() const
+{
+    Stats st;
+    st.hits = hits_.load();
+    st.misses = misses_.load();
+
+    std::lock_guard<std::mutex> lock(m_);
+    st.allocations = allocations_;
+    st.reuses = reuses_;
+    st.idle = idle_.size();
+    for (const auto& b : idle_)
+        st.idleBytes += b.capacity();
+    return st;
+}
+
+DerivedFrame::DerivedFrame(const uint8_t* bgra, int width, int height, size_t stride, PlanePool& pool)
+    : bgra_(bgra), width_(width), height_(height), stride_(stride), pool_(pool)
+{
+}
+
+DerivedFrame::~DerivedFrame()
+{
+    pool_.release(std::move(luma_.buf));
+    pool_.release(std::move(half_.buf));
+    pool_.release(std::move(integral_.buf));
+
+    for (auto& [rect, slot] : crops_)
+        pool_.release(std::move(slot->buf));
+}
+
+template <class Produce>
+DerivedFrame::Slot& DerivedFrame::fill(Slot& slot, Produce&& produce)
+{
+    bool computed = false;
+    std::call_once(slot.once,
+                   [&]
+                   {
+                       produce(slot);
+                       computed = true;
+                   });
+
+    (computed ? misses_ : hits_).fetch_add(1, std::memory_order_relaxed);
+    (computed ? pool_.misses_ : pool_.hits_).fetch_add(1, std::memory_order_relaxed);
+    return slot;
+}
+
+PlaneView DerivedFrame::luma()
+{
+    return fill(luma_,
+                [this](Slot& s)
+                {
+                    s.buf = pool_.acquire(static_cast<size_t>(width_) * height_);
+
+                    YuvPlanes planes;
+                    planes.y = s.buf.data();
+                    planes.yPitch = static_cast<size_t>(width_);
+                    bgra_to_yuv_rows(bgra_, stride_, width_, 0, height_, YuvLayout::Y, planes,
+                                     {YuvMatrix::Bt601, YuvRange::Full});
+
+                    s.view = {width_, height_, static_cast<size_t>(width_), s.buf.data()};
+                })
+        .view;
+}
+
+PlaneView DerivedFrame::half()
+{
+    return fill(half_,
+                [this](Slot& s)
+                {
+                    int w = width_ / 2;
+                    int h = height_ / 2;
+                    size_t rowBytes = static_cast<size_t>(w) * 4;
+                    s.buf = pool_.acquire(rowBytes * h);
+
+                    for (int y = 0; y < h; ++y)
+                    {
+                        const uint8_t* r0 = bgra_ + static_cast<size_t>(2 * y) * stride_;
+                        box2x2_row(r0, r0 + stride_, s.buf.data() + y * rowBytes, w);
+                    }
+
+                    s.view = {w, h, rowBytes, s.buf.data()};
+                })
+        .view;
+}
+
+const uint32_t* DerivedFrame::integral()
+{
+    return reinterpret_cast<const uint32_t*>(
+        fill(integral_,
+             [this](Slot& s)
+             {
+                 PlaneView y = luma();
+                 size_t cols = static_cast<size_t>(width_) + 1;
+                 s.buf = pool_.acquire(cols * (height_ + 1) * sizeof(uint32_t));
+                 auto* sat = reinterpret_cast<uint32_t*>(s.buf.data());
+
+                 std::fill(sat, sat + cols, 0u);
+                 for (int r = 0; r < height_; ++r)
+                 {
+                     const uint8_t* src = y.data + static_cast<size_t>(r) * y.stride;
+                     const uint32_t* above = sat + r * cols;
+                     uint32_t* row = sat + (r + 1) * cols;
+                     uint32_t run = 0;
+
+                     row[0] = 0;
+                     for (int x = 0; x < width_; ++x)
+                     {
+                         run += src[x];
+                         row[x + 1] = above[x + 1] + run;
+                     }
+                 }
+
+                 s.view = {width_ + 1, height_ + 1, cols * sizeof(uint32_t), s.buf.data()};
+             })
+            .view.data);
+}
+
+uint64_t DerivedFrame::luma_sum(int x, int y, int w, int h)
+{
+    const uint32_t* sat = integral();
+    size_t cols = static_cast<size_t>(width_) + 1;
+    auto at = [&](int cx, int cy) { return static_cast<uint64_t>(sat[cy * cols + cx]); };
+
+    // Entries are mod 2^32 on frames past 4K; the difference is still exact for rectangles under 2^32 / 255 pixels
+    return static_cast<uint32_t>(at(x + w, y + h) - at(x, y + h) - at(x + w, y) + at(x, y));
+}
+
+const DerivedFrame::Histogram& DerivedFrame::histogram()
+{
+    bool computed = false;
+    std::call_once(histogramOnce_,
+                   [&]
+                   {
+                       constexpr int shift = 3;  // 256 levels -> kHistogramBins
+                       for (int y = 0; y < height_; ++y)
+                       {
+                           const uint8_t* p = bgra_ + static_cast<size_t>(y) * stride_;
+                           for (int x = 0; x < width_; ++x, p += 4)
+                           {
+                               ++histogram_[p[0] >> shift];
+                               ++histogram_[kHistogramBins + (p[1] >> shift)];
+                               ++histogram_[2 * kHistogramBins + (p[2] >> shift)];
+                           }
+                       }
+                       computed = true;
+                   });
+
+    (computed ? misses_ : hits_).fetch_add(1, std::memory_order_relaxed);
+    (computed ? pool_.misses_ : pool_.hits_).fetch_add(1, std::memory_order_relaxed);
+    return histogram_;
+}
+
+PlaneView DerivedFrame::crop(int x, int y, int w, int h)
+{
+    int x0 = std::clamp(x, 0, width_);
+    int y0 = std::clamp(y, 0, height_);
+    int x1 = std::clamp(x + w, x0, width_);
+    int y1 = std::clamp(y + h, y0, height_);
+
+    if (x1 == x0 || y1 == y0)
+        return {};
+
+    Slot* slot;
+    {
+        std::lock_guard<std::mutex> lock(cropsM_);
+        auto& entry = crops_[{x0, y0, x1, y1}];
+        if (!entry)
+            entry = std::make_unique<Slot>();
+        slot = entry.get();
+    }
+
+    return fill(*slot,
+                [&](Slot& s)
+                {
+                    size_t rowBytes = static_cast<size_t>(x1 - x0) * 4;
+                    s.buf = pool_.acquire(rowBytes * (y1 - y0));
+
+                    for (int r = y0; r < y1; ++r)
+                        memcpy(s.buf.data() + (r - y0) * rowBytes, bgra_ + r * stride_ + static_cast<size_t>(x0) * 4,
+                               rowBytes);
+
+                    s.view = {x1 - x0, y1 - y0, rowBytes, s.buf.data()};
+                })
+        .view;
+}
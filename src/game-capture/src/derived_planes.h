@@ -0,0 +1,120 @@
+// Planes derived from one captured frame (luma, half resolution, integral image, colour histogram, crops), computed
+// on first request and shared by every analysis stage that asks for them afterwards.
+//
+// Each plane is produced at most once per frame: the first caller, on whichever worker, computes it while concurrent
+// callers of the same plane wait, and everyone after that gets the stored result. A plane built from another plane
+// asks for it through the same accessor (the integral image requests luma), so shared inputs are computed once too.
+// Plane buffers come from a PlanePool and return to it when the DerivedFrame is destroyed, so a steady stream of
+// same-sized frames stops allocating after the first few. The BGRA pixels are borrowed and must outlive the frame.
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+struct PlaneView
+{
+    int width = 0;
+    int height = 0;
+    size_t stride = 0;  // bytes between rows
+    const uint8_t* data = nullptr;
+};
+
+// Recycles plane buffers between frames. Thread-safe.
+class PlanePool
+{
+public:
+    explicit PlanePool(size_t maxIdle = 32);
+
+    // A buffer of exactly `bytes` bytes (contents unspecified).
+    std::vector<uint8_t> acquire(size_t bytes);
+    void release(std::vector<uint8_t> buf);
+
+    struct Stats
+    {
+        uint64_t hits = 0;    // plane requests answered from a frame's cache
+        uint64_t misses = 0;  // plane requests that computed the plane
+        uint64_t allocations = 0;
+        uint64_t reuses = 0;
+        size_t idle = 0;
+        uint64_t idleBytes = 0;
+    };
+    Stats stats() const;
+
+private:
+    friend class DerivedFrame;
+
+    mutable std::mutex m_;
+    std::vector<std::vector<uint8_t>> idle_;
+    size_t maxIdle_;
+    uint64_t allocations_ = 0;
+    uint64_t reuses_ = 0;
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+};
+
+class DerivedFrame
+{
+public:
+    static constexpr int kHistogramBins = 32;                     // per channel, 8 levels each
+    using Histogram = std::array<uint32_t, 3 * kHistogramBins>;  // B bins, then G, then R
+
+    DerivedFrame(const uint8_t* bgra, int width, int height, size_t stride, PlanePool& pool);
+    ~DerivedFrame();
+
+    DerivedFrame(const DerivedFrame&) = delete;
+    DerivedFrame& operator=(const DerivedFrame&) = delete;
+
+    PlaneView bgra() const { return {width_, height_, stride_, bgra_}; }
+
+    // 8-bit full-range BT.601 luma, one byte per pixel (yuv_convert.h, Y layout).
+    PlaneView luma();
+    // BGRA at half width and height (2x2 box, as image_pyramid.h level 1).
+    PlaneView half();
+    // (width + 1) x (height + 1) summed-area table of luma: entry (x, y) is the luma sum over [0, x) x [0, y).
+    // Rows are width + 1 entries apart.
+    const uint32_t* integral();
+    // Luma sum over a rectangle, from the integral image; the rectangle must lie inside the frame.
+    uint64_t luma_sum(int x, int y, int w, int h);
+    const Histogram& histogram();
+    // BGRA copy of a rectangle, clipped to the frame (empty if nothing is left). Each distinct rectangle is cached.
+    PlaneView crop(int x, int y, int w, int h);
+
+    uint64_t hits() const { return hits_.load(); }
+    uint64_t misses() const { return misses_.load(); }
+
+private:
+    struct Slot
+    {
+        std::once_flag once;
+        std::vector<uint8_t> buf;
+        PlaneView view;
+    };
+
+    template <class Produce>
+    Slot& fill(Slot& slot, Produce&& produce);
+
+    const uint8_t* bgra_;
+    int width_;
+    int height_;
+    size_t stride_;
+    PlanePool& pool_;
+
+    Slot luma_;
+    Slot half_;
+    Slot integral_;
+    std::once_flag histogramOnce_;
+    Histogram histogram_{};
+
+    std::mutex cropsM_;
+    std::map<std::tuple<int, int, int, int>, std::unique_ptr<Slot>> crops_;
+
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+};
@@ -0,0 +1,352 @@
+#include "detection_sidecar.h"
+
+#include <algorithm>
+#include <charconv>
+#include <fstream>
+#include <sstream>
+#include <utility>
+
+namespace
+{
+// Just enough JSON for sidecars: a value tree, numbers as doubles
+struct JsonValue
+{
+    enum class Kind
+    {
+        Null,
+        Bool,
+        Number,
+        String,
+        Array,
+        Object,
+    };
+
+    Kind kind = Kind::Null;
+    bool boolean = false;
+    double number = 0;
+    std::string string;
+    std::vector<JsonValue> items;
+    std::vector<std::pair<std::string, JsonValue>> members;
+
+    const JsonValue* get(std::string_view key) const
+    {
+        if (kind != Kind::Object)
+            return nullptr;
+        for (const auto& [k, v] : members)
+            if (k == key)
+                return &v;
+        return nullptr;
+    }
+
+    double number_or(std::string_view key, double fallback) const
+    {
+        const JsonValue* v = get(key);
+        return v && v->kind == Kind::Number ? v->number : fallback;
+    }
+};
+
+class JsonParser
+{
+public:
+    explicit JsonParser(std::string_view text) : s_(text) {}
+
+    bool parse(JsonValue& out, std::string& error)
+    {
+        if (!value(out, 0) || (skip_ws(), pos_ != s_.size()))
+        {
+            error = "invalid JSON at offset " + std::to_string(pos_);
+            return false;
+        }
+        return true;
+    }
+
+private:
+    // Nesting past this is not a sidecar, and must not run the stack out
+    static constexpr int kMaxDepth = 64;
+
+    void skip_ws()
+    {
+        while (pos_ < s_.size() && (s_[pos_] == ' ' || s_[pos_] == '\t' || s_[pos_] == '\n' || s_[pos_] == '\r'))
+            ++pos_;
+    }
+
+    bool literal(std::string_view word)
+    {
+        if (s_.substr(pos_, word.size()) != word)
+            return false;
+        pos_ += word.size();
+        return true;
+    }
+
+    static void append_utf8(std::string& out, uint32_t cp)
+    {
+        if (cp < 0x80)
+        {
+            out += static_cast<char>(cp);
+        }
+        else if (cp < 0x800)
+        {
+            out += static_cast<char>(0xC0 | (cp >> 6));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+        else if (cp < 0x10000)
+        {
+            out += static_cast<char>(0xE0 | (cp >> 12));
+            out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+        else
+        {
+            out += static_cast<char>(0xF0 | (cp >> 18));
+            out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+    }
+
+    bool hex4(uint32_t& cp)
+    {
+        if (pos_ + 4 > s_.size())
+            return false;
+        auto r = std::from_chars(s_.data() + pos_, s_.data() + pos_ + 4, cp, 16);
+        if (r.ptr != s_.data() + pos_ + 4)
+            return false;
+        pos_ += 4;
+        return true;
+    }
+
+    bool string(std::string& out)
+    {
+        if (pos_ >= s_.size() || s_[pos_] != '"')
+            return false;
+        ++pos_;
+        while (pos_ < s_.size())
+        {
+            char c = s_[pos_++];
+            if (c == '"')
+                return true;
+            if (static_cast<unsigned char>(c) < 0x20)
+                return false;
+            if (c != '\\')
+            {
+                out += c;
+                continue;
+            }
+            if (pos_ >= s_.size())
+                return false;
+            switch (s_[pos_++])
+            {
+            case '"': out += '"'; break;
+            case '\\': out += '\\'; break;
+            case '/': out += '/'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'n': out += '\n'; break;
+            case 'r': out += '\r'; break;
+            case 't': out += '\t'; break;
+            case 'u': {
+                uint32_t cp = 0;
+                if (!hex4(cp))
+                    return false;
+                // A surrogate pair encodes one code point above the BMP
+                uint32_t low = 0;
+                if (cp >= 0xD800 && cp < 0xDC00 && literal("\\u") && hex4(low) && low >= 0xDC00 && low < 0xE000)
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                append_utf8(out, cp);
+                break;
+            }
+            default:
+                return false;
+            }
+        }
+        return false;
+    }
+
+    bool number(double& out)
+    {
+        size_t start = pos_;
+        while (pos_ < s_.size() && std::string_view("+-0123456789.eE").find(s_[pos_]) != std::string_view::npos)
+            ++pos_;
+        auto r = std::from_chars(s_.data() + start, s_.data() + pos_, out);
+        return r.ec == std::errc() && r.ptr == s_.data() + pos_;
+    }
+
+    bool value(JsonValue& out, int depth)
+    {
+        skip_ws();
+        if (pos_ >= s_.size() || depth > kMaxDepth)
+            return false;
+
+        switch (s_[pos_])
+        {
+        case '{': {
+            out.kind = JsonValue::Kind::Object;
+            ++pos_;
+            skip_ws();
+            if (pos_ < s_.size() && s_[pos_] == '}')
+                return ++pos_, true;
+            for (;;)
+            {
+                std::pair<std::string, JsonValue> member;
+                skip_ws();
+                if (!string(member.first))
+                    return false;
+                skip_ws();
+                if (pos_ >= s_.size() || s_[pos_++] != ':' || !value(member.second, depth + 1))
+                    return false;
+                out.members.push_back(std::move(member));
+                skip_ws();
+                if (pos_ < s_.size() && s_[pos_] == ',')
+                    ++pos_;
+                else
+                    return pos_ < s_.size() && s_[pos_++] == '}';
+            }
+        }
+        case '[': {
+            out.kind = JsonValue::Kind::Array;
+            ++pos_;
+            skip_ws();
+            if (pos_ < s_.size() && s_[pos_] == ']')
+                return ++pos_, true;
+            for (;;)
+            {
+                out.items.emplace_back();
+                if (!value(out.items.back(), depth + 1))
+                    return false;
+                skip_ws();
+                if (pos_ < s_.size() && s_[pos_] == ',')
+                    ++pos_;
+                else
+                    return pos_ < s_.size() && s_[pos_++] == ']';
+            }
+        }
+        case '"':
+            out.kind = JsonValue::Kind::String;
+            return string(out.string);
+        case 't':
+            out.kind = JsonValue::Kind::Bool;
+            out.boolean = true;
+            return literal("true");
+        case 'f':
+            out.kind = JsonValue::Kind::Bool;
+            return literal("false");
+        case 'n':
+            return literal("null");
+        default:
+            out.kind = JsonValue::Kind::Number;
+            return number(out.number);
+        }
+    }
+
+    std::string_view s_;
+    size_t pos_ = 0;
+};
+}  // namespace
+
+bool parse_detection_sidecar(std::string_view json, DetectionSidecar& out, std::string& error)
+{
+    JsonValue root;
+    if (!JsonParser(json).parse(root, error))
+        return false;
+
+    if (root.number_or("version", 0) != 3)
+    {
+        error = "not a version 3 detection sidecar";
+        return false;
+    }
+
+    out = {};
+    out.width = static_cast<int>(root.number_or("width", 0));
+    out.height = static_cast<int>(root.number_or("height", 0));
+    if (out.width <= 0 || out.height <= 0)
+    {
+        error = "sidecar has no frame size";
+        return false;
+    }
+    out.ts = root.number_or("ts", 0);
+    if (const JsonValue* frame = root.get("frame"); frame && frame->kind == JsonValue::Kind::String)
+        out.frame = frame->string;
+
+    out.regionWidth = out.width;
+    out.regionHeight = out.height;
+    const JsonValue* inference = root.get("inference");
+    if (const JsonValue* region = inference ? inference->get("region") : nullptr)
+    {
+        int w = static_cast<int>(region->number_or("width", 0));
+        int h = static_cast<int>(region->number_or("height", 0));
+        if (w > 0 && h > 0)
+        {
+            out.regionX = static_cast<int>(region->number_or("offset_x", 0));
+            out.regionY = static_cast<int>(region->number_or("offset_y", 0));
+            out.regionWidth = w;
+            out.regionHeight = h;
+        }
+    }
+
+    const JsonValue* objects = root.get("objects");
+    if (!objects || objects->kind != JsonValue::Kind::Array)
+        return true;
+
+    for (const JsonValue& o : objects->items)
+    {
+        const JsonValue* center = o.get("center");
+        if (!center || !center->get("x") || !center->get("y"))
+            continue;
+
+        SidecarObject obj;
+        obj.classId = static_cast<int>(o.number_or("class_id", -1));
+        if (const JsonValue* cls = o.get("class"); cls && cls->kind == JsonValue::Kind::String)
+            obj.className = cls->string;
+        obj.conf = o.number_or("conf", 0);
+        obj.x = center->number_or("x", 0);
+        obj.y = center->number_or("y", 0);
+        out.objects.push_back(std::move(obj));
+    }
+    return true;
+}
+
+bool read_detection_sidecar(const std::filesystem::path& path, DetectionSidecar& out, std::string& error)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+    {
+        error = "cannot open";
+        return false;
+    }
+    std::ostringstream text;
+    text << in.rdbuf();
+    return parse_detection_sidecar(text.str(), out, error);
+}
+
+void minimap_detections(const DetectionSidecar& sc, std::span<const int> classes, const FrameRect* minimap,
+                        std::vector<MinimapTracker::Detection>& out, std::vector<int>* objectIndex)
+{
+    double x0 = sc.regionX, y0 = sc.regionY, w = sc.regionWidth, h = sc.regionHeight;
+    if (minimap)
+    {
+        x0 = minimap->x * sc.width;
+        y0 = minimap->y * sc.height;
+        w = minimap->width * sc.width;
+        h = minimap->height * sc.height;
+    }
+
+    out.clear();
+    if (objectIndex)
+        objectIndex->clear();
+    if (w <= 0 || h <= 0)
+        return;
+
+    for (size_t i = 0; i < sc.objects.size(); ++i)
+    {
+        const SidecarObject& o = sc.objects[i];
+        if (!classes.empty() && std::find(classes.begin(), classes.end(), o.classId) == classes.end())
+            continue;
+        double x = (o.x - x0) / w;
+        double y = (o.y - y0) / h;
+        if (x < 0 || x > 1 || y < 0 || y > 1)
+            continue;
+        out.push_back({x, y, o.classId, o.conf});
+        if (objectIndex)
+            objectIndex->push_back(static_cast<int>(i));
+    }
+}
@@ -0,0 +1,57 @@
+// Reading hero-inference's per-frame detection sidecars (state/detections/<stem>.detections.json, version 3) for
+// native consumers such as the minimap tracker (minimap_tracker.h). Only the fields those need are kept:
+//   {"version": 3, "frame": "<stem>", "ts": <unix s>, "width": W, "height": H,
+//    "inference": {"region": {"offset_x", "offset_y", "width", "height"} | null, ...},
+//    "objects": [{"id", "class_id", "class", "conf", "bbox": {...}, "center": {"x", "y"}}, ...], ...}
+// Object ids are positions in the frame's list, not identities; the tracker is what links them across frames.
+#pragma once
+
+#include "minimap_tracker.h"
+
+#include <filesystem>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct SidecarObject
+{
+    int classId = -1;
+    std::string className;
+    double conf = 0;
+    double x = 0;  // centre, frame pixels
+    double y = 0;
+};
+
+struct DetectionSidecar
+{
+    std::string frame;
+    double ts = 0;  // when hero-inference wrote it, unix seconds
+    int width = 0;
+    int height = 0;
+    // The part of the frame the detector ran on (its crop), frame pixels; the whole frame when the sidecar has none
+    int regionX = 0;
+    int regionY = 0;
+    int regionWidth = 0;
+    int regionHeight = 0;
+    std::vector<SidecarObject> objects;
+};
+
+// False with `error` set if `json` is not valid JSON or not a version 3 sidecar with a frame size.
+bool parse_detection_sidecar(std::string_view json, DetectionSidecar& out, std::string& error);
+bool read_detection_sidecar(const std::filesystem::path& path, DetectionSidecar& out, std::string& error);
+
+// A rectangle as fractions of the frame
+struct FrameRect
+{
+    double x = 0;
+    double y = 0;
+    double width = 1;
+    double height = 1;
+};
+
+// Objects of `classes` (every class if empty) as tracker detections in minimap coordinates: centres relative to
+// `minimap`, or to the detector's region when it is null. Objects outside it are left out; `objectIndex`, if given,
+// gets each detection's position in sc.objects.
+void minimap_detections(const DetectionSidecar& sc, std::span<const int> classes, const FrameRect* minimap,
+                        std::vector<MinimapTracker::Detection>& out, std::vector<int>* objectIndex = nullptr);
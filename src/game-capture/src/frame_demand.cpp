@@ -0,0 +1,92 @@
+#include "frame_demand.h"
+
+void FrameDemand::update_earliest()
+{
+    int64_t earliest = kNone;
+
+    for (size_t i = 0; i < kSinks; ++i)
+    {
+        if ((requested_ & (1u << i)) && ticks(due_[i]) < earliest)
+            earliest = ticks(due_[i]);
+    }
+
+    earliestDue_.store(earliest, std::memory_order_release);
+}
+
+void FrameDemand::request(FrameSink sink, Clock::time_point due)
+{
+    std::lock_guard<std::mutex> lock(m_);
+    due_[static_cast<size_t>(sink)] = due;
+    requested_ |= bit(sink);
+    fulfilled_ &= ~bit(sink);
+    update_earliest();
+}
+
+void FrameDemand::cancel(FrameSink sink)
+{
+    std::lock_guard<std::mutex> lock(m_);
+    requested_ &= ~bit(sink);
+    update_earliest();
+}
+
+uint32_t FrameDemand::claim(Clock::time_point now)
+{
+    if (ticks(now) < earliestDue_.load(std::memory_order_acquire))
+        return 0;
+
+    std::lock_guard<std::mutex> lock(m_);
+    uint32_t due = 0;
+
+    for (size_t i = 0; i < kSinks; ++i)
+    {
+        if ((requested_ & (1u << i)) && due_[i] <= now)
+            due |= 1u << i;
+    }
+
+    requested_ &= ~due;
+    update_earliest();
+    return due;
+}
+
+void FrameDemand::fulfil(uint32_t sinks)
+{
+    std::lock_guard<std::mutex> lock(m_);
+    fulfilled_ |= sinks;
+}
+
+void FrameDemand::rearm(uint32_t sinks)
+{
+    std::lock_guard<std::mutex> lock(m_);
+    auto now = Clock::now();
+
+    for (size_t i = 0; i < kSinks; ++i)
+    {
+        if (sinks & (1u << i))
+            due_[i] = now;
+    }
+
+    requested_ |= sinks;
+    update_earliest();
+}
+
+bool FrameDemand::requested(FrameSink sink) const
+{
+    std::lock_guard<std::mutex> lock(m_);
+    return (requested_ & bit(sink)) != 0;
+}
+
+bool FrameDemand::take_fulfilled(FrameSink sink)
+{
+    std::lock_guard<std::mutex> lock(m_);
+    bool ready = (fulfilled_ & bit(sink)) != 0;
+    fulfilled_ &= ~bit(sink);
+    return ready;
+}
+
+void FrameDemand::reset()
+{
+    std::lock_guard<std::mutex> lock(m_);
+    requested_ = 0;
+    fulfilled_ = 0;
+    update_earliest();
+}
@@ -0,0 +1,60 @@
+// Demand-driven readback.
+//
+// Sinks register interest in the first compositor frame arriving at or after a due time. The FrameArrived callback
+// claims a frame only when some sink is due; every other frame is released straight back to the pool with no GPU
+// copy. Claimed sinks are marked fulfilled once the copy into the shared texture completes, and the owning thread
+// picks them up with take_fulfilled().
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+
+enum class FrameSink : uint8_t
+{
+    Saver,
+    Snapshot,
+    Video,
+    Count
+};
+
+class FrameDemand
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    void request(FrameSink sink, Clock::time_point due);
+    void cancel(FrameSink sink);
+
+    // Compositor side. claim() returns the bitmask of sinks due at `now` (0 = release the frame untouched); after
+    // the copy, fulfil() publishes the frame to them, or rearm() puts them back if the copy failed.
+    uint32_t claim(Clock::time_point now);
+    void fulfil(uint32_t sinks);
+    void rearm(uint32_t sinks);
+
+    bool requested(FrameSink sink) const;
+    bool take_fulfilled(FrameSink sink);
+
+    // Drops all requests and fulfilled frames (capture session teardown).
+    void reset();
+
+    static constexpr uint32_t bit(FrameSink sink) { return 1u << static_cast<uint32_t>(sink); }
+
+private:
+    static constexpr size_t kSinks = static_cast<size_t>(FrameSink::Count);
+    static constexpr int64_t kNone = std::numeric_limits<int64_t>::max();
+
+    static int64_t ticks(Clock::time_point t) { return t.time_since_epoch().count(); }
+    void update_earliest();
+
+    // Fast path for the 60-144 Hz callback: nothing is due before this tick count
+    std::atomic<int64_t> earliestDue_{kNone};
+
+    mutable std::mutex m_;
+    std::array<Clock::time_point, kSinks> due_{};
+    uint32_t requested_ = 0;
+    uint32_t fulfilled_ = 0;
+};
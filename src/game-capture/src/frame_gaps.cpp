@@ -0,0 +1,72 @@
+#include "frame_gaps.h"
+
+#include <cmath>
+#include <cstdio>
+
+static const char* const kBucketLabels[FrameGapTracker::kBuckets] = {"1", "2", "3-4", "5-8", "9-16", "17+"};
+
+void FrameGapTracker::set_refresh_hz(double hz)
+{
+    if (!(hz >= 1.0 && hz <= 1000.0))
+        hz = 60.0;
+
+    refreshHz_ = hz;
+    periodTicks_ = static_cast<int64_t>(std::llround(kTicksPerSecond / hz));
+}
+
+size_t FrameGapTracker::bucket_for(uint64_t missed)
+{
+    if (missed <= 2)
+        return static_cast<size_t>(missed - 1);
+    if (missed <= 4)
+        return 2;
+    if (missed <= 8)
+        return 3;
+    if (missed <= 16)
+        return 4;
+    return 5;
+}
+
+uint64_t FrameGapTracker::on_frame(int64_t systemRelativeTicks)
+{
+    delivered_.fetch_add(1, std::memory_order_relaxed);
+
+    int64_t prev = last_.exchange(systemRelativeTicks);
+
+    if (prev == 0 || systemRelativeTicks <= prev)
+        return 0;
+
+    int64_t delta = systemRelativeTicks - prev;
+
+    if (delta >= kIdleGap)
+    {
+        idleGaps_.fetch_add(1, std::memory_order_relaxed);
+        return 0;
+    }
+
+    // Round to whole periods so normal vsync jitter counts as zero drops
+    int64_t period = periodTicks_.load(std::memory_order_relaxed);
+    int64_t periods = (delta + period / 2) / period;
+
+    if (periods <= 1)
+        return 0;
+
+    auto missed = static_cast<uint64_t>(periods - 1);
+    dropped_.fetch_add(missed, std::memory_order_relaxed);
+    hist_[bucket_for(missed)].fetch_add(1, std::memory_order_relaxed);
+    return missed;
+}
+
+std::string FrameGapTracker::histogram() const
+{
+    std::string out;
+    char buf[48];
+
+    for (size_t i = 0; i < kBuckets; ++i)
+    {
+        snprintf(buf, sizeof(buf), "%s%s:%llu", i ? "," : "", kBucketLabels[i], (unsigned long long)hist_[i].load());
+        out += buf;
+    }
+
+    return out;
+}
@@ -0,0 +1,49 @@
+// Dropped-frame accounting from compositor timestamps.
+//
+// Each delivered frame carries SystemRelativeTime (100 ns ticks). A delta of k refresh periods between consecutive
+// frames means k-1 compositor frames were presented but never reached us, typically because the pool was full while
+// the callback was busy. Gaps longer than kIdleGap are treated as the source going idle (minimised, loading screen
+// without presents) rather than drops.
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+class FrameGapTracker
+{
+public:
+    // Histogram buckets by frames missed in one gap: 1, 2, 3-4, 5-8, 9-16, 17+
+    static constexpr size_t kBuckets = 6;
+    static constexpr int64_t kTicksPerSecond = 10'000'000;
+    static constexpr int64_t kIdleGap = kTicksPerSecond / 2;
+
+    void set_refresh_hz(double hz);
+    double refresh_hz() const { return refreshHz_.load(); }
+
+    // Called for every frame delivered by the pool (claimed or not). Returns the frames dropped before this one.
+    uint64_t on_frame(int64_t systemRelativeTicks);
+
+    // Forget the previous timestamp (new capture session) while keeping totals.
+    void restart() { last_.store(0); }
+
+    uint64_t delivered() const { return delivered_.load(); }
+    uint64_t dropped() const { return dropped_.load(); }
+    uint64_t idle_gaps() const { return idleGaps_.load(); }
+    uint64_t bucket(size_t i) const { return hist_[i].load(); }
+
+    // "1:n,2:n,3-4:n,5-8:n,9-16:n,17+:n"
+    std::string histogram() const;
+
+private:
+    static size_t bucket_for(uint64_t missed);
+
+    std::atomic<double> refreshHz_{60.0};
+    std::atomic<int64_t> periodTicks_{kTicksPerSecond / 60};
+    std::atomic<int64_t> last_{0};
+    std::atomic<uint64_t> delivered_{0};
+    std::atomic<uint64_t> dropped_{0};
+    std::atomic<uint64_t> idleGaps_{0};
+    std::array<std::atomic<uint64_t>, kBuckets> hist_{};
+};
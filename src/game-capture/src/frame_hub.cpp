@@ -0,0 +1,267 @@
+#include "frame_hub.h"
+
+#include <algorithm>
+
+FrameHub::FramePtr FrameHub::Subscription::next(std::chrono::milliseconds timeout)
+{
+    std::unique_lock<std::mutex> lock(m_);
+
+    if (!cv_.wait_for(lock, timeout, [&] { return closed_ || queued_ > 0; }) || closed_)
+        return nullptr;
+
+    // Round-robin: the first non-empty node queue after the one served last
+    auto it = queues_.upper_bound(lastServed_);
+    if (it == queues_.end())
+        it = queues_.begin();
+
+    FramePtr f = std::move(it->second.front());
+    it->second.pop_front();
+    lastServed_ = it->first;
+
+    if (it->second.empty())
+        queues_.erase(it);
+
+    --queued_;
+    if (f->data)
+        queuedBytes_ -= f->size;
+
+    delivered_.fetch_add(1, std::memory_order_relaxed);
+    return f;
+}
+
+void FrameHub::Subscription::close()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_);
+        closed_ = true;
+        queues_.clear();
+        queued_ = 0;
+        queuedBytes_ = 0;
+    }
+    cv_.notify_all();
+}
+
+void FrameHub::Subscription::push(FramePtr f, size_t maxQueue)
+{
+    if (closed_)
+        return;
+
+    if (f->data)
+        queuedBytes_ += f->size;
+
+    queues_[f->node].push_back(std::move(f));
+    ++queued_;
+
+    while (queued_ > maxQueue && drop_oldest())
+    {
+    }
+}
+
+bool FrameHub::Subscription::drop_oldest()
+{
+    auto longest = std::max_element(queues_.begin(), queues_.end(),
+                                    [](const auto& a, const auto& b) { return a.second.size() < b.second.size(); });
+
+    if (longest == queues_.end() || longest->second.empty())
+        return false;
+
+    if (longest->second.front()->data)
+        queuedBytes_ -= longest->second.front()->size;
+
+    longest->second.pop_front();
+    if (longest->second.empty())
+        queues_.erase(longest);
+
+    --queued_;
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+FrameHub::FrameHub(Config cfg) : cfg_(cfg), memory_(std::make_shared<std::atomic<uint64_t>>(0)) {}
+
+void FrameHub::publish(Frame f, std::vector<uint8_t> data)
+{
+    f.data.reset();
+    if (!data.empty())
+        f.size = data.size();
+    auto meta = std::make_shared<const Frame>(f);
+    FramePtr live = meta;
+
+    if (!data.empty())
+    {
+        uint64_t size = data.size();
+        memory_->fetch_add(size);
+        f.data = std::shared_ptr<const std::vector<uint8_t>>(new std::vector<uint8_t>(std::move(data)),
+                                                             [memory = memory_, size](const std::vector<uint8_t>* p)
+                                                             {
+                                                                 memory->fetch_sub(size);
+                                                                 delete p;
+                                                             });
+        live = std::make_shared<const Frame>(std::move(f));
+    }
+
+    std::lock_guard<std::mutex> lock(m_);
+    index(meta);
+
+    for (const auto& sub : subs_)
+    {
+        if (!sub->matches(*live))
+            continue;
+
+        {
+            std::lock_guard<std::mutex> subLock(sub->m_);
+            sub->push(live, cfg_.maxQueue);
+        }
+        sub->cv_.notify_one();
+    }
+
+    live.reset();
+    enforce_budget();
+}
+
+void FrameHub::enforce_budget()
+{
+    while (memory_->load() > cfg_.memoryBudget)
+    {
+        // Take from the subscription holding the most queued bytes
+        Subscription* heaviest = nullptr;
+        uint64_t most = 0;
+
+        for (const auto& sub : subs_)
+        {
+            std::lock_guard<std::mutex> subLock(sub->m_);
+            if (sub->queuedBytes_ > most)
+            {
+                most = sub->queuedBytes_;
+                heaviest = sub.get();
+            }
+        }
+
+        // Whatever remains is held by senders mid-write and is released when they finish
+        if (!heaviest)
+            return;
+
+        std::lock_guard<std::mutex> subLock(heaviest->m_);
+        if (!heaviest->drop_oldest())
+            return;
+        ++budgetDrops_;
+    }
+}
+
+void FrameHub::index(const FramePtr& meta)
+{
+    Key key{meta->node, meta->epoch, meta->seq};
+    auto existing = byKey_.find(key);
+
+    // A node that re-ships a frame (after losing its ack) replaces the entry
+    if (existing != byKey_.end())
+    {
+        auto [lo, hi] = byTime_.equal_range(existing->second->unixMs);
+        for (auto it = lo; it != hi; ++it)
+        {
+            if (it->second == key)
+            {
+                byTime_.erase(it);
+                break;
+            }
+        }
+    }
+
+    byKey_[key] = meta;
+    byTime_.emplace(meta->unixMs, key);
+
+    while (byKey_.size() > cfg_.indexLimit)
+    {
+        byKey_.erase(byTime_.begin()->second);
+        byTime_.erase(byTime_.begin());
+    }
+}
+
+std::shared_ptr<FrameHub::Subscription> FrameHub::subscribe(std::string node, std::optional<int64_t> fromMs, int level)
+{
+    auto sub = std::make_shared<Subscription>();
+    sub->node_ = std::move(node);
+    sub->level_ = level;
+
+    std::lock_guard<std::mutex> lock(m_);
+
+    if (fromMs)
+    {
+        std::vector<FramePtr> history;
+        for (auto it = byTime_.lower_bound(*fromMs); it != byTime_.end(); ++it)
+        {
+            const auto& f = byKey_.at(it->second);
+            if (sub->matches(*f))
+                history.push_back(f);
+        }
+
+        size_t skip = history.size() > cfg_.maxQueue ? history.size() - cfg_.maxQueue : 0;
+        std::lock_guard<std::mutex> subLock(sub->m_);
+        for (size_t i = skip; i < history.size(); ++i)
+            sub->push(history[i], cfg_.maxQueue);
+    }
+
+    subs_.push_back(sub);
+    return sub;
+}
+
+void FrameHub::unsubscribe(const std::shared_ptr<Subscription>& sub)
+{
+    sub->close();
+
+    std::lock_guard<std::mutex> lock(m_);
+    subs_.erase(std::remove(subs_.begin(), subs_.end(), sub), subs_.end());
+}
+
+void FrameHub::forget(const std::string& node, uint64_t epoch)
+{
+    std::lock_guard<std::mutex> lock(m_);
+
+    for (auto it = byTime_.begin(); it != byTime_.end();)
+    {
+        const auto& [n, e, seq] = it->second;
+        if (n == node && e == epoch)
+        {
+            byKey_.erase(it->second);
+            it = byTime_.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+bool FrameHub::has_subscribers() const
+{
+    std::lock_guard<std::mutex> lock(m_);
+    return !subs_.empty();
+}
+
+FrameHub::FramePtr FrameHub::find(const std::string& node, uint64_t epoch, uint64_t seq) const
+{
+    std::lock_guard<std::mutex> lock(m_);
+    auto it = byKey_.find(Key{node, epoch, seq});
+    return it == byKey_.end() ? nullptr : it->second;
+}
+
+std::vector<FrameHub::FramePtr> FrameHub::range(const std::string& node, int64_t fromMs, int64_t toMs) const
+{
+    std::lock_guard<std::mutex> lock(m_);
+    std::vector<FramePtr> out;
+
+    for (auto it = byTime_.lower_bound(fromMs); it != byTime_.end() && it->first <= toMs; ++it)
+    {
+        const auto& f = byKey_.at(it->second);
+        if (node.empty() || f->node == node)
+            out.push_back(f);
+    }
+
+    return out;
+}
+
+FrameHub::Stats FrameHub::stats() const
+{
+    std::lock_guard<std::mutex> lock(m_);
+    return Stats{byKey_.size(), subs_.size(), memory_->load(), budgetDrops_};
+}
@@ -0,0 +1,122 @@
+// Frame fan-out for hots_aggregator: merges the frames shipped by every capture node and serves them to subscribers.
+//
+// Every published frame is indexed by (node, epoch, seq) and by capture time, so a subscriber can ask for history
+// (from_ms) before switching to live frames. Live frames carry their bytes in memory, shared by all subscribers that
+// queued them; indexed history is read back from the store when it is sent. A subscription sees one pyramid level
+// (image_pyramid.h): full frames by default, or only the reduced copies of one level.
+//
+// Fairness and memory:
+//   - Each subscription keeps one queue per node and serves them round-robin, so a node shipping at a high rate
+//     cannot starve frames from the others.
+//   - A subscription holds at most maxQueue frames; beyond that its oldest frame from its longest node queue drops.
+//   - Frame bytes referenced by any queue or sender count against one global memoryBudget. Over budget, frames drop
+//     from whichever subscription has the most bytes queued, so one slow consumer cannot push the others out.
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <vector>
+
+class FrameHub
+{
+public:
+    struct Config
+    {
+        uint64_t memoryBudget = 256ull << 20;
+        size_t maxQueue = 64;
+        size_t indexLimit = 1 << 20;  // frames kept in the index; the oldest by capture time go first
+    };
+
+    struct Frame
+    {
+        std::string node;
+        uint64_t epoch = 0;
+        uint64_t seq = 0;
+        int64_t unixMs = 0;  // capture time reported by the node
+        std::filesystem::path path;
+        uint64_t size = 0;
+        std::shared_ptr<const std::vector<uint8_t>> data;  // null: read `path` when sending
+        int level = 0;                                     // pyramid level; 0 is the frame itself
+    };
+    using FramePtr = std::shared_ptr<const Frame>;
+
+    class Subscription
+    {
+    public:
+        // Next frame, round-robin across nodes; null on timeout or once closed.
+        FramePtr next(std::chrono::milliseconds timeout);
+        void close();
+
+        uint64_t delivered() const { return delivered_.load(); }
+        uint64_t dropped() const { return dropped_.load(); }
+
+    private:
+        friend class FrameHub;
+
+        bool matches(const Frame& f) const { return (node_.empty() || node_ == f.node) && level_ == f.level; }
+        void push(FramePtr f, size_t maxQueue);  // caller holds m_
+        bool drop_oldest();                      // caller holds m_
+
+        std::string node_;  // empty: all nodes
+        int level_ = 0;
+        std::mutex m_;
+        std::condition_variable cv_;
+        std::map<std::string, std::deque<FramePtr>> queues_;
+        std::string lastServed_;
+        size_t queued_ = 0;
+        uint64_t queuedBytes_ = 0;
+        bool closed_ = false;
+        std::atomic<uint64_t> delivered_{0};
+        std::atomic<uint64_t> dropped_{0};
+    };
+
+    explicit FrameHub(Config cfg);
+
+    // Indexes a completed frame and hands it to matching subscribers. `data` may be empty when nobody subscribes.
+    void publish(Frame f, std::vector<uint8_t> data);
+
+    // `node` empty subscribes to every node. With `fromMs`, indexed frames captured at or after it are queued first
+    // (the newest maxQueue of them). Only frames of pyramid level `level` are delivered.
+    std::shared_ptr<Subscription> subscribe(std::string node, std::optional<int64_t> fromMs, int level = 0);
+    void unsubscribe(const std::shared_ptr<Subscription>& sub);
+
+    // Drops an epoch's frames from the index (retention deleted them from the store).
+    void forget(const std::string& node, uint64_t epoch);
+
+    bool has_subscribers() const;
+    FramePtr find(const std::string& node, uint64_t epoch, uint64_t seq) const;
+    std::vector<FramePtr> range(const std::string& node, int64_t fromMs, int64_t toMs) const;
+
+    struct Stats
+    {
+        size_t indexed = 0;
+        size_t subscribers = 0;
+        uint64_t memoryBytes = 0;
+        uint64_t budgetDrops = 0;
+    };
+    Stats stats() const;
+
+private:
+    using Key = std::tuple<std::string, uint64_t, uint64_t>;
+
+    void index(const FramePtr& meta);
+    void enforce_budget();
+
+    Config cfg_;
+    mutable std::mutex m_;
+    std::map<Key, FramePtr> byKey_;
+    std::multimap<int64_t, Key> byTime_;
+    std::vector<std::shared_ptr<Subscription>> subs_;
+    std::shared_ptr<std::atomic<uint64_t>> memory_;  // shared with frame buffers, which release it when freed
+    uint64_t budgetDrops_ = 0;
+};
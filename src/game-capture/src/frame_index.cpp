@@ -0,0 +1,384 @@
+#include "frame_index.h"
+
+#include "checksum.h"
+#include "fs_util.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+constexpr uint32_t kRecordMagic = 0x58444946;  // "FIDX"
+constexpr size_t kPathBytes = 100;
+
+struct Record
+{
+    uint32_t magic;
+    uint8_t type;
+    uint8_t more;  // PathMore records that follow with the rest of a path longer than kPathBytes
+    uint8_t reserved[2];
+    uint64_t seq;
+    int64_t unixMs;
+    char path[kPathBytes];  // relative to the session directory, '/' separated, NUL padded unless full
+    uint32_t crc;
+};
+
+static_assert(sizeof(Record) == 128, "index records are fixed-size so the tail can be located by seeking");
+
+// Longest path a record and its continuations can carry; far beyond any path the filesystem takes
+constexpr size_t kMaxPathBytes = kPathBytes * 256;
+
+uint32_t record_crc(const Record& r)
+{
+    return crc32_update(0, &r, offsetof(Record, crc));
+}
+
+bool record_valid(const Record& r)
+{
+    return r.magic == kRecordMagic && r.crc == record_crc(r);
+}
+
+std::string_view record_path(const Record& r)
+{
+    std::string_view path(r.path, kPathBytes);
+    return path.substr(0, path.find('\0'));
+}
+
+FILE* open_file(const std::filesystem::path& p, const char* mode)
+{
+#ifdef _WIN32
+    std::wstring wmode(mode, mode + strlen(mode));
+    return _wfopen(p.wstring().c_str(), wmode.c_str());
+#else
+    return fopen(p.c_str(), mode);
+#endif
+}
+
+// A BMP is complete when the size recorded in its file header matches what is on disk; a JPEG (which records no size)
+// when it ends in the end-of-image marker
+bool frame_complete(const std::filesystem::path& p)
+{
+    std::error_code ec;
+    auto size = std::filesystem::file_size(p, ec);
+
+    if (ec || size < 14)
+        return false;
+
+    FILE* f = open_file(p, "rb");
+
+    if (!f)
+        return false;
+
+    unsigned char header[14];
+    bool ok = fread(header, 1, sizeof(header), f) == sizeof(header);
+    unsigned char tail[2] = {};
+    if (ok && header[0] == 0xFF && header[1] == 0xD8)
+        ok = fseek(f, -2, SEEK_END) == 0 && fread(tail, 1, sizeof(tail), f) == sizeof(tail);
+    fclose(f);
+
+    if (!ok)
+        return false;
+    if (header[0] == 0xFF && header[1] == 0xD8)
+        return tail[0] == 0xFF && tail[1] == 0xD9;
+    if (header[0] != 'B' || header[1] != 'M')
+        return false;
+
+    uint32_t declared;
+    memcpy(&declared, header + 2, sizeof(declared));
+    return declared == size;
+}
+}  // namespace
+
+FrameIndex::FrameIndex(std::filesystem::path indexPath, std::filesystem::path root)
+    : indexPath_(std::move(indexPath)), root_(std::move(root))
+{
+}
+
+FrameIndex::~FrameIndex()
+{
+    if (f_)
+        fclose(f_);
+}
+
+FrameIndex::Recovery FrameIndex::recover()
+{
+    std::lock_guard<std::mutex> lock(m_);
+    Recovery rec;
+
+    std::error_code ec;
+    uint64_t size = std::filesystem::file_size(indexPath_, ec);
+
+    if (ec)
+        size = 0;
+
+    // Drop a half-written trailing record before appending after it
+    uint64_t whole = size - size % sizeof(Record);
+    if (whole != size)
+    {
+        std::filesystem::resize_file(indexPath_, whole, ec);
+        rec.tornBytes = static_cast<size_t>(size - whole);
+    }
+
+    uint64_t count = whole / sizeof(Record);
+    uint64_t first = count > kTailRecords ? count - kTailRecords : 0;
+    std::vector<Record> tail;
+
+    if (FILE* f = open_file(indexPath_, "rb"))
+    {
+        tail.resize(static_cast<size_t>(count - first));
+#ifdef _WIN32
+        _fseeki64(f, static_cast<int64_t>(first * sizeof(Record)), SEEK_SET);
+#else
+        fseeko(f, static_cast<off_t>(first * sizeof(Record)), SEEK_SET);
+#endif
+        tail.resize(fread(tail.data(), sizeof(Record), tail.size(), f));
+
+        Record head{};
+        if (first > 0)
+        {
+            fseek(f, 0, SEEK_SET);
+            if (fread(&head, sizeof(head), 1, f) == 1 && head.magic == kRecordMagic && head.crc == record_crc(head))
+                epoch_ = static_cast<uint64_t>(head.unixMs);
+        }
+        else if (!tail.empty() && tail[0].magic == kRecordMagic && tail[0].crc == record_crc(tail[0]))
+        {
+            epoch_ = static_cast<uint64_t>(tail[0].unixMs);
+        }
+
+        fclose(f);
+    }
+
+    rec.recordsScanned = tail.size();
+
+    // Reconcile: seq -> path of Begins that never saw Commit/Abort
+    bool any = false;
+    uint64_t lastSeq = 0;
+    std::map<uint64_t, std::string> open;
+    std::map<uint64_t, std::string> committed;
+
+    for (size_t i = 0; i < tail.size(); ++i)
+    {
+        const Record& r = tail[i];
+        // A continuation on its own belongs to a record from before the tail
+        if (!record_valid(r) || static_cast<RecordType>(r.type) == RecordType::PathMore)
+            continue;
+
+        // A record whose continuations did not all make it (crash mid-append) is as if never written
+        std::string path(record_path(r));
+        size_t k = 1;
+        for (; k <= r.more && i + k < tail.size(); ++k)
+        {
+            const Record& c = tail[i + k];
+            if (!record_valid(c) || static_cast<RecordType>(c.type) != RecordType::PathMore || c.seq != r.seq)
+                break;
+            path += record_path(c);
+        }
+        if (k <= r.more)
+            continue;
+        i += r.more;
+
+        lastSeq = any ? std::max(lastSeq, r.seq) : r.seq;
+        any = true;
+
+        switch (static_cast<RecordType>(r.type))
+        {
+        case RecordType::Begin:
+            if (!path.empty())  // an unstorable path: nothing recovery could safely touch
+                open[r.seq] = path;
+            break;
+        case RecordType::Commit:
+            open.erase(r.seq);
+            committed[r.seq] = path;
+            break;
+        case RecordType::Abort:
+            open.erase(r.seq);
+            break;
+        default:
+            break;
+        }
+    }
+
+    nextSeq_ = any ? lastSeq + 1 : 0;
+    rec.nextSeq = nextSeq_;
+
+    f_ = open_file(indexPath_, "ab");
+
+    if (!any)
+    {
+        // Fresh index: the first record fixes the epoch
+        epoch_ = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                                           std::chrono::system_clock::now().time_since_epoch())
+                                           .count());
+        append(RecordType::Checkpoint, 0, {});
+    }
+
+    for (const auto& [seq, rel] : open)
+    {
+        auto finalPath = root_ / std::filesystem::path(rel);
+        auto pending = finalPath;
+        pending += ".pending";
+
+        if (std::filesystem::exists(finalPath, ec))
+        {
+            // Crashed between rename and Commit
+            std::filesystem::remove(pending, ec);
+            append(RecordType::Commit, seq, finalPath);
+            committed[seq] = rel;
+        }
+        else if (frame_complete(pending))
+        {
+            std::filesystem::rename(pending, finalPath, ec);
+            append(ec ? RecordType::Abort : RecordType::Commit, seq, finalPath);
+            if (!ec)
+            {
+                committed[seq] = rel;
+                ++rec.finalized;
+            }
+        }
+        else
+        {
+            if (std::filesystem::remove(pending, ec))
+                ++rec.removed;
+            append(RecordType::Abort, seq, finalPath);
+        }
+    }
+
+    if (f_)
+        fflush(f_);
+
+    for (const auto& [seq, rel] : committed)
+        recentCommits_.emplace_back(seq, root_ / std::filesystem::path(rel));
+
+    if (any && whole > kCompactBytes)
+        rec.compacted = compact(lastSeq);
+
+    return rec;
+}
+
+bool FrameIndex::compact(uint64_t lastSeq)
+{
+    auto tmp = indexPath_;
+    tmp += ".compact";
+
+    FILE* out = open_file(tmp, "wb");
+
+    if (!out)
+        return false;
+
+    Record r{};
+    r.magic = kRecordMagic;
+    r.type = static_cast<uint8_t>(RecordType::Checkpoint);
+    r.seq = lastSeq;
+    r.unixMs = static_cast<int64_t>(epoch_);  // the checkpoint becomes the first record and carries the epoch
+    r.crc = record_crc(r);
+
+    bool ok = fwrite(&r, sizeof(r), 1, out) == 1;
+    ok = fclose(out) == 0 && ok;
+    ok = ok && sync_file(tmp);
+
+    if (!ok)
+    {
+        std::error_code ec;
+        std::filesystem::remove(tmp, ec);
+        return false;
+    }
+
+    if (f_)
+    {
+        fclose(f_);
+        f_ = nullptr;
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tmp, indexPath_, ec);
+    sync_dir(indexPath_.parent_path());
+    f_ = open_file(indexPath_, "ab");
+    return !ec;
+}
+
+uint64_t FrameIndex::next_seq()
+{
+    std::lock_guard<std::mutex> lock(m_);
+    return nextSeq_++;
+}
+
+void FrameIndex::append(RecordType type, uint64_t seq, const std::filesystem::path& finalPath)
+{
+    if (!f_)
+        return;
+
+    Record r{};
+    r.magic = kRecordMagic;
+    r.type = static_cast<uint8_t>(type);
+    r.seq = seq;
+    r.unixMs = type == RecordType::Checkpoint ? static_cast<int64_t>(epoch_)
+                                              : std::chrono::duration_cast<std::chrono::milliseconds>(
+                                                    std::chrono::system_clock::now().time_since_epoch())
+                                                    .count();
+
+    // Paths the session directory cannot reach relatively (another drive) are stored whole. One too long even for
+    // continuations is not stored at all, so recovery never acts on a path other than the frame's.
+    std::string rel = finalPath.lexically_relative(root_).generic_string();
+    if (rel.empty())
+        rel = finalPath.generic_string();
+    if (rel.size() > kMaxPathBytes)
+        rel.clear();
+
+    // The record takes the first kPathBytes of the path and PathMore records the rest, appended in one write
+    size_t chunks = std::max<size_t>(1, (rel.size() + kPathBytes - 1) / kPathBytes);
+    std::vector<Record> records(chunks, r);
+    records[0].more = static_cast<uint8_t>(chunks - 1);
+    for (size_t i = 0; i < chunks; ++i)
+    {
+        if (i > 0)
+            records[i].type = static_cast<uint8_t>(RecordType::PathMore);
+        size_t at = i * kPathBytes;
+        if (at < rel.size())
+            memcpy(records[i].path, rel.data() + at, std::min(kPathBytes, rel.size() - at));
+        records[i].crc = record_crc(records[i]);
+    }
+    fwrite(records.data(), sizeof(Record), records.size(), f_);
+}
+
+void FrameIndex::begin(uint64_t seq, const std::filesystem::path& finalPath)
+{
+    std::lock_guard<std::mutex> lock(m_);
+    append(RecordType::Begin, seq, finalPath);
+
+    // Must reach the OS before the .pending file exists, or a crash would leave an orphan the tail cannot name
+    if (f_)
+        fflush(f_);
+}
+
+void FrameIndex::commit(uint64_t seq, const std::filesystem::path& finalPath)
+{
+    std::lock_guard<std::mutex> lock(m_);
+    append(RecordType::Commit, seq, finalPath);
+    if (f_)
+        fflush(f_);
+}
+
+void FrameIndex::abort(uint64_t seq, const std::filesystem::path& finalPath)
+{
+    std::lock_guard<std::mutex> lock(m_);
+    append(RecordType::Abort, seq, finalPath);
+    if (f_)
+        fflush(f_);
+}
+
+void FrameIndex::sync()
+{
+    std::lock_guard<std::mutex> lock(m_);
+
+    if (f_)
+    {
+        fflush(f_);
+        sync_file(indexPath_);
+    }
+}
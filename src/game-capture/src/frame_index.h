@@ -0,0 +1,87 @@
+// Append-only frame index (sessions/current/state/frames.idx) for crash-consistent restarts.
+//
+// Every save appends Begin{seq, path} before the .pending file is written and Commit/Abort once it is renamed or
+// given up. On startup recover() reads only the last kTailRecords fixed-size records, so its cost does not depend on
+// how many frames the directory holds:
+//   - Begin without Commit: the final file exists -> Commit; a complete .pending BMP or JPEG -> renamed and
+//     Committed; anything else -> removed and Aborted.
+//   - The sequence resumes after the highest seq seen, so frame suffixes never repeat across restarts.
+//   - A torn last record (crash mid-append) fails its CRC and is truncated away.
+// Paths are stored relative to the session directory, 100 bytes a record; a longer one continues in PathMore records
+// appended with it, and a record missing any of its continuations is ignored.
+// The index is compacted to a single Checkpoint record once it grows past kCompactBytes. Its first record's
+// timestamp is the index epoch: together with seq it names a frame uniquely across session directories.
+//
+// Records reach the OS on every append (process crashes lose nothing); sync() makes them durable and is called by
+// the control channel's flush.
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+class FrameIndex
+{
+public:
+    static constexpr size_t kTailRecords = 1024;
+    static constexpr uint64_t kCompactBytes = 4ull << 20;
+
+    struct Recovery
+    {
+        uint64_t nextSeq = 0;
+        size_t recordsScanned = 0;
+        size_t finalized = 0;  // complete .pending files renamed into place
+        size_t removed = 0;    // partial .pending files deleted
+        size_t tornBytes = 0;  // trailing bytes of a half-written record
+        bool compacted = false;
+    };
+
+    // `root` is the directory stored paths are relative to (the session directory).
+    FrameIndex(std::filesystem::path indexPath, std::filesystem::path root);
+    ~FrameIndex();
+
+    FrameIndex(const FrameIndex&) = delete;
+    FrameIndex& operator=(const FrameIndex&) = delete;
+
+    // Reconciles the tail of the index with the filesystem and opens it for appending. Call once before use.
+    Recovery recover();
+
+    // Reserves the next sequence number.
+    uint64_t next_seq();
+
+    uint64_t epoch() const { return epoch_; }
+
+    // Frames committed within the scanned tail, oldest first (seeds shipping after a restart).
+    const std::vector<std::pair<uint64_t, std::filesystem::path>>& recent_commits() const { return recentCommits_; }
+
+    void begin(uint64_t seq, const std::filesystem::path& finalPath);
+    void commit(uint64_t seq, const std::filesystem::path& finalPath);
+    void abort(uint64_t seq, const std::filesystem::path& finalPath);
+
+    // fsync the index.
+    void sync();
+
+private:
+    enum class RecordType : uint8_t
+    {
+        Checkpoint = 1,
+        Begin = 2,
+        Commit = 3,
+        Abort = 4,
+        PathMore = 5,  // continues the path of the record before it
+    };
+
+    void append(RecordType type, uint64_t seq, const std::filesystem::path& finalPath);
+    bool compact(uint64_t lastSeq);
+
+    std::filesystem::path indexPath_;
+    std::filesystem::path root_;
+    std::mutex m_;
+    FILE* f_ = nullptr;
+    uint64_t nextSeq_ = 0;
+    uint64_t epoch_ = 0;
+    std::vector<std::pair<uint64_t, std::filesystem::path>> recentCommits_;
+};
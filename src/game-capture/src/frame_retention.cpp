@@ -0,0 +1,140 @@
+#include "frame_retention.h"
+
+#include "image_pyramid.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <map>
+
+FrameRetention::Config FrameRetention::Config::from_env()
+{
+    Config c;
+
+    if (const char* v = std::getenv("CAPTURE_RETAIN_FRAMES"))
+        c.keep = static_cast<size_t>(std::strtoull(v, nullptr, 10));
+
+    return c;
+}
+
+void FrameRetention::add(uint64_t seq, std::vector<std::filesystem::path> files)
+{
+    auto at =
+        std::upper_bound(frames_.begin(), frames_.end(), seq, [](uint64_t s, const Entry& e) { return s < e.seq; });
+    frames_.insert(at, Entry{seq, std::move(files)});
+}
+
+size_t FrameRetention::seed(const std::vector<std::filesystem::path>& dirs)
+{
+    std::map<uint64_t, std::vector<std::filesystem::path>> found;
+
+    for (const auto& dir : dirs)
+    {
+        std::error_code ec;
+        for (auto it = std::filesystem::directory_iterator(dir, ec); !ec && it != std::filesystem::directory_iterator();
+             it.increment(ec))
+        {
+            const auto& p = it->path();
+            if (p.extension() != ".bmp" && p.extension() != ".jpg")
+                continue;
+            if (auto seq = frame_seq_of(p.filename().string()))
+                found[*seq].push_back(p);
+        }
+    }
+
+    for (auto& [seq, files] : found)
+        add(seq, std::move(files));
+    return found.size();
+}
+
+size_t FrameRetention::seed(const std::vector<std::pair<uint64_t, std::filesystem::path>>& commits,
+                            const std::vector<std::filesystem::path>& dirs)
+{
+    std::map<uint64_t, std::vector<std::filesystem::path>> found;
+
+    for (const auto& [indexSeq, p] : commits)
+    {
+        if (std::find(dirs.begin(), dirs.end(), p.parent_path()) == dirs.end())
+            continue;
+        if (auto seq = frame_seq_of(p.filename().string()))
+            found[*seq].push_back(p);
+    }
+
+    for (auto& [seq, files] : found)
+        add(seq, std::move(files));
+    return found.size();
+}
+
+FrameRetention::Reclaimed FrameRetention::reclaim(std::optional<uint64_t> floor)
+{
+    Reclaimed r;
+
+    if (cfg_.keep == 0)
+    {
+        while (!frames_.empty() && (!floor || frames_.front().seq <= *floor))
+            frames_.pop_front();
+        return r;
+    }
+
+    while (frames_.size() > cfg_.keep)
+    {
+        Entry& e = frames_.front();
+
+        if (floor && e.seq > *floor)
+        {
+            r.held = frames_.size() - cfg_.keep;
+            break;
+        }
+
+        for (const auto& f : e.files)
+        {
+            std::error_code ec;
+            uint64_t size = std::filesystem::file_size(f, ec);
+            if (std::filesystem::remove(f, ec))
+            {
+                ++r.files;
+                r.bytes += size;
+            }
+        }
+
+        ++r.frames;
+        frames_.pop_front();
+    }
+
+    return r;
+}
+
+size_t FrameRetention::count_after(uint64_t seq) const
+{
+    auto at =
+        std::upper_bound(frames_.begin(), frames_.end(), seq, [](uint64_t s, const Entry& e) { return s < e.seq; });
+    return static_cast<size_t>(frames_.end() - at);
+}
+
+std::optional<uint64_t> FrameRetention::newest() const
+{
+    if (frames_.empty())
+        return std::nullopt;
+    return frames_.back().seq;
+}
+
+std::optional<uint64_t> frame_seq_of(std::string_view fileName)
+{
+    size_t dot = fileName.rfind('.');
+    std::string_view stem = fileName.substr(0, dot);
+
+    if (pyramid_level_of(fileName) > 0)
+        stem = stem.substr(0, stem.size() - 3);
+
+    size_t underscore = stem.rfind('_');
+    if (underscore == std::string_view::npos || underscore + 1 == stem.size())
+        return std::nullopt;
+
+    uint64_t seq = 0;
+    for (char c : stem.substr(underscore + 1))
+    {
+        if (c < '0' || c > '9')
+            return std::nullopt;
+        seq = seq * 10 + static_cast<uint64_t>(c - '0');
+    }
+    return seq;
+}
@@ -0,0 +1,79 @@
+// Bounded on-disk retention for saved frames (CAPTURE_RETAIN_FRAMES).
+//
+// Every committed frame is registered with the files that belong to it (the frame and its pyramid levels), keyed by the
+// seq in its file name, which is what consumers acknowledge. Once more than `keep` frames are retained the oldest are
+// deleted, but only up to a floor: the lowest live consumer cursor (consumer_cursors.h), lowered further for anything
+// the shipper has yet to send and for the frames a live hero-inference has not yet written detections for
+// (consumer_lag.h), since it tracks its progress through sidecars rather than a cursor. A frame some live reader still
+// needs is never deleted; a reader whose lease lapsed no longer counts, so the store returns to `keep` frames once a
+// dead consumer's lease runs out. With keep = 0 nothing is deleted, as before retention existed; frames are still
+// registered, so lag can be counted, and forgotten once every reader has passed them.
+//
+// Consumer lag is counted in registered frames, not seqs: pyramid levels and snapshots take seqs from the same
+// sequence, so a difference of seqs overstates it.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <optional>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+class FrameRetention
+{
+public:
+    struct Config
+    {
+        size_t keep = 0;  // frames to keep at least; 0 keeps everything; CAPTURE_RETAIN_FRAMES
+
+        static Config from_env();
+    };
+
+    explicit FrameRetention(Config cfg) : cfg_(cfg) {}
+
+    // Registers a committed frame and its files. Frames arrive in seq order; an older seq is inserted in place.
+    void add(uint64_t seq, std::vector<std::filesystem::path> files);
+
+    // Registers frames already on disk (after a restart): every *_<seq>[.lN].bmp or .jpg in `dirs`, grouped by seq.
+    size_t seed(const std::vector<std::filesystem::path>& dirs);
+    // Same, from frame index commits (FrameIndex::recent_commits) instead of a directory scan: bounded by the index
+    // tail rather than by how many files `dirs` hold.
+    size_t seed(const std::vector<std::pair<uint64_t, std::filesystem::path>>& commits,
+                const std::vector<std::filesystem::path>& dirs);
+
+    struct Reclaimed
+    {
+        size_t frames = 0;
+        size_t files = 0;
+        uint64_t bytes = 0;
+        size_t held = 0;  // over the limit but not yet passed by `floor`
+    };
+
+    // Deletes the oldest frames while more than `keep` are retained and their seq is at or below `floor` (no floor:
+    // nobody needs them). With keep = 0 those frames are only forgotten.
+    Reclaimed reclaim(std::optional<uint64_t> floor);
+
+    // Registered frames with a seq above `seq`: how far behind a consumer whose cursor is at `seq` is
+    size_t count_after(uint64_t seq) const;
+
+    size_t size() const { return frames_.size(); }
+    std::optional<uint64_t> newest() const;
+    const Config& config() const { return cfg_; }
+
+private:
+    struct Entry
+    {
+        uint64_t seq;
+        std::vector<std::filesystem::path> files;
+    };
+
+    Config cfg_;
+    std::deque<Entry> frames_;
+};
+
+// Frame seq in a capture file name: the digits after the last '_' of the stem, ignoring a pyramid level tag
+// ("..._00042.bmp", "..._00042.l2.bmp" -> 42).
+std::optional<uint64_t> frame_seq_of(std::string_view fileName);
@@ -0,0 +1,40 @@
+// A window capture backend, as seen by a capture loop: the current contents of one window as BGRA frames, and a way
+// to sleep until they may have changed.
+//
+// Windows Graphics Capture is still driven directly by main.cpp; this is the seam for the backends that are not,
+// starting with X11 (x11_capture.h) for the game running under Wine/Proton on Linux capture boxes.
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+class FrameSource
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Frame
+    {
+        const uint8_t* bgra = nullptr;  // owned by the source; see the backend for how long it stays valid
+        int width = 0;
+        int height = 0;
+        size_t stride = 0;    // bytes between rows
+        uint64_t serial = 0;  // counts frames that differed from the previous one
+        Clock::time_point at{};
+    };
+
+    enum class Grab
+    {
+        Frame,      // `out` holds the window's new contents
+        Unchanged,  // nothing drawn since the last frame; `out` is left alone
+        Lost,       // the window is gone (destroyed, or the connection to it broke); open a new source
+    };
+
+    virtual ~FrameSource() = default;
+
+    // Captures the window if it changed since the last Frame returned.
+    virtual Grab grab(Frame& out) = 0;
+    // Sleeps until the window may have changed or `timeout` passes. True if it may have changed.
+    virtual bool wait(std::chrono::milliseconds timeout) = 0;
+};
@@ -0,0 +1,49 @@
+#include "fs_util.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+bool sync_file(const std::filesystem::path& p)
+{
+#ifdef _WIN32
+    HANDLE h = CreateFileW(p.wstring().c_str(), GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                           nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+    if (h == INVALID_HANDLE_VALUE)
+        return false;
+
+    BOOL ok = FlushFileBuffers(h);
+    CloseHandle(h);
+    return ok != FALSE;
+#else
+    int fd = open(p.c_str(), O_RDONLY);
+
+    if (fd < 0)
+        return false;
+
+    int rc = fsync(fd);
+    close(fd);
+    return rc == 0;
+#endif
+}
+
+bool sync_dir(const std::filesystem::path& dir)
+{
+#ifdef _WIN32
+    (void)dir;
+    return true;
+#else
+    int fd = open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+
+    if (fd < 0)
+        return false;
+
+    int rc = fsync(fd);
+    close(fd);
+    return rc == 0;
+#endif
+}
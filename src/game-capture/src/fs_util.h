@@ -0,0 +1,10 @@
+// Small filesystem helpers shared by the writer paths
+#pragma once
+
+#include <filesystem>
+
+// Force a written file's data to stable storage (FlushFileBuffers / fsync). Returns false if it could not be opened.
+bool sync_file(const std::filesystem::path& p);
+
+// Persist directory entries (renames) on POSIX; no-op on Windows where NTFS journals metadata.
+bool sync_dir(const std::filesystem::path& dir);
@@ -0,0 +1,125 @@
+#include "image_pyramid.h"
+
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HOTS_PYRAMID_SSE2 1
+#include <emmintrin.h>
+#endif
+
+void box2x2_row(const uint8_t* r0, const uint8_t* r1, uint8_t* out, int width)
+{
+    int x = 0;
+
+#ifdef HOTS_PYRAMID_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i two = _mm_set1_epi16(2);
+
+    // 8 source pixels per row -> 4 output pixels; channels are widened to 16 bits so the 4-pixel sum cannot overflow
+    for (; x + 4 <= width; x += 4)
+    {
+        const uint8_t* a = r0 + static_cast<size_t>(x) * 8;
+        const uint8_t* b = r1 + static_cast<size_t>(x) * 8;
+        __m128i a0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a));
+        __m128i a1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + 16));
+        __m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b));
+        __m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + 16));
+
+        // Vertical sums, two source pixels per register
+        __m128i v0 = _mm_add_epi16(_mm_unpacklo_epi8(a0, zero), _mm_unpacklo_epi8(b0, zero));
+        __m128i v1 = _mm_add_epi16(_mm_unpackhi_epi8(a0, zero), _mm_unpackhi_epi8(b0, zero));
+        __m128i v2 = _mm_add_epi16(_mm_unpacklo_epi8(a1, zero), _mm_unpacklo_epi8(b1, zero));
+        __m128i v3 = _mm_add_epi16(_mm_unpackhi_epi8(a1, zero), _mm_unpackhi_epi8(b1, zero));
+
+        // Horizontal pairs: [p0 p2] + [p1 p3]
+        __m128i h01 = _mm_add_epi16(_mm_unpacklo_epi64(v0, v1), _mm_unpackhi_epi64(v0, v1));
+        __m128i h23 = _mm_add_epi16(_mm_unpacklo_epi64(v2, v3), _mm_unpackhi_epi64(v2, v3));
+
+        h01 = _mm_srli_epi16(_mm_add_epi16(h01, two), 2);
+        h23 = _mm_srli_epi16(_mm_add_epi16(h23, two), 2);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + static_cast<size_t>(x) * 4), _mm_packus_epi16(h01, h23));
+    }
+#endif
+
+    for (; x < width; ++x)
+    {
+        const uint8_t* a = r0 + static_cast<size_t>(x) * 8;
+        const uint8_t* b = r1 + static_cast<size_t>(x) * 8;
+        uint8_t* o = out + static_cast<size_t>(x) * 4;
+
+        for (int c = 0; c < 4; ++c)
+            o[c] = static_cast<uint8_t>((a[c] + a[c + 4] + b[c] + b[c + 4] + 2) >> 2);
+    }
+}
+
+void ImagePyramid::build(const uint8_t* bgra, int width, int height, size_t stride, int levels)
+{
+    levels = std::clamp(levels, 0, kMaxLevels);
+    width_[0] = width;
+    height_[0] = height;
+    size_t total = 0;
+    levels_ = 0;
+
+    for (int n = 1; n <= levels; ++n)
+    {
+        width_[n] = width_[n - 1] / 2;
+        height_[n] = height_[n - 1] / 2;
+        if (width_[n] == 0 || height_[n] == 0)
+            break;
+        offset_[n] = total;
+        total += static_cast<size_t>(width_[n]) * height_[n] * 4;
+        levels_ = n;
+    }
+
+    storage_.resize(total);
+
+    if (levels_ == 0)
+        return;
+
+    auto row = [this](int n, int y)
+    { return storage_.data() + offset_[n] + static_cast<size_t>(y) * width_[n] * 4; };
+
+    for (int y = 0; y < height_[1]; ++y)
+    {
+        const uint8_t* r0 = bgra + static_cast<size_t>(2 * y) * stride;
+        box2x2_row(r0, r0 + stride, row(1, y), width_[1]);
+
+        // Every second row of a level completes a row of the next one
+        for (int n = 1, yn = y; n < levels_ && (yn & 1) && yn / 2 < height_[n + 1]; ++n, yn /= 2)
+            box2x2_row(row(n, yn - 1), row(n, yn), row(n + 1, yn / 2), width_[n + 1]);
+    }
+}
+
+ImagePyramid::Level ImagePyramid::level(int n) const
+{
+    return Level{width_[n], height_[n], storage_.data() + offset_[n]};
+}
+
+std::string pyramid_level_name(std::string_view stem, int level, std::string_view ext)
+{
+    std::string name(stem);
+
+    if (level > 0)
+    {
+        name += ".l";
+        name += static_cast<char>('0' + level);
+    }
+
+    name += ext;
+    return name;
+}
+
+int pyramid_level_of(std::string_view name)
+{
+    size_t dot = name.rfind('.');
+
+    if (dot == std::string_view::npos || dot < 3)
+        return 0;
+
+    std::string_view tag = name.substr(dot - 3, 3);
+
+    if (tag[0] != '.' || tag[1] != 'l' || tag[2] < '1' || tag[2] > '0' + ImagePyramid::kMaxLevels)
+        return 0;
+
+    return tag[2] - '0';
+}
@@ -0,0 +1,55 @@
+// Reduced-resolution copies of a BGRA frame (1/2, 1/4, 1/8) for consumers that work at a smaller scale.
+//
+// Level n is the 2x2 box average of level n-1 (level 0 being the frame), with odd trailing rows and columns dropped.
+// All levels come out of one pass over the frame: every pair of source rows yields a level-1 row, and each completed
+// pair of level-n rows immediately yields a level-n+1 row while both are still in cache. The 2x2 filter handles four
+// output pixels per SSE2 operation on x86/x64 and falls back to scalar code elsewhere; both round the same way.
+//
+// Level files are named after their frame with an ".l<n>" suffix (…_00042.l2.bmp), which is how the aggregator and
+// its subscribers tell levels apart.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class ImagePyramid
+{
+public:
+    static constexpr int kMaxLevels = 3;
+
+    struct Level
+    {
+        int width = 0;
+        int height = 0;
+        const uint8_t* bgra = nullptr;  // rows of width * 4 bytes, no padding
+    };
+
+    // Builds `levels` (0 to kMaxLevels) reduced levels of a width x height frame whose rows are `stride` bytes apart.
+    // Storage is reused across calls.
+    void build(const uint8_t* bgra, int width, int height, size_t stride, int levels);
+
+    int levels() const { return levels_; }
+    // 1 <= n <= levels()
+    Level level(int n) const;
+
+    // Bytes held by all reduced levels (the storage the pyramid adds to a frame)
+    size_t bytes() const { return storage_.size(); }
+
+private:
+    int levels_ = 0;
+    int width_[kMaxLevels + 1]{};
+    int height_[kMaxLevels + 1]{};
+    size_t offset_[kMaxLevels + 1]{};
+    std::vector<uint8_t> storage_;
+};
+
+// One output row of a 2x2 box filter: `width` BGRA pixels from the source rows `r0` and `r1` (2 * width pixels each).
+void box2x2_row(const uint8_t* r0, const uint8_t* r1, uint8_t* out, int width);
+
+// "<stem>.l<level><ext>" for level > 0, `stem + ext` otherwise.
+std::string pyramid_level_name(std::string_view stem, int level, std::string_view ext);
+// Level encoded in a frame file name by pyramid_level_name; 0 for ordinary frames.
+int pyramid_level_of(std::string_view name);
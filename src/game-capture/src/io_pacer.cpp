@@ -0,0 +1,148 @@
+#include "io_pacer.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+#ifdef _WIN32
+#include <io.h>
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+// Sends the `n` bytes just written through `f` (those before its current position) to the device and waits for them,
+// so they leave at the pace they were written rather than whenever writeback gets to them
+bool push_to_device(FILE* f, size_t n)
+{
+    if (fflush(f) != 0)
+        return false;
+
+#ifdef _WIN32
+    (void)n;
+    auto h = reinterpret_cast<HANDLE>(_get_osfhandle(_fileno(f)));
+    return h != INVALID_HANDLE_VALUE && FlushFileBuffers(h);
+#else
+    int fd = fileno(f);
+    off_t end = lseek(fd, 0, SEEK_CUR);
+    if (end < static_cast<off_t>(n))
+        return false;
+    return sync_file_range(fd, end - static_cast<off_t>(n), static_cast<off_t>(n),
+                           SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER) == 0;
+#endif
+}
+}  // namespace
+
+IoPacerConfig IoPacerConfig::from_env()
+{
+    IoPacerConfig c;
+
+    if (const char* v = std::getenv("CAPTURE_IO_MAX_BPS"))
+        c.maxBytesPerSec = std::max(0.0, std::atof(v));
+    if (const char* v = std::getenv("CAPTURE_IO_BURST_BYTES"))
+        c.burstBytes = std::max(0.0, std::atof(v));
+    if (const char* v = std::getenv("CAPTURE_IO_CHUNK_BYTES"))
+        c.chunkBytes = std::clamp<size_t>(std::strtoull(v, nullptr, 10), 64 << 10, 16 << 20);
+    if (const char* v = std::getenv("CAPTURE_IO_PRIORITY"))
+    {
+        if (strcmp(v, "normal") == 0)
+            c.priority = IoPriority::Normal;
+        else if (strcmp(v, "idle") == 0)
+            c.priority = IoPriority::Idle;
+        else
+            c.priority = IoPriority::Low;
+    }
+
+    return c;
+}
+
+// A burst smaller than one chunk would make every chunk wait for tokens it can never have banked
+IoPacer::IoPacer(IoPacerConfig cfg)
+    : cfg_(cfg), bucket_(cfg.maxBytesPerSec, std::max(cfg.burstBytes, static_cast<double>(cfg.chunkBytes)))
+{
+}
+
+bool IoPacer::write(FILE* f, const void* data, size_t n)
+{
+    set_io_priority(f, cfg_.priority);
+
+    const auto* p = static_cast<const uint8_t*>(data);
+
+    while (n > 0)
+    {
+        size_t chunk = std::min(n, cfg_.chunkBytes);
+        Clock::duration wait{};
+        {
+            std::lock_guard<std::mutex> lock(m_);
+            wait = bucket_.take(static_cast<double>(chunk), Clock::now());
+            stats_.bytes += chunk;
+            ++stats_.chunks;
+            if (wait > Clock::duration::zero())
+            {
+                ++stats_.delayedChunks;
+                stats_.queued += wait;
+                stats_.maxQueued = std::max(stats_.maxQueued, wait);
+            }
+        }
+
+        if (wait > Clock::duration::zero())
+            std::this_thread::sleep_for(wait);
+
+        if (fwrite(p, 1, chunk, f) != chunk)
+            return false;
+        if (cfg_.maxBytesPerSec > 0 && !push_to_device(f, chunk))
+            return false;
+
+        p += chunk;
+        n -= chunk;
+    }
+
+    return true;
+}
+
+IoPacer::Stats IoPacer::stats() const
+{
+    std::lock_guard<std::mutex> lock(m_);
+    return stats_;
+}
+
+bool set_io_priority(FILE* f, IoPriority priority)
+{
+    if (priority == IoPriority::Normal)
+        return true;
+
+#ifdef _WIN32
+    FILE_IO_PRIORITY_HINT_INFO hint{};
+    hint.PriorityHint = priority == IoPriority::Idle ? IoPriorityHintVeryLow : IoPriorityHintLow;
+    auto h = reinterpret_cast<HANDLE>(_get_osfhandle(_fileno(f)));
+    return h != INVALID_HANDLE_VALUE && SetFileInformationByHandle(h, FileIoPriorityHintInfo, &hint, sizeof(hint));
+#else
+    (void)f;
+    // linux/ioprio.h: IOPRIO_WHO_PROCESS with id 0 is the calling thread; class in the top bits, level below
+    constexpr int kWhoProcess = 1;
+    constexpr int kClassShift = 13;
+    constexpr int kClassBestEffort = 2;
+    constexpr int kClassIdle = 3;
+    int value = priority == IoPriority::Idle ? kClassIdle << kClassShift : (kClassBestEffort << kClassShift) | 7;
+    return syscall(SYS_ioprio_set, kWhoProcess, 0, value) == 0;
+#endif
+}
+
+const char* io_priority_name(IoPriority priority)
+{
+    switch (priority)
+    {
+    case IoPriority::Normal:
+        return "normal";
+    case IoPriority::Low:
+        return "low";
+    case IoPriority::Idle:
+        return "idle";
+    }
+    return "?";
+}
@@ -0,0 +1,75 @@
+// Disk write shaping for frame files, so capture leaves headroom for the game streaming its own assets from the same
+// disk.
+//
+// Every writer thread draws from one token bucket (token_bucket.h): a write is split into chunkBytes pieces and each
+// piece waits until the bucket has paid for it, then is pushed to the device before the next one is written
+// (sync_file_range on Linux, FlushFileBuffers on Windows). Without the push the pieces would only be paced into the
+// page cache, and writeback would still send the frame to the disk in one burst; with it a 6 MB frame reaches the
+// disk as a steady trickle at maxBytesPerSec. Up to burstBytes may go out back to back after a quiet spell. Without
+// a rate limit writes are left to the OS writeback as before.
+//
+// Writes are also tagged low priority: on Linux the writing thread's I/O class is set with ioprio_set (best-effort
+// level 7, or the idle class), which the BFQ scheduler honours for the I/O the thread submits itself, as the pushes
+// are; on Windows the file handle gets a FILE_IO_PRIORITY_HINT (low or very low). Normal leaves both alone.
+#pragma once
+
+#include "token_bucket.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+
+enum class IoPriority
+{
+    Normal,
+    Low,
+    Idle,
+};
+
+struct IoPacerConfig
+{
+    double maxBytesPerSec = 0;              // CAPTURE_IO_MAX_BPS, 0 = unlimited
+    double burstBytes = 8 << 20;            // CAPTURE_IO_BURST_BYTES
+    size_t chunkBytes = 1 << 20;            // CAPTURE_IO_CHUNK_BYTES
+    IoPriority priority = IoPriority::Low;  // CAPTURE_IO_PRIORITY=normal|low|idle
+
+    static IoPacerConfig from_env();
+};
+
+class IoPacer
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit IoPacer(IoPacerConfig cfg);
+
+    // fwrite()s `n` bytes in paced chunks after applying the configured priority, each pushed to the device when a
+    // rate is set. Blocks the calling thread while it waits for tokens or the device; safe to call from several
+    // threads at once. False on a short write or a failed push.
+    bool write(FILE* f, const void* data, size_t n);
+
+    struct Stats
+    {
+        uint64_t bytes = 0;
+        uint64_t chunks = 0;
+        uint64_t delayedChunks = 0;   // chunks that had to wait for tokens
+        Clock::duration queued{};     // total time chunks waited
+        Clock::duration maxQueued{};  // longest single wait
+    };
+    Stats stats() const;
+
+    const IoPacerConfig& config() const { return cfg_; }
+
+private:
+    IoPacerConfig cfg_;
+    mutable std::mutex m_;
+    TokenBucket bucket_;
+    Stats stats_;
+};
+
+// Applies `priority` to writes through `f` (Windows) or by the calling thread (Linux). False if the OS refused.
+bool set_io_priority(FILE* f, IoPriority priority);
+
+const char* io_priority_name(IoPriority priority);
@@ -0,0 +1,229 @@
+// hots_iopace: writes frame-sized files through the I/O pacer (io_pacer.h) from several threads at once, as the save
+// workers do, and reports the rate the disk was actually written at against the pacer's target.
+//
+//   hots_iopace [--mbps MB] [--threads N] [--seconds S] [--frame-bytes B] [--priority normal|low|idle]
+//               [--tolerance PCT] [--dir D]
+//
+// Settings start from the CAPTURE_IO_* environment variables; --mbps sets the target in MB/s (10^6 bytes).
+// Frames default to a 1080p 24-bit BMP, written round-robin over four files per thread in D (default: a directory
+// under the system temp directory, removed afterwards). The rate is measured at the block device holding D (Linux
+// sysfs stat, sectors written), sampled every 100 ms, so it counts what reached the disk rather than what the pacer
+// let through; other writers to the same device add to it. The burst allowance goes out unpaced, so it is left out
+// of the achieved rate. Exits 1 if the rate is more than --tolerance percent (default 5) off the target or any 100 ms
+// after the burst saw more than twice the target plus one chunk, 3 if the device cannot be read (not Linux, or no
+// block device behind D, as with tmpfs); without a target the rates are only reported.
+#include "io_pacer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+// Bytes written so far to the block device holding `dir`, or -1 if there is none to read
+static double device_written(const fs::path& dir)
+{
+#ifdef _WIN32
+    (void)dir;
+    return -1;
+#else
+    struct stat st;
+    if (stat(dir.c_str(), &st) != 0)
+        return -1;
+
+    std::ifstream in("/sys/dev/block/" + std::to_string(major(st.st_dev)) + ":" + std::to_string(minor(st.st_dev)) +
+                     "/stat");
+    unsigned long long fields[7];
+    for (auto& v : fields)
+        if (!(in >> v))
+            return -1;
+    return static_cast<double>(fields[6]) * 512;  // sectors written
+#endif
+}
+
+static int usage()
+{
+    fprintf(stderr, "usage: hots_iopace [--mbps MB] [--threads N] [--seconds S] [--frame-bytes B] "
+                    "[--priority normal|low|idle] [--tolerance PCT] [--dir D]\n");
+    return 2;
+}
+
+static double ms(std::chrono::steady_clock::duration d)
+{
+    return std::chrono::duration<double, std::milli>(d).count();
+}
+
+int main(int argc, char** argv)
+{
+    IoPacerConfig cfg = IoPacerConfig::from_env();
+    int threads = 4;
+    double seconds = 10, tolerance = 5;
+    size_t frameBytes = 1920 * 1080 * 3 + 54;
+    fs::path dir;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string a = argv[i];
+
+        if (i + 1 >= argc)
+            return usage();
+
+        if (a == "--mbps")
+            cfg.maxBytesPerSec = std::atof(argv[++i]) * 1e6;
+        else if (a == "--threads")
+            threads = std::max(1, std::atoi(argv[++i]));
+        else if (a == "--seconds")
+            seconds = std::atof(argv[++i]);
+        else if (a == "--frame-bytes")
+            frameBytes = std::max<size_t>(1, std::strtoull(argv[++i], nullptr, 10));
+        else if (a == "--tolerance")
+            tolerance = std::atof(argv[++i]);
+        else if (a == "--dir")
+            dir = argv[++i];
+        else if (a == "--priority")
+        {
+            std::string p = argv[++i];
+            if (p == "normal")
+                cfg.priority = IoPriority::Normal;
+            else if (p == "low")
+                cfg.priority = IoPriority::Low;
+            else if (p == "idle")
+                cfg.priority = IoPriority::Idle;
+            else
+                return usage();
+        }
+        else
+            return usage();
+    }
+    if (seconds <= 0)
+        return usage();
+
+    bool tempDir = dir.empty();
+    if (tempDir)
+    {
+        auto stamp = std::chrono::steady_clock::now().time_since_epoch().count();
+        dir = fs::temp_directory_path() / ("hots_iopace_" + std::to_string(stamp));
+    }
+    std::error_code ec;
+    fs::create_directories(dir, ec);
+
+    IoPacer pacer(cfg);
+    std::vector<unsigned char> frame(frameBytes, 0x5a);
+    std::atomic<bool> failed{false}, refused{false};
+    std::atomic<uint64_t> files{0};
+
+#ifndef _WIN32
+    // Whatever other writers left dirty goes out now, not during the measurement
+    sync();
+#endif
+    double deviceStart = device_written(dir);
+    auto start = std::chrono::steady_clock::now();
+    auto end = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                           std::chrono::duration<double>(seconds));
+    std::vector<std::thread> workers;
+
+    for (int t = 0; t < threads; ++t)
+        workers.emplace_back(
+            [&, t]
+            {
+                for (int i = 0; !failed && std::chrono::steady_clock::now() < end; ++i)
+                {
+                    fs::path p = dir / ("iopace_" + std::to_string(t) + "_" + std::to_string(i % 4) + ".bmp");
+#ifdef _WIN32
+                    FILE* f = _wfopen(p.wstring().c_str(), L"wb");
+#else
+                    FILE* f = fopen(p.c_str(), "wb");
+#endif
+                    // write() applies the priority too; this only finds out whether the OS accepted it
+                    if (f && i == 0 && !set_io_priority(f, cfg.priority))
+                        refused = true;
+                    if (!f || !pacer.write(f, frame.data(), frame.size()))
+                        failed = true;
+                    if (f)
+                        fclose(f);
+                    ++files;
+                }
+            });
+
+    // The fastest the device was written over any 100 ms once the burst allowance is out: close to the target when
+    // writes trickle out, far above it when they leave in bursts
+    double peak = 0;
+    if (deviceStart >= 0)
+    {
+        double last = deviceStart;
+        while (std::chrono::steady_clock::now() < end)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            double now = device_written(dir);
+            if (last - deviceStart >= cfg.burstBytes)
+                peak = std::max(peak, (now - last) / 0.1);
+            last = now;
+        }
+    }
+
+    for (auto& w : workers)
+        w.join();
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double deviceBytes = deviceStart >= 0 ? device_written(dir) - deviceStart : -1;
+    if (tempDir)
+        fs::remove_all(dir, ec);
+
+    if (failed)
+    {
+        fprintf(stderr, "cannot write frames under %s\n", dir.string().c_str());
+        return 1;
+    }
+
+    IoPacer::Stats s = pacer.stats();
+
+    printf("%d threads, %llu frames of %zu bytes in %.2f s, priority %s (%s)\n", threads,
+           static_cast<unsigned long long>(files.load()), frameBytes, elapsed, io_priority_name(cfg.priority),
+           refused ? "refused" : "applied");
+    printf("chunks: %llu of %zu bytes, %llu waited for tokens, %.2f ms mean wait, %.2f ms max\n",
+           static_cast<unsigned long long>(s.chunks), cfg.chunkBytes, static_cast<unsigned long long>(s.delayedChunks),
+           s.delayedChunks ? ms(s.queued) / static_cast<double>(s.delayedChunks) : 0.0, ms(s.maxQueued));
+
+    printf("pacer let through %.2f MB/s\n", static_cast<double>(s.bytes) / elapsed / 1e6);
+
+    if (deviceBytes < 0)
+    {
+        printf("cannot read the block device holding %s: device writes not measured\n", dir.string().c_str());
+        return 3;
+    }
+
+    double paced = deviceBytes - std::min(deviceBytes, cfg.burstBytes);
+    double rate = paced / elapsed;
+
+    if (cfg.maxBytesPerSec <= 0)
+    {
+        printf("device written at %.2f MB/s (unpaced), peak 100 ms %.2f MB/s\n", rate / 1e6, peak / 1e6);
+        return 0;
+    }
+
+    double off = 100.0 * (rate - cfg.maxBytesPerSec) / cfg.maxBytesPerSec;
+    bool ok = std::fabs(off) <= tolerance;
+    printf("device written at %.2f MB/s against a target of %.2f MB/s: %+.2f%% (%s, tolerance %.1f%%)\n", rate / 1e6,
+           cfg.maxBytesPerSec / 1e6, off, ok ? "ok" : "FAIL", tolerance);
+
+    // A 100 ms window can catch a chunk more than its share; anything past twice the target came out in bursts
+    double peakLimit = 2 * cfg.maxBytesPerSec + static_cast<double>(cfg.chunkBytes) / 0.1;
+    bool steady = peak <= peakLimit;
+    printf("peak 100 ms %.2f MB/s against a limit of %.2f MB/s (%s)\n", peak / 1e6, peakLimit / 1e6,
+           steady ? "ok" : "FAIL: written in bursts");
+    return ok && steady ? 0 : 1;
+}
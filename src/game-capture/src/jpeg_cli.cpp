@@ -0,0 +1,191 @@
+// hots_jpeg: runs the JPEG rate control (jpeg_rate_control.h) over saved frames in name order, as the save loop would,
+// and reports the budget against what was written: mean size and its error, the spread of sizes around the target
+// (over frames whose target can be met at all), the quality range and how often the quality reversed direction.
+//
+//   hots_jpeg [--target BYTES | --mb-per-hour MB [--fps F]] [--quality Q] [--min Q] [--max Q] [--repeat R]
+//             [--out DIR] [--verbose] <dir|file.bmp>...
+//
+// Without a budget every frame is encoded at --quality (default 85). Frames are spaced 1/F s apart (default 1) for
+// the MB/hour conversion. --out keeps the encoded frames; --verbose prints one line per frame.
+#include "bmp_reader.h"
+#include "jpeg_encoder.h"
+#include "jpeg_rate_control.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+static int usage()
+{
+    fprintf(stderr, "usage: hots_jpeg [--target BYTES | --mb-per-hour MB [--fps F]] [--quality Q] [--min Q] [--max Q] "
+                    "[--repeat R] [--out DIR] [--verbose] <dir|file.bmp>...\n");
+    return 2;
+}
+
+int main(int argc, char** argv)
+{
+    JpegRateControl::Config cfg;
+    double fps = 1.0;
+    int repeat = 1;
+    bool verbose = false;
+    fs::path outDir;
+    std::vector<fs::path> files;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string a = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (a == "--target" && hasValue)
+            cfg.targetBytes = std::strtoull(argv[++i], nullptr, 10);
+        else if (a == "--mb-per-hour" && hasValue)
+            cfg.mbPerHour = std::atof(argv[++i]);
+        else if (a == "--fps" && hasValue)
+            fps = std::atof(argv[++i]);
+        else if (a == "--quality" && hasValue)
+            cfg.quality = std::clamp(std::atoi(argv[++i]), 1, 100);
+        else if (a == "--min" && hasValue)
+            cfg.minQuality = std::clamp(std::atoi(argv[++i]), 1, 100);
+        else if (a == "--max" && hasValue)
+            cfg.maxQuality = std::clamp(std::atoi(argv[++i]), 1, 100);
+        else if (a == "--repeat" && hasValue)
+            repeat = std::atoi(argv[++i]);
+        else if (a == "--out" && hasValue)
+            outDir = argv[++i];
+        else if (a == "--verbose")
+            verbose = true;
+        else if (a.rfind("--", 0) == 0)
+            return usage();
+        else if (fs::is_directory(a))
+        {
+            for (const auto& e : fs::directory_iterator(a))
+                if (e.is_regular_file() && e.path().extension() == ".bmp")
+                    files.push_back(e.path());
+        }
+        else
+            files.push_back(a);
+    }
+
+    if (files.empty() || fps <= 0 || repeat < 1 || cfg.minQuality > cfg.maxQuality)
+        return usage();
+
+    std::sort(files.begin(), files.end());
+    if (!outDir.empty())
+        fs::create_directories(outDir);
+
+    cfg.interval = std::chrono::milliseconds(static_cast<int64_t>(1000.0 / fps));
+    JpegRateControl rate(cfg);
+    auto at = JpegRateControl::Clock::now();
+    const auto step =
+        std::chrono::duration_cast<JpegRateControl::Clock::duration>(std::chrono::duration<double>(1.0 / fps));
+
+    BmpImage img;
+    std::vector<uint8_t> jpeg;
+    size_t frames = 0;
+    double totalBytes = 0, totalTarget = 0, sumSqError = 0, sumPredError = 0, encodeMs = 0;
+    size_t predicted = 0, within10 = 0, reversals = 0, pinned = 0;
+    int minQ = 100, maxQ = 0, lastDirection = 0, lastQuality = -1;
+    double sumQ = 0, sumAbsStep = 0;
+
+    for (int r = 0; r < repeat; ++r)
+    {
+        for (const auto& p : files)
+        {
+            if (!load_bmp(p, img))
+            {
+                if (r == 0)
+                    fprintf(stderr, "skipping %s: not a readable 24/32-bit BMP\n", p.string().c_str());
+                continue;
+            }
+
+            auto t0 = std::chrono::steady_clock::now();
+            double complexity = jpeg_complexity(img.bgra.data(), img.width, img.height, img.width * 4);
+            size_t pixels = static_cast<size_t>(img.width) * img.height;
+            auto plan = rate.plan(complexity, pixels, at);
+            encode_jpeg(img.bgra.data(), img.width, img.height, img.width * 4, plan.quality, jpeg);
+            rate.update(plan, complexity, pixels, jpeg.size());
+            encodeMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+            at += step;
+
+            double bytes = static_cast<double>(jpeg.size());
+            ++frames;
+            totalBytes += bytes;
+            totalTarget += plan.targetBytes;
+            if (plan.targetBytes > 0)
+            {
+                // A frame still under its target at the highest quality (or over it at the lowest) measures the
+                // content, not the control
+                double err = bytes / plan.targetBytes - 1.0;
+                if ((err < 0 && plan.quality >= rate.config().maxQuality) ||
+                    (err > 0 && plan.quality <= rate.config().minQuality))
+                {
+                    ++pinned;
+                }
+                else
+                {
+                    sumSqError += err * err;
+                    within10 += std::abs(err) <= 0.10;
+                }
+            }
+            if (plan.predictedBytes > 0)
+            {
+                sumPredError += std::abs(bytes / plan.predictedBytes - 1.0);
+                ++predicted;
+            }
+
+            minQ = std::min(minQ, plan.quality);
+            maxQ = std::max(maxQ, plan.quality);
+            sumQ += plan.quality;
+            if (lastQuality >= 0 && plan.quality != lastQuality)
+            {
+                int direction = plan.quality > lastQuality ? 1 : -1;
+                reversals += lastDirection && direction != lastDirection;
+                lastDirection = direction;
+                sumAbsStep += std::abs(plan.quality - lastQuality);
+            }
+            lastQuality = plan.quality;
+
+            if (verbose)
+                printf("%-48s q=%3d bytes=%8zu target=%8.0f predicted=%8.0f complexity=%6.2f\n",
+                       p.filename().string().c_str(), plan.quality, jpeg.size(), plan.targetBytes,
+                       plan.predictedBytes, complexity);
+
+            if (!outDir.empty() && r == 0)
+            {
+                auto out = outDir / p.filename().replace_extension(".jpg");
+                if (FILE* f = fopen(out.string().c_str(), "wb"))
+                {
+                    fwrite(jpeg.data(), 1, jpeg.size(), f);
+                    fclose(f);
+                }
+            }
+        }
+    }
+
+    if (!frames)
+        return 1;
+
+    double n = static_cast<double>(frames);
+    printf("%zu frames  %.2f ms/frame (complexity + encode)\n", frames, encodeMs / n);
+    if (totalTarget > 0)
+    {
+        double tracked = std::max(n - static_cast<double>(pinned), 1.0);
+        printf("target %.0f B/frame  achieved %.0f B/frame (%+.1f%%)  out of reach %zu  rms error %.1f%%  "
+               "within 10%%: %.1f%%\n",
+               totalTarget / n, totalBytes / n, (totalBytes / totalTarget - 1.0) * 100.0, pinned,
+               std::sqrt(sumSqError / tracked) * 100.0, static_cast<double>(within10) * 100.0 / tracked);
+    }
+    else
+        printf("fixed quality  %.0f B/frame\n", totalBytes / n);
+    printf("quality %d-%d mean %.1f  mean step %.2f  reversals %zu  prediction error %.1f%%  alpha %.2f  beta %.2f\n",
+           minQ, maxQ, sumQ / n, sumAbsStep / std::max(n - 1, 1.0), reversals,
+           predicted ? sumPredError / static_cast<double>(predicted) * 100.0 : 0.0, rate.alpha(), rate.beta());
+    return 0;
+}
@@ -0,0 +1,418 @@
+#include "jpeg_encoder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+namespace
+{
+// Natural (row-major) position -> zigzag position
+constexpr uint8_t kZigZag[64] = {0,  1,  5,  6,  14, 15, 27, 28, 2,  4,  7,  13, 16, 26, 29, 42,
+                                 3,  8,  12, 17, 25, 30, 41, 43, 9,  11, 18, 24, 31, 40, 44, 53,
+                                 10, 19, 23, 32, 39, 45, 52, 54, 20, 22, 33, 38, 46, 51, 55, 60,
+                                 21, 34, 37, 47, 50, 56, 59, 61, 35, 36, 48, 49, 57, 58, 62, 63};
+
+// ITU-T T.81 Annex K quantisation tables, natural order
+constexpr uint8_t kLumaQuant[64] = {16, 11, 10, 16, 24,  40,  51,  61,  12, 12, 14, 19, 26,  58,  60,  55,
+                                    14, 13, 16, 24, 40,  57,  69,  56,  14, 17, 22, 29, 51,  87,  80,  62,
+                                    18, 22, 37, 56, 68,  109, 103, 77,  24, 35, 55, 64, 81,  104, 113, 92,
+                                    49, 64, 78, 87, 103, 121, 120, 101, 72, 92, 95, 98, 112, 100, 103, 99};
+constexpr uint8_t kChromaQuant[64] = {17, 18, 24, 47, 99, 99, 99, 99, 18, 21, 26, 66, 99, 99, 99, 99,
+                                      24, 26, 56, 99, 99, 99, 99, 99, 47, 66, 99, 99, 99, 99, 99, 99,
+                                      99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99,
+                                      99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99};
+
+// Annex K.3 Huffman tables: code counts per length 1-16, then the symbols in code order
+constexpr uint8_t kDcLumaBits[16] = {0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0};
+constexpr uint8_t kDcChromaBits[16] = {0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0};
+constexpr uint8_t kDcValues[12] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+constexpr uint8_t kAcLumaBits[16] = {0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7d};
+constexpr uint8_t kAcLumaValues[162] = {
+    0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07, 0x22, 0x71,
+    0x14, 0x32, 0x81, 0x91, 0xa1, 0x08, 0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52, 0xd1, 0xf0, 0x24, 0x33, 0x62, 0x72,
+    0x82, 0x09, 0x0a, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x25, 0x26, 0x27, 0x28, 0x29, 0x2a, 0x34, 0x35, 0x36, 0x37,
+    0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59,
+    0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x83,
+    0x84, 0x85, 0x86, 0x87, 0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3,
+    0xa4, 0xa5, 0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3,
+    0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe1, 0xe2,
+    0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8, 0xf9, 0xfa};
+constexpr uint8_t kAcChromaBits[16] = {0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77};
+constexpr uint8_t kAcChromaValues[162] = {
+    0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71, 0x13, 0x22,
+    0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xa1, 0xb1, 0xc1, 0x09, 0x23, 0x33, 0x52, 0xf0, 0x15, 0x62, 0x72, 0xd1,
+    0x0a, 0x16, 0x24, 0x34, 0xe1, 0x25, 0xf1, 0x17, 0x18, 0x19, 0x1a, 0x26, 0x27, 0x28, 0x29, 0x2a, 0x35, 0x36,
+    0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58,
+    0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a,
+    0x82, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a,
+    0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba,
+    0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda,
+    0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8, 0xf9, 0xfa};
+
+struct HuffTable
+{
+    uint16_t code[256]{};
+    uint8_t length[256]{};
+};
+
+// Canonical codes (Annex C) from the count-per-length form
+HuffTable build_huffman(const uint8_t* bits, const uint8_t* values)
+{
+    HuffTable t;
+    uint16_t code = 0;
+    int k = 0;
+
+    for (int len = 1; len <= 16; ++len)
+    {
+        for (int i = 0; i < bits[len - 1]; ++i, ++k, ++code)
+        {
+            t.code[values[k]] = code;
+            t.length[values[k]] = static_cast<uint8_t>(len);
+        }
+        code <<= 1;
+    }
+    return t;
+}
+
+struct HuffTables
+{
+    HuffTable dcLuma = build_huffman(kDcLumaBits, kDcValues);
+    HuffTable dcChroma = build_huffman(kDcChromaBits, kDcValues);
+    HuffTable acLuma = build_huffman(kAcLumaBits, kAcLumaValues);
+    HuffTable acChroma = build_huffman(kAcChromaBits, kAcChromaValues);
+};
+
+const HuffTables& huffman()
+{
+    static const HuffTables tables;
+    return tables;
+}
+
+// Entropy-coded segment writer: MSB-first, with a 0x00 stuffed after every 0xFF
+class BitWriter
+{
+public:
+    explicit BitWriter(std::vector<uint8_t>& out) : out_(out) {}
+
+    void put(uint32_t bits, int count)
+    {
+        acc_ = (acc_ << count) | (bits & ((1u << count) - 1));
+        used_ += count;
+
+        while (used_ >= 8)
+        {
+            used_ -= 8;
+            uint8_t b = static_cast<uint8_t>(acc_ >> used_);
+            out_.push_back(b);
+            if (b == 0xFF)
+                out_.push_back(0);
+        }
+    }
+
+    // Pads the last byte with 1 bits
+    void flush() { put(0x7F, 7); }
+
+private:
+    std::vector<uint8_t>& out_;
+    uint32_t acc_ = 0;
+    int used_ = 0;
+};
+
+// Scaled quantisation table for `quality`, natural order (libjpeg's jpeg_quality_scaling and baseline clamp)
+void scale_quant(const uint8_t* base, int quality, uint8_t* out)
+{
+    int scale = static_cast<int>(jpeg_quality_scale(quality));
+
+    for (int i = 0; i < 64; ++i)
+        out[i] = static_cast<uint8_t>(std::clamp((base[i] * scale + 50) / 100, 1, 255));
+}
+
+// Divisors for the AAN DCT's output: it leaves coefficient (u, v) scaled by 8 * s(u) * s(v)
+void aan_divisors(const uint8_t* quant, float* out)
+{
+    static constexpr float kAan[8] = {1.0f,         1.387039845f, 1.306562965f, 1.175875602f,
+                                      1.0f,         0.785694958f, 0.541196100f, 0.275899379f};
+
+    for (int v = 0; v < 8; ++v)
+        for (int u = 0; u < 8; ++u)
+            out[v * 8 + u] = 1.0f / (quant[v * 8 + u] * kAan[u] * kAan[v] * 8.0f);
+}
+
+// One-dimensional AAN forward DCT (Arai, Agui, Nakajima) over 8 values `step` apart
+inline void dct8(float* d, int step)
+{
+    float d0 = d[0], d1 = d[step], d2 = d[2 * step], d3 = d[3 * step];
+    float d4 = d[4 * step], d5 = d[5 * step], d6 = d[6 * step], d7 = d[7 * step];
+
+    float tmp0 = d0 + d7, tmp7 = d0 - d7;
+    float tmp1 = d1 + d6, tmp6 = d1 - d6;
+    float tmp2 = d2 + d5, tmp5 = d2 - d5;
+    float tmp3 = d3 + d4, tmp4 = d3 - d4;
+
+    // Even part
+    float tmp10 = tmp0 + tmp3, tmp13 = tmp0 - tmp3;
+    float tmp11 = tmp1 + tmp2, tmp12 = tmp1 - tmp2;
+    d[0] = tmp10 + tmp11;
+    d[4 * step] = tmp10 - tmp11;
+    float z1 = (tmp12 + tmp13) * 0.707106781f;
+    d[2 * step] = tmp13 + z1;
+    d[6 * step] = tmp13 - z1;
+
+    // Odd part
+    tmp10 = tmp4 + tmp5;
+    tmp11 = tmp5 + tmp6;
+    tmp12 = tmp6 + tmp7;
+    float z5 = (tmp10 - tmp12) * 0.382683433f;
+    float z2 = tmp10 * 0.541196100f + z5;
+    float z4 = tmp12 * 1.306562965f + z5;
+    float z3 = tmp11 * 0.707106781f;
+    float z11 = tmp7 + z3, z13 = tmp7 - z3;
+    d[5 * step] = z13 + z2;
+    d[3 * step] = z13 - z2;
+    d[step] = z11 + z4;
+    d[7 * step] = z11 - z4;
+}
+
+// Magnitude category and the value's low bits as JPEG codes them (negative values one's-complemented)
+inline void category(int v, int& bits, int& count)
+{
+    int mag = v < 0 ? -v : v;
+    bits = v < 0 ? v - 1 : v;
+    count = 0;
+    while (mag)
+    {
+        ++count;
+        mag >>= 1;
+    }
+}
+
+// DCT, quantisation and entropy coding of one 8x8 block (level-shifted samples, natural order). Returns its DC.
+int encode_block(BitWriter& bw, float* block, const float* divisors, int prevDc, const HuffTable& dc,
+                 const HuffTable& ac)
+{
+    for (int row = 0; row < 64; row += 8)
+        dct8(block + row, 1);
+    for (int col = 0; col < 8; ++col)
+        dct8(block + col, 8);
+
+    int coef[64];
+    for (int i = 0; i < 64; ++i)
+    {
+        float v = block[i] * divisors[i];
+        coef[kZigZag[i]] = static_cast<int>(v < 0 ? v - 0.5f : v + 0.5f);
+    }
+
+    int bits, count;
+    int diff = coef[0] - prevDc;
+    category(diff, bits, count);
+    bw.put(dc.code[count], dc.length[count]);
+    if (count)
+        bw.put(static_cast<uint32_t>(bits), count);
+
+    int last = 63;
+    while (last > 0 && coef[last] == 0)
+        --last;
+
+    for (int i = 1; i <= last; ++i)
+    {
+        int run = 0;
+        while (coef[i] == 0)
+        {
+            ++run;
+            ++i;
+        }
+        for (; run >= 16; run -= 16)
+            bw.put(ac.code[0xF0], ac.length[0xF0]);
+
+        category(coef[i], bits, count);
+        int symbol = (run << 4) | count;
+        bw.put(ac.code[symbol], ac.length[symbol]);
+        bw.put(static_cast<uint32_t>(bits), count);
+    }
+
+    if (last != 63)
+        bw.put(ac.code[0x00], ac.length[0x00]);
+    return coef[0];
+}
+
+void put16(std::vector<uint8_t>& out, int v)
+{
+    out.push_back(static_cast<uint8_t>(v >> 8));
+    out.push_back(static_cast<uint8_t>(v));
+}
+
+void put_huffman_table(std::vector<uint8_t>& out, uint8_t classAndId, const uint8_t* bits, const uint8_t* values)
+{
+    out.push_back(classAndId);
+    out.insert(out.end(), bits, bits + 16);
+    int n = 0;
+    for (int i = 0; i < 16; ++i)
+        n += bits[i];
+    out.insert(out.end(), values, values + n);
+}
+
+void write_headers(std::vector<uint8_t>& out, int width, int height, const uint8_t* lumaQ, const uint8_t* chromaQ)
+{
+    static constexpr uint8_t kSoiApp0[] = {0xFF, 0xD8, 0xFF, 0xE0, 0, 16, 'J', 'F', 'I', 'F', 0, 1, 1, 0, 0, 1, 0, 1,
+                                           0,    0};
+    out.insert(out.end(), kSoiApp0, kSoiApp0 + sizeof(kSoiApp0));
+
+    // Quantisation tables are stored in zigzag order
+    out.insert(out.end(), {0xFF, 0xDB});
+    put16(out, 2 + 2 * 65);
+    for (int id = 0; id < 2; ++id)
+    {
+        const uint8_t* q = id ? chromaQ : lumaQ;
+        uint8_t zz[64];
+        for (int i = 0; i < 64; ++i)
+            zz[kZigZag[i]] = q[i];
+        out.push_back(static_cast<uint8_t>(id));
+        out.insert(out.end(), zz, zz + 64);
+    }
+
+    // Baseline frame: Y at 2x2 sampling on table 0, Cb and Cr at 1x1 on table 1
+    out.insert(out.end(), {0xFF, 0xC0});
+    put16(out, 17);
+    out.push_back(8);
+    put16(out, height);
+    put16(out, width);
+    out.insert(out.end(), {3, 1, 0x22, 0, 2, 0x11, 1, 3, 0x11, 1});
+
+    out.insert(out.end(), {0xFF, 0xC4});
+    put16(out, 2 + 2 * (17 + 12) + 2 * (17 + 162));
+    put_huffman_table(out, 0x00, kDcLumaBits, kDcValues);
+    put_huffman_table(out, 0x10, kAcLumaBits, kAcLumaValues);
+    put_huffman_table(out, 0x01, kDcChromaBits, kDcValues);
+    put_huffman_table(out, 0x11, kAcChromaBits, kAcChromaValues);
+
+    out.insert(out.end(), {0xFF, 0xDA});
+    put16(out, 12);
+    out.insert(out.end(), {3, 1, 0x00, 2, 0x11, 3, 0x11, 0, 63, 0});
+}
+
+inline int luma(const uint8_t* p)
+{
+    return (29 * p[0] + 150 * p[1] + 77 * p[2] + 128) >> 8;
+}
+}  // namespace
+
+double jpeg_quality_scale(int quality)
+{
+    quality = std::clamp(quality, 1, 100);
+    return quality < 50 ? 5000.0 / quality : 200.0 - 2.0 * quality;
+}
+
+int jpeg_quality_for_scale(double scale)
+{
+    if (scale >= 100.0)
+        return std::clamp(static_cast<int>(std::lround(5000.0 / scale)), 1, 50);
+    return std::clamp(static_cast<int>(std::lround((200.0 - scale) / 2.0)), 50, 100);
+}
+
+bool encode_jpeg(const uint8_t* bgra, int width, int height, size_t stride, int quality, std::vector<uint8_t>& out)
+{
+    out.clear();
+    if (!bgra || width <= 0 || height <= 0 || width > 65535 || height > 65535)
+        return false;
+
+    uint8_t lumaQ[64], chromaQ[64];
+    scale_quant(kLumaQuant, quality, lumaQ);
+    scale_quant(kChromaQuant, quality, chromaQ);
+    float lumaDiv[64], chromaDiv[64];
+    aan_divisors(lumaQ, lumaDiv);
+    aan_divisors(chromaQ, chromaDiv);
+
+    // A usual frame lands well under this; one reservation avoids regrowing the buffer per frame
+    out.reserve(static_cast<size_t>(width) * height / 4 + 1024);
+    write_headers(out, width, height, lumaQ, chromaQ);
+
+    const HuffTables& huff = huffman();
+    BitWriter bw(out);
+    int dcY = 0, dcCb = 0, dcCr = 0;
+
+    // Each 16x16 MCU: four luma blocks, then one 2x2-averaged block each of Cb and Cr. Edge MCUs repeat the last
+    // row and column.
+    float y[256], cb[256], cr[256], block[64];
+
+    for (int my = 0; my < height; my += 16)
+    {
+        for (int mx = 0; mx < width; mx += 16)
+        {
+            for (int r = 0; r < 16; ++r)
+            {
+                const uint8_t* row = bgra + static_cast<size_t>(std::min(my + r, height - 1)) * stride;
+
+                for (int c = 0; c < 16; ++c)
+                {
+                    const uint8_t* p = row + static_cast<size_t>(std::min(mx + c, width - 1)) * 4;
+                    float b = p[0], g = p[1], rr = p[2];
+                    int i = r * 16 + c;
+                    y[i] = 0.299f * rr + 0.587f * g + 0.114f * b - 128.0f;
+                    cb[i] = -0.168736f * rr - 0.331264f * g + 0.5f * b;
+                    cr[i] = 0.5f * rr - 0.418688f * g - 0.081312f * b;
+                }
+            }
+
+            for (int by = 0; by < 16; by += 8)
+            {
+                for (int bx = 0; bx < 16; bx += 8)
+                {
+                    for (int r = 0; r < 8; ++r)
+                        std::copy_n(y + (by + r) * 16 + bx, 8, block + r * 8);
+                    dcY = encode_block(bw, block, lumaDiv, dcY, huff.dcLuma, huff.acLuma);
+                }
+            }
+
+            for (int r = 0; r < 8; ++r)
+            {
+                for (int c = 0; c < 8; ++c)
+                {
+                    int i = r * 32 + c * 2;
+                    block[r * 8 + c] = (cb[i] + cb[i + 1] + cb[i + 16] + cb[i + 17]) * 0.25f;
+                }
+            }
+            dcCb = encode_block(bw, block, chromaDiv, dcCb, huff.dcChroma, huff.acChroma);
+
+            for (int r = 0; r < 8; ++r)
+            {
+                for (int c = 0; c < 8; ++c)
+                {
+                    int i = r * 32 + c * 2;
+                    block[r * 8 + c] = (cr[i] + cr[i + 1] + cr[i + 16] + cr[i + 17]) * 0.25f;
+                }
+            }
+            dcCr = encode_block(bw, block, chromaDiv, dcCr, huff.dcChroma, huff.acChroma);
+        }
+    }
+
+    bw.flush();
+    out.insert(out.end(), {0xFF, 0xD9});
+    return true;
+}
+
+double jpeg_complexity(const uint8_t* bgra, int width, int height, size_t stride)
+{
+    if (!bgra || width < 2 || height < 2)
+        return 0.0;
+
+    std::vector<int> above(static_cast<size_t>(width));
+    uint64_t sum = 0, samples = 0;
+
+    for (int y = 0; y + 1 < height; y += 4)
+    {
+        const uint8_t* r0 = bgra + static_cast<size_t>(y) * stride;
+        const uint8_t* r1 = r0 + stride;
+
+        for (int x = 0; x < width; ++x)
+            above[x] = luma(r0 + static_cast<size_t>(x) * 4);
+
+        for (int x = 0; x + 1 < width; ++x)
+        {
+            sum += static_cast<uint64_t>(std::abs(above[x + 1] - above[x]) +
+                                         std::abs(luma(r1 + static_cast<size_t>(x) * 4) - above[x]));
+            ++samples;
+        }
+    }
+
+    return samples ? static_cast<double>(sum) / static_cast<double>(samples) : 0.0;
+}
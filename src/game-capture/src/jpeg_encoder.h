@@ -0,0 +1,26 @@
+// Baseline JPEG encoder for saved frames (CAPTURE_FRAME_FORMAT=jpeg), and the per-frame measures the JPEG rate
+// control (jpeg_rate_control.h) predicts sizes from.
+//
+// Output is a plain JFIF file: YCbCr with 2x2 chroma subsampling, the Annex K quantisation tables scaled the way
+// libjpeg scales them for a 1-100 quality, the standard Huffman tables, and a float AAN DCT. It is meant to be read
+// by every decoder, not to be small; a frame costs roughly one pass of colour conversion plus one DCT per block.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Encodes a width x height BGRA image whose rows are `stride` bytes apart, at `quality` (clamped to 1-100), replacing
+// the contents of `out`. Alpha is ignored. False for an empty image or one larger than 65535 on a side.
+bool encode_jpeg(const uint8_t* bgra, int width, int height, size_t stride, int quality, std::vector<uint8_t>& out);
+
+// libjpeg's quality scaling: the percentage the Annex K tables are multiplied by at `quality` (5000/q below 50,
+// 200 - 2q from 50 up). Encoded size falls roughly as a power of this.
+double jpeg_quality_scale(int quality);
+
+// Inverse of jpeg_quality_scale over 1-100, for a scale that is not one of its values: the nearest quality.
+int jpeg_quality_for_scale(double scale);
+
+// How much detail a frame has, for predicting its encoded size: the mean absolute luma difference between
+// neighbouring pixels (horizontal and vertical), sampled on every fourth row. 0 for a flat frame.
+double jpeg_complexity(const uint8_t* bgra, int width, int height, size_t stride);
@@ -0,0 +1,148 @@
+#include "jpeg_rate_control.h"
+
+#include "jpeg_encoder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+namespace
+{
+// Size ~ scale^-alpha * complexity^beta per pixel. Starting values are what game captures and photographs show
+// between qualities 30 and 95 (beta 0.4-0.6 at a fixed quality); both are re-estimated as frames come in.
+constexpr double kInitialAlpha = 0.75;
+constexpr double kMinAlpha = 0.3;
+constexpr double kMaxAlpha = 1.5;
+constexpr double kInitialBeta = 0.55;
+constexpr double kMinBeta = 0.2;
+constexpr double kMaxBeta = 1.2;
+// Weight of a new estimate, and the smallest change (as a log ratio) worth learning from
+constexpr double kLearnGain = 0.3;
+constexpr double kMinLearnStep = 0.03;
+// Complexity below this counts as this, so near-flat frames (loading screens) do not predict a size of zero
+constexpr double kMinComplexity = 0.25;
+// The budget debt is repaid over this many frames, limited to this fraction of a frame's target, and decays by
+// kDebtDecay a frame
+constexpr double kDebtFrames = 10.0;
+constexpr double kMaxCorrection = 0.25;
+constexpr double kDebtDecay = 0.95;
+// Weight of the newest frame interval in the smoothed one, and the range it may take (s)
+constexpr double kIntervalGain = 0.2;
+constexpr double kMinInterval = 0.05;
+constexpr double kMaxInterval = 60.0;
+
+double detail_of(double complexity, size_t pixels, double beta)
+{
+    return std::pow(std::max(complexity, kMinComplexity), beta) * static_cast<double>(std::max<size_t>(pixels, 1));
+}
+
+double scale_of(int quality)
+{
+    // Quality 100 scales by 0; the tables bottom out at 1 there anyway
+    return std::max(jpeg_quality_scale(quality), 1.0);
+}
+}  // namespace
+
+JpegRateControl::Config JpegRateControl::Config::from_env()
+{
+    Config c;
+
+    if (const char* v = std::getenv("CAPTURE_JPEG_QUALITY"))
+        c.quality = std::clamp(std::atoi(v), 1, 100);
+    if (const char* v = std::getenv("CAPTURE_JPEG_TARGET_BYTES"))
+        c.targetBytes = std::strtoull(v, nullptr, 10);
+    if (const char* v = std::getenv("CAPTURE_JPEG_MB_PER_HOUR"))
+        c.mbPerHour = std::max(0.0, std::atof(v));
+    if (const char* v = std::getenv("CAPTURE_JPEG_QUALITY_MIN"))
+        c.minQuality = std::clamp(std::atoi(v), 1, 100);
+    if (const char* v = std::getenv("CAPTURE_JPEG_QUALITY_MAX"))
+        c.maxQuality = std::clamp(std::atoi(v), 1, 100);
+
+    c.maxQuality = std::max(c.maxQuality, c.minQuality);
+    return c;
+}
+
+JpegRateControl::JpegRateControl(Config cfg)
+    : cfg_(cfg), quality_(cfg.budgeted() ? std::clamp(cfg.quality, cfg.minQuality, cfg.maxQuality) : cfg.quality),
+      alpha_(kInitialAlpha), beta_(kInitialBeta), interval_(std::chrono::duration<double>(cfg.interval).count())
+{
+}
+
+JpegRateControl::Plan JpegRateControl::plan(double complexity, size_t pixels, Clock::time_point at)
+{
+    Plan p;
+    p.quality = quality_;
+
+    if (!cfg_.budgeted())
+        return p;
+
+    if (lastAt_ != Clock::time_point{} && at > lastAt_)
+    {
+        double dt = std::clamp(std::chrono::duration<double>(at - lastAt_).count(), kMinInterval, kMaxInterval);
+        interval_ += kIntervalGain * (dt - interval_);
+    }
+    lastAt_ = at;
+
+    p.targetBytes = cfg_.targetBytes ? static_cast<double>(cfg_.targetBytes) : cfg_.mbPerHour * 1e6 / 3600 * interval_;
+
+    if (!havePrev_)
+        return p;
+
+    // A data rate is a budget over time: aim off the target by part of the accumulated debt, never by more than
+    // kMaxCorrection of it. A per-frame target is met frame by frame.
+    double aim = p.targetBytes;
+    if (!cfg_.targetBytes)
+        aim -= std::clamp(debt_ / kDebtFrames, -kMaxCorrection * p.targetBytes, kMaxCorrection * p.targetBytes);
+
+    // Size at the current quality, from the last frame and the change in detail
+    double atCurrent =
+        prevBytes_ * detail_of(complexity, pixels, beta_) / detail_of(prevComplexity_, prevPixels_, beta_);
+    p.predictedBytes = atCurrent;
+
+    if (std::abs(atCurrent / aim - 1.0) <= cfg_.deadband)
+        return p;
+
+    double scale = scale_of(quality_) * std::pow(atCurrent / aim, 1.0 / alpha_);
+    int q = jpeg_quality_for_scale(scale);
+    q = std::clamp(std::min(q, quality_ + cfg_.maxStep), cfg_.minQuality, cfg_.maxQuality);
+
+    p.quality = q;
+    p.predictedBytes = atCurrent * std::pow(scale_of(q) / scale_of(quality_), -alpha_);
+    return p;
+}
+
+void JpegRateControl::update(const Plan& p, double complexity, size_t pixels, size_t bytes)
+{
+    if (!cfg_.budgeted())
+        return;
+
+    double actual = std::max(static_cast<double>(bytes), 1.0);
+
+    // Learn from the frame whichever exponent it isolates: alpha when the quality moved (with the change in detail
+    // taken out), beta when only the content did
+    double step = std::log(scale_of(p.quality) / scale_of(quality_));
+    if (havePrev_)
+    {
+        double change = std::log(actual / prevBytes_) - std::log(static_cast<double>(std::max<size_t>(pixels, 1)) /
+                                                                 static_cast<double>(std::max<size_t>(prevPixels_, 1)));
+        double detail = std::log(std::max(complexity, kMinComplexity) / std::max(prevComplexity_, kMinComplexity));
+
+        if (std::abs(step) >= kMinLearnStep)
+            alpha_ += kLearnGain * (std::clamp(-(change - beta_ * detail) / step, kMinAlpha, kMaxAlpha) - alpha_);
+        else if (std::abs(detail) >= kMinLearnStep)
+            beta_ += kLearnGain * (std::clamp(change / detail, kMinBeta, kMaxBeta) - beta_);
+    }
+
+    havePrev_ = true;
+    prevBytes_ = actual;
+    prevComplexity_ = complexity;
+    prevPixels_ = pixels;
+    quality_ = p.quality;
+
+    // Bytes a frame could not use at the highest quality, or could not save at the lowest, are not carried forward:
+    // the quality cannot move that way to settle them
+    double over = actual - p.targetBytes;
+    if ((over < 0 && p.quality >= cfg_.maxQuality) || (over > 0 && p.quality <= cfg_.minQuality))
+        over = 0;
+    debt_ = debt_ * kDebtDecay + over;
+}
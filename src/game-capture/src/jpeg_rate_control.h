@@ -0,0 +1,75 @@
+// Per-frame JPEG quality for a size budget: a target size per frame (CAPTURE_JPEG_TARGET_BYTES) or a data rate
+// (CAPTURE_JPEG_MB_PER_HOUR, spread over the frame rate actually seen).
+//
+// The next frame's size is predicted from the last one, scaled by the change in pixel count (so a resized window is
+// followed at once), in detail and in quantisation: size is taken to grow as complexity^beta (jpeg_complexity) and
+// to fall as scale^-alpha in the libjpeg quality scale (jpeg_quality_scale). Both exponents start at typical values
+// and are re-estimated from frames where only one of the two changed. The quality is the one whose predicted size
+// meets the target; under a data rate the target is also corrected for bytes over or under budget so far, so the
+// average converges on the rate even when single predictions miss.
+//
+// Oscillation is bounded three ways: a prediction within `deadband` of the target keeps the quality, the quality
+// rises by at most `maxStep` a frame, and the rate correction is limited to a quarter of the target and decays, so
+// a long run over or under budget cannot wind it up. Falling is not rate-limited: a frame predicted over budget
+// (the first frame after a loading screen) gets the quality its prediction asks for at once, and a frame that
+// overshoots by undershooting afterwards is the only swing left, approached from below.
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+class JpegRateControl
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Config
+    {
+        int quality = 85;                          // fixed, or the starting one under a budget; CAPTURE_JPEG_QUALITY
+        uint64_t targetBytes = 0;                  // per frame; CAPTURE_JPEG_TARGET_BYTES
+        double mbPerHour = 0;                      // CAPTURE_JPEG_MB_PER_HOUR (10^6 bytes); without targetBytes
+        int minQuality = 20;                       // CAPTURE_JPEG_QUALITY_MIN
+        int maxQuality = 95;                       // CAPTURE_JPEG_QUALITY_MAX
+        int maxStep = 8;                           // most the quality rises between consecutive frames
+        double deadband = 0.04;                    // relative prediction error that leaves the quality alone
+        std::chrono::milliseconds interval{1000};  // assumed frame interval until one has been measured
+
+        static Config from_env();
+        bool budgeted() const { return targetBytes > 0 || mbPerHour > 0; }
+    };
+
+    struct Plan
+    {
+        int quality = 0;
+        double targetBytes = 0;     // budget for this frame (0 without one)
+        double predictedBytes = 0;  // 0 while there is no previous frame to predict from
+    };
+
+    explicit JpegRateControl(Config cfg);
+
+    // Quality for the next frame, given its jpeg_complexity, its size in pixels and when it was taken.
+    Plan plan(double complexity, size_t pixels, Clock::time_point at);
+    // The frame planned by `p` came out at `bytes`.
+    void update(const Plan& p, double complexity, size_t pixels, size_t bytes);
+
+    int quality() const { return quality_; }
+    double alpha() const { return alpha_; }
+    double beta() const { return beta_; }
+    // Bytes written over (positive) or under the budget, decayed
+    double debt() const { return debt_; }
+    const Config& config() const { return cfg_; }
+
+private:
+    Config cfg_;
+    int quality_;
+    double alpha_;
+    double beta_;
+    double interval_;  // seconds, smoothed
+    bool havePrev_ = false;
+    double prevBytes_ = 0;
+    double prevComplexity_ = 0;
+    size_t prevPixels_ = 0;
+    double debt_ = 0;
+    Clock::time_point lastAt_{};
+};
@@ -0,0 +1,309 @@
+#include "log.h"
+
+#include "log_reader.h"
+#include "paths.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace
+{
+struct LogConfig
+{
+    uint64_t maxBytes = 8ull << 20;
+    int files = 4;
+    LogLevel level = LogLevel::Debug;
+    bool echo = false;
+
+    static LogConfig from_env()
+    {
+        LogConfig c;
+
+        if (const char* v = std::getenv("CAPTURE_LOG_MAX_BYTES"))
+            c.maxBytes = std::max<uint64_t>(64 * 1024, std::strtoull(v, nullptr, 10));
+        if (const char* v = std::getenv("CAPTURE_LOG_FILES"))
+            c.files = std::max(1, std::atoi(v));
+        if (const char* v = std::getenv("CAPTURE_LOG_ECHO"))
+            c.echo = std::atoi(v) != 0;
+        if (const char* v = std::getenv("CAPTURE_LOG_LEVEL"))
+        {
+            std::string_view s(v);
+            if (s == "info")
+                c.level = LogLevel::Info;
+            else if (s == "warning")
+                c.level = LogLevel::Warning;
+            else if (s == "error")
+                c.level = LogLevel::Error;
+        }
+
+        return c;
+    }
+};
+
+uint32_t current_pid()
+{
+#ifdef _WIN32
+    return static_cast<uint32_t>(GetCurrentProcessId());
+#else
+    return static_cast<uint32_t>(getpid());
+#endif
+}
+
+class LogWriter
+{
+public:
+    static LogWriter& instance()
+    {
+        static LogWriter writer;
+        return writer;
+    }
+
+    const LogConfig& config() const { return config_; }
+    const std::filesystem::path& path() const { return path_; }
+
+    void write(const unsigned char* rec, size_t n, LogLevel level, int64_t unixNs)
+    {
+        std::lock_guard<std::mutex> lock(m_);
+
+        if (f_ && size_ + n > config_.maxBytes)
+            rotate();
+
+        if (f_)
+        {
+            fwrite(rec, 1, n, f_);
+            size_ += n;
+
+            // Bounded loss on a crash: at most ~1 s of info/debug records sit in the stdio buffer, whether or not
+            // another record follows (the flusher thread covers quiet periods)
+            if (level >= LogLevel::Warning || unixNs - lastFlushNs_ >= 1000000000)
+            {
+                fflush(f_);
+                lastFlushNs_ = unixNs;
+                dirty_ = false;
+            }
+            else if (!dirty_)
+            {
+                dirty_ = true;
+                wake_.notify_one();
+            }
+        }
+
+        if (config_.echo)
+            echo(rec, n);
+    }
+
+    void flush()
+    {
+        std::lock_guard<std::mutex> lock(m_);
+        if (f_)
+            fflush(f_);
+        dirty_ = false;
+    }
+
+private:
+    LogWriter() : config_(LogConfig::from_env()), schema_(current_log_schema(current_pid()))
+    {
+        path_ = session_dir() / "capture.hlog";
+        std::error_code ec;
+        std::filesystem::create_directories(path_.parent_path(), ec);
+
+        // One header per file: a previous run's log moves to .1
+        if (std::filesystem::file_size(path_, ec) > 0 && !ec)
+            shift_rotated();
+
+        open_fresh();
+        flusher_ = std::thread([this] { flush_loop(); });
+    }
+
+    ~LogWriter()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_);
+            stopping_ = true;
+        }
+        wake_.notify_one();
+        if (flusher_.joinable())
+            flusher_.join();
+        if (f_)
+            fclose(f_);
+    }
+
+    // Flushes records left buffered by write() within a second, so the last ones before a quiet period reach the file
+    // without waiting for the next record. Sleeps without a timeout while nothing is buffered: an idle service is not
+    // woken by its log.
+    void flush_loop()
+    {
+        std::unique_lock<std::mutex> lock(m_);
+        while (true)
+        {
+            wake_.wait(lock, [this] { return stopping_ || dirty_; });
+            if (stopping_ || wake_.wait_for(lock, std::chrono::seconds(1), [this] { return stopping_; }))
+                return;
+            if (f_ && dirty_)
+            {
+                fflush(f_);
+                dirty_ = false;
+            }
+        }
+    }
+
+    std::filesystem::path rotated(int i) const
+    {
+        auto p = path_;
+        p += ".";
+        p += std::to_string(i);
+        return p;
+    }
+
+    void shift_rotated()
+    {
+        std::error_code ec;
+        std::filesystem::remove(rotated(config_.files), ec);
+
+        for (int i = config_.files - 1; i >= 1; --i)
+            std::filesystem::rename(rotated(i), rotated(i + 1), ec);
+
+        std::filesystem::rename(path_, rotated(1), ec);
+    }
+
+    void open_fresh()
+    {
+#ifdef _WIN32
+        f_ = _wfopen(path_.wstring().c_str(), L"wb");
+#else
+        f_ = fopen(path_.c_str(), "wb");
+#endif
+        size_ = 0;
+
+        if (!f_)
+            return;
+
+        std::string header = encode_log_header(schema_);
+        fwrite(header.data(), 1, header.size(), f_);
+        fflush(f_);
+        size_ = header.size();
+    }
+
+    void rotate()
+    {
+        fclose(f_);
+        f_ = nullptr;
+        shift_rotated();
+        open_fresh();
+    }
+
+    // Development aid (CAPTURE_LOG_ECHO=1): the only place the capture process renders text
+    void echo(const unsigned char* rec, size_t n)
+    {
+        LogRecord parsed;
+
+        if (n < 2 || !parse_log_record(rec + 2, n - 2, parsed))
+            return;
+
+        std::string line = render_log_text(schema_, parsed) + "\n";
+#ifdef _WIN32
+        OutputDebugStringA(line.c_str());
+#endif
+        fputs(line.c_str(), stderr);
+    }
+
+    LogConfig config_;
+    LogSchema schema_;
+    std::filesystem::path path_;
+    std::mutex m_;
+    FILE* f_ = nullptr;
+    uint64_t size_ = 0;
+    int64_t lastFlushNs_ = 0;
+    bool dirty_ = false;  // records written since the last flush
+    bool stopping_ = false;
+    std::condition_variable wake_;
+    std::thread flusher_;
+};
+}  // namespace
+
+namespace logdetail
+{
+RecordBuilder::RecordBuilder(Ev ev) : ev_(ev)
+{
+    auto id = static_cast<uint16_t>(ev);
+    int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                     std::chrono::system_clock::now().time_since_epoch())
+                     .count();
+
+    n_ = 2;  // size prefix, filled by commit()
+    memcpy(buf_ + n_, &id, sizeof(id));
+    n_ += sizeof(id);
+    memcpy(buf_ + n_, &ns, sizeof(ns));
+    n_ += sizeof(ns);
+}
+
+void RecordBuilder::put_fixed(LogTag tag, const void* p, size_t n)
+{
+    if (n_ + 1 + n > sizeof(buf_))
+        return;
+
+    buf_[n_++] = static_cast<unsigned char>(tag);
+    memcpy(buf_ + n_, p, n);
+    n_ += n;
+}
+
+void RecordBuilder::put_str(std::string_view s)
+{
+    if (n_ + 3 > sizeof(buf_))
+        return;
+
+    auto len = static_cast<uint16_t>(std::min(s.size(), sizeof(buf_) - n_ - 3));
+    buf_[n_++] = static_cast<unsigned char>(LogTag::Str);
+    memcpy(buf_ + n_, &len, sizeof(len));
+    n_ += sizeof(len);
+    memcpy(buf_ + n_, s.data(), len);
+    n_ += len;
+}
+
+void RecordBuilder::put_wstr(const wchar_t* s)
+{
+    // Process and window names are ASCII; anything else is replaced rather than transcoded on the hot path
+    char narrow[256];
+    size_t n = 0;
+
+    for (; s && s[n] && n < sizeof(narrow); ++n)
+        narrow[n] = s[n] < 0x80 ? static_cast<char>(s[n]) : '?';
+
+    put_str(std::string_view(narrow, n));
+}
+
+void RecordBuilder::commit()
+{
+    auto size = static_cast<uint16_t>(n_ - 2);
+    memcpy(buf_, &size, sizeof(size));
+
+    int64_t ns;
+    memcpy(&ns, buf_ + 4, sizeof(ns));
+    LogWriter::instance().write(buf_, n_, event_info(ev_).level, ns);
+}
+
+bool enabled(LogLevel level)
+{
+    return level >= LogWriter::instance().config().level;
+}
+}  // namespace logdetail
+
+void log_flush()
+{
+    LogWriter::instance().flush();
+}
+
+std::filesystem::path log_file()
+{
+    return LogWriter::instance().path();
+}
@@ -0,0 +1,112 @@
+// Binary structured capture log.
+//
+// log_event<Ev::X>(args...) appends one record (event ID, timestamp, typed arguments) without any text formatting;
+// names and rendering live in the decoder (hots_logdump, log_reader.h), which prints the old text lines or the
+// JSON shape of the Python services' JsonLogger.
+//
+// Files: sessions/current/capture.hlog, rotated to capture.hlog.1 .. .N once CAPTURE_LOG_MAX_BYTES is reached.
+//
+//   file    := "HOTSLOG\0" u32 version u32 pid str8 service str8 role u16 nevents { u8 level str8 name u8 nfields
+//              { str8 field } }* record*
+//   record  := u16 size (bytes that follow) u16 event i64 unix_ns { u8 tag value }*
+//   value   := I64/U64: 8 bytes | F64: 8 bytes | Bool: 1 byte | Str: u16 length + bytes
+//
+// Integers are little-endian (all supported targets). Records are buffered and flushed immediately for warnings and
+// errors; a background thread flushes the rest at least once a second, so none sits buffered longer than that even
+// when no further record follows.
+#pragma once
+
+#include "log_events.h"
+
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+enum class LogTag : uint8_t
+{
+    I64 = 1,
+    U64 = 2,
+    F64 = 3,
+    Bool = 4,
+    Str = 5
+};
+
+inline constexpr char kLogMagic[8] = {'H', 'O', 'T', 'S', 'L', 'O', 'G', '\0'};
+inline constexpr uint32_t kLogVersion = 1;
+inline constexpr size_t kMaxLogRecord = 1024;
+
+namespace logdetail
+{
+// Encodes one record into a fixed stack buffer; strings are truncated to fit.
+class RecordBuilder
+{
+public:
+    explicit RecordBuilder(Ev ev);
+
+    void put_i64(int64_t v) { put_fixed(LogTag::I64, &v, sizeof(v)); }
+    void put_u64(uint64_t v) { put_fixed(LogTag::U64, &v, sizeof(v)); }
+    void put_f64(double v) { put_fixed(LogTag::F64, &v, sizeof(v)); }
+    void put_bool(bool v)
+    {
+        uint8_t b = v ? 1 : 0;
+        put_fixed(LogTag::Bool, &b, 1);
+    }
+    void put_str(std::string_view s);
+    void put_wstr(const wchar_t* s);
+
+    template <typename T>
+    void put(const T& v)
+    {
+        using D = std::decay_t<T>;
+
+        if constexpr (std::is_same_v<D, bool>)
+            put_bool(v);
+        else if constexpr (std::is_enum_v<D>)
+            put_i64(static_cast<int64_t>(v));
+        else if constexpr (std::is_integral_v<D> && std::is_signed_v<D>)
+            put_i64(static_cast<int64_t>(v));
+        else if constexpr (std::is_integral_v<D>)
+            put_u64(static_cast<uint64_t>(v));
+        else if constexpr (std::is_floating_point_v<D>)
+            put_f64(static_cast<double>(v));
+        else if constexpr (std::is_same_v<D, const wchar_t*> || std::is_same_v<D, wchar_t*>)
+            put_wstr(v);
+        else if constexpr (std::is_same_v<D, std::filesystem::path>)
+            put_str(v.string());
+        else
+            put_str(std::string_view(v));
+    }
+
+    void commit();
+
+private:
+    void put_fixed(LogTag tag, const void* p, size_t n);
+
+    Ev ev_;
+    size_t n_ = 0;
+    unsigned char buf_[kMaxLogRecord];
+};
+
+bool enabled(LogLevel level);
+}  // namespace logdetail
+
+template <Ev E, typename... A>
+void log_event(const A&... args)
+{
+    static_assert(sizeof...(A) == event_info(E).field_count(), "argument count must match the event catalog");
+
+    if (!logdetail::enabled(event_info(E).level))
+        return;
+
+    logdetail::RecordBuilder rec(E);
+    (rec.put(args), ...);
+    rec.commit();
+}
+
+// Flushes buffered records (shutdown, before handing the file to a reader).
+void log_flush();
+
+// Path of the active log file.
+std::filesystem::path log_file();
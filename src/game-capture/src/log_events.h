@@ -0,0 +1,127 @@
+// Catalog of capture log events: stable ID (enum order, append only), name, level and argument names.
+// The writer copies this table into every log file header, so decoding never needs a matching build.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+enum class LogLevel : uint8_t
+{
+    Debug,
+    Info,
+    Warning,
+    Error
+};
+
+// X(Id, name, Level, field names...)
+#define HOTS_LOG_EVENTS(X)                                                                                             \
+    X(CaptureServiceStart, capture_service_start, Info)                                                                \
+    X(CaptureServiceStop, capture_service_stop, Info)                                                                  \
+    X(Cwd, cwd, Info, "path")                                                                                          \
+    X(FramesDir, frames_dir, Info, "path")                                                                             \
+    X(WaitingForProcess, waiting_for_process, Info, "names")                                                           \
+    X(ProcessFound, process_found, Info)                                                                               \
+    X(ProcessFoundViaTitle, process_found_via_title, Info)                                                             \
+    X(WindowFoundViaTitle, window_found_via_title, Info)                                                               \
+    X(NoWindowYet, no_window_yet, Info)                                                                                \
+    X(DeviceFail, device_fail, Error)                                                                                  \
+    X(CreateItemFail, create_item_fail, Error)                                                                         \
+    X(InvalidSize, invalid_size, Warning)                                                                              \
+    X(StartingCapture, starting_capture, Info, "width", "height", "pool_buffers", "pool_bytes", "refresh_hz")         \
+    X(SessionStarted, session_started, Info)                                                                           \
+    X(FrameEvent, frame_event, Debug, "count")                                                                         \
+    X(SharedTextureRecreated, shared_texture_recreated, Info, "w", "h")                                                \
+    X(ProbeCenter, probe_center, Debug, "b", "g", "r", "a")                                                            \
+    X(ProbeAvg10x10, probe_avg10x10, Debug, "b", "g", "r")                                                             \
+    X(FrameWritten, frame_written, Debug)                                                                              \
+    X(FrameSaved, frame_saved, Info, "index", "w", "h", "events", "copies")                                            \
+    X(SnapshotSaved, snapshot_saved, Info, "path")                                                                     \
+    X(FramesFlushed, frames_flushed, Info, "files")                                                                    \
+    X(CopyRate, copy_rate, Info, "events_per_s", "copies_per_s", "reactor_wakeups_per_s", "dropped_frames",           \
+      "drop_hist")                                                                                                     \
+    X(CaptureStalledNoEvents, capture_stalled_no_events, Warning, "events")                                            \
+    X(OpenProcFail, open_proc_fail, Error)                                                                             \
+    X(ProcessEnded, process_ended, Info, "exit_code", "uptime_ms")                                                     \
+    X(CaptureCancelled, capture_cancelled, Info)                                                                       \
+    X(ControlCommand, control_command, Info, "cmd", "fps", "seconds")                                                  \
+    X(ControlEffect, control_effect, Info, "cmd", "latency_us")                                                        \
+    X(ControlListening, control_listening, Info, "endpoint")                                                           \
+    X(ControlPipeFail, control_pipe_fail, Error, "err")                                                                \
+    X(ControlSocketPathTooLong, control_socket_path_too_long, Error, "path")                                           \
+    X(ControlSocketFail, control_socket_fail, Error)                                                                   \
+    X(ControlBindFail, control_bind_fail, Error, "path")                                                               \
+    X(TaskFailed, task_failed, Error, "name", "error")                                                                 \
+    X(ConsumerAttached, consumer_attached, Info, "heartbeat")                                                          \
+    X(ConsumerDetached, consumer_detached, Warning, "heartbeat")                                                       \
+    X(EmitRateAdapted, emit_rate_adapted, Info, "interval_ms", "lag_frames", "oldest_age_ms", "bound_ms")            \
+    X(FrameIndexRecovered, frame_index_recovered, Info, "next_seq", "records_scanned", "finalized", "removed",         \
+      "torn_bytes", "compacted", "recovery_us")                                                                        \
+    X(ShipConnected, ship_connected, Info, "endpoint", "node", "epoch", "next_seq", "offset")                          \
+    X(ShipDisconnected, ship_disconnected, Warning, "endpoint", "reason", "inflight")                                  \
+    X(ShipFileAcked, ship_file_acked, Debug, "seq", "raw_bytes", "wire_bytes")                                         \
+    X(ShipSkipped, ship_skipped, Warning, "seq", "reason")                                                             \
+    X(ShipQueueOverflow, ship_queue_overflow, Warning, "dropped_seq")                                                  \
+    X(ReplayHeader, replay_header, Info, "path", "build", "game_loops", "duration_ms", "read_us")                      \
+    X(ReplayHeaderUnreadable, replay_header_unreadable, Warning, "path")                                               \
+    X(CaptureBudget, capture_budget, Info, "expected_frames", "expected_bytes", "free_bytes")                          \
+    X(CaptureDiskShort, capture_disk_short, Warning, "expected_bytes", "free_bytes")                                   \
+    X(CaptureTimeBoxed, capture_time_boxed, Info, "uptime_ms", "game_ms")                                              \
+    X(AlignStarted, align_started, Info, "next_seq", "ticks")                                                          \
+    X(AlignRejected, align_rejected, Warning, "seq", "loop")                                                           \
+    X(AlignmentClosed, alignment_closed, Info, "path", "frame_knots", "loop_knots", "rejected")                        \
+    X(IoPacing, io_pacing, Info, "max_bytes_per_s", "burst_bytes", "chunk_bytes", "priority")                          \
+    X(IoRate, io_rate, Info, "bytes_per_s", "delayed_chunks", "queue_ms_avg", "queue_ms_max")                          \
+    X(CpuTopologyDetected, cpu_topology, Info, "logical", "cores", "efficiency_cpus", "performance_cpus")              \
+    X(ThreadPlacement, thread_placement, Info, "role", "cpus", "ok")                                                   \
+    X(PlacementSpecInvalid, placement_spec_invalid, Warning, "var", "value")                                           \
+    X(FrameBufferPages, frame_buffer_pages, Info, "buffer", "bytes", "kind", "huge_bytes")                             \
+    X(SharpnessGate, sharpness_gate, Info, "min_sharpness", "window_ms")                                               \
+    X(FrameSharpness, frame_sharpness, Info, "index", "sharpness", "passed", "waited_ms")                              \
+    X(FrameRetention, frame_retention, Info, "keep", "seeded")                                                         \
+    X(ConsumerRegistered, consumer_registered, Info, "name", "seq", "lease_ms")                                        \
+    X(ConsumerLeaseExpired, consumer_lease_expired, Warning, "name", "seq", "age_ms")                                  \
+    X(ConsumerCursor, consumer_cursor, Info, "name", "seq", "lag_frames", "age_ms")                                    \
+    X(FramesReclaimed, frames_reclaimed, Info, "frames", "files", "bytes", "floor", "retained", "held")                \
+    X(JpegSink, jpeg_sink, Info, "quality", "target_bytes", "mb_per_hour", "min_quality", "max_quality")               \
+    X(JpegFrame, jpeg_frame, Info, "index", "quality", "bytes", "target_bytes", "predicted_bytes", "complexity")       \
+    X(VideoSink, video_sink, Info, "width", "height", "fps", "format", "pid")                                          \
+    X(VideoSinkFailed, video_sink_failed, Error, "command")                                                            \
+    X(VideoSinkEnded, video_sink_ended, Info, "written", "duplicated", "dropped", "skipped", "mismatched", "exit_code")
+
+enum class Ev : uint16_t
+{
+#define HOTS_EV_ENUM(id, name, level, ...) id,
+    HOTS_LOG_EVENTS(HOTS_EV_ENUM)
+#undef HOTS_EV_ENUM
+    Count
+};
+
+struct EventInfo
+{
+    static constexpr size_t kMaxFields = 8;
+
+    const char* name;
+    LogLevel level;
+    const char* fields[kMaxFields];  // unused slots are null
+
+    constexpr size_t field_count() const
+    {
+        size_t n = 0;
+        while (n < kMaxFields && fields[n])
+            ++n;
+        return n;
+    }
+};
+
+inline constexpr EventInfo kEventCatalog[] = {
+#define HOTS_EV_INFO(id, name, level, ...) {#name, LogLevel::level, {__VA_ARGS__}},
+    HOTS_LOG_EVENTS(HOTS_EV_INFO)
+#undef HOTS_EV_INFO
+};
+
+static_assert(sizeof(kEventCatalog) / sizeof(kEventCatalog[0]) == static_cast<size_t>(Ev::Count));
+
+constexpr const EventInfo& event_info(Ev ev)
+{
+    return kEventCatalog[static_cast<size_t>(ev)];
+}
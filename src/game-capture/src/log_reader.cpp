@@ -0,0 +1,424 @@
+#include "log_reader.h"
+
+#include "log.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <ctime>
+
+static void append_str8(std::string& out, const std::string& s)
+{
+    size_t n = std::min<size_t>(s.size(), 255);
+    out.push_back(static_cast<char>(n));
+    out.append(s.data(), n);
+}
+
+template <typename T>
+static void append_raw(std::string& out, T v)
+{
+    out.append(reinterpret_cast<const char*>(&v), sizeof(v));
+}
+
+LogSchema current_log_schema(uint32_t pid)
+{
+    LogSchema schema;
+    schema.version = kLogVersion;
+    schema.pid = pid;
+    schema.service = "game-capture";
+    schema.role = "capture";
+
+    for (const auto& info : kEventCatalog)
+    {
+        LogEventDesc desc;
+        desc.name = info.name;
+        desc.level = info.level;
+
+        for (size_t i = 0; i < info.field_count(); ++i)
+            desc.fields.emplace_back(info.fields[i]);
+
+        schema.events.push_back(std::move(desc));
+    }
+
+    return schema;
+}
+
+std::string encode_log_header(const LogSchema& schema)
+{
+    std::string out(kLogMagic, sizeof(kLogMagic));
+    append_raw<uint32_t>(out, schema.version);
+    append_raw<uint32_t>(out, schema.pid);
+    append_str8(out, schema.service);
+    append_str8(out, schema.role);
+    append_raw<uint16_t>(out, static_cast<uint16_t>(schema.events.size()));
+
+    for (const auto& ev : schema.events)
+    {
+        out.push_back(static_cast<char>(ev.level));
+        append_str8(out, ev.name);
+        out.push_back(static_cast<char>(ev.fields.size()));
+
+        for (const auto& f : ev.fields)
+            append_str8(out, f);
+    }
+
+    return out;
+}
+
+bool parse_log_record(const unsigned char* p, size_t n, LogRecord& out)
+{
+    size_t off = 0;
+
+    auto take = [&](void* dst, size_t len)
+    {
+        if (off + len > n)
+            return false;
+        memcpy(dst, p + off, len);
+        off += len;
+        return true;
+    };
+
+    out.args.clear();
+
+    if (!take(&out.event, sizeof(out.event)) || !take(&out.unixNs, sizeof(out.unixNs)))
+        return false;
+
+    while (off < n)
+    {
+        LogValue v;
+
+        if (!take(&v.tag, 1))
+            return false;
+
+        switch (static_cast<LogTag>(v.tag))
+        {
+        case LogTag::I64:
+            if (!take(&v.i, 8))
+                return false;
+            break;
+        case LogTag::U64:
+            if (!take(&v.u, 8))
+                return false;
+            break;
+        case LogTag::F64:
+            if (!take(&v.f, 8))
+                return false;
+            break;
+        case LogTag::Bool:
+        {
+            uint8_t b = 0;
+            if (!take(&b, 1))
+                return false;
+            v.u = b;
+            break;
+        }
+        case LogTag::Str:
+        {
+            uint16_t len = 0;
+            if (!take(&len, 2) || off + len > n)
+                return false;
+            v.s.assign(reinterpret_cast<const char*>(p + off), len);
+            off += len;
+            break;
+        }
+        default:
+            return false;
+        }
+
+        out.args.push_back(std::move(v));
+    }
+
+    return true;
+}
+
+const char* log_level_name(LogLevel level)
+{
+    switch (level)
+    {
+    case LogLevel::Debug:
+        return "debug";
+    case LogLevel::Info:
+        return "info";
+    case LogLevel::Warning:
+        return "warning";
+    default:
+        return "error";
+    }
+}
+
+// Name and field names for `rec`, tolerating events newer than the schema
+static std::string event_name(const LogSchema& schema, const LogRecord& rec)
+{
+    if (rec.event < schema.events.size())
+        return schema.events[rec.event].name;
+    return "event_" + std::to_string(rec.event);
+}
+
+static std::string field_name(const LogSchema& schema, const LogRecord& rec, size_t i)
+{
+    if (rec.event < schema.events.size() && i < schema.events[rec.event].fields.size())
+        return schema.events[rec.event].fields[i];
+    return "arg" + std::to_string(i);
+}
+
+static LogLevel event_level(const LogSchema& schema, const LogRecord& rec)
+{
+    return rec.event < schema.events.size() ? schema.events[rec.event].level : LogLevel::Info;
+}
+
+// `utcSuffix` is "Z" for text lines and "+00:00" for JSON (Python's isoformat)
+static std::string format_timestamp(int64_t unixNs, const char* utcSuffix)
+{
+    int64_t ms = unixNs / 1000000;
+    std::time_t secs = static_cast<std::time_t>(ms / 1000);
+    std::tm utc{};
+#ifdef _WIN32
+    gmtime_s(&utc, &secs);
+#else
+    gmtime_r(&secs, &utc);
+#endif
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%04d-%02d-%02dT%02d:%02d:%02d.%03d%s", utc.tm_year + 1900, utc.tm_mon + 1,
+             utc.tm_mday, utc.tm_hour, utc.tm_min, utc.tm_sec, static_cast<int>(ms % 1000), utcSuffix);
+    return buf;
+}
+
+static std::string value_text(const LogValue& v)
+{
+    char buf[64];
+
+    switch (static_cast<LogTag>(v.tag))
+    {
+    case LogTag::I64:
+        snprintf(buf, sizeof(buf), "%lld", static_cast<long long>(v.i));
+        return buf;
+    case LogTag::U64:
+        snprintf(buf, sizeof(buf), "%llu", static_cast<unsigned long long>(v.u));
+        return buf;
+    case LogTag::F64:
+        snprintf(buf, sizeof(buf), "%.2f", v.f);
+        return buf;
+    case LogTag::Bool:
+        return v.u ? "1" : "0";
+    default:
+        return v.s;
+    }
+}
+
+static void append_json_string(std::string& out, const std::string& s)
+{
+    out.push_back('"');
+
+    for (unsigned char c : s)
+    {
+        switch (c)
+        {
+        case '"':
+            out += "\\\"";
+            break;
+        case '\\':
+            out += "\\\\";
+            break;
+        case '\n':
+            out += "\\n";
+            break;
+        case '\r':
+            out += "\\r";
+            break;
+        case '\t':
+            out += "\\t";
+            break;
+        default:
+            if (c < 0x20)
+            {
+                char esc[8];
+                snprintf(esc, sizeof(esc), "\\u%04x", c);
+                out += esc;
+            }
+            else
+            {
+                out.push_back(static_cast<char>(c));
+            }
+        }
+    }
+
+    out.push_back('"');
+}
+
+static void append_json_value(std::string& out, const LogValue& v)
+{
+    char buf[64];
+
+    switch (static_cast<LogTag>(v.tag))
+    {
+    case LogTag::F64:
+        if (!std::isfinite(v.f))
+        {
+            out += "null";
+            return;
+        }
+        snprintf(buf, sizeof(buf), "%.10g", v.f);
+        out += buf;
+        return;
+    case LogTag::Bool:
+        out += v.u ? "true" : "false";
+        return;
+    case LogTag::Str:
+        append_json_string(out, v.s);
+        return;
+    default:
+        out += value_text(v);
+    }
+}
+
+std::string render_log_text(const LogSchema& schema, const LogRecord& rec)
+{
+    std::string line = format_timestamp(rec.unixNs, "Z");
+    line += ' ';
+    line += event_name(schema, rec);
+
+    for (size_t i = 0; i < rec.args.size(); ++i)
+    {
+        line += ' ';
+        line += field_name(schema, rec, i);
+        line += '=';
+        line += value_text(rec.args[i]);
+    }
+
+    return line;
+}
+
+std::string render_log_json(const LogSchema& schema, const LogRecord& rec)
+{
+    std::string out = "{\"@timestamp\":";
+    append_json_string(out, format_timestamp(rec.unixNs, "+00:00"));
+    out += ",\"service.name\":";
+    append_json_string(out, schema.service);
+    out += ",\"service.role\":";
+    append_json_string(out, schema.role);
+    out += ",\"process.pid\":" + std::to_string(schema.pid);
+    out += ",\"log.level\":";
+    append_json_string(out, log_level_name(event_level(schema, rec)));
+    out += ",\"message\":";
+    append_json_string(out, event_name(schema, rec));
+
+    for (size_t i = 0; i < rec.args.size(); ++i)
+    {
+        out += ',';
+        append_json_string(out, field_name(schema, rec, i));
+        out += ':';
+        append_json_value(out, rec.args[i]);
+    }
+
+    out += '}';
+    return out;
+}
+
+LogReader::~LogReader()
+{
+    if (f_)
+        fclose(f_);
+}
+
+static bool read_str8(FILE* f, std::string& out)
+{
+    unsigned char len = 0;
+
+    if (fread(&len, 1, 1, f) != 1)
+        return false;
+
+    out.resize(len);
+    return len == 0 || fread(out.data(), 1, len, f) == len;
+}
+
+template <typename T>
+static bool read_raw(FILE* f, T& v)
+{
+    return fread(&v, sizeof(v), 1, f) == 1;
+}
+
+bool LogReader::open(const std::filesystem::path& path, std::string& error)
+{
+#ifdef _WIN32
+    f_ = _wfopen(path.wstring().c_str(), L"rb");
+#else
+    f_ = fopen(path.c_str(), "rb");
+#endif
+
+    if (!f_)
+    {
+        error = "cannot_open";
+        return false;
+    }
+
+    char magic[sizeof(kLogMagic)];
+    uint16_t nevents = 0;
+
+    if (fread(magic, 1, sizeof(magic), f_) != sizeof(magic) || memcmp(magic, kLogMagic, sizeof(magic)) != 0)
+    {
+        error = "not_a_capture_log";
+        return false;
+    }
+
+    if (!read_raw(f_, schema_.version) || !read_raw(f_, schema_.pid) || !read_str8(f_, schema_.service) ||
+        !read_str8(f_, schema_.role) || !read_raw(f_, nevents))
+    {
+        error = "truncated_header";
+        return false;
+    }
+
+    if (schema_.version != kLogVersion)
+    {
+        error = "unsupported_version";
+        return false;
+    }
+
+    for (uint16_t i = 0; i < nevents; ++i)
+    {
+        LogEventDesc ev;
+        uint8_t level = 0;
+        uint8_t nfields = 0;
+
+        if (!read_raw(f_, level) || !read_str8(f_, ev.name) || !read_raw(f_, nfields))
+        {
+            error = "truncated_header";
+            return false;
+        }
+
+        ev.level = static_cast<LogLevel>(level);
+        ev.fields.resize(nfields);
+
+        for (auto& field : ev.fields)
+        {
+            if (!read_str8(f_, field))
+            {
+                error = "truncated_header";
+                return false;
+            }
+        }
+
+        schema_.events.push_back(std::move(ev));
+    }
+
+    return true;
+}
+
+bool LogReader::next(LogRecord& out)
+{
+    uint16_t size = 0;
+    size_t got = fread(&size, 1, sizeof(size), f_);
+
+    if (got == 0)
+        return false;
+
+    unsigned char buf[kMaxLogRecord];
+
+    if (got != sizeof(size) || size > sizeof(buf) || fread(buf, 1, size, f_) != size ||
+        !parse_log_record(buf, size, out))
+    {
+        truncated_ = true;
+        return false;
+    }
+
+    return true;
+}
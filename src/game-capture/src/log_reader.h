@@ -0,0 +1,84 @@
+// Decoding side of the binary capture log (format in log.h): file parsing plus text and JSON rendering.
+#pragma once
+
+#include "log_events.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+struct LogEventDesc
+{
+    std::string name;
+    LogLevel level = LogLevel::Info;
+    std::vector<std::string> fields;
+};
+
+// Everything a renderer needs besides the record: the header of the file it came from.
+struct LogSchema
+{
+    uint32_t version = 0;
+    uint32_t pid = 0;
+    std::string service;
+    std::string role;
+    std::vector<LogEventDesc> events;
+};
+
+struct LogValue
+{
+    uint8_t tag = 0;
+    int64_t i = 0;
+    uint64_t u = 0;
+    double f = 0.0;
+    std::string s;
+};
+
+struct LogRecord
+{
+    uint16_t event = 0;
+    int64_t unixNs = 0;
+    std::vector<LogValue> args;
+};
+
+// Schema of this build's catalog (used by the stderr echo, which never reads a file).
+LogSchema current_log_schema(uint32_t pid);
+
+// Serialized file header for `schema`.
+std::string encode_log_header(const LogSchema& schema);
+
+// Parses the record body that follows the u16 size prefix.
+bool parse_log_record(const unsigned char* p, size_t n, LogRecord& out);
+
+const char* log_level_name(LogLevel level);
+
+// "2025-05-30T18:00:18.123Z frame_saved index=3 w=1920 ..." (the original capture.log line shape)
+std::string render_log_text(const LogSchema& schema, const LogRecord& rec);
+
+// One JsonLogger-shaped object: @timestamp, service.name, service.role, process.pid, log.level, message + fields.
+std::string render_log_json(const LogSchema& schema, const LogRecord& rec);
+
+class LogReader
+{
+public:
+    LogReader() = default;
+    ~LogReader();
+
+    LogReader(const LogReader&) = delete;
+    LogReader& operator=(const LogReader&) = delete;
+
+    // Opens `path` and parses its header; returns false with `error` set when it is not a capture log.
+    bool open(const std::filesystem::path& path, std::string& error);
+
+    // Next record; false at end of file. A record cut short by a crash ends the file and sets truncated().
+    bool next(LogRecord& out);
+
+    const LogSchema& schema() const { return schema_; }
+    bool truncated() const { return truncated_; }
+
+private:
+    FILE* f_ = nullptr;
+    LogSchema schema_;
+    bool truncated_ = false;
+};
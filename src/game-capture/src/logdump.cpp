@@ -0,0 +1,121 @@
+// hots_logdump: renders binary capture logs (capture.hlog*) as text lines or JsonLogger-shaped JSON.
+//
+//   hots_logdump [--json] [--level debug|info|warning|error] [file...]
+//
+// Without files it decodes sessions/current/capture.hlog and its rotated predecessors, oldest first.
+
+#include "log_reader.h"
+#include "paths.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+static void usage()
+{
+    fprintf(stderr, "usage: hots_logdump [--json] [--level debug|info|warning|error] [file...]\n");
+}
+
+static std::vector<std::filesystem::path> default_files()
+{
+    std::vector<std::filesystem::path> files;
+    auto base = session_dir() / "capture.hlog";
+
+    for (int i = 64; i >= 1; --i)
+    {
+        auto p = base;
+        p += ".";
+        p += std::to_string(i);
+
+        std::error_code ec;
+        if (std::filesystem::exists(p, ec))
+            files.push_back(p);
+    }
+
+    files.push_back(base);
+    return files;
+}
+
+int main(int argc, char** argv)
+{
+    bool json = false;
+    LogLevel minLevel = LogLevel::Debug;
+    std::vector<std::filesystem::path> files;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--json") == 0)
+        {
+            json = true;
+        }
+        else if (strcmp(argv[i], "--level") == 0 && i + 1 < argc)
+        {
+            std::string_view lv(argv[++i]);
+            bool matched = false;
+
+            for (auto l : {LogLevel::Debug, LogLevel::Info, LogLevel::Warning, LogLevel::Error})
+            {
+                if (lv == log_level_name(l))
+                {
+                    minLevel = l;
+                    matched = true;
+                }
+            }
+
+            if (!matched)
+            {
+                usage();
+                return 2;
+            }
+        }
+        else if (argv[i][0] == '-')
+        {
+            usage();
+            return 2;
+        }
+        else
+        {
+            files.emplace_back(argv[i]);
+        }
+    }
+
+    if (files.empty())
+        files = default_files();
+
+    int status = 0;
+
+    for (const auto& path : files)
+    {
+        LogReader reader;
+        std::string error;
+
+        if (!reader.open(path, error))
+        {
+            fprintf(stderr, "%s: %s\n", path.string().c_str(), error.c_str());
+            status = 1;
+            continue;
+        }
+
+        const auto& schema = reader.schema();
+        LogRecord rec;
+
+        while (reader.next(rec))
+        {
+            LogLevel level = rec.event < schema.events.size() ? schema.events[rec.event].level : LogLevel::Info;
+
+            if (level < minLevel)
+                continue;
+
+            std::string line = json ? render_log_json(schema, rec) : render_log_text(schema, rec);
+            line += '\n';
+            fputs(line.c_str(), stdout);
+        }
+
+        // A crash can cut the last record short; everything before it is intact
+        if (reader.truncated())
+            fprintf(stderr, "%s: truncated_tail\n", path.string().c_str());
+    }
+
+    return status;
+}
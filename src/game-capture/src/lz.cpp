@@ -0,0 +1,161 @@
+#include "lz.h"
+
+#include <cstring>
+
+static constexpr size_t kMinMatch = 4;
+static constexpr size_t kMaxOffset = 65535;
+static constexpr size_t kTailLiterals = 5;  // last bytes are always literals, like LZ4, so matches never overrun
+static constexpr int kHashBits = 14;
+
+static uint32_t read32(const uint8_t* p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static uint32_t hash4(uint32_t v)
+{
+    return (v * 2654435761u) >> (32 - kHashBits);
+}
+
+static void put_length(std::vector<uint8_t>& out, size_t len)
+{
+    while (len >= 255)
+    {
+        out.push_back(255);
+        len -= 255;
+    }
+    out.push_back(static_cast<uint8_t>(len));
+}
+
+static void emit(std::vector<uint8_t>& out, const uint8_t* lit, size_t litLen, size_t matchLen, size_t offset)
+{
+    size_t litCode = litLen < 15 ? litLen : 15;
+    size_t matchCode = 0;
+
+    if (matchLen)
+        matchCode = matchLen - kMinMatch < 15 ? matchLen - kMinMatch : 15;
+
+    out.push_back(static_cast<uint8_t>(litCode << 4 | matchCode));
+
+    if (litCode == 15)
+        put_length(out, litLen - 15);
+
+    out.insert(out.end(), lit, lit + litLen);
+
+    if (!matchLen)
+        return;
+
+    out.push_back(static_cast<uint8_t>(offset & 0xFF));
+    out.push_back(static_cast<uint8_t>(offset >> 8));
+
+    if (matchCode == 15)
+        put_length(out, matchLen - kMinMatch - 15);
+}
+
+bool lz_compress(const uint8_t* in, size_t n, std::vector<uint8_t>& out)
+{
+    out.clear();
+    out.reserve(n);
+
+    if (n < kMinMatch + kTailLiterals + 1)
+        return false;
+
+    std::vector<uint32_t> table(size_t(1) << kHashBits, 0);  // position + 1, 0 = empty
+    size_t anchor = 0;
+    size_t i = 0;
+    size_t limit = n - kTailLiterals;
+
+    while (i + kMinMatch <= limit)
+    {
+        uint32_t v = read32(in + i);
+        uint32_t h = hash4(v);
+        size_t cand = table[h];
+        table[h] = static_cast<uint32_t>(i + 1);
+
+        if (cand == 0 || i - (cand - 1) > kMaxOffset || read32(in + cand - 1) != v)
+        {
+            ++i;
+            continue;
+        }
+
+        size_t ref = cand - 1;
+        size_t len = kMinMatch;
+
+        while (i + len < limit && in[ref + len] == in[i + len])
+            ++len;
+
+        emit(out, in + anchor, i - anchor, len, i - ref);
+
+        // Bail out early once compression is clearly not paying off
+        if (out.size() >= n)
+            return false;
+
+        i += len;
+        anchor = i;
+    }
+
+    emit(out, in + anchor, n - anchor, 0, 0);
+    return out.size() < n;
+}
+
+bool lz_decompress(const uint8_t* in, size_t n, uint8_t* out, size_t rawLen)
+{
+    size_t ip = 0;
+    size_t op = 0;
+
+    auto read_length = [&](size_t& len)
+    {
+        uint8_t b;
+        do
+        {
+            if (ip >= n)
+                return false;
+            b = in[ip++];
+            len += b;
+        } while (b == 255);
+        return true;
+    };
+
+    while (ip < n)
+    {
+        uint8_t token = in[ip++];
+        size_t litLen = token >> 4;
+
+        if (litLen == 15 && !read_length(litLen))
+            return false;
+
+        if (litLen > n - ip || litLen > rawLen - op)
+            return false;
+
+        memcpy(out + op, in + ip, litLen);
+        ip += litLen;
+        op += litLen;
+
+        if (ip == n)
+            break;  // final literal-only sequence
+
+        if (n - ip < 2)
+            return false;
+
+        size_t offset = in[ip] | (size_t(in[ip + 1]) << 8);
+        ip += 2;
+
+        size_t matchLen = (token & 0x0F);
+        if (matchLen == 15 && !read_length(matchLen))
+            return false;
+        matchLen += kMinMatch;
+
+        if (offset == 0 || offset > op || matchLen > rawLen - op)
+            return false;
+
+        // Byte-wise: overlapping matches (offset < length) replicate runs
+        const uint8_t* src = out + op - offset;
+        for (size_t k = 0; k < matchLen; ++k)
+            out[op + k] = src[k];
+        op += matchLen;
+    }
+
+    return op == rawLen;
+}
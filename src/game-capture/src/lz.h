@@ -0,0 +1,17 @@
+// Small LZ77 block codec for frame shipping (LZ4-style sequences, no external dependency).
+//
+// Sequence: token (literal length << 4 | match length - 4), extra length bytes (255 = continue), literals,
+// u16 little-endian match offset, extra match length bytes. The last sequence has literals only.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Compresses `in` into `out` (replacing its contents). Returns false when the result would not be smaller, in which
+// case the caller should send the block raw.
+bool lz_compress(const uint8_t* in, size_t n, std::vector<uint8_t>& out);
+
+// Decompresses exactly `rawLen` bytes into `out`. Returns false on malformed input (never reads or writes out of
+// bounds).
+bool lz_decompress(const uint8_t* in, size_t n, uint8_t* out, size_t rawLen);
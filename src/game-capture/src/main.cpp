@@ -3,20 +3,52 @@
 //  1. Find Heroes process + main window
 //  2. Create WinRT GraphicsCaptureItem for HWND
 //  3. Capture frames via Direct3D11CaptureFramePool (free-threaded)
-//  4. Throttle to 1 FPS, saving BMPs to sessions/current/frames using atomic .pending -> final rename
-//  5. If window or process ends, restart polling
-
+//  4. Throttle to 1 FPS, saving BMPs (or JPEGs) to sessions/current/frames using atomic .pending -> final rename
+//     (compositor frames are only copied off the pool when a sink has asked for one, see frame_demand.h)
+//  5. If window or process ends, restart polling. When the active replay's header announces its length, capture
+//     stops at the expected game end rather than at process exit (storm_replay.h).
+// A control channel (control.h) can pause/resume, burst, snapshot, flush and report stats at runtime.
+// All waiting (process discovery, process exit, save cadence, control I/O) runs as coroutines on one Reactor
+// (async.h); readback and file I/O run on a small ThreadPool. Ctrl+C cancels everything through g_serviceStop.
+
+#include "alignment_map.h"
+#include "async.h"
+#include "consumer_cursors.h"
+#include "consumer_lag.h"
+#include "control.h"
+#include "copy_engine.h"
+#include "cpu_topology.h"
+#include "frame_demand.h"
+#include "frame_index.h"
+#include "frame_retention.h"
+#include "fs_util.h"
+#include "image_pyramid.h"
+#include "io_pacer.h"
+#include "jpeg_encoder.h"
+#include "jpeg_rate_control.h"
+#include "log.h"
+#include "page_buffer.h"
+#include "paths.h"
+#include "sharpness.h"
+#include "ship.h"
+#include "storm_replay.h"
+#include "video_sink.h"
+
+#include <algorithm>
 #include <atomic>
 #include <chrono>
-#include <cstdarg>
 #include <cstdio>
+#include <cstdlib>
 #include <ctime>
 #include <d3d11.h>
+#include <d3d11_4.h>
 #include <dxgi1_2.h>
 #include <filesystem>
+#include <memory>
 #include <mutex>
+#include <optional>
 #include <string>
-#include <thread>
+#include <string_view>
 #include <tlhelp32.h>
 #include <vector>
 #include <windows.graphics.capture.interop.h>
@@ -45,60 +77,39 @@ namespace WGD3D11 = winrt::Windows::Graphics::DirectX::Direct3D11;
 
 static const wchar_t* kPrimaryProcessName = L"HeroesOfTheStorm_x64.exe";
 static const wchar_t* kAltProcessName = L"HeroesOfTheStorm.exe";  // fallback if x64 suffix differs
-
-static void log_line(const char* msg)
+static const char* kProcessNames = "[HeroesOfTheStorm_x64.exe|HeroesOfTheStorm.exe]";
+static constexpr std::chrono::seconds kSaveInterval{1};
+static constexpr std::chrono::seconds kFrameStallTimeout{2};
+static constexpr std::chrono::seconds kCopyRateLogInterval{10};
+static constexpr std::chrono::seconds kRetryDelay{2};
+static constexpr std::chrono::milliseconds kExitGrace{750};
+static constexpr std::chrono::seconds kReplayMargin{60};
+static constexpr std::chrono::seconds kAlignSaveInterval{10};
+static constexpr std::chrono::seconds kCursorScanInterval{1};
+
+// Process-wide so the control channel survives capture session restarts
+static CaptureStats g_stats;
+static CaptureControl g_control{g_stats};
+static FrameDemand g_demand;
+static AsyncEvent g_saverWake;  // a requested frame was copied, or a control command arrived
+static AsyncEvent g_videoWake;  // a frame requested by the video loop was copied
+static std::stop_source g_serviceStop;
+static std::unique_ptr<Shipper> g_shipper;  // set when CAPTURE_SHIP_TO names an aggregator
+static std::unique_ptr<IoPacer> g_ioPacer;  // paces and deprioritizes frame file writes (CAPTURE_IO_*)
+static CpuTopology g_cpuTopology;
+static std::vector<int> g_handoffCpus;  // reactor and FrameArrived threads (CAPTURE_HANDOFF_CPUS)
+static PagePolicy g_pagePolicy = PagePolicy::Large;  // frame-sized worker buffers (CAPTURE_LARGE_PAGES)
+static std::unique_ptr<CopyEngine> g_copyEngine;  // staging readback copies (CAPTURE_COPY_*)
+
+// Latest compositor frame copied for a sink; FrameArrived writes it, the save loop reads it back
+struct SharedFrame
 {
-    static std::filesystem::path logPath;
-
-    if (logPath.empty())
-    {
-        // Use same base directory logic as frames_dir
-        const char* base_dir = std::getenv("NEXUS_BASE_DIR");
-        std::filesystem::path base_path = base_dir ? std::filesystem::path(base_dir) : std::filesystem::current_path();
-
-        logPath = base_path / "sessions" / "current" / "capture.log";
-        std::error_code ec;
-        std::filesystem::create_directories(logPath.parent_path(), ec);
-    }
-
-    SYSTEMTIME st;
-    GetSystemTime(&st);
-
-    char line[1024];
-
-    _snprintf_s(line, _TRUNCATE, "%04d-%02d-%02dT%02d:%02d:%02dZ %s\n", st.wYear, st.wMonth, st.wDay, st.wHour,
-                st.wMinute, st.wSecond, msg);
-
-    FILE* f = fopen(logPath.string().c_str(), "a");
-
-    if (f)
-    {
-        fputs(line, f);
-        fclose(f);
-    }
-
-    // Mirror to debugger & stderr for visibility if file fails
-    OutputDebugStringA(line);
-
-    fputs(line, stderr);
-}
-
-static void logf(const char* fmt, ...)
-{
-    char buf[768];
-    va_list ap;
-    va_start(ap, fmt);
-    _vsnprintf_s(buf, _TRUNCATE, fmt, ap);
-    va_end(ap);
-    log_line(buf);
-}
-
-static void log_path(const char* label, const std::filesystem::path& p)
-{
-    // Avoid char8_t conversion issues on MSVC prior to full char8_t interop.
-    std::string s = p.string();
-    logf("%s=%s", label, s.c_str());
-}
+    std::mutex m;
+    ComPtr<ID3D11Texture2D> tex;
+    UINT w = 0;
+    UINT h = 0;
+    int64_t ticks = 0;  // SystemRelativeTime of the frame in `tex`
+};
 
 static bool find_process(DWORD& pid)
 {
@@ -198,6 +209,14 @@ static HWND find_window_by_title_substring(const wchar_t* needleLower)
 
     return ctx.hwnd;
 }
+// Per-worker frame buffer, grown (and its page kind logged) the first time a frame does not fit
+static uint8_t* frame_buffer(PageBuffer& buf, const char* name, size_t bytes)
+{
+    if (buf.reserve(bytes, g_pagePolicy))
+        log_event<Ev::FrameBufferPages>(name, bytes, page_kind_name(buf.kind()), buf.huge_bytes());
+    return buf.data();
+}
+
 struct BmpWriter
 {
     // Input buffer expected BGRA (B,G,R,A). Converts to 24-bit BGR.
@@ -223,47 +242,63 @@ struct BmpWriter
         if (!f)
             return false;
 
-        fwrite(&fh, sizeof(fh), 1, f);
-        fwrite(&ih, sizeof(ih), 1, f);
+        // Encoded whole so the pacer sees one write per file, which it splits into evenly paced chunks
+        thread_local PageBuffer fileBuf;
+        unsigned char* file = frame_buffer(fileBuf, "encode", fh.bfSize);
 
-        std::vector<unsigned char> row(stride + pad);
+        if (!file)
+        {
+            fclose(f);
+            return false;
+        }
+
+        memcpy(file, &fh, sizeof(fh));
+        memcpy(file + sizeof(fh), &ih, sizeof(ih));
 
         for (int y = 0; y < h; ++y)
         {
             const unsigned char* src = &bgra[y * w * 4];
+            unsigned char* row = file + fh.bfOffBits + static_cast<size_t>(y) * (stride + pad);
             for (int x = 0; x < w; ++x)
             {  // BGR ordering in file
-                unsigned char B = src[x * 4 + 0];
-                unsigned char G = src[x * 4 + 1];
-                unsigned char R = src[x * 4 + 2];
-                row[x * 3 + 0] = B;
-                row[x * 3 + 1] = G;
-                row[x * 3 + 2] = R;
+                row[x * 3 + 0] = src[x * 4 + 0];
+                row[x * 3 + 1] = src[x * 4 + 1];
+                row[x * 3 + 2] = src[x * 4 + 2];
             }
 
             if (pad)
-                memset(row.data() + stride, 0, pad);
-
-            fwrite(row.data(), 1, stride + pad, f);
+                memset(row + stride, 0, pad);
         }
 
-        fclose(f);
+        bool ok = g_ioPacer ? g_ioPacer->write(f, file, fh.bfSize) : fwrite(file, 1, fh.bfSize, f) == fh.bfSize;
 
-        return true;
+        return fclose(f) == 0 && ok;
     }
 };
 
-static std::filesystem::path frames_dir()
+struct JpegWriter
 {
-    // Check for NEXUS_BASE_DIR environment variable, default to current working directory
-    const char* base_dir = std::getenv("NEXUS_BASE_DIR");
+    // Input buffer expected BGRA, rows packed. Encoded whole before writing, like BmpWriter; `bytes` is the file size.
+    static bool write(const std::filesystem::path& p, const unsigned char* bgra, int w, int h, int quality,
+                      size_t& bytes)
+    {
+        thread_local std::vector<uint8_t> file;
 
-    std::filesystem::path base_path = base_dir ? std::filesystem::path(base_dir) : std::filesystem::current_path();
-    std::filesystem::path p = base_path / "sessions" / "current" / "frames";
-    std::error_code ec;
-    std::filesystem::create_directories(p, ec);
-    return p;
-}
+        if (!encode_jpeg(bgra, w, h, static_cast<size_t>(w) * 4, quality, file))
+            return false;
+
+        FILE* f = _wfopen(p.wstring().c_str(), L"wb");
+
+        if (!f)
+            return false;
+
+        bool ok = g_ioPacer ? g_ioPacer->write(f, file.data(), file.size())
+                            : fwrite(file.data(), 1, file.size(), f) == file.size();
+        bytes = file.size();
+
+        return fclose(f) == 0 && ok;
+    }
+};
 
 static WGD3D11::IDirect3DDevice to_direct3d_device(ID3D11Device* d3dDevice)
 {
@@ -274,9 +309,228 @@ static WGD3D11::IDirect3DDevice to_direct3d_device(ID3D11Device* d3dDevice)
     return insp.as<WGD3D11::IDirect3DDevice>();
 }
 
-// Save texture to BMP. Input texture expected format: BGRA (B8G8R8A8). We convert to RGB for 24-bit output.
-static void save_staging_to_file(ID3D11Device* dev, ID3D11DeviceContext* ctx, ID3D11Texture2D* src,
-                                 const std::filesystem::path& outPath)
+// WGC frame pool depth (CAPTURE_POOL_BUFFERS, 1-8). More buffers absorb callback stalls at w*h*4 bytes each.
+static int32_t pool_buffer_count()
+{
+    const char* v = std::getenv("CAPTURE_POOL_BUFFERS");
+    int n = v ? std::atoi(v) : 2;
+    return std::clamp(n, 1, 8);
+}
+
+// Pool threads for frame readback, BMP encoding and fsync (CAPTURE_WORKERS, 1-8)
+static size_t worker_count()
+{
+    const char* v = std::getenv("CAPTURE_WORKERS");
+    int n = v ? std::atoi(v) : 2;
+    return static_cast<size_t>(std::clamp(n, 1, 8));
+}
+
+// CPUs a thread role may run on, from a cpu_topology.h spec in `var`; a malformed spec places nothing
+static std::vector<int> placement_cpus(const char* var, const char* fallback)
+{
+    const char* v = std::getenv(var);
+    auto cpus = resolve_cpu_spec(v ? v : fallback, g_cpuTopology);
+
+    if (!cpus)
+    {
+        log_event<Ev::PlacementSpecInvalid>(var, v);
+        return {};
+    }
+
+    return *cpus;
+}
+
+// Reduced levels (1/2, 1/4, 1/8) saved beside each frame under frames/pyramid (CAPTURE_PYRAMID_LEVELS, 0-3)
+static int pyramid_levels()
+{
+    const char* v = std::getenv("CAPTURE_PYRAMID_LEVELS");
+    int n = v ? std::atoi(v) : 0;
+    return std::clamp(n, 0, ImagePyramid::kMaxLevels);
+}
+
+// Saved frame format (CAPTURE_FRAME_FORMAT): "bmp" (default) or "jpeg", sized by JpegRateControl
+static bool jpeg_frames()
+{
+    const char* v = std::getenv("CAPTURE_FRAME_FORMAT");
+    return v && (std::string_view(v) == "jpeg" || std::string_view(v) == "jpg");
+}
+
+// Refresh rate of the monitor showing `hwnd` (CAPTURE_REFRESH_HZ overrides), used as the expected frame period
+static double display_refresh_hz(HWND hwnd)
+{
+    if (const char* v = std::getenv("CAPTURE_REFRESH_HZ"))
+    {
+        double hz = std::atof(v);
+        if (hz > 0.0)
+            return hz;
+    }
+
+    MONITORINFOEXW mi{};
+    mi.cbSize = sizeof(mi);
+    DEVMODEW dm{};
+    dm.dmSize = sizeof(dm);
+
+    if (GetMonitorInfoW(MonitorFromWindow(hwnd, MONITOR_DEFAULTTONEAREST), &mi) &&
+        EnumDisplaySettingsW(mi.szDevice, ENUM_CURRENT_SETTINGS, &dm) && dm.dmDisplayFrequency > 1)
+    {
+        return static_cast<double>(dm.dmDisplayFrequency);
+    }
+
+    return 60.0;  // 0/1 mean "hardware default"
+}
+
+// Header of the replay the session manager is playing (find_active_replay), if there is a readable one
+static bool read_active_replay(StormReplayHeader& h)
+{
+    auto path = find_active_replay();
+
+    if (path.empty())
+        return false;
+
+    auto readStart = std::chrono::steady_clock::now();
+
+    if (!read_storm_replay_header(path, h))
+    {
+        log_event<Ev::ReplayHeaderUnreadable>(path);
+        return false;
+    }
+
+    log_event<Ev::ReplayHeader>(
+        path, h.build, h.elapsedGameLoops, h.duration().count(),
+        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - readStart).count());
+    return true;
+}
+
+// How long a session against that replay should run: its game time plus CAPTURE_REPLAY_MARGIN_S (default 60) for
+// loading. CAPTURE_REPLAY_MARGIN_S=off captures until process exit.
+static std::optional<std::chrono::steady_clock::duration> replay_time_box(const StormReplayHeader& h)
+{
+    auto margin = std::chrono::duration_cast<std::chrono::steady_clock::duration>(kReplayMargin);
+
+    if (const char* v = std::getenv("CAPTURE_REPLAY_MARGIN_S"))
+    {
+        if (std::string_view(v) == "off")
+            return std::nullopt;
+        margin = std::chrono::seconds(std::max(0, std::atoi(v)));
+    }
+
+    return h.duration() + margin;
+}
+
+// Size of a w x h frame as write_bmp writes it: 24-bit rows padded to 4 bytes, plus the headers
+static uint64_t bmp_file_bytes(int32_t w, int32_t h)
+{
+    uint64_t row = (static_cast<uint64_t>(w) * 3 + 3) & ~uint64_t(3);
+    return row * h + sizeof(BITMAPFILEHEADER) + sizeof(BITMAPINFOHEADER);
+}
+
+// Logs what a session of `gameTime` will write at the base save rate and warns when the frames volume cannot hold it.
+// Counts each frame's pyramid levels; JPEG frames are sized by their budget, or without one at a generous 2 bits per
+// pixel (game frames at the default quality 85 come to about 1).
+static void log_capture_budget(std::chrono::milliseconds gameTime, int32_t w, int32_t h)
+{
+    uint64_t frames = static_cast<uint64_t>(gameTime / kSaveInterval) + 1;
+    const int levels = pyramid_levels();
+    uint64_t bytes = 0;
+
+    if (jpeg_frames())
+    {
+        auto cfg = JpegRateControl::Config::from_env();
+        double pixels = static_cast<double>(w) * h;
+        double frameBytes = pixels / 4;
+        if (cfg.targetBytes)
+            frameBytes = static_cast<double>(cfg.targetBytes);
+        else if (cfg.mbPerHour > 0)
+            frameBytes = cfg.mbPerHour * 1e6 * std::chrono::duration<double, std::ratio<3600>>(kSaveInterval).count();
+
+        // Levels are written at their frame's quality, so they scale with their pixel count
+        double levelPixels = 0;
+        for (int n = 1; n <= levels; ++n)
+            levelPixels += static_cast<double>(w >> n) * (h >> n);
+        bytes = static_cast<uint64_t>(frames * frameBytes * (1 + levelPixels / pixels));
+    }
+    else
+    {
+        uint64_t frameBytes = bmp_file_bytes(w, h);
+        for (int n = 1; n <= levels; ++n)
+            frameBytes += bmp_file_bytes(w >> n, h >> n);
+        bytes = frames * frameBytes;
+    }
+
+    std::error_code ec;
+    auto space = std::filesystem::space(frames_dir(), ec);
+    uint64_t freeBytes = ec ? 0 : space.available;
+
+    log_event<Ev::CaptureBudget>(frames, bytes, freeBytes);
+    if (!ec && freeBytes < bytes)
+        log_event<Ev::CaptureDiskShort>(bytes, freeBytes);
+}
+
+// steady_clock and SystemRelativeTime both count from the QueryPerformanceCounter origin; the latter in 100 ns units
+static int64_t system_relative_ticks(std::chrono::steady_clock::time_point t)
+{
+    using Ticks = std::chrono::duration<int64_t, std::ratio<1, AlignmentMap::kTicksPerSecond>>;
+    return std::chrono::duration_cast<Ticks>(t.time_since_epoch()).count();
+}
+
+// Ends the process wait at the time box unless the session finishes first
+static Task<> expire_at(Reactor& reactor, Reactor::Clock::time_point deadline, std::stop_source expire,
+                        std::stop_token stop)
+{
+    if (co_await reactor.sleep_until(deadline, stop) == WaitResult::Timeout)
+        expire.request_stop();
+}
+
+// UTC timestamp file name with the persistent frame sequence, e.g. 2025-05-30T18-00-18.123Z_00042.bmp
+static std::wstring frame_file_name(uint64_t seq, const wchar_t* ext)
+{
+    auto now = std::chrono::system_clock::now();
+    auto msEpoch = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch());
+    auto secEpoch = std::chrono::duration_cast<std::chrono::seconds>(msEpoch);
+    auto msPart = msEpoch - secEpoch;
+    std::time_t tt = std::chrono::system_clock::to_time_t(now);
+    std::tm utc{};
+    gmtime_s(&utc, &tt);
+    wchar_t name[128];
+    swprintf(name, 128, L"%04d-%02d-%02dT%02d-%02d-%02d.%03lldZ_%05llu%ls", utc.tm_year + 1900, utc.tm_mon + 1,
+             utc.tm_mday, utc.tm_hour, utc.tm_min, utc.tm_sec, static_cast<long long>(msPart.count()),
+             static_cast<unsigned long long>(seq), ext);
+    return name;
+}
+
+// Writes a BGRA image through <outPath>.pending, renamed into place once complete: as BMP, or as JPEG when `quality`
+// is set (1-100). `written`, if given, receives the file size.
+static bool write_image_file(const std::filesystem::path& outPath, const unsigned char* bgra, int w, int h,
+                             int quality = 0, size_t* written = nullptr)
+{
+    auto tmp = outPath;
+    tmp += L".pending";
+    size_t bytes = static_cast<size_t>(w) * h * 3;
+
+    if (quality ? JpegWriter::write(tmp, bgra, w, h, quality, bytes) : BmpWriter::write(tmp, bgra, w, h))
+    {
+        if (written)
+            *written = bytes;
+        std::error_code ec;
+        std::filesystem::rename(tmp, outPath, ec);
+
+        if (ec)
+        {
+            std::filesystem::remove(outPath, ec);
+            std::filesystem::rename(tmp, outPath, ec);
+        }
+
+        return true;
+    }
+
+    std::error_code ec;
+    std::filesystem::remove(tmp, ec);
+    return false;
+}
+
+// Read texture back into `out`, rows packed (width * 4 bytes). Input texture expected format: BGRA (B8G8R8A8).
+static bool read_staging(ID3D11Device* dev, ID3D11DeviceContext* ctx, ID3D11Texture2D* src, PageBuffer& out,
+                         UINT& width, UINT& height)
 {
     D3D11_TEXTURE2D_DESC desc{};
 
@@ -293,7 +547,7 @@ static void save_staging_to_file(ID3D11Device* dev, ID3D11DeviceContext* ctx, ID
 
     if (FAILED(dev->CreateTexture2D(&s, nullptr, &staging)))
     {
-        return;
+        return false;
     }
 
     ctx->CopyResource(staging.Get(), src);
@@ -302,21 +556,21 @@ static void save_staging_to_file(ID3D11Device* dev, ID3D11DeviceContext* ctx, ID
 
     if (FAILED(ctx->Map(staging.Get(), 0, D3D11_MAP_READ, 0, &map)))
     {
-        return;
+        return false;
     }
 
-    std::vector<unsigned char> bgra(desc.Width * desc.Height * 4);
+    unsigned char* bgra = frame_buffer(out, "readback", static_cast<size_t>(desc.Width) * desc.Height * 4);
 
-    for (UINT y = 0; y < desc.Height; ++y)
+    if (!bgra)
     {
-        const unsigned char* rowSrc = (unsigned char*)map.pData + y * map.RowPitch;
-        memcpy(&bgra[y * desc.Width * 4], rowSrc, desc.Width * 4);
+        ctx->Unmap(staging.Get(), 0);
+        return false;
     }
 
+    g_copyEngine->copy(bgra, desc.Width * 4, map.pData, map.RowPitch, desc.Width * 4, desc.Height);
+
     ctx->Unmap(staging.Get(), 0);
 
-    auto tmp = outPath;
-    tmp += L".pending";
     static bool loggedProbe = false;
 
     if (!loggedProbe)
@@ -326,7 +580,7 @@ static void save_staging_to_file(ID3D11Device* dev, ID3D11DeviceContext* ctx, ID
         if (cx < desc.Width && cy < desc.Height)
         {
             const unsigned char* pix = &bgra[(cy * desc.Width + cx) * 4];
-            logf("probe_center bg=%u g=%u r=%u a=%u", pix[0], pix[1], pix[2], pix[3]);
+            log_event<Ev::ProbeCenter>(pix[0], pix[1], pix[2], pix[3]);
             unsigned int sumB = 0, sumG = 0, sumR = 0, count = 0;
 
             for (int dy = -5; dy < 5; ++dy)
@@ -351,306 +605,1033 @@ static void save_staging_to_file(ID3D11Device* dev, ID3D11DeviceContext* ctx, ID
 
             if (count)
             {
-                logf("probe_avg10x10 b=%u g=%u r=%u", sumB / count, sumG / count, sumR / count);
+                log_event<Ev::ProbeAvg10x10>(sumB / count, sumG / count, sumR / count);
             }
         }
 
         loggedProbe = true;
     }
 
-    if (BmpWriter::write(tmp, bgra.data(), (int)desc.Width, (int)desc.Height))
-    {
-        std::error_code ec;
-        std::filesystem::rename(tmp, outPath, ec);
+    width = desc.Width;
+    height = desc.Height;
+    return true;
+}
 
-        if (ec)
-        {
-            std::filesystem::remove(outPath, ec);
-            std::filesystem::rename(tmp, outPath, ec);
-        }
+// Write a readback as BMP (we convert to RGB for 24-bit output), or as JPEG at `quality`. With `pyramid`, its reduced
+// levels are built from the same pixels (written by the caller).
+static bool write_frame(const std::filesystem::path& outPath, const unsigned char* bgra, UINT width, UINT height,
+                        int quality = 0, size_t* written = nullptr, ImagePyramid* pyramid = nullptr,
+                        int pyramidLevels = 0)
+{
+    if (!write_image_file(outPath, bgra, (int)width, (int)height, quality, written))
+        return false;
 
-        log_line("frame_written");
-    }
+    if (pyramid)
+        pyramid->build(bgra, (int)width, (int)height, width * 4, pyramidLevels);
+
+    log_event<Ev::FrameWritten>();
+    return true;
 }
 
-int main()
+// Save texture to a lossless BMP (snapshots: no sharpness gate, no pyramid, no JPEG whatever the frame format)
+static bool save_staging_to_file(ID3D11Device* dev, ID3D11DeviceContext* ctx, ID3D11Texture2D* src,
+                                 const std::filesystem::path& outPath)
 {
-    winrt::init_apartment(winrt::apartment_type::multi_threaded);
-    log_line("capture_service_start");
+    thread_local PageBuffer readback;
+    UINT w = 0, h = 0;
+    return read_staging(dev, ctx, src, readback, w, h) && write_frame(outPath, readback.data(), w, h, 0);
+}
 
-    try
-    {
-        log_path("cwd", std::filesystem::current_path());
-    }
-    catch (...)
-    {
-    }
+// Everything a capture session's coroutines and its FrameArrived callback share
+struct CaptureSession
+{
+    ComPtr<ID3D11Device> d3d;
+    ComPtr<ID3D11DeviceContext> ctx;
+    SharedFrame shared;
+    std::atomic<bool> running{true};
+    std::atomic<uint64_t> frameEvents{0};
+    std::filesystem::path framesDir;
+    std::optional<uint64_t> replayEndLoop;  // from the replay header; the alignment map ends there
+};
 
-    log_path("frames_dir", frames_dir());
+// A frame read back by the save loop, kept while the sharpness gate decides whether it is emitted
+struct Readback
+{
+    PageBuffer bgra;
+    UINT w = 0, h = 0;
+    int64_t ticks = 0;
+    double sharpness = 0;
+    bool ok = false;
+};
 
-    int scanCount = 0;
+// Save loop: every 1s (or the burst / backoff interval) request the next compositor frame and save it once
+// FrameArrived has copied it. Readback and file I/O run on the pool; waiting happens on the reactor, woken by
+// g_saverWake for copied frames and control commands. A frame blurred by a camera pan is held back while the
+// following frames are requested, until a sharp one arrives or the gate's window runs out (sharpness.h).
+static Task<> save_loop(Reactor& reactor, ThreadPool& pool, FrameIndex& index, FrameRetention& retention,
+                        CaptureSession& s, std::stop_token stop)
+{
+    auto snapshotDir = session_dir() / "snapshots";
+    auto detectionsDir = state_dir() / "detections";
+    std::vector<std::filesystem::path> unflushed;
+    ConsumerLag lag(detectionsDir.parent_path(), ConsumerLag::Config::from_env());
+    bool saveRequested = false;
+    bool snapshotRequested = false;
+    auto requestedAt = std::chrono::steady_clock::now();
+    auto rateStart = requestedAt;
+    uint64_t rateEvents = g_stats.frameEvents.load();
+    uint64_t rateCopies = g_stats.gpuCopies.load();
+    uint64_t rateWakeups = reactor.wakeups();
+    IoPacer::Stats rateIo = g_ioPacer->stats();
+    auto next =
+        std::chrono::steady_clock::now() + g_control.save_interval(std::chrono::steady_clock::now(), kSaveInterval);
+
+    ImagePyramid pyramid;
+    const int levels = pyramid_levels();
+    const auto pyramidDir = s.framesDir / "pyramid";
+
+    SharpnessGate gate(SharpnessGate::Config::from_env());
+    Readback current, held;
+    log_event<Ev::SharpnessGate>(gate.config().minSharpness, gate.config().window.count());
+
+    // JPEG frames get their quality from rate control and pyramid levels are written at their frame's quality.
+    // Snapshots stay lossless BMPs.
+    const bool jpeg = jpeg_frames();
+    const wchar_t* frameExt = jpeg ? L".jpg" : L".bmp";
+    auto rateCfg = JpegRateControl::Config::from_env();
+    rateCfg.interval = kSaveInterval;
+    JpegRateControl rate(rateCfg);
+    if (jpeg)
+        log_event<Ev::JpegSink>(rateCfg.quality, rateCfg.targetBytes, rateCfg.mbPerHour, rateCfg.minQuality,
+                                rateCfg.maxQuality);
+
+    // Retention outlives the session (seeded once in main); consumers hold frames back through their cursors
+    CursorTable cursors(state_dir() / "cursors");
+    auto cursorsScannedAt = requestedAt - kCursorScanInterval;
+    auto cursorsLoggedAt = requestedAt;
+
+    // Frame <-> game loop map for this session, named after the first sequence it can contain
+    AlignmentMap::Config alignCfg;
+    alignCfg.frameToleranceTicks = AlignmentMap::kTicksPerSecond / g_stats.gaps.refresh_hz();
+    AlignmentMap align(alignCfg);
+    if (s.replayEndLoop)
+        align.set_end_loop(*s.replayEndLoop);
+    auto alignDir = state_dir() / "alignment";
+    auto alignPath = alignDir / (std::to_string(index.next_seq()) + ".map");
+    uint64_t alignSaved = align.revision();
+    auto alignSavedAt = requestedAt;
 
     while (true)
     {
-        DWORD pid = 0;
-        if (!find_process(pid))
+        // While a frame is requested FrameArrived wakes us as soon as it has been copied
+        auto wake = std::min(saveRequested ? requestedAt + kFrameStallTimeout : next, gate.deadline());
+        auto woke = co_await g_saverWake.wait_until(reactor, wake, stop);
+        if (woke == WaitResult::Cancelled || !s.running.load())
+            break;
+
+        auto now = std::chrono::steady_clock::now();
+
+        if (g_control.take_flush())
         {
-            if ((scanCount++ % 15) == 0)
-                logf("waiting_for_process names=[%S|%S]", kPrimaryProcessName, kAltProcessName);
+            co_await pool.schedule();
+            for (const auto& p : unflushed)
+                sync_file(p);
+            sync_dir(s.framesDir);
+            index.sync();
+            co_await reactor.schedule();
+
+            log_event<Ev::FramesFlushed>(unflushed.size());
+            unflushed.clear();
+            g_stats.flushes.fetch_add(1);
+            g_control.ack(ControlOp::Flush);
+        }
 
-            // fallback window title heuristic if process not yet enumerated (edge cases)
+        // Timer readings name a frame already saved; a replay start means "now"
+        if (auto inputs = g_control.take_align(); !inputs.empty())
+        {
+            for (const auto& in : inputs)
+            {
+                if (in.start)
+                {
+                    align.mark_start(system_relative_ticks(in.at));
+                    log_event<Ev::AlignStarted>(index.next_seq(), system_relative_ticks(in.at));
+                }
+                else if (!align.add_reading(in.seq, in.loop))
+                {
+                    log_event<Ev::AlignRejected>(in.seq, in.loop);
+                }
+            }
+            g_control.ack(ControlOp::Align);
+        }
 
-            HWND byTitle = find_window_by_title_substring(L"heroes of the storm");
+        if (g_control.snapshot_pending() && !snapshotRequested)
+        {
+            g_demand.request(FrameSink::Snapshot, now);
+            snapshotRequested = true;
+        }
 
-            if (byTitle)
+        if (snapshotRequested && g_demand.take_fulfilled(FrameSink::Snapshot))
+        {
+            snapshotRequested = false;
+            ComPtr<ID3D11Texture2D> snapTex;
             {
-                DWORD wpid = 0;
+                std::lock_guard<std::mutex> lock(s.shared.m);
+                snapTex = s.shared.tex;
+            }
+            uint64_t snapSeq = index.next_seq();
+            auto snapPath = snapshotDir / frame_file_name(snapSeq, L".bmp");
+            index.begin(snapSeq, snapPath);
+
+            co_await pool.schedule();
+            std::error_code ec;
+            std::filesystem::create_directories(snapshotDir, ec);
+            bool saved =
+                snapTex && save_staging_to_file(s.d3d.Get(), s.ctx.Get(), snapTex.Get(), snapPath);
+            co_await reactor.schedule();
+
+            if (saved)
+            {
+                index.commit(snapSeq, snapPath);
+                unflushed.push_back(snapPath);
+                g_stats.snapshots.fetch_add(1);
+                log_event<Ev::SnapshotSaved>(snapPath);
+            }
+            else
+            {
+                index.abort(snapSeq, snapPath);
+            }
+            g_control.ack(ControlOp::Snapshot);
+        }
 
-                GetWindowThreadProcessId(byTitle, &wpid);
+        if (now - rateStart >= kCopyRateLogInterval)
+        {
+            double secs = std::chrono::duration<double>(now - rateStart).count();
+            uint64_t events = g_stats.frameEvents.load();
+            uint64_t copies = g_stats.gpuCopies.load();
+            uint64_t wakeups = reactor.wakeups();
+            log_event<Ev::CopyRate>(static_cast<double>(events - rateEvents) / secs,
+                                    static_cast<double>(copies - rateCopies) / secs,
+                                    static_cast<double>(wakeups - rateWakeups) / secs, g_stats.gaps.dropped(),
+                                    g_stats.gaps.histogram());
+
+            // Achieved write bandwidth and how long chunks queued for it
+            IoPacer::Stats io = g_ioPacer->stats();
+            uint64_t delayed = io.delayedChunks - rateIo.delayedChunks;
+            double queuedMs = std::chrono::duration<double, std::milli>(io.queued - rateIo.queued).count();
+            g_stats.ioBytes = io.bytes;
+            double ioBytesPerSec = static_cast<double>(io.bytes - rateIo.bytes) / secs;
+            g_stats.ioBytesPerSec = static_cast<uint64_t>(ioBytesPerSec);
+            g_stats.ioDelayedChunks = io.delayedChunks;
+            g_stats.ioQueueMaxUs = std::chrono::duration_cast<std::chrono::microseconds>(io.maxQueued).count();
+            log_event<Ev::IoRate>(ioBytesPerSec, delayed, delayed ? queuedMs / static_cast<double>(delayed) : 0.0,
+                                  std::chrono::duration<double, std::milli>(io.maxQueued).count());
+
+            rateStart = now;
+            rateEvents = events;
+            rateCopies = copies;
+            rateWakeups = wakeups;
+            rateIo = io;
+        }
 
-                if (wpid)
+        if (saveRequested && g_control.paused())
+        {
+            g_demand.cancel(FrameSink::Saver);
+            saveRequested = false;
+        }
+
+        // The readback to write this time round, if any
+        Readback* emit = nullptr;
+
+        // The pan outlasted the window without a sharp frame: the sharpest one seen goes out
+        if (gate.expire(now))
+        {
+            if (saveRequested)
+                g_demand.cancel(FrameSink::Saver);
+            saveRequested = false;
+            emit = &held;
+        }
+
+        if (saveRequested)
+        {
+            if (!g_demand.take_fulfilled(FrameSink::Saver))
+            {
+                // Stall detection (requested frame has not arrived)
+                if (now - requestedAt >= kFrameStallTimeout)
                 {
-                    pid = wpid;
-                    log_line("process_found_via_title");
+                    log_event<Ev::CaptureStalledNoEvents>(s.frameEvents.load());
+                    requestedAt = now;
                 }
+                continue;
             }
+            saveRequested = false;
+            // The first frame copied for the saver since a resume is the command's effect
+            g_control.ack(ControlOp::Resume);
 
-            if (!pid)
+            ComPtr<ID3D11Texture2D> texCopy;
+            {
+                std::lock_guard<std::mutex> lock(s.shared.m);
+                texCopy = s.shared.tex;
+                current.ticks = s.shared.ticks;
+            }
+
+            co_await pool.schedule();
+            current.ok = texCopy && read_staging(s.d3d.Get(), s.ctx.Get(), texCopy.Get(), current.bgra, current.w,
+                                                 current.h);
+            if (current.ok)
+                current.sharpness = frame_sharpness(current.bgra.data(), (int)current.w, (int)current.h, current.w * 4);
+            co_await reactor.schedule();
+
+            auto verdict = SharpnessGate::Verdict::Emit;
+            if (current.ok)
+            {
+                g_stats.sharpness = static_cast<uint64_t>(current.sharpness + 0.5);
+                verdict = gate.offer(current.sharpness, now);
+            }
+
+            switch (verdict)
             {
-                std::this_thread::sleep_for(std::chrono::seconds(2));
+            case SharpnessGate::Verdict::Emit:
+                emit = &current;
+                break;
+            case SharpnessGate::Verdict::EmitHeld:
+                emit = &held;
+                break;
+            case SharpnessGate::Verdict::Hold:
+                std::swap(current, held);
+                [[fallthrough]];
+            case SharpnessGate::Verdict::Drop:
+                // Straight on to the next compositor frame; the periodic schedule resumes once one is emitted
+                g_stats.framesDeferred.fetch_add(1);
+                g_demand.request(FrameSink::Saver, now);
+                saveRequested = true;
+                requestedAt = now;
                 continue;
             }
         }
-        else
+
+        if (emit)
         {
-            log_line("process_found");
-        }
+            // Sequence numbers come from the index so they keep increasing across sessions and restarts
+            uint64_t seq = index.next_seq();
+            auto outPath = s.framesDir / frame_file_name(seq, frameExt);
+            index.begin(seq, outPath);
+
+            // Each reduced level is an indexed file of its own (own sequence number), named after the frame
+            std::vector<std::pair<uint64_t, std::filesystem::path>> levelFiles;
+            for (int n = 1; n <= levels; ++n)
+            {
+                uint64_t levelSeq = index.next_seq();
+                auto levelPath =
+                    pyramidDir / pyramid_level_name(outPath.stem().string(), n, outPath.extension().string());
+                index.begin(levelSeq, levelPath);
+                levelFiles.emplace_back(levelSeq, std::move(levelPath));
+            }
 
-        HWND hwnd = find_main_hwnd(pid);
+            co_await pool.schedule();
+            // Rate control runs with the encode; only this loop touches it, one frame at a time
+            JpegRateControl::Plan plan;
+            double complexity = 0;
+            size_t pixels = static_cast<size_t>(emit->w) * emit->h;
+            size_t bytes = 0;
+            if (jpeg && emit->ok)
+            {
+                complexity = jpeg_complexity(emit->bgra.data(), (int)emit->w, (int)emit->h, emit->w * 4);
+                plan = rate.plan(complexity, pixels, now);
+            }
+            bool saved = emit->ok && write_frame(outPath, emit->bgra.data(), emit->w, emit->h, plan.quality, &bytes,
+                                                 levels ? &pyramid : nullptr, levels);
+            if (saved && jpeg)
+                rate.update(plan, complexity, pixels, bytes);
+            std::vector<bool> levelSaved(levelFiles.size(), false);
+            if (saved && !levelFiles.empty())
+            {
+                std::error_code ec;
+                std::filesystem::create_directories(pyramidDir, ec);
+                for (int n = 1; n <= pyramid.levels() && n <= levels; ++n)
+                {
+                    auto level = pyramid.level(n);
+                    levelSaved[n - 1] = write_image_file(levelFiles[n - 1].second, level.bgra, level.width,
+                                                         level.height, plan.quality);
+                }
+            }
+            co_await reactor.schedule();
 
-        if (!hwnd)
+            if (saved)
+            {
+                index.commit(seq, outPath);
+                unflushed.push_back(outPath);
+                g_stats.framesSaved.fetch_add(1);
+                align.add_frame(seq, emit->ticks);
+                if (g_shipper)
+                    g_shipper->enqueue(seq, outPath);
+                auto sidecar = detectionsDir / outPath.filename().replace_extension(L".detections.json");
+                lag.emitted(seq, sidecar, now);
+                log_event<Ev::FrameSharpness>(seq, emit->sharpness, gate.passed(), gate.waited().count());
+                if (jpeg)
+                {
+                    g_stats.jpegQuality = plan.quality;
+                    g_stats.jpegBytes = bytes;
+                    g_stats.jpegTargetBytes = static_cast<uint64_t>(plan.targetBytes);
+                    log_event<Ev::JpegFrame>(seq, plan.quality, bytes, plan.targetBytes, plan.predictedBytes,
+                                             complexity);
+                }
+            }
+            else
+            {
+                index.abort(seq, outPath);
+            }
+            for (size_t i = 0; i < levelFiles.size(); ++i)
+            {
+                const auto& [levelSeq, levelPath] = levelFiles[i];
+                if (!levelSaved[i])
+                {
+                    index.abort(levelSeq, levelPath);
+                    continue;
+                }
+                index.commit(levelSeq, levelPath);
+                unflushed.push_back(levelPath);
+                if (g_shipper)
+                    g_shipper->enqueue(levelSeq, levelPath);
+            }
+            if (saved)
+            {
+                std::vector<std::filesystem::path> files{outPath};
+                for (size_t i = 0; i < levelFiles.size(); ++i)
+                    if (levelSaved[i])
+                        files.push_back(levelFiles[i].second);
+                retention.add(seq, std::move(files));
+            }
+            if (g_control.bursting(now))
+                g_control.ack(ControlOp::Burst);
+            log_event<Ev::FrameSaved>(seq, emit->w, emit->h, s.frameEvents.load(), g_stats.gpuCopies.load());
+        }
+
+        if (now - cursorsScannedAt >= kCursorScanInterval)
         {
-            // Try fallback by title if main window enumeration not ready yet
-            hwnd = find_window_by_title_substring(L"heroes of the storm");
-            if (hwnd)
-                log_line("window_found_via_title");
+            cursorsScannedAt = now;
+            auto shipPending = g_shipper ? g_shipper->oldest_pending() : std::nullopt;
+            auto inferencePending = lag.oldest_pending();
+
+            co_await pool.schedule();
+            int64_t nowMs = unix_ms_now();
+            auto scan = cursors.scan(nowMs);
+            auto floor = cursors.floor();
+            // The shipper is a consumer too: frames before the oldest one it still has to send are done with
+            if (auto shipSeq = shipPending ? frame_seq_of(shipPending->filename().string()) : std::nullopt)
+                floor = std::min(floor.value_or(UINT64_MAX), *shipSeq ? *shipSeq - 1 : 0);
+            // So is hero-inference, which acknowledges through its sidecars rather than a cursor (consumer_lag.h)
+            if (inferencePending)
+                floor = std::min(floor.value_or(UINT64_MAX), *inferencePending ? *inferencePending - 1 : 0);
+            auto reclaimed = retention.reclaim(floor);
+            co_await reactor.schedule();
+
+            for (const auto& c : scan.registered)
+                log_event<Ev::ConsumerRegistered>(c.name, c.seq, c.lease.count());
+            for (const auto& c : scan.expired)
+                log_event<Ev::ConsumerLeaseExpired>(c.name, c.seq, nowMs - c.renewedUnixMs);
+            if (reclaimed.frames)
+                log_event<Ev::FramesReclaimed>(reclaimed.frames, reclaimed.files, reclaimed.bytes,
+                                               floor ? static_cast<int64_t>(*floor) : -1, retention.size(),
+                                               reclaimed.held);
+
+            // Lag per consumer: frames saved since its cursor (counted, since levels and snapshots share the seqs),
+            // and time since it last wrote
+            bool logCursors = now - cursorsLoggedAt >= kCopyRateLogInterval;
+            if (logCursors)
+                cursorsLoggedAt = now;
+            std::string lagText;
+            for (const auto& c : scan.live)
+            {
+                uint64_t lagFrames = retention.count_after(c.seq);
+                int64_t ageMs = nowMs - c.renewedUnixMs;
+                lagText += (lagText.empty() ? "" : ",") + c.name + ":" + std::to_string(lagFrames) + ":" +
+                           std::to_string(ageMs);
+                if (logCursors)
+                    log_event<Ev::ConsumerCursor>(c.name, c.seq, lagFrames, ageMs);
+            }
+            g_stats.set_consumers(std::move(lagText));
+            g_stats.retainedFrames = retention.config().keep ? retention.size() : 0;
+            g_stats.reclaimedFrames.fetch_add(reclaimed.frames);
+            g_stats.retentionHeld = reclaimed.held;
         }
 
-        if (!hwnd)
+        g_stats.alignFrameKnots = align.frames().knots().size();
+        g_stats.alignLoopKnots = align.loops().knots().size();
+        g_stats.alignRejected = align.rejected();
+        if (align.revision() != alignSaved && now - alignSavedAt >= kAlignSaveInterval)
         {
-            log_line("no_window_yet");
-            std::this_thread::sleep_for(std::chrono::seconds(1));
-            continue;
+            alignSaved = align.revision();
+            alignSavedAt = now;
+            co_await pool.schedule();
+            std::error_code ec;
+            std::filesystem::create_directories(alignDir, ec);
+            align.save(alignPath);
+            co_await reactor.schedule();
         }
-        // Create D3D11 device
-        ComPtr<ID3D11Device> d3d;
-        ComPtr<ID3D11DeviceContext> ctx;
-        D3D_FEATURE_LEVEL fl;
 
-        if (FAILED(D3D11CreateDevice(nullptr, D3D_DRIVER_TYPE_HARDWARE, nullptr, D3D11_CREATE_DEVICE_BGRA_SUPPORT,
-                                     nullptr, 0, D3D11_SDK_VERSION, &d3d, &fl, &ctx)))
+        // An explicit burst overrides the consumer-lag backoff
+        auto interval = g_control.save_interval(now, lag.next_interval(now, kSaveInterval));
+        g_stats.emitIntervalMs = std::chrono::duration_cast<std::chrono::milliseconds>(interval).count();
+        g_stats.lagFrames = lag.lag_frames();
+        g_stats.lagMs = lag.oldest_age_ms(now);
+        g_stats.ackLatencyMs = lag.last_ack_latency_ms();
+        g_stats.reactorWakeups = reactor.wakeups();
+        if (g_shipper)
+        {
+            auto shipped = g_shipper->counters();
+            g_stats.shipAckedFiles = shipped.ackedFiles;
+            g_stats.shipRawBytes = shipped.rawBytes;
+            g_stats.shipWireBytes = shipped.wireBytes;
+            g_stats.shipBacklog = shipped.backlog;
+        }
+        if (now < next)
         {
-            log_line("device_fail");
-            std::this_thread::sleep_for(std::chrono::seconds(2));
+            // Woken early; a new burst may have shortened the interval
+            next = std::min(next, now + interval);
             continue;
         }
+        next += interval;
+        if (next < now)
+            next = now + interval;
+
+        if (g_control.paused())
+            continue;
+
+        g_demand.request(FrameSink::Saver, now);
+        saveRequested = true;
+        requestedAt = now;
+    }
+
+    // Session over: write what changed since the last periodic save
+    if (align.revision() != alignSaved)
+    {
+        co_await pool.schedule();
+        std::error_code ec;
+        std::filesystem::create_directories(alignDir, ec);
+        align.save(alignPath);
+        co_await reactor.schedule();
+    }
+    if (!align.frames().empty())
+        log_event<Ev::AlignmentClosed>(alignPath, align.frames().knots().size(), align.loops().knots().size(),
+                                       align.rejected());
+}
+
+// Converts a compositor frame for the video sink straight out of the mapped staging texture (row pitch and all), so
+// the only CPU pass over the BGRA pixels is the conversion. The staging texture is kept between frames.
+static bool submit_video_frame(ID3D11Device* dev, ID3D11DeviceContext* ctx, ID3D11Texture2D* src,
+                               ComPtr<ID3D11Texture2D>& staging, VideoSink& sink)
+{
+    D3D11_TEXTURE2D_DESC desc{};
+    src->GetDesc(&desc);
+
+    D3D11_TEXTURE2D_DESC have{};
+    if (staging)
+        staging->GetDesc(&have);
+
+    if (!staging || have.Width != desc.Width || have.Height != desc.Height || have.Format != desc.Format)
+    {
+        D3D11_TEXTURE2D_DESC s = desc;
+        s.Usage = D3D11_USAGE_STAGING;
+        s.BindFlags = 0;
+        s.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+        s.MipLevels = 1;
+        s.ArraySize = 1;
+        s.MiscFlags = 0;
+        staging.Reset();
+        if (FAILED(dev->CreateTexture2D(&s, nullptr, &staging)))
+            return false;
+    }
 
-        auto interopDev = to_direct3d_device(d3d.Get());
-        // Create GraphicsCaptureItem
-        auto interop = winrt::get_activation_factory<WGC::GraphicsCaptureItem, IGraphicsCaptureItemInterop>();
-        WGC::GraphicsCaptureItem item{nullptr};
+    ctx->CopyResource(staging.Get(), src);
 
-        if (FAILED(interop->CreateForWindow(hwnd, winrt::guid_of<WGC::GraphicsCaptureItem>(), winrt::put_abi(item))))
+    D3D11_MAPPED_SUBRESOURCE map{};
+    if (FAILED(ctx->Map(staging.Get(), 0, D3D11_MAP_READ, 0, &map)))
+        return false;
+
+    bool ok = sink.submit(static_cast<const uint8_t*>(map.pData), (int)desc.Width, (int)desc.Height, map.RowPitch);
+    ctx->Unmap(staging.Get(), 0);
+    return ok;
+}
+
+// Video loop: asks for a compositor frame every 1/fps and hands it to the video sink, whose own thread feeds the
+// encoder at a constant rate. A window that presents nothing new before the next tick leaves the sink repeating its
+// last frame; while paused no frames are requested and the stream holds its last picture.
+static Task<> video_loop(Reactor& reactor, ThreadPool& pool, CaptureSession& s, VideoSink& sink, std::stop_token stop)
+{
+    const auto interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(sink.config().interval());
+    ComPtr<ID3D11Texture2D> staging;
+    auto next = std::chrono::steady_clock::now();
+
+    while (s.running.load() && !sink.ended())
+    {
+        if (g_control.paused())
         {
-            log_line("create_item_fail");
-            std::this_thread::sleep_for(std::chrono::seconds(2));
+            g_demand.cancel(FrameSink::Video);
+            if (co_await reactor.sleep_for(interval, stop) == WaitResult::Cancelled)
+                break;
+            next = std::chrono::steady_clock::now();
             continue;
         }
 
-        auto size = item.Size();
+        g_demand.request(FrameSink::Video, next);
+        if (co_await g_videoWake.wait_until(reactor, next + interval, stop) == WaitResult::Cancelled)
+            break;
 
-        if (size.Width <= 0 || size.Height <= 0)
+        auto now = std::chrono::steady_clock::now();
+
+        if (g_demand.take_fulfilled(FrameSink::Video))
         {
-            log_line("invalid_size");
-            std::this_thread::sleep_for(std::chrono::seconds(2));
-            continue;
+            ComPtr<ID3D11Texture2D> texCopy;
+            {
+                std::lock_guard<std::mutex> lock(s.shared.m);
+                texCopy = s.shared.tex;
+            }
+
+            co_await pool.schedule();
+            if (texCopy)
+                submit_video_frame(s.d3d.Get(), s.ctx.Get(), texCopy.Get(), staging, sink);
+            co_await reactor.schedule();
+
+            auto c = sink.counters();
+            g_stats.videoWritten = c.written;
+            g_stats.videoDuplicated = c.duplicated;
+            g_stats.videoDropped = c.dropped;
+            g_stats.videoSkipped = c.skipped;
+
+            next = std::max(next + interval, now);
+        }
+        else if (now >= next + interval)
+        {
+            next += interval;
         }
+    }
+
+    g_demand.cancel(FrameSink::Video);
+}
+
+// One capture session against `hwnd`, until the game process exits or the service stops
+static Task<> capture_window(Reactor& reactor, ThreadPool& pool, FrameIndex& index, FrameRetention& retention,
+                             DWORD pid, HWND hwnd, std::stop_token stop)
+{
+    CaptureSession s;
+    D3D_FEATURE_LEVEL fl;
 
-        logf("starting_capture width=%d height=%d", size.Width, size.Height);
+    // Create D3D11 device
+    if (FAILED(D3D11CreateDevice(nullptr, D3D_DRIVER_TYPE_HARDWARE, nullptr, D3D11_CREATE_DEVICE_BGRA_SUPPORT, nullptr,
+                                 0, D3D11_SDK_VERSION, &s.d3d, &fl, &s.ctx)))
+    {
+        log_event<Ev::DeviceFail>();
+        co_await reactor.sleep_for(kRetryDelay, stop);
+        co_return;
+    }
 
-        auto framePool = WGC::Direct3D11CaptureFramePool::CreateFreeThreaded(
-            interopDev, WGD::DirectXPixelFormat::B8G8R8A8UIntNormalized, 2, size);
+    // The FrameArrived callback (pool thread) and the save loop's workers share the immediate context
+    ComPtr<ID3D11Multithread> multithread;
+    if (SUCCEEDED(s.ctx.As(&multithread)))
+        multithread->SetMultithreadProtected(TRUE);
 
-        auto session = framePool.CreateCaptureSession(item);
+    auto interopDev = to_direct3d_device(s.d3d.Get());
+    // Create GraphicsCaptureItem
+    auto interop = winrt::get_activation_factory<WGC::GraphicsCaptureItem, IGraphicsCaptureItemInterop>();
+    WGC::GraphicsCaptureItem item{nullptr};
 
-        session.StartCapture();
+    if (FAILED(interop->CreateForWindow(hwnd, winrt::guid_of<WGC::GraphicsCaptureItem>(), winrt::put_abi(item))))
+    {
+        log_event<Ev::CreateItemFail>();
+        co_await reactor.sleep_for(kRetryDelay, stop);
+        co_return;
+    }
 
-        log_line("session_started");
+    auto size = item.Size();
 
-        auto baseDir = frames_dir();
+    if (size.Width <= 0 || size.Height <= 0)
+    {
+        log_event<Ev::InvalidSize>();
+        co_await reactor.sleep_for(kRetryDelay, stop);
+        co_return;
+    }
 
-        struct SharedFrame
+    StormReplayHeader replay;
+    std::optional<std::chrono::steady_clock::duration> timeBox;
+
+    if (read_active_replay(replay))
+    {
+        s.replayEndLoop = replay.elapsedGameLoops;
+        timeBox = replay_time_box(replay);
+        log_capture_budget(replay.duration(), size.Width, size.Height);
+    }
+
+    int32_t poolBuffers = pool_buffer_count();
+    g_stats.poolBuffers = static_cast<uint32_t>(poolBuffers);
+    g_stats.gaps.set_refresh_hz(display_refresh_hz(hwnd));
+    g_stats.gaps.restart();
+
+    log_event<Ev::StartingCapture>(size.Width, size.Height, poolBuffers,
+                                   static_cast<int64_t>(poolBuffers) * size.Width * size.Height * 4,
+                                   g_stats.gaps.refresh_hz());
+
+    auto framePool = WGC::Direct3D11CaptureFramePool::CreateFreeThreaded(
+        interopDev, WGD::DirectXPixelFormat::B8G8R8A8UIntNormalized, poolBuffers, size);
+
+    auto session = framePool.CreateCaptureSession(item);
+
+    session.StartCapture();
+    g_stats.capturing = true;
+
+    log_event<Ev::SessionStarted>();
+
+    s.framesDir = frames_dir();
+
+    // Frame event: copy into the shared texture only when a sink has asked for this frame; all other frames
+    // are released untouched (no GPU copy)
+    auto token = framePool.FrameArrived(
+        [&s](WGC::Direct3D11CaptureFramePool const& sender, auto const&)
         {
-            std::mutex m;
-            ComPtr<ID3D11Texture2D> tex;
-            UINT w = 0;
-            UINT h = 0;
-        } shared;
-
-        std::atomic<bool> running{true};
-        std::atomic<uint64_t> frameEvents{0};
-        auto sessionStart = std::chrono::steady_clock::now();
-
-        // Frame event: just copy latest frame into shared texture (GPU copy)
-        auto token = framePool.FrameArrived(
-            [&](WGC::Direct3D11CaptureFramePool const& sender, auto const&)
+            if (!s.running.load())
+                return;
+
+            // Callbacks arrive on WGC's own threads; each is placed with the handoff CPUs the first time it shows up
+            thread_local bool placed = false;
+            if (!placed)
             {
-                if (!running.load())
-                    return;
-                auto frame = sender.TryGetNextFrame();
-                if (!frame)
-                    return;
-                frameEvents.fetch_add(1);
-                logf("frame_event count=%llu", (unsigned long long)frameEvents.load());
-                auto surface = frame.Surface();
-                winrt::com_ptr<IDirect3DDxgiInterfaceAccess> access;
-                if (FAILED(surface.as<IInspectable>()->QueryInterface(__uuidof(IDirect3DDxgiInterfaceAccess),
-                                                                      access.put_void())))
-                    return;
-                ComPtr<ID3D11Texture2D> src;
-                if (FAILED(
-                        access->GetInterface(__uuidof(ID3D11Texture2D), reinterpret_cast<void**>(src.GetAddressOf()))))
-                    return;
-
-                D3D11_TEXTURE2D_DESC desc{};
-
-                src->GetDesc(&desc);
-
-                // Ensure a reusable texture of same size/format exists
-                {
-                    std::lock_guard<std::mutex> lock(shared.m);
-                    if (!shared.tex || shared.w != desc.Width || shared.h != desc.Height)
-                    {
-                        desc.Usage = D3D11_USAGE_DEFAULT;
-                        desc.BindFlags = 0;
-                        desc.CPUAccessFlags = 0;
-                        desc.MipLevels = 1;
-                        desc.ArraySize = 1;
-                        desc.MiscFlags = 0;
-
-                        ComPtr<ID3D11Texture2D> newTex;
-
-                        if (SUCCEEDED(d3d->CreateTexture2D(&desc, nullptr, &newTex)))
-                        {
-                            shared.tex = newTex;
-                            shared.w = desc.Width;
-                            shared.h = desc.Height;
-                            logf("shared_texture_recreated w=%u h=%u", shared.w, shared.h);
-                        }
-                        else
-                        {
-                            return;
-                        }
-                    }
-                    ctx->CopyResource(shared.tex.Get(), src.Get());
-                }
-            });
+                placed = true;
+                place_current_thread(g_handoffCpus, g_cpuTopology);
+            }
+
+            auto frame = sender.TryGetNextFrame();
+            if (!frame)
+                return;
+            s.frameEvents.fetch_add(1);
+            g_stats.frameEvents.fetch_add(1);
+            g_stats.gaps.on_frame(frame.SystemRelativeTime().count());
+            log_event<Ev::FrameEvent>(s.frameEvents.load());
+
+            uint32_t sinks = g_demand.claim(std::chrono::steady_clock::now());
+
+            if (!sinks)
+            {
+                frame.Close();
+                if (g_control.paused())
+                    g_control.ack(ControlOp::Pause);
+                return;
+            }
 
-        // Saver thread: every 1s save the most recent shared texture (if any)
-        std::atomic<bool> saverRun{true};
+            auto surface = frame.Surface();
+            winrt::com_ptr<IDirect3DDxgiInterfaceAccess> access;
+            ComPtr<ID3D11Texture2D> src;
+            if (FAILED(surface.as<IInspectable>()->QueryInterface(__uuidof(IDirect3DDxgiInterfaceAccess),
+                                                                  access.put_void())) ||
+                FAILED(access->GetInterface(__uuidof(ID3D11Texture2D), reinterpret_cast<void**>(src.GetAddressOf()))))
+            {
+                g_demand.rearm(sinks);
+                return;
+            }
 
-        std::thread saver(
-            [&]
+            D3D11_TEXTURE2D_DESC desc{};
+
+            src->GetDesc(&desc);
+
+            // Ensure a reusable texture of same size/format exists
             {
-                int saveIdx = 0;
-                auto next = std::chrono::steady_clock::now();
-                while (saverRun.load())
+                std::lock_guard<std::mutex> lock(s.shared.m);
+                if (!s.shared.tex || s.shared.w != desc.Width || s.shared.h != desc.Height)
                 {
-                    next += std::chrono::seconds(1);
-                    std::this_thread::sleep_until(next);
-                    if (!running.load())
-                        break;
-                    // Stall detection (no frame events yet after 2s)
-                    if (frameEvents.load() == 0 && std::chrono::duration_cast<std::chrono::milliseconds>(
-                                                       std::chrono::steady_clock::now() - sessionStart)
-                                                           .count() > 2000)
+                    desc.Usage = D3D11_USAGE_DEFAULT;
+                    desc.BindFlags = 0;
+                    desc.CPUAccessFlags = 0;
+                    desc.MipLevels = 1;
+                    desc.ArraySize = 1;
+                    desc.MiscFlags = 0;
+
+                    ComPtr<ID3D11Texture2D> newTex;
+
+                    if (SUCCEEDED(s.d3d->CreateTexture2D(&desc, nullptr, &newTex)))
                     {
-                        log_line("capture_stalled_no_events");
+                        s.shared.tex = newTex;
+                        s.shared.w = desc.Width;
+                        s.shared.h = desc.Height;
+                        log_event<Ev::SharedTextureRecreated>(s.shared.w, s.shared.h);
                     }
-                    ComPtr<ID3D11Texture2D> texCopy;
-                    UINT w = 0, h = 0;
+                    else
                     {
-                        std::lock_guard<std::mutex> lock(shared.m);
-                        if (!shared.tex)
-                        {
-                            continue;
-                        }
-                        texCopy = shared.tex;
-                        w = shared.w;
-                        h = shared.h;
+                        g_demand.rearm(sinks);
+                        return;
                     }
-                    auto now = std::chrono::system_clock::now();
-                    auto msEpoch = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch());
-                    auto secEpoch = std::chrono::duration_cast<std::chrono::seconds>(msEpoch);
-                    auto msPart = msEpoch - secEpoch;
-                    std::time_t tt = std::chrono::system_clock::to_time_t(now);
-                    std::tm utc{};
-                    gmtime_s(&utc, &tt);
-                    wchar_t name[128];
-                    swprintf(name, 128, L"%04d-%02d-%02dT%02d-%02d-%02d.%03lldZ_%05d.bmp", utc.tm_year + 1900,
-                             utc.tm_mon + 1, utc.tm_mday, utc.tm_hour, utc.tm_min, utc.tm_sec,
-                             static_cast<long long>(msPart.count()), saveIdx++);
-                    save_staging_to_file(d3d.Get(), ctx.Get(), texCopy.Get(), baseDir / name);
-                    logf("frame_saved index=%d scheduler w=%u h=%u events=%llu", saveIdx - 1, w, h,
-                         (unsigned long long)frameEvents.load());
                 }
-            });
-        // Monitor process
-        HANDLE hProc = OpenProcess(SYNCHRONIZE, FALSE, pid);
-        if (!hProc)
+                s.ctx->CopyResource(s.shared.tex.Get(), src.Get());
+                s.shared.ticks = frame.SystemRelativeTime().count();
+            }
+
+            g_stats.gpuCopies.fetch_add(1);
+            g_demand.fulfil(sinks);
+            // Each loop is woken only for the frames it asked for, so video frames do not spin the saver
+            if (sinks & FrameDemand::bit(FrameSink::Video))
+                g_videoWake.set();
+            if (sinks & (FrameDemand::bit(FrameSink::Saver) | FrameDemand::bit(FrameSink::Snapshot)))
+                g_control.wake();
+        });
+
+    // The saver stops with the session (process exit) or with the whole service
+    std::stop_source sessionStop;
+    std::stop_callback forwardStop(stop, [&sessionStop] { sessionStop.request_stop(); });
+    auto saver = reactor.spawn(save_loop(reactor, pool, index, retention, s, sessionStop.get_token()), "saver");
+
+    // One encoder process per session (CAPTURE_VIDEO_CMD), fed from the same compositor frames
+    VideoSink video(VideoSink::Config::from_env());
+    JoinHandle videoLoop;
+    if (video.config().enabled())
+        videoLoop = reactor.spawn(video_loop(reactor, pool, s, video, sessionStop.get_token()), "video");
+
+    // Monitor process: the reactor is signalled on exit, no polling. With a time box the wait also ends at the
+    // replay's expected end, since the client lingers on the score screen until the session manager closes it.
+    DWORD exitCode = 0;
+    bool signaled = false;
+    bool timedOut = false;
+    auto start = std::chrono::steady_clock::now();
+    HANDLE hProc = OpenProcess(SYNCHRONIZE | PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
+
+    std::stop_source processWait;
+    std::stop_callback forwardWait(stop, [&processWait] { processWait.request_stop(); });
+    std::stop_source timerStop;
+    JoinHandle timer;
+
+    if (timeBox)
+        timer = reactor.spawn(expire_at(reactor, start + *timeBox, processWait, timerStop.get_token()), "time-box");
+
+    if (!hProc)
+    {
+        log_event<Ev::OpenProcFail>();
+    }
+    else if (co_await reactor.process_exit(hProc, processWait.get_token()) == WaitResult::Signaled)
+    {
+        signaled = true;
+        GetExitCodeProcess(hProc, &exitCode);
+        // Give a brief grace period to flush a last frame
+        co_await reactor.sleep_for(kExitGrace, stop);
+    }
+    else
+    {
+        timedOut = !stop.stop_requested();
+    }
+
+    timerStop.request_stop();
+    co_await timer.join(reactor);
+
+    s.running = false;
+    g_stats.capturing = false;
+    framePool.FrameArrived(token);  // revoke
+    session.Close();
+    framePool.Close();
+    sessionStop.request_stop();
+    co_await saver.join(reactor);
+    co_await videoLoop.join(reactor);
+    // The encoder may take a while to finish its output; that wait belongs on the pool, not the reactor
+    co_await pool.schedule();
+    video.stop();
+    co_await reactor.schedule();
+    g_demand.reset();
+
+    auto uptimeMs = [start]
+    {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start)
+            .count();
+    };
+
+    // Game over: stay off the process until it exits, or the service would start capturing it again
+    if (timedOut)
+    {
+        log_event<Ev::CaptureTimeBoxed>(uptimeMs(), replay.duration().count());
+        if (co_await reactor.process_exit(hProc, stop) == WaitResult::Signaled)
         {
-            log_line("open_proc_fail");
-            framePool.FrameArrived(token);
-            framePool.Close();
-            session.Close();
-            continue;
+            signaled = true;
+            GetExitCodeProcess(hProc, &exitCode);
         }
-        DWORD exitCode = 0;
-        bool signaled = false;
-        auto start = std::chrono::steady_clock::now();
-        while (true)
+    }
+
+    if (hProc)
+        CloseHandle(hProc);
+
+    if (signaled)
+        log_event<Ev::ProcessEnded>(exitCode, uptimeMs());
+    else if (hProc)
+        log_event<Ev::CaptureCancelled>();
+}
+
+// Finds the game process and window, captures it, and starts over when it exits
+static Task<> capture_service(Reactor& reactor, ThreadPool& pool, FrameIndex& index, FrameRetention& retention,
+                              std::stop_token stop)
+{
+    int scanCount = 0;
+
+    while (!stop.stop_requested())
+    {
+        DWORD pid = 0;
+        if (!find_process(pid))
         {
-            DWORD w = WaitForSingleObject(hProc, 500);
-            if (w == WAIT_TIMEOUT)
+            if ((scanCount++ % 15) == 0)
+                log_event<Ev::WaitingForProcess>(kProcessNames);
+
+            // fallback window title heuristic if process not yet enumerated (edge cases)
+
+            HWND byTitle = find_window_by_title_substring(L"heroes of the storm");
+
+            if (byTitle)
             {
-                continue;
+                DWORD wpid = 0;
+
+                GetWindowThreadProcessId(byTitle, &wpid);
+
+                if (wpid)
+                {
+                    pid = wpid;
+                    log_event<Ev::ProcessFoundViaTitle>();
+                }
             }
-            signaled = true;
-            GetExitCodeProcess(hProc, &exitCode);
-            // Give a brief grace period (up to 750ms) to flush a last frame
-            auto graceStart = std::chrono::steady_clock::now();
-            while (std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - graceStart)
-                       .count() < 750)
+
+            if (!pid)
             {
-                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                co_await reactor.sleep_for(kRetryDelay, stop);
+                continue;
             }
-            break;
         }
-        CloseHandle(hProc);
-        running = false;
-        framePool.FrameArrived(token);  // revoke
-        session.Close();
-        framePool.Close();
-        saverRun = false;
-        if (saver.joinable())
-            saver.join();
-        if (signaled)
-            logf("process_ended exit_code=%lu uptime_ms=%llu", (unsigned long)exitCode,
-                 (unsigned long long)std::chrono::duration_cast<std::chrono::milliseconds>(
-                     std::chrono::steady_clock::now() - start)
-                     .count());
         else
-            log_line("process_ended");
+        {
+            log_event<Ev::ProcessFound>();
+        }
+
+        HWND hwnd = find_main_hwnd(pid);
+
+        if (!hwnd)
+        {
+            // Try fallback by title if main window enumeration not ready yet
+            hwnd = find_window_by_title_substring(L"heroes of the storm");
+            if (hwnd)
+                log_event<Ev::WindowFoundViaTitle>();
+        }
+
+        if (!hwnd)
+        {
+            log_event<Ev::NoWindowYet>();
+            co_await reactor.sleep_for(std::chrono::seconds(1), stop);
+            continue;
+        }
+
+        co_await capture_window(reactor, pool, index, retention, pid, hwnd, stop);
+    }
+}
+
+// Ctrl+C / console close: cancel every task so sessions tear down and the reactor returns
+static BOOL WINAPI on_console_ctrl(DWORD)
+{
+    g_serviceStop.request_stop();
+    return TRUE;
+}
+
+int main()
+{
+    winrt::init_apartment(winrt::apartment_type::multi_threaded);
+    log_event<Ev::CaptureServiceStart>();
+
+    try
+    {
+        log_event<Ev::Cwd>(std::filesystem::current_path());
     }
+    catch (...)
+    {
+    }
+
+    log_event<Ev::FramesDir>(frames_dir());
+
+    // Reconcile frames a previous run left half-written before anything new is saved
+    auto recoverStart = std::chrono::steady_clock::now();
+    FrameIndex index(state_dir() / "frames.idx", session_dir());
+    auto recovered = index.recover();
+    log_event<Ev::FrameIndexRecovered>(
+        recovered.nextSeq, recovered.recordsScanned, recovered.finalized, recovered.removed, recovered.tornBytes,
+        recovered.compacted,
+        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - recoverStart)
+            .count());
+
+    // Frames already on disk count towards retention, registered once per process before the reactor runs. With a
+    // limit the directory holds about `keep` frames and is scanned so none escape it; without one they only count
+    // consumer lag, so the commits in the index tail will do, and only while some cursor is live.
+    FrameRetention retention(FrameRetention::Config::from_env());
+    const std::vector<std::filesystem::path> retainedDirs{frames_dir(), frames_dir() / "pyramid"};
+    if (retention.config().keep)
+    {
+        log_event<Ev::FrameRetention>(retention.config().keep, retention.seed(retainedDirs));
+    }
+    else
+    {
+        auto cursors = list_cursors(state_dir() / "cursors");
+        int64_t nowMs = unix_ms_now();
+        if (std::any_of(cursors.begin(), cursors.end(), [nowMs](const ConsumerCursor& c) { return !c.expired(nowMs); }))
+            retention.seed(index.recent_commits(), retainedDirs);
+    }
+
+    g_ioPacer = std::make_unique<IoPacer>(IoPacerConfig::from_env());
+    g_pagePolicy = page_policy_from_env();
+    const auto& ioCfg = g_ioPacer->config();
+    log_event<Ev::IoPacing>(ioCfg.maxBytesPerSec, ioCfg.burstBytes, ioCfg.chunkBytes,
+                            io_priority_name(ioCfg.priority));
+
+    // Frames committed before a restart may not have reached the aggregator; its RESUME skips the ones that did
+    if (auto shipCfg = ShipConfig::from_env(); !shipCfg.endpoint.empty())
+    {
+        g_shipper = std::make_unique<Shipper>(std::move(shipCfg), index.epoch());
+        for (const auto& [seq, path] : index.recent_commits())
+            if (path.parent_path() == frames_dir() || path.parent_path() == frames_dir() / "pyramid")
+                g_shipper->enqueue(seq, path);
+        g_shipper->start();
+    }
+
+    // Readback/encode/write workers go to the E-cores and the handoff threads (reactor, FrameArrived) to the P-cores,
+    // so a frame handoff never queues behind an encode; both are CAPTURE_*_CPUS specs and a no-op off hybrid CPUs
+    g_cpuTopology = detect_cpu_topology();
+    g_handoffCpus = placement_cpus("CAPTURE_HANDOFF_CPUS", "performance");
+    const auto workerCpus = placement_cpus("CAPTURE_WORKER_CPUS", "efficiency");
+    log_event<Ev::CpuTopologyDetected>(g_cpuTopology.cpus.size(), g_cpuTopology.cores(),
+                                       format_cpu_list(g_cpuTopology.efficiency_cpus()),
+                                       format_cpu_list(g_cpuTopology.performance_cpus()));
+    log_event<Ev::ThreadPlacement>("handoff", format_cpu_list(g_handoffCpus),
+                                   place_current_thread(g_handoffCpus, g_cpuTopology));
+
+    g_copyEngine = std::make_unique<CopyEngine>(CopyEngine::Config::from_env(),
+                                                [&workerCpus]
+                                                {
+                                                    log_event<Ev::ThreadPlacement>(
+                                                        "copy", format_cpu_list(workerCpus),
+                                                        place_current_thread(workerCpus, g_cpuTopology));
+                                                });
+
+    Reactor reactor;
+    ThreadPool pool(worker_count(),
+                    [&workerCpus]
+                    {
+                        log_event<Ev::ThreadPlacement>("worker", format_cpu_list(workerCpus),
+                                                       place_current_thread(workerCpus, g_cpuTopology));
+                    });
+    auto stop = g_serviceStop.get_token();
+
+    g_control.set_notifier([] { g_saverWake.set(); });
+    SetConsoleCtrlHandler(on_console_ctrl, TRUE);
+
+    reactor.spawn(serve_control(
+                      reactor,
+                      [&reactor](std::string_view line)
+                      {
+                          g_stats.reactorWakeups = reactor.wakeups();
+                          return handle_control_line(g_control, line);
+                      },
+                      stop),
+                  "control");
+    reactor.spawn(capture_service(reactor, pool, index, retention, stop), "capture");
+    reactor.run();
+
+    if (g_shipper)
+        g_shipper->stop();
+
+    log_event<Ev::CaptureServiceStop>();
+    log_flush();
     return 0;
 }
@@ -0,0 +1,347 @@
+#include "minimap_tracker.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+
+namespace
+{
+// Cost of a pairing the gate rules out: large enough that the assignment takes any number of allowed pairings over
+// one forbidden one, finite so the potentials stay exact
+constexpr double kForbidden = 1e9;
+
+double env_double(const char* name, double fallback, double lo, double hi)
+{
+    const char* v = std::getenv(name);
+    return v ? std::clamp(std::atof(v), lo, hi) : fallback;
+}
+}  // namespace
+
+MinimapTracker::Config MinimapTracker::Config::from_env()
+{
+    Config c;
+
+    c.accelNoise = env_double("CAPTURE_TRACK_ACCEL", c.accelNoise, 1e-4, 10.0);
+    c.measureNoise = env_double("CAPTURE_TRACK_NOISE", c.measureNoise, 1e-4, 0.5);
+    c.gate = env_double("CAPTURE_TRACK_GATE", c.gate, 1.0, 20.0);
+    c.maxCoast = env_double("CAPTURE_TRACK_COAST_S", c.maxCoast, 0.0, 120.0);
+    if (const char* v = std::getenv("CAPTURE_TRACK_CONFIRM"))
+        c.confirmHits = std::clamp(std::atoi(v), 1, 100);
+    if (const char* v = std::getenv("CAPTURE_TRACK_PER_CLASS"))
+        c.maxPerClass = std::clamp(std::atoi(v), 0, 1000);
+
+    return c;
+}
+
+MinimapTracker::MinimapTracker(Config cfg) : cfg_(cfg) {}
+
+void MinimapTracker::predict(Track& t, double dt) const
+{
+    if (dt <= 0)
+        return;
+
+    if (t.state == State::Coasting && cfg_.coastDamping > 0)
+    {
+        // Unseen heroes tend to stop (fog, a fight, a recall), so coasting slows down rather than running on
+        const double decay = std::exp(-dt / cfg_.coastDamping);
+        const double travel = cfg_.coastDamping * (1.0 - decay);
+        t.x += t.vx * travel;
+        t.y += t.vy * travel;
+        t.vx *= decay;
+        t.vy *= decay;
+    }
+    else
+    {
+        t.x += t.vx * dt;
+        t.y += t.vy * dt;
+    }
+
+    // Icons stay on the minimap
+    if (t.x < 0 || t.x > 1)
+    {
+        t.x = std::clamp(t.x, 0.0, 1.0);
+        t.vx = 0;
+    }
+    if (t.y < 0 || t.y > 1)
+    {
+        t.y = std::clamp(t.y, 0.0, 1.0);
+        t.vy = 0;
+    }
+
+    // P = F P F' + Q for F = [1 dt; 0 1] and white acceleration noise
+    const double q = cfg_.accelNoise * cfg_.accelNoise;
+    const double dt2 = dt * dt;
+    t.pp += 2 * dt * t.pv + dt2 * t.vv + q * dt2 * dt2 / 4;
+    t.pv += dt * t.vv + q * dt2 * dt / 2;
+    t.vv += q * dt2;
+    t.sigma = std::sqrt(t.pp);
+}
+
+void MinimapTracker::correct(Track& t, const Detection& d) const
+{
+    const double r = cfg_.measureNoise * cfg_.measureNoise;
+    const double s = t.pp + r;
+    const double kp = t.pp / s;
+    const double kv = t.pv / s;
+    const double ix = d.x - t.x;
+    const double iy = d.y - t.y;
+
+    t.x += kp * ix;
+    t.y += kp * iy;
+    t.vx += kv * ix;
+    t.vy += kv * iy;
+
+    t.vv -= kv * t.pv;
+    t.pv *= r / s;
+    t.pp *= r / s;
+    t.sigma = std::sqrt(t.pp);
+}
+
+const std::vector<MinimapTracker::Track>& MinimapTracker::update(double t, std::span<const Detection> detections)
+{
+    const double dt = started_ ? std::max(0.0, t - time_) : 0.0;
+    time_ = started_ ? std::max(time_, t) : t;
+    started_ = true;
+    ++stats_.updates;
+    stats_.detections += detections.size();
+
+    for (Track& tr : tracks_)
+    {
+        predict(tr, dt);
+        tr.detection = -1;
+    }
+
+    const int n = static_cast<int>(tracks_.size());
+    const int m = static_cast<int>(detections.size());
+    assigned_.assign(detections.size(), 0);
+
+    if (n && m)
+    {
+        const double r = cfg_.measureNoise * cfg_.measureNoise;
+        const double gate2 = cfg_.gate * cfg_.gate;
+        const double jump2 = cfg_.maxJump * cfg_.maxJump;
+
+        cost_.resize(static_cast<size_t>(n) * m);
+        for (int i = 0; i < n; ++i)
+        {
+            const Track& tr = tracks_[i];
+            const double s = tr.pp + r;
+            const double logS = std::log(s);
+            for (int j = 0; j < m; ++j)
+            {
+                const Detection& d = detections[j];
+                const double dx = d.x - tr.x, dy = d.y - tr.y;
+                const double dist2 = dx * dx + dy * dy;
+                const double maha2 = dist2 / s;
+                const bool allowed = d.classId == tr.classId && maha2 <= gate2 && dist2 <= jump2;
+                // Negative log likelihood of the 2D innovation, up to a constant
+                cost_[static_cast<size_t>(i) * m + j] = allowed ? maha2 + 2 * logS : kForbidden;
+            }
+        }
+
+        solve_assignment(cost_.data(), n, m, match_, u_, v_, minv_, p_, way_, used_);
+
+        for (int i = 0; i < n; ++i)
+        {
+            const int j = match_[i];
+            if (j < 0 || cost_[static_cast<size_t>(i) * m + j] >= kForbidden)
+                continue;
+
+            Track& tr = tracks_[i];
+            correct(tr, detections[j]);
+            tr.detection = j;
+            tr.lastSeen = t;
+            tr.misses = 0;
+            ++tr.hits;
+            ++stats_.matched;
+            assigned_[j] = tr.id;
+
+            if (tr.state == State::Coasting)
+            {
+                tr.state = State::Confirmed;
+                ++stats_.recovered;
+            }
+        }
+    }
+
+    // Unmatched: tentative tracks go at once, confirmed ones coast until maxCoast. An ID of 0 marks a track to remove.
+    for (Track& tr : tracks_)
+    {
+        if (tr.detection >= 0)
+            continue;
+        ++tr.misses;
+        if (tr.state == State::Tentative)
+        {
+            tr.id = 0;
+            continue;
+        }
+        tr.state = State::Coasting;
+        if (t - tr.lastSeen > cfg_.maxCoast)
+        {
+            tr.id = 0;
+            ++stats_.dropped;
+        }
+    }
+
+    for (int j = 0; j < m; ++j)
+    {
+        if (assigned_[j])
+            continue;
+
+        const Detection& d = detections[j];
+        Track tr;
+        tr.id = nextId_++;
+        tr.classId = d.classId;
+        tr.x = d.x;
+        tr.y = d.y;
+        tr.pp = cfg_.measureNoise * cfg_.measureNoise;
+        tr.vv = cfg_.initialSpeed * cfg_.initialSpeed;
+        tr.sigma = cfg_.measureNoise;
+        tr.hits = 1;
+        tr.born = tr.lastSeen = t;
+        tr.detection = j;
+        assigned_[j] = tr.id;
+        tracks_.push_back(tr);
+        ++stats_.created;
+    }
+
+    // Once every track's state is settled for this frame, so the coasting tracks are the ones not seen in it
+    for (Track& tr : tracks_)
+        if (tr.id && tr.state == State::Tentative && tr.hits >= cfg_.confirmHits)
+            confirm(tr);
+
+    tracks_.erase(std::remove_if(tracks_.begin(), tracks_.end(), [](const Track& tr) { return tr.id == 0; }),
+                  tracks_.end());
+    return tracks_;
+}
+
+void MinimapTracker::confirm(Track& t)
+{
+    if (cfg_.maxPerClass > 0)
+    {
+        int confirmed = 0;
+        Track* best = nullptr;
+        double bestCost = 0;
+        const double r = cfg_.measureNoise * cfg_.measureNoise;
+        for (Track& c : tracks_)
+        {
+            if (!c.id || c.classId != t.classId || c.state == State::Tentative)
+                continue;
+            ++confirmed;
+            if (c.state != State::Coasting)
+                continue;
+            // No gate: with the class full, one of the coasting tracks is this hero, however far it went
+            const double s = c.pp + t.pp + r;
+            const double dx = t.x - c.x, dy = t.y - c.y;
+            const double cost = (dx * dx + dy * dy) / s + 2 * std::log(s);
+            if (!best || cost < bestCost)
+            {
+                best = &c;
+                bestCost = cost;
+            }
+        }
+
+        if (confirmed >= cfg_.maxPerClass)
+        {
+            if (!best)
+                return;
+            t.id = best->id;
+            t.born = best->born;
+            t.hits += best->hits;
+            best->id = 0;
+            assigned_[t.detection] = t.id;
+            t.state = State::Confirmed;
+            ++stats_.reclaimed;
+            return;
+        }
+    }
+
+    t.state = State::Confirmed;
+    ++stats_.confirmed;
+}
+
+void solve_assignment(const double* cost, int n, int m, std::vector<int>& rowMatch, std::vector<double>& u,
+                      std::vector<double>& v, std::vector<double>& minv, std::vector<int>& p, std::vector<int>& way,
+                      std::vector<char>& used)
+{
+    rowMatch.assign(static_cast<size_t>(n), -1);
+    if (n == 0 || m == 0)
+        return;
+
+    // The algorithm assigns every one of `rows` to a distinct column, so it runs on the transpose when n > m
+    const bool transposed = n > m;
+    const int rows = transposed ? m : n;
+    const int cols = transposed ? n : m;
+    auto at = [&](int i, int j)
+    { return transposed ? cost[static_cast<size_t>(j) * m + i] : cost[static_cast<size_t>(i) * m + j]; };
+
+    // 1-based; p[j] is the row assigned to column j, way[] the augmenting path
+    constexpr double kInf = std::numeric_limits<double>::infinity();
+    u.assign(static_cast<size_t>(rows) + 1, 0.0);
+    v.assign(static_cast<size_t>(cols) + 1, 0.0);
+    p.assign(static_cast<size_t>(cols) + 1, 0);
+    way.assign(static_cast<size_t>(cols) + 1, 0);
+
+    for (int i = 1; i <= rows; ++i)
+    {
+        p[0] = i;
+        int j0 = 0;
+        minv.assign(static_cast<size_t>(cols) + 1, kInf);
+        used.assign(static_cast<size_t>(cols) + 1, 0);
+
+        do
+        {
+            used[j0] = 1;
+            const int i0 = p[j0];
+            double delta = kInf;
+            int j1 = 0;
+            for (int j = 1; j <= cols; ++j)
+            {
+                if (used[j])
+                    continue;
+                const double cur = at(i0 - 1, j - 1) - u[i0] - v[j];
+                if (cur < minv[j])
+                {
+                    minv[j] = cur;
+                    way[j] = j0;
+                }
+                if (minv[j] < delta)
+                {
+                    delta = minv[j];
+                    j1 = j;
+                }
+            }
+            for (int j = 0; j <= cols; ++j)
+            {
+                if (used[j])
+                {
+                    u[p[j]] += delta;
+                    v[j] -= delta;
+                }
+                else
+                {
+                    minv[j] -= delta;
+                }
+            }
+            j0 = j1;
+        } while (p[j0] != 0);
+
+        do
+        {
+            const int j1 = way[j0];
+            p[j0] = p[j1];
+            j0 = j1;
+        } while (j0);
+    }
+
+    for (int j = 1; j <= cols; ++j)
+    {
+        if (!p[j])
+            continue;
+        if (transposed)
+            rowMatch[j - 1] = p[j] - 1;
+        else
+            rowMatch[p[j] - 1] = j - 1;
+    }
+}
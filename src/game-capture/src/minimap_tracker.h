@@ -0,0 +1,132 @@
+// Multi-object tracker for hero icons on the minimap: gives detections persistent track IDs across frames, with
+// position and velocity estimates, so a consumer can follow one hero instead of re-deciding from each frame's list
+// (detection sidecars number objects by their index within the frame).
+//
+// Input is any per-frame set of minimap detections (position in minimap coordinates, 0-1 across its width and
+// height, the "minimap units" below, plus class): parsed from hero-inference sidecars (detection_sidecar.h) or
+// produced natively. update() runs once per frame:
+//   1. Predict: every track advances to the frame's time under a constant-velocity Kalman filter (white acceleration
+//      noise). Both axes share one 2x2 covariance, since they have the same noise and are always updated together.
+//   2. Assign: a Hungarian assignment over tracks x detections of the same class, minimising the negative log
+//      likelihood of each pairing (squared Mahalanobis distance plus the log of the innovation variance). Pairings
+//      further than `gate` standard deviations, or than maxJump, are not allowed.
+//   3. Update the matched tracks; start a tentative track for each unmatched detection.
+// A track is confirmed after confirmHits matches (a tentative one that misses a frame is dropped, which keeps one-off
+// false positives from ever getting a stable ID). An unmatched confirmed track coasts: it keeps its ID and is
+// extrapolated, with its velocity decaying, while its uncertainty (and so its gate) grows, so a hero hidden by fog or
+// under another icon is picked up again where it reappears. It is dropped after maxCoast.
+// A team has five heroes, so at most maxPerClass tracks of a class are confirmed at once: a new track that reaches
+// confirmHits while its class is full takes over the ID of the coasting track it fits best (a hero back from fog
+// far from where it was lost), and stays tentative if none is coasting.
+//
+// Costs are a few microseconds a frame for ten heroes; nothing is allocated once the buffers have grown.
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+class MinimapTracker
+{
+public:
+    struct Config
+    {
+        double accelNoise = 0.05;    // CAPTURE_TRACK_ACCEL: acceleration std dev, minimap units/s^2
+        double measureNoise = 0.01;  // CAPTURE_TRACK_NOISE: detection position std dev, minimap units
+        double initialSpeed = 0.1;   // velocity std dev of a new track, minimap units/s
+        double gate = 4.0;           // CAPTURE_TRACK_GATE: largest Mahalanobis distance of a pairing
+        double maxJump = 0.25;       // largest distance of a pairing, minimap units, however uncertain the track
+        int confirmHits = 3;         // CAPTURE_TRACK_CONFIRM: matches before a track is confirmed
+        double maxCoast = 4.0;       // CAPTURE_TRACK_COAST_S: seconds a confirmed track survives unseen
+        double coastDamping = 1.0;   // time constant (s) of the velocity decay while coasting
+        int maxPerClass = 5;         // CAPTURE_TRACK_PER_CLASS: confirmed tracks of one class, 0 = no limit
+
+        static Config from_env();
+    };
+
+    struct Detection
+    {
+        double x = 0;  // minimap coordinates
+        double y = 0;
+        int classId = 0;
+        double conf = 0;
+    };
+
+    enum class State
+    {
+        Tentative,
+        Confirmed,
+        Coasting,  // confirmed, unmatched in the latest frame
+    };
+
+    struct Track
+    {
+        uint32_t id = 0;
+        int classId = 0;
+        State state = State::Tentative;
+        double x = 0;  // estimates at the latest update
+        double y = 0;
+        double vx = 0;  // minimap units/s
+        double vy = 0;
+        double sigma = 0;     // position std dev
+        int hits = 0;         // frames matched
+        int misses = 0;       // consecutive frames unmatched
+        double born = 0;      // time of the first detection
+        double lastSeen = 0;  // time of the latest match
+        int detection = -1;   // index of the detection matched in the latest update, -1 if none
+
+        // Kalman covariance of one axis: position variance, cross term, velocity variance
+        double pp = 0, pv = 0, vv = 0;
+    };
+
+    struct Stats
+    {
+        uint64_t updates = 0;
+        uint64_t detections = 0;
+        uint64_t matched = 0;
+        uint64_t created = 0;    // tracks started, tentative ones included
+        uint64_t confirmed = 0;  // tracks that reached confirmHits
+        uint64_t dropped = 0;    // confirmed tracks that coasted past maxCoast
+        uint64_t recovered = 0;  // coasting tracks matched again
+        uint64_t reclaimed = 0;  // coasting track IDs taken over by a new track of a full class
+    };
+
+    explicit MinimapTracker(Config cfg);
+
+    // Advances to time `t` (seconds, any epoch; a time not after the previous one counts as no time passing) and
+    // assigns this frame's detections. Returns the live tracks, each with the detection it took if any.
+    const std::vector<Track>& update(double t, std::span<const Detection> detections);
+
+    // Track ID given to each detection of the latest update: the track it joined, or the one it started
+    const std::vector<uint32_t>& assignment() const { return assigned_; }
+    const std::vector<Track>& tracks() const { return tracks_; }
+    const Stats& stats() const { return stats_; }
+    const Config& config() const { return cfg_; }
+
+private:
+    void predict(Track& t, double dt) const;
+    void correct(Track& t, const Detection& d) const;
+    void confirm(Track& t);
+
+    Config cfg_;
+    std::vector<Track> tracks_;
+    std::vector<uint32_t> assigned_;
+    uint32_t nextId_ = 1;
+    double time_ = 0;
+    bool started_ = false;
+    Stats stats_;
+
+    // Assignment scratch, kept across updates
+    std::vector<double> cost_;
+    std::vector<int> match_;
+    std::vector<double> u_, v_, minv_;
+    std::vector<int> p_, way_;
+    std::vector<char> used_;
+};
+
+// Minimum-cost assignment of rows to columns of an n x m cost matrix (row-major), every row to a distinct column if
+// n <= m, else every column to a distinct row. rowMatch[i] gets row i's column or -1. Hungarian algorithm with
+// potentials, O(max(n, m)^3); the scratch vectors are reused between calls.
+void solve_assignment(const double* cost, int n, int m, std::vector<int>& rowMatch, std::vector<double>& u,
+                      std::vector<double>& v, std::vector<double>& minv, std::vector<int>& p, std::vector<int>& way,
+                      std::vector<char>& used);
@@ -0,0 +1,288 @@
+#include "net.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+
+#ifdef _WIN32
+#include <ws2tcpip.h>
+#else
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+static void net_init()
+{
+    static std::once_flag once;
+    std::call_once(once,
+                   []
+                   {
+                       WSADATA wsa;
+                       WSAStartup(MAKEWORD(2, 2), &wsa);
+                   });
+}
+#else
+static void net_init() {}
+#endif
+
+bool parse_endpoint(const std::string& endpoint, std::string& host, uint16_t& port)
+{
+    auto colon = endpoint.rfind(':');
+
+    if (colon == std::string::npos || colon + 1 >= endpoint.size())
+        return false;
+
+    char* end = nullptr;
+    long p = std::strtol(endpoint.c_str() + colon + 1, &end, 10);
+
+    if (!end || *end != '\0' || p < 0 || p > 65535)
+        return false;
+
+    host = endpoint.substr(0, colon);
+    port = static_cast<uint16_t>(p);
+    return true;
+}
+
+socket_handle Socket::invalid()
+{
+#ifdef _WIN32
+    return INVALID_SOCKET;
+#else
+    return -1;
+#endif
+}
+
+Socket& Socket::operator=(Socket&& o) noexcept
+{
+    if (this != &o)
+    {
+        close();
+        h_ = o.release();
+    }
+    return *this;
+}
+
+bool Socket::valid() const
+{
+    return h_ != invalid();
+}
+
+void Socket::close()
+{
+    if (!valid())
+        return;
+#ifdef _WIN32
+    closesocket(h_);
+#else
+    ::close(h_);
+#endif
+    h_ = invalid();
+}
+
+socket_handle Socket::release()
+{
+    socket_handle h = h_;
+    h_ = invalid();
+    return h;
+}
+
+static std::string last_error(const char* what)
+{
+#ifdef _WIN32
+    return std::string(what) + ":" + std::to_string(WSAGetLastError());
+#else
+    return std::string(what) + ":" + strerror(errno);
+#endif
+}
+
+Socket Socket::connect_to(const std::string& host, uint16_t port, int timeoutMs, std::string& error)
+{
+    net_init();
+
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* res = nullptr;
+    std::string service = std::to_string(port);
+
+    if (getaddrinfo(host.c_str(), service.c_str(), &hints, &res) != 0 || !res)
+    {
+        error = "resolve_failed";
+        return Socket();
+    }
+
+    Socket out;
+
+    for (addrinfo* ai = res; ai; ai = ai->ai_next)
+    {
+        Socket s(::socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol));
+
+        if (!s.valid())
+            continue;
+
+        // Connect timeout via SO_SNDTIMEO is honoured on Linux; Windows falls back to the OS default
+        s.set_timeouts(timeoutMs);
+
+        if (::connect(s.h_, ai->ai_addr, static_cast<int>(ai->ai_addrlen)) == 0)
+        {
+            out = std::move(s);
+            break;
+        }
+
+        error = last_error("connect");
+    }
+
+    freeaddrinfo(res);
+    return out;
+}
+
+Socket Socket::listen_on(const std::string& host, uint16_t port, std::string& error)
+{
+    net_init();
+
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    addrinfo* res = nullptr;
+    std::string service = std::to_string(port);
+
+    if (getaddrinfo(host.empty() ? nullptr : host.c_str(), service.c_str(), &hints, &res) != 0 || !res)
+    {
+        error = "resolve_failed";
+        return Socket();
+    }
+
+    Socket s(::socket(res->ai_family, res->ai_socktype, res->ai_protocol));
+
+    if (s.valid())
+    {
+        int one = 1;
+        setsockopt(s.h_, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&one), sizeof(one));
+
+        if (::bind(s.h_, res->ai_addr, static_cast<int>(res->ai_addrlen)) != 0 || ::listen(s.h_, 16) != 0)
+        {
+            error = last_error("bind");
+            s.close();
+        }
+    }
+    else
+    {
+        error = last_error("socket");
+    }
+
+    freeaddrinfo(res);
+    return s;
+}
+
+Socket Socket::accept_client()
+{
+    return Socket(::accept(h_, nullptr, nullptr));
+}
+
+void Socket::set_timeouts(int ms)
+{
+#ifdef _WIN32
+    DWORD t = static_cast<DWORD>(ms);
+#else
+    timeval t{ms / 1000, (ms % 1000) * 1000};
+#endif
+    setsockopt(h_, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&t), sizeof(t));
+    setsockopt(h_, SOL_SOCKET, SO_SNDTIMEO, reinterpret_cast<const char*>(&t), sizeof(t));
+}
+
+void Socket::set_nodelay()
+{
+    int one = 1;
+    setsockopt(h_, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&one), sizeof(one));
+}
+
+bool Socket::send_all(const void* data, size_t n)
+{
+    auto* p = static_cast<const char*>(data);
+
+    while (n > 0)
+    {
+#ifdef _WIN32
+        int sent = ::send(h_, p, static_cast<int>(n > 1 << 20 ? 1 << 20 : n), 0);
+#elif defined(MSG_NOSIGNAL)
+        ssize_t sent = ::send(h_, p, n, MSG_NOSIGNAL);
+#else
+        ssize_t sent = ::send(h_, p, n, 0);
+#endif
+        if (sent <= 0)
+            return false;
+
+        p += sent;
+        n -= static_cast<size_t>(sent);
+    }
+
+    return true;
+}
+
+bool Socket::recv_all(void* data, size_t n)
+{
+    auto* p = static_cast<char*>(data);
+
+    while (n > 0)
+    {
+#ifdef _WIN32
+        int got = ::recv(h_, p, static_cast<int>(n > 1 << 20 ? 1 << 20 : n), 0);
+#else
+        ssize_t got = ::recv(h_, p, n, 0);
+#endif
+        if (got <= 0)
+            return false;
+
+        p += got;
+        n -= static_cast<size_t>(got);
+    }
+
+    return true;
+}
+
+int Socket::wait_readable(int timeoutMs)
+{
+#ifdef _WIN32
+    WSAPOLLFD pfd{h_, POLLRDNORM, 0};
+    int rc = WSAPoll(&pfd, 1, timeoutMs);
+#else
+    pollfd pfd{h_, POLLIN, 0};
+    int rc = ::poll(&pfd, 1, timeoutMs);
+#endif
+    if (rc < 0)
+        return -1;
+    return rc > 0 ? 1 : 0;
+}
+
+uint16_t Socket::local_port() const
+{
+    sockaddr_storage addr{};
+    socklen_t len = sizeof(addr);
+
+    if (getsockname(h_, reinterpret_cast<sockaddr*>(&addr), &len) != 0)
+        return 0;
+
+    if (addr.ss_family == AF_INET)
+        return ntohs(reinterpret_cast<sockaddr_in*>(&addr)->sin_port);
+
+    return ntohs(reinterpret_cast<sockaddr_in6*>(&addr)->sin6_port);
+}
+
+void Socket::shutdown_both()
+{
+    if (!valid())
+        return;
+#ifdef _WIN32
+    ::shutdown(h_, SD_BOTH);
+#else
+    ::shutdown(h_, SHUT_RDWR);
+#endif
+}
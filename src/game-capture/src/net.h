@@ -0,0 +1,59 @@
+// Minimal blocking TCP wrapper over Winsock / BSD sockets for the shipping sink and the aggregator.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#ifdef _WIN32
+#include <winsock2.h>
+using socket_handle = SOCKET;
+#else
+using socket_handle = int;
+#endif
+
+// "host:port" -> parts. Returns false when the port is missing or out of range.
+bool parse_endpoint(const std::string& endpoint, std::string& host, uint16_t& port);
+
+class Socket
+{
+public:
+    Socket() = default;
+    explicit Socket(socket_handle h) : h_(h) {}
+    ~Socket() { close(); }
+
+    Socket(Socket&& o) noexcept : h_(o.release()) {}
+    Socket& operator=(Socket&& o) noexcept;
+    Socket(const Socket&) = delete;
+    Socket& operator=(const Socket&) = delete;
+
+    static Socket connect_to(const std::string& host, uint16_t port, int timeoutMs, std::string& error);
+    static Socket listen_on(const std::string& host, uint16_t port, std::string& error);
+
+    Socket accept_client();
+
+    bool valid() const;
+    void close();
+    socket_handle release();
+
+    // Applies to every blocking send/recv; 0 disables.
+    void set_timeouts(int ms);
+    void set_nodelay();
+
+    bool send_all(const void* data, size_t n);
+    bool recv_all(void* data, size_t n);
+
+    // 1 readable, 0 timeout, -1 error.
+    int wait_readable(int timeoutMs);
+
+    // Port actually bound (listen_on with port 0).
+    uint16_t local_port() const;
+
+    // Unblocks a thread sitting in accept/recv on this socket.
+    void shutdown_both();
+
+private:
+    socket_handle h_ = invalid();
+
+    static socket_handle invalid();
+};
@@ -0,0 +1,255 @@
+#include "page_buffer.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+constexpr size_t kSmallPage = 4096;
+
+size_t round_up(size_t n, size_t to)
+{
+    return (n + to - 1) / to * to;
+}
+
+// One write per small page, so every page (or huge page) is faulted in now rather than during the first frame
+void touch(uint8_t* p, size_t n)
+{
+    for (size_t off = 0; off < n; off += kSmallPage)
+        p[off] = 0;
+}
+
+#ifdef _WIN32
+// MEM_LARGE_PAGES needs SeLockMemoryPrivilege enabled in the process token; granting it is up to the administrator
+bool enable_lock_memory_privilege()
+{
+    static const bool enabled = []
+    {
+        HANDLE token;
+        if (!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token))
+            return false;
+
+        TOKEN_PRIVILEGES tp{};
+        tp.PrivilegeCount = 1;
+        tp.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+        bool ok = LookupPrivilegeValueW(nullptr, SE_LOCK_MEMORY_NAME, &tp.Privileges[0].Luid) &&
+                  AdjustTokenPrivileges(token, FALSE, &tp, 0, nullptr, nullptr) && GetLastError() == ERROR_SUCCESS;
+        CloseHandle(token);
+        return ok;
+    }();
+    return enabled;
+}
+#else
+void* map_anonymous(size_t n, int extraFlags)
+{
+    void* p = mmap(nullptr, n, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | extraFlags, -1, 0);
+    return p == MAP_FAILED ? nullptr : p;
+}
+
+// A mapping aligned to `align`, so THP can back it with whole huge pages from the first byte
+void* map_aligned(size_t n, size_t align)
+{
+    auto* raw = static_cast<uint8_t*>(map_anonymous(n + align, 0));
+    if (!raw)
+        return nullptr;
+
+    uint8_t* start = reinterpret_cast<uint8_t*>(round_up(reinterpret_cast<uintptr_t>(raw), align));
+    if (start > raw)
+        munmap(raw, start - raw);
+    if (size_t tail = (raw + n + align) - (start + n))
+        munmap(start + n, tail);
+    return start;
+}
+#endif
+}  // namespace
+
+PageBuffer::~PageBuffer()
+{
+    release();
+}
+
+PageBuffer::PageBuffer(PageBuffer&& other) noexcept
+    : data_(std::exchange(other.data_, nullptr)),
+      capacity_(std::exchange(other.capacity_, 0)),
+      mapped_(std::exchange(other.mapped_, 0)),
+      kind_(other.kind_),
+      policy_(other.policy_)
+{
+}
+
+PageBuffer& PageBuffer::operator=(PageBuffer&& other) noexcept
+{
+    if (this != &other)
+    {
+        release();
+        data_ = std::exchange(other.data_, nullptr);
+        capacity_ = std::exchange(other.capacity_, 0);
+        mapped_ = std::exchange(other.mapped_, 0);
+        kind_ = other.kind_;
+        policy_ = other.policy_;
+    }
+    return *this;
+}
+
+void PageBuffer::release()
+{
+    if (!data_)
+        return;
+
+#ifdef _WIN32
+    VirtualFree(data_, 0, MEM_RELEASE);
+#else
+    munmap(data_, mapped_);
+#endif
+    data_ = nullptr;
+    capacity_ = 0;
+    mapped_ = 0;
+}
+
+bool PageBuffer::reserve(size_t bytes, PagePolicy policy)
+{
+    if (data_ && bytes <= capacity_ && policy == policy_)
+        return false;
+
+    release();
+    policy_ = policy;
+    kind_ = PageKind::Small;
+    size_t large = large_page_size();
+    void* p = nullptr;
+
+#ifdef _WIN32
+    if (policy == PagePolicy::Large && large && enable_lock_memory_privilege())
+    {
+        mapped_ = round_up(bytes, large);
+        p = VirtualAlloc(nullptr, mapped_, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+        if (p)
+            kind_ = PageKind::Large;
+    }
+
+    if (!p)
+    {
+        mapped_ = round_up(bytes, kSmallPage);
+        p = VirtualAlloc(nullptr, mapped_, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    }
+#else
+    if (policy != PagePolicy::Small && large)
+    {
+        mapped_ = round_up(bytes, large);
+        if (policy == PagePolicy::Large && (p = map_anonymous(mapped_, MAP_HUGETLB)))
+            kind_ = PageKind::Large;
+        else if ((p = map_aligned(mapped_, large)))
+        {
+            madvise(p, mapped_, MADV_HUGEPAGE);
+            kind_ = PageKind::Transparent;
+        }
+    }
+
+    if (!p)
+    {
+        mapped_ = round_up(bytes, kSmallPage);
+        p = map_anonymous(mapped_, 0);
+    }
+#endif
+
+    if (!p)
+    {
+        mapped_ = 0;
+        return true;
+    }
+
+    data_ = static_cast<uint8_t*>(p);
+    capacity_ = bytes;
+    touch(data_, mapped_);
+    return true;
+}
+
+size_t PageBuffer::huge_bytes() const
+{
+    if (!data_ || kind_ == PageKind::Small)
+        return 0;
+    if (kind_ == PageKind::Large)
+        return mapped_;
+
+#ifdef _WIN32
+    return 0;
+#else
+    // AnonHugePages of this mapping's entry in /proc/self/smaps (THP may have merged it with a neighbour)
+    FILE* f = fopen("/proc/self/smaps", "r");
+    if (!f)
+        return 0;
+
+    char line[256];
+    bool inside = false;
+    size_t kb = 0;
+    auto addr = reinterpret_cast<uintptr_t>(data_);
+
+    while (fgets(line, sizeof(line), f))
+    {
+        unsigned long lo, hi;
+        if (sscanf(line, "%lx-%lx ", &lo, &hi) == 2 && strchr(line, '-') < strchr(line, ' '))
+            inside = addr >= lo && addr < hi;
+        else if (inside && sscanf(line, "AnonHugePages: %zu kB", &kb) == 1)
+            break;
+    }
+
+    fclose(f);
+    return kb * 1024;
+#endif
+}
+
+size_t large_page_size()
+{
+#ifdef _WIN32
+    static const size_t size = GetLargePageMinimum();
+    return size;
+#else
+    static const size_t size = []
+    {
+        FILE* f = fopen("/proc/meminfo", "r");
+        if (!f)
+            return size_t(0);
+
+        char line[128];
+        size_t kb = 0;
+        while (fgets(line, sizeof(line), f) && sscanf(line, "Hugepagesize: %zu kB", &kb) != 1)
+        {
+        }
+        fclose(f);
+        return kb * 1024;
+    }();
+    return size;
+#endif
+}
+
+PagePolicy page_policy_from_env()
+{
+    const char* v = std::getenv("CAPTURE_LARGE_PAGES");
+    if (v && strcmp(v, "off") == 0)
+        return PagePolicy::Small;
+    if (v && strcmp(v, "transparent") == 0)
+        return PagePolicy::Transparent;
+    return PagePolicy::Large;
+}
+
+const char* page_kind_name(PageKind kind)
+{
+    switch (kind)
+    {
+    case PageKind::Small:
+        return "small";
+    case PageKind::Transparent:
+        return "transparent";
+    case PageKind::Large:
+        return "large";
+    }
+    return "?";
+}
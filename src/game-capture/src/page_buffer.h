@@ -0,0 +1,69 @@
+// Frame-sized buffers backed by large pages where the OS allows, so kernels that stream over a whole frame (readback
+// copy, BGRA -> BGR encode, pyramid) take a TLB miss per 2 MB rather than per 4 KB.
+//
+// With PagePolicy::Large a buffer tries, in order:
+//   large        explicit huge pages: MAP_HUGETLB on Linux (needs vm.nr_hugepages reserved), MEM_LARGE_PAGES on
+//                Windows (needs the "Lock pages in memory" right, SeLockMemoryPrivilege)
+//   transparent  Linux only: a 2 MB-aligned mapping with madvise(MADV_HUGEPAGE), backed by huge pages as THP finds them
+//   small        ordinary pages
+// and reports which it got. PagePolicy::Transparent starts at the second step (small pages on Windows), so the two
+// kinds of huge page can be compared. Buffers are touched once when allocated, so transparent huge pages are in place
+// (and counted) before the first frame, and are meant to be kept and reused rather than allocated per frame.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+enum class PagePolicy
+{
+    Small,
+    Transparent,
+    Large,
+};
+
+enum class PageKind
+{
+    Small,
+    Transparent,
+    Large,
+};
+
+class PageBuffer
+{
+public:
+    PageBuffer() = default;
+    ~PageBuffer();
+
+    PageBuffer(PageBuffer&& other) noexcept;
+    PageBuffer& operator=(PageBuffer&& other) noexcept;
+    PageBuffer(const PageBuffer&) = delete;
+    PageBuffer& operator=(const PageBuffer&) = delete;
+
+    // Makes room for `bytes`, reallocating (contents lost) only if the buffer is smaller or the policy changed.
+    // Returns true if it reallocated; data() is null if even small pages could not be had.
+    bool reserve(size_t bytes, PagePolicy policy);
+
+    uint8_t* data() const { return data_; }
+    size_t capacity() const { return capacity_; }
+    PageKind kind() const { return kind_; }
+    // Bytes currently backed by huge pages (all of a Large buffer; what THP provided for a Transparent one).
+    size_t huge_bytes() const;
+
+private:
+    void release();
+
+    uint8_t* data_ = nullptr;
+    size_t capacity_ = 0;
+    size_t mapped_ = 0;  // length of the OS mapping (capacity rounded up to its page size)
+    PageKind kind_ = PageKind::Small;
+    PagePolicy policy_ = PagePolicy::Small;
+};
+
+// Size of one large page (Hugepagesize on Linux, GetLargePageMinimum on Windows); 0 if unsupported.
+size_t large_page_size();
+
+// CAPTURE_LARGE_PAGES: "off" for small pages, "transparent" for PagePolicy::Transparent, anything else (default "on")
+// for PagePolicy::Large.
+PagePolicy page_policy_from_env();
+
+const char* page_kind_name(PageKind kind);
@@ -0,0 +1,32 @@
+#include "paths.h"
+
+#include <cstdlib>
+
+std::filesystem::path base_dir()
+{
+    // Check for NEXUS_BASE_DIR environment variable, default to current working directory
+    const char* base = std::getenv("NEXUS_BASE_DIR");
+
+    return base ? std::filesystem::path(base) : std::filesystem::current_path();
+}
+
+std::filesystem::path session_dir()
+{
+    return base_dir() / "sessions" / "current";
+}
+
+std::filesystem::path frames_dir()
+{
+    std::filesystem::path p = session_dir() / "frames";
+    std::error_code ec;
+    std::filesystem::create_directories(p, ec);
+    return p;
+}
+
+std::filesystem::path state_dir()
+{
+    std::filesystem::path p = session_dir() / "state";
+    std::error_code ec;
+    std::filesystem::create_directories(p, ec);
+    return p;
+}
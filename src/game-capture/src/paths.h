@@ -0,0 +1,16 @@
+// Shared directory layout for the capture service (mirrors the Python services' NEXUS_BASE_DIR handling)
+#pragma once
+
+#include <filesystem>
+
+// ${NEXUS_BASE_DIR} or the current working directory
+std::filesystem::path base_dir();
+
+// ${base}/sessions/current
+std::filesystem::path session_dir();
+
+// ${base}/sessions/current/frames (created on first use)
+std::filesystem::path frames_dir();
+
+// ${base}/sessions/current/state (created on first use)
+std::filesystem::path state_dir();
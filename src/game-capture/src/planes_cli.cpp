@@ -0,0 +1,488 @@
+// hots_planes: runs stand-ins for the per-frame analysis stages (dedup hash, scene classifier, motion energy, minimap,
+// health bars, thumbnail) over saved frames, first with one shared DerivedFrame per frame and then with one per stage,
+// and prints the time per frame with the plane cache's hit/miss and buffer reuse counts.
+//
+//   hots_planes [--workers N] [--repeat R] [--sharpness | --pyramid] <dir|file.bmp>...
+//
+// Stages are spread over N worker threads (default 3) that all work on the same frame at once.
+//
+// --sharpness instead checks the sharpness score (sharpness.h) against a plain scalar version of it, on the frames and
+// on random planes and frames of odd sizes and padded strides: the two must agree exactly. It then times both per
+// frame, R times over. Exits 1 on a difference.
+//
+// --pyramid does the same for the frame pyramid (image_pyramid.h): every level of every frame and of 200 random
+// frames of odd sizes and padded strides must match a plain scalar 2x2 box chain. It then times the fused build of
+// all three levels per frame against three consumers each making their own level, by chaining 2x2 filters or with
+// one direct box filter, and prints the storage the levels add to a frame. Exits 1 on a difference.
+#include "bmp_reader.h"
+#include "derived_planes.h"
+#include "image_pyramid.h"
+#include "sharpness.h"
+
+#include <algorithm>
+#include <barrier>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+// Per-stage state that carries over between frames (each stage always runs on the same worker)
+struct StageState
+{
+    std::vector<uint32_t> grid;  // motion: previous frame's 16x16 luma means
+    uint64_t result = 0;         // folded into the printed checksum so the work is not optimised away
+};
+
+constexpr int kStages = 6;
+
+void run_stage(int stage, DerivedFrame& f, StageState& st)
+{
+    const int w = f.bgra().width;
+    const int h = f.bgra().height;
+
+    switch (stage)
+    {
+    case 0:  // dedup: 8x8 average hash of luma
+    {
+        uint64_t cells[64];
+        uint64_t total = 0;
+        for (int i = 0; i < 64; ++i)
+            total += cells[i] = f.luma_sum(i % 8 * (w / 8), i / 8 * (h / 8), w / 8, h / 8);
+
+        uint64_t hash = 0;
+        for (int i = 0; i < 64; ++i)
+            hash |= uint64_t(cells[i] * 64 > total) << i;
+        st.result ^= hash;
+        break;
+    }
+    case 1:  // scene classifier: share of the darkest bins (loading and score screens)
+    {
+        const auto& hist = f.histogram();
+        uint64_t dark = 0;
+        for (int c = 0; c < 3; ++c)
+            dark += hist[c * DerivedFrame::kHistogramBins] + hist[c * DerivedFrame::kHistogramBins + 1];
+        st.result += dark * 100 / (3ull * w * h);
+        break;
+    }
+    case 2:  // motion energy: change of 16x16 luma means since the previous frame
+    {
+        std::vector<uint32_t> grid(256);
+        for (int i = 0; i < 256; ++i)
+            grid[i] = static_cast<uint32_t>(f.luma_sum(i % 16 * (w / 16), i / 16 * (h / 16), w / 16, h / 16) /
+                                            (uint64_t(w / 16) * (h / 16)));
+
+        if (st.grid.size() == grid.size())
+            for (int i = 0; i < 256; ++i)
+                st.result += static_cast<uint64_t>(std::abs(int(grid[i]) - int(st.grid[i])));
+        st.grid = std::move(grid);
+        break;
+    }
+    case 3:  // minimap: bottom-right corner
+    {
+        PlaneView map = f.crop(w * 4 / 5, h * 3 / 4, w / 5, h / 4);
+        st.result += f.luma_sum(w * 4 / 5, h * 3 / 4, map.width, map.height) / (uint64_t(map.width) * map.height + 1);
+        break;
+    }
+    case 4:  // health bars: red-dominant pixels in the top strip
+    {
+        PlaneView bar = f.crop(0, 0, w, h / 12);
+        for (int y = 0; y < bar.height; ++y)
+        {
+            const uint8_t* p = bar.data + y * bar.stride;
+            for (int x = 0; x < bar.width; ++x, p += 4)
+                st.result += p[2] > 160 && p[1] < 90;
+        }
+        break;
+    }
+    case 5:  // thumbnail: mean colour of the half-resolution frame and its luma
+    {
+        PlaneView half = f.half();
+        uint64_t sum = 0;
+        for (int y = 0; y < half.height; ++y)
+        {
+            const uint8_t* p = half.data + y * half.stride;
+            for (int x = 0; x < half.width * 4; ++x)
+                sum += p[x];
+        }
+        st.result += sum / (uint64_t(half.width) * half.height * 4 + 1) + f.luma().data[0];
+        break;
+    }
+    }
+}
+
+struct RunResult
+{
+    double msPerFrame = 0.0;
+    uint64_t checksum = 0;
+    PlanePool::Stats pool;
+};
+
+RunResult run(const std::vector<BmpImage>& frames, int workers, int repeat, bool shared)
+{
+    PlanePool pool;
+    std::vector<StageState> states(kStages);
+    std::vector<std::unique_ptr<DerivedFrame>> current(kStages);
+    size_t total = frames.size() * repeat;
+    size_t frame = 0;
+
+    // Completion step runs once per phase: drops the previous frame's planes and sets up the next one
+    auto next = [&]() noexcept
+    {
+        for (auto& c : current)
+            c.reset();
+
+        if (frame >= total)
+            return;
+
+        const BmpImage& img = frames[frame++ % frames.size()];
+        for (int s = 0; s < kStages; ++s)
+            if (shared && s > 0)
+                current[s] = nullptr;
+            else
+                current[s] = std::make_unique<DerivedFrame>(img.bgra.data(), img.width, img.height, img.width * 4ull,
+                                                            pool);
+    };
+
+    next();
+    std::barrier sync(workers, next);
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < workers; ++t)
+        threads.emplace_back(
+            [&, t]
+            {
+                for (size_t i = 0; i < total; ++i)
+                {
+                    for (int s = t; s < kStages; s += workers)
+                        run_stage(s, shared ? *current[0] : *current[s], states[s]);
+                    sync.arrive_and_wait();
+                }
+            });
+
+    for (auto& t : threads)
+        t.join();
+
+    RunResult r;
+    r.msPerFrame = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() /
+                   static_cast<double>(total);
+    for (const auto& s : states)
+        r.checksum ^= s.result;
+    r.pool = pool.stats();
+    return r;
+}
+
+// The sharpness score without SIMD, written out as sharpness.h describes it
+double scalar_laplacian_variance(const uint8_t* plane, int width, int height, size_t stride)
+{
+    if (width < 3 || height < 3)
+        return 0;
+
+    int64_t sum = 0, sumSq = 0;
+    for (int y = 1; y + 1 < height; ++y)
+        for (int x = 1; x + 1 < width; ++x)
+        {
+            const uint8_t* c = plane + y * stride + x;
+            int lap = 4 * c[0] - c[-1] - c[1] - c[-static_cast<ptrdiff_t>(stride)] - c[stride];
+            sum += lap;
+            sumSq += lap * lap;
+        }
+
+    double n = static_cast<double>(width - 2) * (height - 2);
+    double mean = static_cast<double>(sum) / n;
+    return std::max(0.0, static_cast<double>(sumSq) / n - mean * mean);
+}
+
+double scalar_frame_sharpness(const uint8_t* bgra, int width, int height, size_t stride)
+{
+    int x0 = static_cast<int>(width * kSharpnessRoiLeft);
+    int x1 = static_cast<int>(width * kSharpnessRoiRight);
+    int y0 = static_cast<int>(height * kSharpnessRoiTop);
+    int y1 = static_cast<int>(height * kSharpnessRoiBottom);
+    int hw = (x1 - x0) / 2;
+    int hh = (y1 - y0) / 2;
+
+    if (hw < 3 || hh < 3)
+        return 0;
+
+    std::vector<uint8_t> half(static_cast<size_t>(hw) * hh);
+    for (int y = 0; y < hh; ++y)
+        for (int x = 0; x < hw; ++x)
+        {
+            const uint8_t* a = bgra + static_cast<size_t>(y0 + 2 * y) * stride + static_cast<size_t>(x0 + 2 * x) * 4;
+            const uint8_t* b = a + stride;
+            int sb = a[0] + a[4] + b[0] + b[4];
+            int sg = a[1] + a[5] + b[1] + b[5];
+            int sr = a[2] + a[6] + b[2] + b[6];
+            half[static_cast<size_t>(y) * hw + x] = static_cast<uint8_t>((29 * sb + 150 * sg + 77 * sr + 512) >> 10);
+        }
+
+    return scalar_laplacian_variance(half.data(), hw, hh, hw);
+}
+
+int run_sharpness(const std::vector<BmpImage>& frames, int repeat)
+{
+    size_t checks = 0, failures = 0;
+    auto compare = [&](const char* what, int w, int h, double got, double want)
+    {
+        ++checks;
+        if (got != want && failures++ < 10)
+            printf("FAIL %s %dx%d: %.17g, scalar %.17g\n", what, w, h, got, want);
+    };
+
+    for (const auto& f : frames)
+        compare("frame", f.width, f.height, frame_sharpness(f.bgra.data(), f.width, f.height, f.width * 4ull),
+                scalar_frame_sharpness(f.bgra.data(), f.width, f.height, f.width * 4ull));
+
+    // Odd sizes cover every mix of SIMD blocks and scalar tails; extreme values the widest Laplacian responses
+    std::mt19937 rng(1);
+    for (int i = 0; i < 500; ++i)
+    {
+        int w = 1 + static_cast<int>(rng() % 300), h = 1 + static_cast<int>(rng() % 60);
+        size_t stride = w + rng() % 40;
+        std::vector<uint8_t> plane(stride * h);
+        for (auto& v : plane)
+            v = i % 5 == 0 ? (rng() & 1) * 255 : static_cast<uint8_t>(rng());
+        compare("plane", w, h, laplacian_variance(plane.data(), w, h, stride),
+                scalar_laplacian_variance(plane.data(), w, h, stride));
+
+        int fw = 8 + static_cast<int>(rng() % 400), fh = 8 + static_cast<int>(rng() % 200);
+        size_t fstride = fw * 4ull + (rng() % 8) * 4;
+        std::vector<uint8_t> bgra(fstride * fh);
+        for (auto& v : bgra)
+            v = static_cast<uint8_t>(rng());
+        compare("frame", fw, fh, frame_sharpness(bgra.data(), fw, fh, fstride),
+                scalar_frame_sharpness(bgra.data(), fw, fh, fstride));
+    }
+    printf("sharpness: %zu scores checked against scalar, %zu differ\n", checks, failures);
+
+    double sum = 0;
+    auto time = [&](auto score)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (int r = 0; r < repeat; ++r)
+            for (const auto& f : frames)
+                sum += score(f.bgra.data(), f.width, f.height, f.width * 4ull);
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() /
+               (static_cast<double>(repeat) * static_cast<double>(frames.size()));
+    };
+    double simd = time(frame_sharpness);
+    double scalar = time(scalar_frame_sharpness);
+    printf("frame_sharpness %.3f ms/frame, scalar %.3f ms/frame (%.1fx)  checksum=%.0f\n", simd, scalar,
+           scalar / simd, sum);
+
+    return failures ? 1 : 0;
+}
+
+// One pyramid level without SIMD, as image_pyramid.h describes it: the rounded 2x2 box average of the level above
+std::vector<uint8_t> scalar_box2x2(const uint8_t* bgra, int width, int height, size_t stride)
+{
+    int w = width / 2, h = height / 2;
+    std::vector<uint8_t> out(static_cast<size_t>(w) * h * 4);
+
+    for (int y = 0; y < h; ++y)
+        for (int x = 0; x < w; ++x)
+        {
+            const uint8_t* a = bgra + static_cast<size_t>(2 * y) * stride + static_cast<size_t>(x) * 8;
+            const uint8_t* b = a + stride;
+            for (int c = 0; c < 4; ++c)
+                out[(static_cast<size_t>(y) * w + x) * 4 + c] =
+                    static_cast<uint8_t>((a[c] + a[c + 4] + b[c] + b[c + 4] + 2) >> 2);
+        }
+
+    return out;
+}
+
+int run_pyramid(const std::vector<BmpImage>& frames, int repeat)
+{
+    ImagePyramid pyramid;
+    size_t checks = 0, failures = 0;
+    auto compare = [&](const uint8_t* bgra, int width, int height, size_t stride)
+    {
+        pyramid.build(bgra, width, height, stride, ImagePyramid::kMaxLevels);
+        const uint8_t* src = bgra;
+        int w = width, h = height;
+        std::vector<uint8_t> want;
+
+        for (int n = 1; n <= ImagePyramid::kMaxLevels && w >= 2 && h >= 2; ++n)
+        {
+            want = scalar_box2x2(src, w, h, n == 1 ? stride : w * 4ull);
+            src = want.data();
+            w /= 2;
+            h /= 2;
+
+            ++checks;
+            ImagePyramid::Level got = n <= pyramid.levels() ? pyramid.level(n) : ImagePyramid::Level{};
+            if ((got.width != w || got.height != h || memcmp(got.bgra, want.data(), want.size()) != 0) &&
+                failures++ < 10)
+                printf("FAIL %dx%d level %d: %dx%d, scalar %dx%d%s\n", width, height, n, got.width, got.height, w, h,
+                       got.width == w && got.height == h ? ", pixels differ" : "");
+        }
+    };
+
+    for (const auto& f : frames)
+        compare(f.bgra.data(), f.width, f.height, f.width * 4ull);
+
+    // Odd sizes cover every mix of SIMD blocks and scalar tails at each level, and frames too small for three levels
+    std::mt19937 rng(1);
+    for (int i = 0; i < 200; ++i)
+    {
+        int w = 1 + static_cast<int>(rng() % 400), h = 1 + static_cast<int>(rng() % 120);
+        size_t stride = w * 4ull + (rng() % 8) * 4;
+        std::vector<uint8_t> bgra(stride * h);
+        for (auto& v : bgra)
+            v = i % 5 == 0 ? (rng() & 1) * 255 : static_cast<uint8_t>(rng());
+        compare(bgra.data(), w, h, stride);
+    }
+    printf("pyramid: %zu levels checked against scalar, %zu differ\n", checks, failures);
+
+    // Consumers without the pyramid, one per level: each chains 2x2 filters from the frame, or box-filters it
+    // directly at its own scale
+    std::vector<uint8_t> a, b;
+    auto chained = [&](const BmpImage& f)
+    {
+        for (int target = 1; target <= ImagePyramid::kMaxLevels; ++target)
+        {
+            const uint8_t* src = f.bgra.data();
+            int w = f.width, h = f.height;
+            for (int n = 0; n < target; ++n)
+            {
+                auto& dst = n % 2 ? b : a;
+                dst.resize(static_cast<size_t>(w / 2) * (h / 2) * 4);
+                for (int y = 0; y < h / 2; ++y)
+                    box2x2_row(src + static_cast<size_t>(2 * y) * w * 4, src + static_cast<size_t>(2 * y + 1) * w * 4,
+                               dst.data() + static_cast<size_t>(y) * (w / 2) * 4, w / 2);
+                src = dst.data();
+                w /= 2;
+                h /= 2;
+            }
+        }
+    };
+    auto direct = [&](const BmpImage& f)
+    {
+        for (int target = 1; target <= ImagePyramid::kMaxLevels; ++target)
+        {
+            int k = 1 << target, w = f.width / k, h = f.height / k;
+            a.resize(static_cast<size_t>(w) * h * 4);
+            for (int y = 0; y < h; ++y)
+                for (int x = 0; x < w; ++x)
+                    for (int c = 0; c < 4; ++c)
+                    {
+                        unsigned sum = 0;
+                        for (int yy = 0; yy < k; ++yy)
+                            for (int xx = 0; xx < k; ++xx)
+                                sum += f.bgra[(static_cast<size_t>(y * k + yy) * f.width + x * k + xx) * 4 + c];
+                        a[(static_cast<size_t>(y) * w + x) * 4 + c] = static_cast<uint8_t>((sum + k * k / 2) / (k * k));
+                    }
+        }
+    };
+
+    uint64_t sum = 0;
+    auto time = [&](auto build)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (int r = 0; r < repeat; ++r)
+            for (const auto& f : frames)
+            {
+                build(f);
+                sum += a.empty() ? 0 : a[0];
+            }
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() /
+               (static_cast<double>(repeat) * static_cast<double>(frames.size()));
+    };
+    double fused = time([&](const BmpImage& f)
+                        { pyramid.build(f.bgra.data(), f.width, f.height, f.width * 4ull, ImagePyramid::kMaxLevels); });
+    double chain = time(chained);
+    double box = time(direct);
+    printf("fused pyramid %.3f ms/frame, 3 consumers chaining 2x2 %.3f ms/frame (%.1fx), direct box %.3f ms/frame "
+           "(%.1fx)  checksum=%llu\n",
+           fused, chain, chain / fused, box, box / fused, static_cast<unsigned long long>(sum));
+
+    const BmpImage& f = frames.front();
+    pyramid.build(f.bgra.data(), f.width, f.height, f.width * 4ull, ImagePyramid::kMaxLevels);
+    printf("levels add %zu bytes to a %dx%d frame (%.1f%%)\n", pyramid.bytes(), f.width, f.height,
+           100.0 * static_cast<double>(pyramid.bytes()) / static_cast<double>(f.width * 4ull * f.height));
+
+    return failures ? 1 : 0;
+}
+
+int usage()
+{
+    fprintf(stderr, "usage: hots_planes [--workers N] [--repeat R] [--sharpness | --pyramid] <dir|file.bmp>...\n");
+    return 2;
+}
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    int workers = 3;
+    int repeat = 1;
+    bool sharpness = false, pyramid = false;
+    std::vector<fs::path> files;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string a = argv[i];
+
+        if ((a == "--workers" || a == "--repeat") && i + 1 < argc)
+            (a == "--workers" ? workers : repeat) = std::atoi(argv[++i]);
+        else if (a == "--sharpness")
+            sharpness = true;
+        else if (a == "--pyramid")
+            pyramid = true;
+        else if (a.rfind("--", 0) == 0)
+            return usage();
+        else if (fs::is_directory(a))
+        {
+            for (const auto& e : fs::directory_iterator(a))
+                if (e.is_regular_file() && e.path().extension() == ".bmp")
+                    files.push_back(e.path());
+        }
+        else
+            files.push_back(a);
+    }
+
+    if (files.empty() || workers < 1 || workers > kStages || repeat < 1 || (sharpness && pyramid))
+        return usage();
+
+    std::sort(files.begin(), files.end());
+    std::vector<BmpImage> frames;
+
+    for (const auto& p : files)
+    {
+        BmpImage img;
+        if (load_bmp(p, img) && img.width >= 16 && img.height >= 16)
+            frames.push_back(std::move(img));
+        else
+            fprintf(stderr, "skipping %s: not a readable 24/32-bit BMP of at least 16x16\n", p.string().c_str());
+    }
+
+    if (frames.empty())
+        return 1;
+    if (sharpness)
+        return run_sharpness(frames, repeat);
+    if (pyramid)
+        return run_pyramid(frames, repeat);
+
+    printf("%zu frames x %d, %d stages on %d workers\n", frames.size(), repeat, kStages, workers);
+
+    for (bool shared : {true, false})
+    {
+        RunResult r = run(frames, workers, repeat, shared);
+        printf("%-9s %.3f ms/frame  hits=%llu misses=%llu  buffers allocated=%llu reused=%llu  checksum=%016llx\n",
+               shared ? "shared" : "per-stage", r.msPerFrame, (unsigned long long)r.pool.hits,
+               (unsigned long long)r.pool.misses, (unsigned long long)r.pool.allocations,
+               (unsigned long long)r.pool.reuses, (unsigned long long)r.checksum);
+    }
+
+    return 0;
+}
@@ -0,0 +1,85 @@
+// hots_replayinfo: prints the header capture reads from a .StormReplay (build, game loops, duration), one line per
+// replay, with the time the header took to read.
+//
+//   hots_replayinfo [--json] <dir|file>...
+//
+// Exits 1 if any file is not a readable replay header.
+#include "storm_replay.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+static int usage()
+{
+    fprintf(stderr, "usage: hots_replayinfo [--json] <dir|file>...\n");
+    return 2;
+}
+
+int main(int argc, char** argv)
+{
+    bool json = false;
+    std::vector<fs::path> files;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string a = argv[i];
+
+        if (a == "--json")
+            json = true;
+        else if (a.rfind("--", 0) == 0)
+            return usage();
+        else if (fs::is_directory(a))
+        {
+            for (const auto& e : fs::directory_iterator(a))
+                if (e.is_regular_file() && e.path().extension() == ".StormReplay")
+                    files.push_back(e.path());
+        }
+        else
+            files.push_back(a);
+    }
+
+    if (files.empty())
+        return usage();
+
+    std::sort(files.begin(), files.end());
+    int rc = 0;
+
+    for (const auto& p : files)
+    {
+        StormReplayHeader h;
+        auto start = std::chrono::steady_clock::now();
+        bool ok = read_storm_replay_header(p, h);
+        double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        std::string name = p.filename().string();
+
+        if (!ok)
+        {
+            rc = 1;
+            if (json)
+                printf("{\"file\":\"%s\",\"ok\":false}\n", name.c_str());
+            else
+                printf("%s: not a replay header\n", name.c_str());
+            continue;
+        }
+
+        long long ms = static_cast<long long>(h.duration().count());
+
+        if (json)
+            printf("{\"file\":\"%s\",\"ok\":true,\"version\":\"%u.%u.%u\",\"build\":%u,\"base_build\":%u,"
+                   "\"data_build\":%u,\"game_loops\":%llu,\"duration_ms\":%lld,\"read_us\":%.1f}\n",
+                   name.c_str(), h.major, h.minor, h.revision, h.build, h.baseBuild, h.dataBuild,
+                   (unsigned long long)h.elapsedGameLoops, ms, us);
+        else
+            printf("%s: %u.%u.%u.%u base=%u loops=%llu duration=%lld:%02lld read_us=%.1f\n", name.c_str(), h.major,
+                   h.minor, h.revision, h.build, h.baseBuild, (unsigned long long)h.elapsedGameLoops, ms / 60000,
+                   ms / 1000 % 60, us);
+    }
+
+    return rc;
+}
@@ -0,0 +1,221 @@
+#include "sharpness.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HOTS_SHARPNESS_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+// One row of half-resolution BT.601 luma from two BGRA rows: each output is the luma of a 2x2 box average
+void half_luma_row(const uint8_t* r0, const uint8_t* r1, uint8_t* out, int width)
+{
+    int x = 0;
+
+#ifdef HOTS_SHARPNESS_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i weights = _mm_setr_epi16(29, 150, 77, 0, 29, 150, 77, 0);
+    const __m128i round = _mm_set1_epi32(512);
+
+    for (; x + 4 <= width; x += 4)
+    {
+        const uint8_t* a = r0 + static_cast<size_t>(x) * 8;
+        const uint8_t* b = r1 + static_cast<size_t>(x) * 8;
+        __m128i a0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a));
+        __m128i a1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + 16));
+        __m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b));
+        __m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + 16));
+
+        // 2x2 channel sums as in box2x2_row, left unscaled
+        __m128i v0 = _mm_add_epi16(_mm_unpacklo_epi8(a0, zero), _mm_unpacklo_epi8(b0, zero));
+        __m128i v1 = _mm_add_epi16(_mm_unpackhi_epi8(a0, zero), _mm_unpackhi_epi8(b0, zero));
+        __m128i v2 = _mm_add_epi16(_mm_unpacklo_epi8(a1, zero), _mm_unpacklo_epi8(b1, zero));
+        __m128i v3 = _mm_add_epi16(_mm_unpackhi_epi8(a1, zero), _mm_unpackhi_epi8(b1, zero));
+        __m128i h01 = _mm_add_epi16(_mm_unpacklo_epi64(v0, v1), _mm_unpackhi_epi64(v0, v1));
+        __m128i h23 = _mm_add_epi16(_mm_unpacklo_epi64(v2, v3), _mm_unpackhi_epi64(v2, v3));
+
+        // [29B + 150G, 77R] per output, then the two halves of each added together
+        __m128 m01 = _mm_castsi128_ps(_mm_madd_epi16(h01, weights));
+        __m128 m23 = _mm_castsi128_ps(_mm_madd_epi16(h23, weights));
+        __m128i y = _mm_add_epi32(_mm_castps_si128(_mm_shuffle_ps(m01, m23, _MM_SHUFFLE(2, 0, 2, 0))),
+                                  _mm_castps_si128(_mm_shuffle_ps(m01, m23, _MM_SHUFFLE(3, 1, 3, 1))));
+
+        // Four pixels times weights summing to 256
+        y = _mm_srli_epi32(_mm_add_epi32(y, round), 10);
+        y = _mm_packs_epi32(y, y);
+        int packed = _mm_cvtsi128_si32(_mm_packus_epi16(y, y));
+        memcpy(out + x, &packed, 4);
+    }
+#endif
+
+    for (; x < width; ++x)
+    {
+        const uint8_t* a = r0 + static_cast<size_t>(x) * 8;
+        const uint8_t* b = r1 + static_cast<size_t>(x) * 8;
+        int sb = a[0] + a[4] + b[0] + b[4];
+        int sg = a[1] + a[5] + b[1] + b[5];
+        int sr = a[2] + a[6] + b[2] + b[6];
+        out[x] = static_cast<uint8_t>((29 * sb + 150 * sg + 77 * sr + 512) >> 10);
+    }
+}
+}  // namespace
+
+double laplacian_variance(const uint8_t* plane, int width, int height, size_t stride)
+{
+    if (width < 3 || height < 3)
+        return 0;
+
+    int64_t sum = 0;
+    int64_t sumSq = 0;
+
+    for (int y = 1; y + 1 < height; ++y)
+    {
+        const uint8_t* up = plane + (y - 1) * stride;
+        const uint8_t* row = plane + y * stride;
+        const uint8_t* down = plane + (y + 1) * stride;
+        int x = 1;
+
+#ifdef HOTS_SHARPNESS_SSE2
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i ones = _mm_set1_epi16(1);
+
+        // Responses fit in 16 bits (|lap| <= 1020); madd pairs them into 32-bit lanes, which are drained to 64 bits
+        // every 256 steps, before 256 * 2 * 1020^2 could overflow
+        while (x + 8 + 1 <= width)
+        {
+            __m128i accSum = _mm_setzero_si128();
+            __m128i accSq = _mm_setzero_si128();
+
+            for (int steps = 0; steps < 256 && x + 8 + 1 <= width; ++steps, x += 8)
+            {
+                auto load = [&](const uint8_t* p)
+                { return _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)), zero); };
+
+                __m128i c = load(row + x);
+                __m128i around = _mm_add_epi16(_mm_add_epi16(load(row + x - 1), load(row + x + 1)),
+                                               _mm_add_epi16(load(up + x), load(down + x)));
+                __m128i lap = _mm_sub_epi16(_mm_slli_epi16(c, 2), around);
+                accSum = _mm_add_epi32(accSum, _mm_madd_epi16(lap, ones));
+                accSq = _mm_add_epi32(accSq, _mm_madd_epi16(lap, lap));
+            }
+
+            alignas(16) int32_t s[4];
+            alignas(16) uint32_t q[4];
+            _mm_store_si128(reinterpret_cast<__m128i*>(s), accSum);
+            _mm_store_si128(reinterpret_cast<__m128i*>(q), accSq);
+            sum += static_cast<int64_t>(s[0]) + s[1] + s[2] + s[3];
+            sumSq += static_cast<int64_t>(q[0]) + q[1] + q[2] + q[3];
+        }
+#endif
+
+        for (; x + 1 < width; ++x)
+        {
+            int lap = 4 * row[x] - row[x - 1] - row[x + 1] - up[x] - down[x];
+            sum += lap;
+            sumSq += lap * lap;
+        }
+    }
+
+    double n = static_cast<double>(width - 2) * (height - 2);
+    double mean = static_cast<double>(sum) / n;
+    return std::max(0.0, static_cast<double>(sumSq) / n - mean * mean);
+}
+
+double frame_sharpness(const uint8_t* bgra, int width, int height, size_t stride)
+{
+    int x0 = static_cast<int>(width * kSharpnessRoiLeft);
+    int x1 = static_cast<int>(width * kSharpnessRoiRight);
+    int y0 = static_cast<int>(height * kSharpnessRoiTop);
+    int y1 = static_cast<int>(height * kSharpnessRoiBottom);
+    int hw = (x1 - x0) / 2;
+    int hh = (y1 - y0) / 2;
+
+    if (hw < 3 || hh < 3)
+        return 0;
+
+    thread_local std::vector<uint8_t> half;
+    half.resize(static_cast<size_t>(hw) * hh);
+
+    for (int y = 0; y < hh; ++y)
+    {
+        const uint8_t* r0 = bgra + static_cast<size_t>(y0 + 2 * y) * stride + static_cast<size_t>(x0) * 4;
+        half_luma_row(r0, r0 + stride, half.data() + static_cast<size_t>(y) * hw, hw);
+    }
+
+    return laplacian_variance(half.data(), hw, hh, hw);
+}
+
+SharpnessGate::Config SharpnessGate::Config::from_env()
+{
+    Config c;
+
+    if (const char* v = std::getenv("CAPTURE_SHARPNESS_MIN"))
+        c.minSharpness = std::max(0.0, std::atof(v));
+    if (const char* v = std::getenv("CAPTURE_SHARPNESS_WINDOW_MS"))
+        c.window = std::chrono::milliseconds(std::clamp(std::atoi(v), 0, 5000));
+
+    return c;
+}
+
+SharpnessGate::Verdict SharpnessGate::offer(double sharpness, Clock::time_point now)
+{
+    if (cfg_.minSharpness <= 0 || sharpness >= cfg_.minSharpness)
+    {
+        close(now);
+        return Verdict::Emit;
+    }
+
+    if (!open_)
+    {
+        open_ = true;
+        opened_ = now;
+        held_ = -1;
+        offered_ = 0;
+    }
+
+    ++offered_;
+    bool sharper = sharpness > held_;
+
+    if (now - opened_ >= cfg_.window)
+    {
+        --offered_;  // one of the window's frames is emitted after all
+        close(now);
+        return sharper ? Verdict::Emit : Verdict::EmitHeld;
+    }
+
+    if (!sharper)
+        return Verdict::Drop;
+
+    held_ = sharpness;
+    return Verdict::Hold;
+}
+
+bool SharpnessGate::expire(Clock::time_point now)
+{
+    if (!open_ || now < deadline())
+        return false;
+
+    --offered_;  // the held frame is emitted after all
+    close(now);
+    return true;
+}
+
+SharpnessGate::Clock::time_point SharpnessGate::deadline() const
+{
+    return open_ ? opened_ + cfg_.window : Clock::time_point::max();
+}
+
+void SharpnessGate::close(Clock::time_point now)
+{
+    // Frames offered since the window opened, other than the one emitted
+    passed_ = open_ ? offered_ : 0;
+    waited_ = std::chrono::milliseconds(0);
+    if (open_)
+        waited_ = std::chrono::duration_cast<std::chrono::milliseconds>(now - opened_);
+    open_ = false;
+}
@@ -0,0 +1,77 @@
+// Per-frame sharpness score, and a gate that holds back frames taken mid camera pan until a sharp one turns up.
+//
+// The score is the variance of the 3x3 Laplacian (4-neighbour) over the luma of the frame's central region at half
+// resolution. Motion blur flattens edges, so a frame smeared by a camera drag scores a fraction of what the same scene
+// scores at rest. The region leaves out the top bar and the bottom HUD (portrait, ability bar, minimap), which stay
+// sharp while the playfield blurs. Downsampling first keeps the cost near one pass over a quarter of the ROI and makes
+// the score less sensitive to single-pixel noise and UI text. Scores depend on content, so thresholds are tuned by
+// looking at the scores logged for a session rather than derived.
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+// Region scored by frame_sharpness, as fractions of the frame.
+inline constexpr double kSharpnessRoiLeft = 0.10;
+inline constexpr double kSharpnessRoiRight = 0.90;
+inline constexpr double kSharpnessRoiTop = 0.15;
+inline constexpr double kSharpnessRoiBottom = 0.75;
+
+// Variance of 4*c - l - r - u - d over the interior of an 8-bit plane (SSE2 where available); 0 if smaller than 3x3.
+double laplacian_variance(const uint8_t* plane, int width, int height, size_t stride);
+
+// Laplacian variance of the 2x2-downsampled luma of the ROI above. Uses a thread-local scratch plane.
+double frame_sharpness(const uint8_t* bgra, int width, int height, size_t stride);
+
+// Decides, frame by frame, whether to emit now or wait for a sharper one. A frame scoring at least minSharpness is
+// emitted at once. A blurred one opens a window of `window`; until it runs out the sharpest blurred frame is held and
+// further frames are requested, and the first sharp frame ends the wait. When the window runs out the sharpest frame
+// seen in it is emitted, so a long pan delays a frame by at most `window` and never drops it. Not thread-safe.
+class SharpnessGate
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Config
+    {
+        double minSharpness = 0;                // 0 disables deferral; CAPTURE_SHARPNESS_MIN
+        std::chrono::milliseconds window{400};  // CAPTURE_SHARPNESS_WINDOW_MS
+
+        static Config from_env();
+    };
+
+    enum class Verdict
+    {
+        Emit,      // emit this frame
+        EmitHeld,  // the window ran out and the held frame is sharper: emit that one, drop this
+        Hold,      // keep this frame as the best so far (replacing any held one) and wait for another
+        Drop,      // drop this frame and wait for another
+    };
+
+    explicit SharpnessGate(Config cfg) : cfg_(cfg) {}
+
+    Verdict offer(double sharpness, Clock::time_point now);
+
+    // True, closing the window, if one is open and has run out; the caller then emits the held frame.
+    bool expire(Clock::time_point now);
+    // When the open window runs out (time_point::max() if none is open).
+    Clock::time_point deadline() const;
+
+    // For the frame just emitted: frames passed over before it, and how long its window had been open.
+    uint32_t passed() const { return passed_; }
+    std::chrono::milliseconds waited() const { return waited_; }
+
+    const Config& config() const { return cfg_; }
+
+private:
+    void close(Clock::time_point now);
+
+    Config cfg_;
+    bool open_ = false;
+    Clock::time_point opened_{};
+    double held_ = 0;
+    uint32_t offered_ = 0;  // frames offered since the window opened
+    uint32_t passed_ = 0;
+    std::chrono::milliseconds waited_{0};
+};
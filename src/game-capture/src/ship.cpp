@@ -0,0 +1,673 @@
+#include "ship.h"
+
+#include "checksum.h"
+#include "log.h"
+#include "lz.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace ship
+{
+void Writer::u32(uint32_t v)
+{
+    for (int i = 0; i < 4; ++i)
+        buf_.push_back(static_cast<uint8_t>(v >> (8 * i)));
+}
+
+void Writer::u64(uint64_t v)
+{
+    for (int i = 0; i < 8; ++i)
+        buf_.push_back(static_cast<uint8_t>(v >> (8 * i)));
+}
+
+void Writer::str(std::string_view s)
+{
+    size_t n = std::min<size_t>(s.size(), 0xFFFF);
+    buf_.push_back(static_cast<uint8_t>(n & 0xFF));
+    buf_.push_back(static_cast<uint8_t>(n >> 8));
+    bytes(s.data(), n);
+}
+
+void Writer::bytes(const void* p, size_t n)
+{
+    auto* b = static_cast<const uint8_t*>(p);
+    buf_.insert(buf_.end(), b, b + n);
+}
+
+const uint8_t* Reader::bytes(size_t n)
+{
+    if (!ok_ || n > n_ - pos_)
+    {
+        ok_ = false;
+        return nullptr;
+    }
+
+    const uint8_t* p = p_ + pos_;
+    pos_ += n;
+    return p;
+}
+
+uint8_t Reader::u8()
+{
+    const uint8_t* p = bytes(1);
+    return p ? p[0] : 0;
+}
+
+uint32_t Reader::u32()
+{
+    const uint8_t* p = bytes(4);
+    uint32_t v = 0;
+    for (int i = 0; p && i < 4; ++i)
+        v |= uint32_t(p[i]) << (8 * i);
+    return v;
+}
+
+uint64_t Reader::u64()
+{
+    const uint8_t* p = bytes(8);
+    uint64_t v = 0;
+    for (int i = 0; p && i < 8; ++i)
+        v |= uint64_t(p[i]) << (8 * i);
+    return v;
+}
+
+std::string Reader::str()
+{
+    const uint8_t* len = bytes(2);
+    size_t n = len ? len[0] | (size_t(len[1]) << 8) : 0;
+    const uint8_t* p = bytes(n);
+    return p ? std::string(reinterpret_cast<const char*>(p), n) : std::string();
+}
+
+void frame(std::vector<uint8_t>& out, Msg type, const std::vector<uint8_t>& payload)
+{
+    auto n = static_cast<uint32_t>(payload.size());
+    for (int i = 0; i < 4; ++i)
+        out.push_back(static_cast<uint8_t>(n >> (8 * i)));
+    out.push_back(static_cast<uint8_t>(type));
+    out.insert(out.end(), payload.begin(), payload.end());
+}
+
+bool send(Socket& s, Msg type, const std::vector<uint8_t>& payload)
+{
+    std::vector<uint8_t> out;
+    out.reserve(payload.size() + 5);
+    frame(out, type, payload);
+    return s.send_all(out.data(), out.size());
+}
+
+bool recv(Socket& s, Msg& type, std::vector<uint8_t>& payload)
+{
+    uint8_t header[5];
+
+    if (!s.recv_all(header, sizeof(header)))
+        return false;
+
+    uint32_t n = header[0] | uint32_t(header[1]) << 8 | uint32_t(header[2]) << 16 | uint32_t(header[3]) << 24;
+
+    if (n > kMaxMessage)
+        return false;
+
+    type = static_cast<Msg>(header[4]);
+    payload.resize(n);
+    return n == 0 || s.recv_all(payload.data(), n);
+}
+
+bool valid_name(std::string_view s, size_t maxLen)
+{
+    if (s.empty() || s.size() > maxLen || s[0] == '.')
+        return false;
+
+    return std::all_of(s.begin(), s.end(),
+                       [](char c)
+                       {
+                           return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+                                  c == '.' || c == '_' || c == '-';
+                       });
+}
+}  // namespace ship
+
+namespace
+{
+template <Ev E, typename... A>
+void ship_log(bool on, const A&... args)
+{
+    if (on)
+        log_event<E>(args...);
+}
+
+std::string host_name()
+{
+    char buf[256] = {};
+#ifdef _WIN32
+    DWORD n = sizeof(buf);
+    if (!GetComputerNameA(buf, &n))
+        return "node";
+#else
+    if (gethostname(buf, sizeof(buf) - 1) != 0)
+        return "node";
+#endif
+    std::string name = buf;
+
+    for (char& c : name)
+        if (!ship::valid_name(std::string_view(&c, 1), 1))
+            c = '-';
+
+    return name.empty() || name[0] == '-' ? "node" + name : name;
+}
+
+// Frames are written once, so the modification time is the capture time
+int64_t capture_unix_ms(const std::filesystem::path& p)
+{
+    std::error_code ec;
+    auto t = std::filesystem::last_write_time(p, ec);
+
+    if (ec)
+        return 0;
+
+    auto sys = std::chrono::file_clock::to_sys(t);
+    return std::chrono::duration_cast<std::chrono::milliseconds>(sys.time_since_epoch()).count();
+}
+
+constexpr int kConnectTimeoutMs = 5000;
+constexpr int kIoTimeoutMs = 15000;
+constexpr auto kAckStall = std::chrono::seconds(30);
+constexpr auto kMaxBackoff = std::chrono::seconds(30);
+}  // namespace
+
+ShipConfig ShipConfig::from_env()
+{
+    ShipConfig c;
+
+    if (const char* v = std::getenv("CAPTURE_SHIP_TO"))
+        c.endpoint = v;
+    if (const char* v = std::getenv("CAPTURE_SHIP_NODE"); v && ship::valid_name(v, 64))
+        c.node = v;
+    if (const char* v = std::getenv("CAPTURE_SHIP_MAX_BPS"))
+        c.maxBytesPerSec = std::max(0.0, std::atof(v));
+    if (const char* v = std::getenv("CAPTURE_SHIP_COMPRESS"))
+        c.compress = std::atoi(v) != 0;
+    if (const char* v = std::getenv("CAPTURE_SHIP_BATCH_BYTES"))
+        c.batchBytes = std::clamp<size_t>(std::strtoull(v, nullptr, 10), 4096, 16 << 20);
+
+    if (c.node.empty())
+        c.node = host_name().substr(0, 64);
+
+    return c;
+}
+
+Shipper::Shipper(ShipConfig cfg, uint64_t epoch)
+    : cfg_(std::move(cfg)),
+      epoch_(epoch),
+      bucket_(cfg_.maxBytesPerSec, std::max<double>(static_cast<double>(cfg_.batchBytes), cfg_.maxBytesPerSec / 4))
+{
+    parse_endpoint(cfg_.endpoint, host_, port_);
+}
+
+Shipper::~Shipper()
+{
+    stop();
+}
+
+void Shipper::start()
+{
+    if (!thread_.joinable())
+        thread_ = std::thread([this] { run(); });
+}
+
+void Shipper::stop()
+{
+    stop_ = true;
+    {
+        std::lock_guard<std::mutex> lock(m_);
+        if (active_)
+            active_->shutdown_both();
+    }
+    cv_.notify_all();
+
+    if (thread_.joinable())
+        thread_.join();
+}
+
+void Shipper::enqueue(uint64_t seq, std::filesystem::path path)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_);
+
+        if (queue_.size() >= cfg_.maxQueue)
+        {
+            ship_log<Ev::ShipQueueOverflow>(cfg_.log, queue_.front().seq);
+            queue_.pop_front();
+            ++counters_.dropped;
+        }
+
+        queue_.push_back(Item{seq, std::move(path)});
+    }
+    cv_.notify_all();
+}
+
+bool Shipper::idle() const
+{
+    std::lock_guard<std::mutex> lock(m_);
+    return queue_.empty() && inflight_.empty();
+}
+
+std::optional<std::filesystem::path> Shipper::oldest_pending() const
+{
+    std::lock_guard<std::mutex> lock(m_);
+    const Item* oldest = nullptr;
+    for (const auto* q : {&queue_, &inflight_})
+        for (const auto& it : *q)
+            if (!oldest || it.seq < oldest->seq)
+                oldest = &it;
+    if (!oldest)
+        return std::nullopt;
+    return oldest->path;
+}
+
+Shipper::Counters Shipper::counters() const
+{
+    std::lock_guard<std::mutex> lock(m_);
+    Counters c = counters_;
+    c.backlog = queue_.size() + inflight_.size();
+    return c;
+}
+
+uint64_t Shipper::unacked() const
+{
+    std::lock_guard<std::mutex> lock(m_);
+    uint64_t n = 0;
+    for (const auto& it : inflight_)
+        n += it.sent - it.acked;
+    return n;
+}
+
+void Shipper::run()
+{
+    auto backoff = std::chrono::seconds(1);
+    std::string lastError;
+
+    while (!stopping())
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_);
+            cv_.wait(lock, [&] { return stopping() || !queue_.empty(); });
+        }
+
+        if (stopping())
+            break;
+
+        std::string error;
+        Socket s = port_ ? Socket::connect_to(host_, port_, kConnectTimeoutMs, error) : Socket();
+
+        if (s.valid())
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_);
+                active_ = &s;
+            }
+
+            bool handshook = false;
+            session(s, handshook);
+
+            size_t inflight;
+            {
+                std::lock_guard<std::mutex> lock(m_);
+                active_ = nullptr;
+                inflight = inflight_.size();
+            }
+
+            requeue_inflight();
+
+            if (stopping())
+                break;
+
+            ship_log<Ev::ShipDisconnected>(cfg_.log, cfg_.endpoint, handshook ? "connection_lost" : "handshake_failed",
+                                           inflight);
+            lastError.clear();
+
+            if (handshook)
+            {
+                backoff = std::chrono::seconds(1);
+                std::lock_guard<std::mutex> lock(m_);
+                ++counters_.reconnects;
+            }
+        }
+        else
+        {
+            if (port_ == 0)
+                error = "bad_endpoint";
+
+            // One event per distinct failure rather than one per retry
+            if (error != lastError)
+                ship_log<Ev::ShipDisconnected>(cfg_.log, cfg_.endpoint, error, 0);
+            lastError = error;
+        }
+
+        std::unique_lock<std::mutex> lock(m_);
+        cv_.wait_for(lock, backoff, [&] { return stopping(); });
+        backoff = std::min<std::chrono::seconds>(backoff * 2, kMaxBackoff);
+    }
+}
+
+void Shipper::session(Socket& s, bool& handshook)
+{
+    s.set_timeouts(kIoTimeoutMs);
+    s.set_nodelay();
+    batch_.clear();
+
+    ship::Writer hello;
+    hello.u32(ship::kVersion);
+    hello.str(cfg_.node);
+    hello.u64(epoch_);
+
+    Msg type;
+    std::vector<uint8_t> payload;
+
+    if (!ship::send(s, Msg::Hello, hello.data()) || !ship::recv(s, type, payload) || type != Msg::Resume)
+        return;
+
+    ship::Reader r(payload.data(), payload.size());
+    bool hasComplete = r.u8() != 0;
+    uint64_t lastComplete = r.u64();
+    bool hasPartial = r.u8() != 0;
+    uint64_t partialSeq = r.u64();
+    uint64_t partialOffset = r.u64();
+
+    if (!r.ok())
+        return;
+
+    handshook = true;
+    uint64_t nextSeq = 0;
+    uint64_t offset = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_);
+
+        // Files the aggregator already holds were acknowledged before the connection dropped
+        while (hasComplete && !queue_.empty() && queue_.front().seq <= lastComplete)
+            queue_.pop_front();
+
+        for (auto& it : queue_)
+            if (hasPartial && it.seq == partialSeq)
+                it.start = partialOffset;
+
+        if (!queue_.empty())
+        {
+            nextSeq = queue_.front().seq;
+            offset = queue_.front().start;
+        }
+    }
+    ship_log<Ev::ShipConnected>(cfg_.log, cfg_.endpoint, cfg_.node, epoch_, nextSeq, offset);
+
+    while (!stopping())
+    {
+        Item* item = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(m_);
+
+            if (!queue_.empty())
+            {
+                inflight_.push_back(std::move(queue_.front()));
+                queue_.pop_front();
+                item = &inflight_.back();  // deque::push_back keeps references valid
+            }
+        }
+
+        if (item)
+        {
+            if (!send_file(s, *item))
+                return;
+            continue;
+        }
+
+        // Queue empty: push out what is batched and wait for acks or new work
+        if (!flush_batch(s) || !drain_acks(s, false))
+            return;
+
+        bool waitingForAcks;
+        {
+            std::unique_lock<std::mutex> lock(m_);
+            waitingForAcks = !inflight_.empty();
+
+            if (!waitingForAcks)
+                cv_.wait_for(lock, std::chrono::milliseconds(200), [&] { return stopping() || !queue_.empty(); });
+        }
+
+        if (waitingForAcks && !drain_acks(s, true))
+            return;
+    }
+}
+
+bool Shipper::send_file(Socket& s, Item& item)
+{
+    auto drop = [&](const char* reason)
+    {
+        ship_log<Ev::ShipSkipped>(cfg_.log, item.seq, reason);
+        std::lock_guard<std::mutex> lock(m_);
+        ++counters_.dropped;
+        inflight_.erase(std::find_if(inflight_.begin(), inflight_.end(),
+                                     [&](const Item& it) { return &it == &item; }));
+    };
+
+    std::error_code ec;
+    uint64_t size = std::filesystem::file_size(item.path, ec);
+    std::string name = item.path.filename().string();
+
+    if (ec || !ship::valid_name(name, 128))
+    {
+        drop(ec ? "missing" : "bad_name");
+        return true;
+    }
+
+#ifdef _WIN32
+    FILE* f = _wfopen(item.path.wstring().c_str(), L"rb");
+#else
+    FILE* f = fopen(item.path.c_str(), "rb");
+#endif
+
+    if (!f)
+    {
+        drop("unreadable");
+        return true;
+    }
+
+    item.size = size;
+    item.start = item.start <= size ? item.start : 0;
+
+    std::vector<uint8_t> raw(ship::kChunkBytes);
+    std::vector<uint8_t> packed;
+    uint32_t crc = 0;
+
+    // The END crc covers the whole file, so a resumed transfer hashes the prefix the aggregator already has
+    for (uint64_t done = 0; done < item.start;)
+    {
+        size_t want = static_cast<size_t>(std::min<uint64_t>(raw.size(), item.start - done));
+        size_t got = fread(raw.data(), 1, want, f);
+
+        if (got != want)
+        {
+            item.start = 0;
+            break;
+        }
+
+        crc = crc32_update(crc, raw.data(), got);
+        done += got;
+    }
+
+    if (item.start == 0)
+    {
+        crc = 0;
+        fseek(f, 0, SEEK_SET);
+    }
+
+    item.sent = item.acked = item.start;
+
+    ship::Writer header;
+    header.u64(item.seq);
+    header.u64(size);
+    header.u64(item.start);
+    header.str(name);
+    header.u64(static_cast<uint64_t>(capture_unix_ms(item.path)));
+
+    bool ok = push(s, Msg::File, header.data(), false);
+
+    while (ok && item.sent < size && !stopping())
+    {
+        // Flow control: at most `window` bytes the aggregator has not confirmed
+        auto stallStart = Clock::now();
+        while (ok && unacked() >= cfg_.window && !stopping())
+        {
+            ok = flush_batch(s) && drain_acks(s, true) && Clock::now() - stallStart < kAckStall;
+        }
+
+        size_t want = static_cast<size_t>(std::min<uint64_t>(raw.size(), size - item.sent));
+        size_t got = ok ? fread(raw.data(), 1, want, f) : 0;
+
+        if (got != want)
+        {
+            // Committed frames are immutable; a short read means the file was removed or truncated underneath us
+            fclose(f);
+            if (ok)
+                drop("truncated");
+            return false;
+        }
+
+        crc = crc32_update(crc, raw.data(), got);
+
+        ship::Writer chunk;
+        bool packedOk = cfg_.compress && lz_compress(raw.data(), got, packed);
+        chunk.u8(static_cast<uint8_t>(packedOk ? ship::Codec::Lz : ship::Codec::Raw));
+        chunk.u32(static_cast<uint32_t>(got));
+        chunk.bytes(packedOk ? packed.data() : raw.data(), packedOk ? packed.size() : got);
+
+        item.wire += chunk.data().size() + 5;
+        item.sent += got;
+        ok = push(s, Msg::Chunk, chunk.data(), false) && drain_acks(s, false);
+    }
+
+    fclose(f);
+
+    if (!ok || stopping())
+        return false;
+
+    ship::Writer end;
+    end.u32(crc);
+
+    bool more;
+    {
+        std::lock_guard<std::mutex> lock(m_);
+        more = !queue_.empty();
+    }
+
+    return push(s, Msg::End, end.data(), !more);
+}
+
+bool Shipper::push(Socket& s, Msg type, const std::vector<uint8_t>& payload, bool flush)
+{
+    ship::frame(batch_, type, payload);
+
+    if (flush || batch_.size() >= cfg_.batchBytes)
+        return flush_batch(s);
+
+    return true;
+}
+
+bool Shipper::flush_batch(Socket& s)
+{
+    if (batch_.empty())
+        return true;
+
+    auto wait = bucket_.take(static_cast<double>(batch_.size()), Clock::now());
+
+    if (wait > Clock::duration::zero())
+    {
+        std::unique_lock<std::mutex> lock(m_);
+        if (cv_.wait_for(lock, wait, [&] { return stopping(); }))
+            return false;
+    }
+
+    if (!s.send_all(batch_.data(), batch_.size()))
+        return false;
+
+    {
+        std::lock_guard<std::mutex> lock(m_);
+        counters_.wireBytes += batch_.size();
+    }
+
+    batch_.clear();
+    return true;
+}
+
+bool Shipper::drain_acks(Socket& s, bool block)
+{
+    int timeoutMs = block ? 1000 : 0;
+
+    for (;;)
+    {
+        int ready = s.wait_readable(timeoutMs);
+
+        if (ready < 0)
+            return false;
+        if (ready == 0)
+            return true;
+
+        Msg type;
+        std::vector<uint8_t> payload;
+
+        if (!ship::recv(s, type, payload) || type != Msg::Ack || !handle_ack(payload))
+            return false;
+
+        timeoutMs = 0;
+    }
+}
+
+bool Shipper::handle_ack(const std::vector<uint8_t>& payload)
+{
+    ship::Reader r(payload.data(), payload.size());
+    uint64_t seq = r.u64();
+    uint64_t offset = r.u64();
+    bool complete = r.u8() != 0;
+
+    if (!r.ok())
+        return false;
+
+    std::lock_guard<std::mutex> lock(m_);
+    auto it = std::find_if(inflight_.begin(), inflight_.end(), [&](const Item& i) { return i.seq == seq; });
+
+    if (it == inflight_.end())
+        return true;  // a late ack for a transfer that was already settled
+
+    it->acked = std::min(std::max(it->acked, offset), it->sent);
+
+    if (!complete)
+        return true;
+
+    ship_log<Ev::ShipFileAcked>(cfg_.log, seq, it->size - it->start, it->wire);
+    ++counters_.ackedFiles;
+    counters_.rawBytes += it->size - it->start;
+    inflight_.erase(it);
+    return true;
+}
+
+void Shipper::requeue_inflight()
+{
+    std::lock_guard<std::mutex> lock(m_);
+
+    // Unacknowledged files go back in front in their original order; RESUME decides where each restarts
+    while (!inflight_.empty())
+    {
+        Item it = std::move(inflight_.back());
+        inflight_.pop_back();
+        it.sent = it.acked = it.start = it.wire = 0;
+        queue_.push_front(std::move(it));
+    }
+}
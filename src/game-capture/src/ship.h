@@ -0,0 +1,201 @@
+// Frame shipping: streams committed frame files from a capture node to a central aggregator (hots_aggregator).
+//
+// Wire format: every message is u32 payload length, u8 type, payload; integers little-endian, strings u16 length +
+// bytes.
+//   HELLO  (node -> agg)  u32 version, str node, u64 epoch
+//   RESUME (agg -> node)  u8 has_complete, u64 last_complete_seq, u8 has_partial, u64 partial_seq, u64 partial_offset
+//   FILE   (node -> agg)  u64 seq, u64 size, u64 start_offset, str name, i64 capture unix ms
+//   CHUNK  (node -> agg)  u8 codec (0 raw, 1 lz), u32 raw_len, bytes; each chunk decodes on its own
+//   END    (node -> agg)  u32 crc32 of the whole file
+//   ACK    (agg -> node)  u64 seq, u64 offset, u8 complete
+//   FRAME  (agg -> subscriber)  str node, u64 epoch, u64 seq, i64 unix_ms, str name, file bytes to the end
+//
+// Subscribers connect to the aggregator's --serve port and send one text line,
+// `subscribe [node=N] [from_ms=T] [level=L]`; every frame after that arrives as a FRAME message (see FrameHub for
+// ordering and drops). `level` picks one pyramid level (image_pyramid.h), 0 for full frames.
+//
+// (node, epoch) identifies one frame index (FrameIndex::epoch), so seqs never collide between capture sessions.
+// Frames ship in seq order; after a reconnect the aggregator's RESUME says which files it already holds and how much
+// of the one in progress it kept, and the shipper continues from that byte offset instead of resending.
+//
+// The shipper runs on its own thread with blocking sockets: it keeps up to `window` unacknowledged bytes in flight,
+// coalesces messages into batches of `batchBytes` and paces wire bytes through a token bucket (`maxBytesPerSec`).
+#pragma once
+
+#include "net.h"
+#include "token_bucket.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace ship
+{
+constexpr uint32_t kVersion = 2;
+constexpr size_t kChunkBytes = 64 * 1024;
+constexpr size_t kMaxMessage = kChunkBytes + 1024;  // a chunk plus headers; also bounds HELLO/FILE
+constexpr uint64_t kAckEvery = 1 << 20;             // aggregator acks progress at least this often per file
+
+enum class Msg : uint8_t
+{
+    Hello = 1,
+    Resume = 2,
+    File = 3,
+    Chunk = 4,
+    End = 5,
+    Ack = 6,
+    Frame = 7
+};
+
+enum class Codec : uint8_t
+{
+    Raw = 0,
+    Lz = 1
+};
+
+class Writer
+{
+public:
+    void u8(uint8_t v) { buf_.push_back(v); }
+    void u32(uint32_t v);
+    void u64(uint64_t v);
+    void str(std::string_view s);
+    void bytes(const void* p, size_t n);
+
+    std::vector<uint8_t>& data() { return buf_; }
+
+private:
+    std::vector<uint8_t> buf_;
+};
+
+// Bounds-checked; once a read runs past the end every later read fails and ok() turns false.
+class Reader
+{
+public:
+    Reader(const uint8_t* p, size_t n) : p_(p), n_(n) {}
+
+    uint8_t u8();
+    uint32_t u32();
+    uint64_t u64();
+    std::string str();
+    const uint8_t* bytes(size_t n);
+
+    size_t remaining() const { return n_ - pos_; }
+    bool ok() const { return ok_; }
+
+private:
+    const uint8_t* p_;
+    size_t n_;
+    size_t pos_ = 0;
+    bool ok_ = true;
+};
+
+// Appends a framed message to `out` (batched sends) or sends it directly.
+void frame(std::vector<uint8_t>& out, Msg type, const std::vector<uint8_t>& payload);
+bool send(Socket& s, Msg type, const std::vector<uint8_t>& payload);
+
+// Receives one message; fails on socket errors and on payloads above kMaxMessage.
+bool recv(Socket& s, Msg& type, std::vector<uint8_t>& payload);
+
+// Node names and file names become path components on the aggregator: [A-Za-z0-9._-], no leading dot, <= 64/128.
+bool valid_name(std::string_view s, size_t maxLen);
+}  // namespace ship
+
+struct ShipConfig
+{
+    std::string endpoint;           // CAPTURE_SHIP_TO=host:port; empty disables shipping
+    std::string node;               // CAPTURE_SHIP_NODE, defaults to the host name
+    double maxBytesPerSec = 0;      // CAPTURE_SHIP_MAX_BPS (wire bytes), 0 = unlimited
+    bool compress = true;           // CAPTURE_SHIP_COMPRESS
+    size_t batchBytes = 256 << 10;  // CAPTURE_SHIP_BATCH_BYTES
+    uint64_t window = 8ull << 20;   // unacknowledged bytes in flight
+    size_t maxQueue = 4096;         // files waiting to ship; the oldest is dropped beyond this
+    bool log = true;                // emit capture log events (hots_ship turns this off)
+
+    static ShipConfig from_env();
+};
+
+class Shipper
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    Shipper(ShipConfig cfg, uint64_t epoch);
+    ~Shipper();
+
+    Shipper(const Shipper&) = delete;
+    Shipper& operator=(const Shipper&) = delete;
+
+    void start();
+    void stop();
+
+    // Queues a committed frame. Thread-safe; never blocks on the network.
+    void enqueue(uint64_t seq, std::filesystem::path path);
+
+    // Nothing queued or awaiting acknowledgement.
+    bool idle() const;
+    // The lowest-seq file still queued or awaiting acknowledgement (retention must keep it); nullopt when idle.
+    std::optional<std::filesystem::path> oldest_pending() const;
+
+    struct Counters
+    {
+        uint64_t ackedFiles = 0;
+        uint64_t rawBytes = 0;   // file bytes acknowledged by the aggregator
+        uint64_t wireBytes = 0;  // bytes written to the socket, framing included
+        uint64_t reconnects = 0;
+        uint64_t dropped = 0;    // queue overflow and unreadable files
+        uint64_t backlog = 0;    // files queued or in flight
+    };
+    Counters counters() const;
+
+private:
+    struct Item
+    {
+        uint64_t seq;
+        std::filesystem::path path;
+        uint64_t size = 0;
+        uint64_t sent = 0;   // absolute file offset sent so far
+        uint64_t acked = 0;  // absolute file offset acknowledged
+        uint64_t start = 0;  // offset this transfer started at
+        uint64_t wire = 0;   // socket bytes this transfer cost
+    };
+
+    using Msg = ship::Msg;
+
+    void run();
+    // Runs one connection until it fails or stop() is called.
+    void session(Socket& s, bool& handshook);
+    bool send_file(Socket& s, Item& item);
+    bool push(Socket& s, Msg type, const std::vector<uint8_t>& payload, bool flush);
+    bool flush_batch(Socket& s);
+    bool drain_acks(Socket& s, bool block);
+    bool handle_ack(const std::vector<uint8_t>& payload);
+    void requeue_inflight();
+    uint64_t unacked() const;
+    bool stopping() const { return stop_.load(std::memory_order_relaxed); }
+
+    ShipConfig cfg_;
+    std::string host_;
+    uint16_t port_ = 0;
+    uint64_t epoch_;
+    TokenBucket bucket_;
+
+    mutable std::mutex m_;
+    std::condition_variable cv_;
+    std::deque<Item> queue_;
+    std::deque<Item> inflight_;
+    Socket* active_ = nullptr;
+    Counters counters_;
+
+    std::vector<uint8_t> batch_;
+    std::atomic<bool> stop_{false};
+    std::thread thread_;
+};
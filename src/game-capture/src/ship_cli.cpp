@@ -0,0 +1,89 @@
+// hots_ship: ships existing frame files to an aggregator with the same Shipper the capture service uses. Meant for
+// backfilling a node and for exercising hots_aggregator on localhost.
+//
+//   hots_ship --to host:port [--node N] [--epoch E] [--max-bps N] [--no-compress] <dir|file>...
+//
+// Files are numbered in name order starting at 1; rerunning with the same --node/--epoch resumes where the aggregator
+// left off. Exits once everything is acknowledged.
+#include "ship.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+static int usage()
+{
+    fprintf(stderr, "usage: hots_ship --to host:port [--node N] [--epoch E] [--max-bps N] [--no-compress] "
+                    "<dir|file>...\n");
+    return 2;
+}
+
+int main(int argc, char** argv)
+{
+    ShipConfig cfg = ShipConfig::from_env();
+    cfg.log = false;
+    uint64_t epoch = 1;
+    std::vector<fs::path> files;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string a = argv[i];
+
+        if (a == "--to" && i + 1 < argc)
+            cfg.endpoint = argv[++i];
+        else if (a == "--node" && i + 1 < argc)
+            cfg.node = argv[++i];
+        else if (a == "--epoch" && i + 1 < argc)
+            epoch = std::strtoull(argv[++i], nullptr, 10);
+        else if (a == "--max-bps" && i + 1 < argc)
+            cfg.maxBytesPerSec = std::atof(argv[++i]);
+        else if (a == "--no-compress")
+            cfg.compress = false;
+        else if (a.rfind("--", 0) == 0)
+            return usage();
+        else if (fs::is_directory(a))
+        {
+            for (const auto& e : fs::directory_iterator(a))
+                if (e.is_regular_file())
+                    files.push_back(e.path());
+        }
+        else
+            files.push_back(a);
+    }
+
+    if (cfg.endpoint.empty() || files.empty() || !ship::valid_name(cfg.node, 64))
+        return usage();
+
+    std::sort(files.begin(), files.end());
+    cfg.maxQueue = std::max(cfg.maxQueue, files.size());
+
+    Shipper shipper(cfg, epoch);
+
+    for (size_t i = 0; i < files.size(); ++i)
+        shipper.enqueue(i + 1, files[i]);
+
+    auto start = std::chrono::steady_clock::now();
+    shipper.start();
+
+    while (!shipper.idle())
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    shipper.stop();
+
+    auto c = shipper.counters();
+    printf("files=%llu raw_bytes=%llu wire_bytes=%llu ratio=%.3f seconds=%.2f wire_mbps=%.2f reconnects=%llu "
+           "dropped=%llu\n",
+           (unsigned long long)c.ackedFiles, (unsigned long long)c.rawBytes, (unsigned long long)c.wireBytes,
+           c.rawBytes ? double(c.wireBytes) / double(c.rawBytes) : 0.0, secs,
+           secs > 0 ? double(c.wireBytes) * 8 / secs / 1e6 : 0.0, (unsigned long long)c.reconnects,
+           (unsigned long long)c.dropped);
+    return c.dropped ? 1 : 0;
+}
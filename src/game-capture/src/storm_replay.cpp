@@ -0,0 +1,286 @@
+#include "storm_replay.h"
+
+#include "paths.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <system_error>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+constexpr uint8_t kUserDataMagic[4] = {'M', 'P', 'Q', 0x1b};
+constexpr size_t kUserDataPrefix = 16;  // magic, max size, archive offset, header size
+constexpr size_t kMaxUserData = 4096;   // Heroes writes 0x200; anything far beyond that is not a replay header
+constexpr int kMaxDepth = 16;
+constexpr char kSignature[] = "Heroes of the Storm replay";
+
+// Value type bytes of the versioned serialization
+enum Type : uint8_t
+{
+    Array = 0,
+    BitArray = 1,
+    Blob = 2,
+    Choice = 3,
+    Optional = 4,
+    Struct = 5,
+    U8 = 6,
+    U32 = 7,
+    U64 = 8,
+    VarInt = 9,
+};
+
+uint32_t read_u32(const uint8_t* p)
+{
+    return uint32_t(p[0]) | uint32_t(p[1]) << 8 | uint32_t(p[2]) << 16 | uint32_t(p[3]) << 24;
+}
+
+class VersionedReader
+{
+public:
+    VersionedReader(const uint8_t* p, size_t n) : p_(p), end_(p + n) {}
+
+    bool type(Type expected) { return p_ < end_ && *p_++ == expected; }
+
+    // Zigzag varint: bit 0 of the first byte is the sign, then 6 + 7n magnitude bits
+    bool vint(int64_t& v)
+    {
+        if (p_ >= end_)
+            return false;
+
+        uint8_t b = *p_++;
+        bool negative = b & 1;
+        uint64_t r = (b >> 1) & 0x3f;
+        int shift = 6;
+
+        while (b & 0x80)
+        {
+            if (p_ >= end_ || shift > 62)
+                return false;
+            b = *p_++;
+            r |= uint64_t(b & 0x7f) << shift;
+            shift += 7;
+        }
+
+        v = negative ? -int64_t(r) : int64_t(r);
+        return true;
+    }
+
+    bool int_value(int64_t& v) { return type(VarInt) && vint(v); }
+
+    bool bytes(size_t n, const uint8_t** out = nullptr)
+    {
+        if (size_t(end_ - p_) < n)
+            return false;
+        if (out)
+            *out = p_;
+        p_ += n;
+        return true;
+    }
+
+    // Skips one value of any type
+    bool skip(int depth = 0)
+    {
+        if (p_ >= end_ || depth > kMaxDepth)
+            return false;
+
+        int64_t n = 0;
+
+        switch (*p_++)
+        {
+        case Array:
+            if (!vint(n) || n < 0)
+                return false;
+            for (int64_t i = 0; i < n; ++i)
+                if (!skip(depth + 1))
+                    return false;
+            return true;
+        case BitArray:
+            return vint(n) && n >= 0 && bytes(size_t(n + 7) / 8);
+        case Blob:
+            return vint(n) && n >= 0 && bytes(size_t(n));
+        case Choice:
+            return vint(n) && skip(depth + 1);
+        case Optional:
+            if (p_ >= end_)
+                return false;
+            return *p_++ == 0 || skip(depth + 1);
+        case Struct:
+            if (!vint(n) || n < 0)
+                return false;
+            for (int64_t i = 0; i < n; ++i)
+            {
+                int64_t tag;
+                if (!vint(tag) || !skip(depth + 1))
+                    return false;
+            }
+            return true;
+        case U8:
+            return bytes(1);
+        case U32:
+            return bytes(4);
+        case U64:
+            return bytes(8);
+        case VarInt:
+            return vint(n);
+        default:
+            return false;
+        }
+    }
+
+    // Calls `field(tag)` for each member of a struct; `field` consumes the value or returns false to skip it
+    template <class F> bool for_each_field(F&& field)
+    {
+        int64_t n;
+        if (!type(Struct) || !vint(n) || n < 0)
+            return false;
+
+        for (int64_t i = 0; i < n; ++i)
+        {
+            int64_t tag;
+            if (!vint(tag))
+                return false;
+
+            const uint8_t* at = p_;
+            if (!field(tag))
+            {
+                p_ = at;
+                if (!skip(1))
+                    return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    const uint8_t* p_;
+    const uint8_t* end_;
+};
+
+bool to_u32(int64_t v, uint32_t& out)
+{
+    if (v < 0 || v > int64_t(UINT32_MAX))
+        return false;
+    out = uint32_t(v);
+    return true;
+}
+}  // namespace
+
+bool parse_storm_replay_header(const uint8_t* data, size_t n, StormReplayHeader& out)
+{
+    if (n < kUserDataPrefix || std::memcmp(data, kUserDataMagic, 4) != 0)
+        return false;
+
+    uint32_t archiveOffset = read_u32(data + 8);
+    uint32_t size = read_u32(data + 12);
+
+    if (size > kMaxUserData || n - kUserDataPrefix < size)
+        return false;
+
+    StormReplayHeader h;
+    h.archiveOffset = archiveOffset;
+    bool signed_ok = false;
+    bool have_loops = false;
+    bool have_build = false;
+
+    VersionedReader r(data + kUserDataPrefix, size);
+
+    bool ok = r.for_each_field(
+        [&](int64_t tag)
+        {
+            int64_t v;
+            switch (tag)
+            {
+            case 0:  // m_signature
+            {
+                int64_t len;
+                const uint8_t* s;
+                if (!r.type(Blob) || !r.vint(len) || len < 0 || !r.bytes(size_t(len), &s))
+                    return false;
+                signed_ok = size_t(len) >= sizeof(kSignature) - 1 &&
+                            std::memcmp(s, kSignature, sizeof(kSignature) - 1) == 0;
+                return true;
+            }
+            case 1:  // m_version
+                return r.for_each_field(
+                    [&](int64_t vtag)
+                    {
+                        uint32_t* dst = vtag == 1   ? &h.major
+                                        : vtag == 2 ? &h.minor
+                                        : vtag == 3 ? &h.revision
+                                        : vtag == 4 ? &h.build
+                                        : vtag == 5 ? &h.baseBuild
+                                                    : nullptr;
+                        if (!dst || !r.int_value(v) || !to_u32(v, *dst))
+                            return false;
+                        have_build |= vtag == 4;
+                        return true;
+                    });
+            case 3:  // m_elapsedGameLoops
+                if (!r.int_value(v) || v < 0)
+                    return false;
+                h.elapsedGameLoops = uint64_t(v);
+                have_loops = true;
+                return true;
+            case 6:  // m_dataBuildNum
+                return r.int_value(v) && to_u32(v, h.dataBuild);
+            default:
+                return false;
+            }
+        });
+
+    if (!ok || !signed_ok || !have_loops || !have_build)
+        return false;
+
+    out = h;
+    return true;
+}
+
+bool read_storm_replay_header(const fs::path& path, StormReplayHeader& out)
+{
+#ifdef _WIN32
+    FILE* f = _wfopen(path.wstring().c_str(), L"rb");
+#else
+    FILE* f = fopen(path.c_str(), "rb");
+#endif
+
+    if (!f)
+        return false;
+
+    uint8_t buf[kUserDataPrefix + kMaxUserData];
+    size_t got = fread(buf, 1, kUserDataPrefix, f);
+    size_t want = got == kUserDataPrefix ? read_u32(buf + 12) : 0;
+
+    if (want <= kMaxUserData)
+        got += fread(buf + got, 1, want, f);
+
+    fclose(f);
+    return parse_storm_replay_header(buf, got, out);
+}
+
+fs::path find_active_replay()
+{
+    if (const char* v = std::getenv("CAPTURE_REPLAY"); v && *v)
+        return fs::path(v);
+
+    std::error_code ec;
+    fs::path newest;
+    fs::file_time_type newestTime{};
+
+    for (const auto& e : fs::directory_iterator(base_dir() / "replays" / "active", ec))
+    {
+        if (!e.is_regular_file(ec) || e.path().extension() != ".StormReplay")
+            continue;
+
+        auto t = e.last_write_time(ec);
+        if (!ec && (newest.empty() || t > newestTime))
+        {
+            newest = e.path();
+            newestTime = t;
+        }
+    }
+
+    return newest;
+}
@@ -0,0 +1,43 @@
+// Reads the replay header of a .StormReplay without opening the MPQ archive behind it.
+//
+// A replay starts with an MPQ user-data block ("MPQ\x1b"): a 16-byte prefix followed by the replay header, stored
+// in Blizzard's versioned serialization (a type byte before every value, zigzag varints, tagged struct fields).
+// That header carries the client build and the total number of game loops, which is all capture needs to know how
+// long the game will run. Only the first few hundred bytes are read; nothing is decompressed.
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+struct StormReplayHeader
+{
+    uint32_t major = 0;
+    uint32_t minor = 0;
+    uint32_t revision = 0;
+    uint32_t build = 0;
+    uint32_t baseBuild = 0;  // protocol build; differs from `build` on hotfix clients
+    uint32_t dataBuild = 0;  // 0 when the header predates m_dataBuildNum
+    uint64_t elapsedGameLoops = 0;
+    uint32_t archiveOffset = 0;  // where the MPQ archive header starts
+
+    static constexpr uint32_t kGameLoopsPerSecond = 16;
+
+    // Game time covered by the replay, from the first loop to the last
+    std::chrono::milliseconds duration() const
+    {
+        return std::chrono::milliseconds(elapsedGameLoops * 1000 / kGameLoopsPerSecond);
+    }
+};
+
+// Decodes the user-data block at the start of a replay (`data` is the file prefix). Returns false when the bytes are
+// not a Heroes of the Storm replay header or are truncated.
+bool parse_storm_replay_header(const uint8_t* data, size_t n, StormReplayHeader& out);
+
+// Reads just the user-data block of `path` and decodes it.
+bool read_storm_replay_header(const std::filesystem::path& path, StormReplayHeader& out);
+
+// The replay the session manager is playing: ${CAPTURE_REPLAY} if set, else the newest .StormReplay in
+// replays/active. Empty when there is none.
+std::filesystem::path find_active_replay();
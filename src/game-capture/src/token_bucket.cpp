@@ -0,0 +1,23 @@
+#include "token_bucket.h"
+
+#include <algorithm>
+
+TokenBucket::TokenBucket(double ratePerSec, double burst) : rate_(ratePerSec), burst_(burst), tokens_(burst) {}
+
+TokenBucket::Clock::duration TokenBucket::take(double n, Clock::time_point now)
+{
+    if (rate_ <= 0.0)
+        return Clock::duration::zero();
+
+    if (started_)
+        tokens_ = std::min(burst_, tokens_ + std::chrono::duration<double>(now - last_).count() * rate_);
+
+    started_ = true;
+    last_ = now;
+    tokens_ -= n;
+
+    if (tokens_ >= 0.0)
+        return Clock::duration::zero();
+
+    return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(-tokens_ / rate_));
+}
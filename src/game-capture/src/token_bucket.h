@@ -0,0 +1,25 @@
+// Token bucket rate limiter (bytes per second with a burst allowance). Not thread-safe; callers own the sleeping.
+#pragma once
+
+#include <chrono>
+
+class TokenBucket
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // rate <= 0 disables limiting.
+    TokenBucket(double ratePerSec, double burst);
+
+    // Takes `n` tokens (possibly going into debt) and returns how long to wait before the caller may proceed.
+    Clock::duration take(double n, Clock::time_point now);
+
+    double rate() const { return rate_; }
+
+private:
+    double rate_;
+    double burst_;
+    double tokens_;
+    Clock::time_point last_{};
+    bool started_ = false;
+};
@@ -0,0 +1,436 @@
+// hots_track: runs the minimap tracker (minimap_tracker.h) over hero-inference detection sidecars, giving their
+// objects persistent track IDs, and reports the tracker's time per frame.
+//
+//   hots_track [--classes 1,6|all] [--minimap X,Y,W,H] [--out DIR] [--follow] [--quiet] <dir|file.detections.json>...
+//
+// Sidecars are taken in name order (frame stems sort by sequence) and timed by their "ts". --classes picks the
+// class ids to track (default 1,6: blue and red players); --minimap gives the minimap as fractions of the frame
+// (default: the detector's crop region). Each frame prints its tracks unless --quiet. --out writes
+// <stem>.tracks.json per frame, plus latest.tracks.json, for consumers that want to follow one hero:
+//   {"version": 1, "frame": "<stem>", "ts": <unix s>,
+//    "tracks": [{"id", "class_id", "state", "x", "y", "vx", "vy", "sigma", "hits", "misses", "object"}, ...]}
+// with positions in minimap coordinates and "object" the index of the sidecar object the track took (-1: none).
+// --follow keeps polling the directories for new sidecars until interrupted. Tracker settings come from the
+// CAPTURE_TRACK_* environment variables.
+//
+//   hots_track --simulate SEED [--frames N] [--max-switches N] [--min-coverage PCT]
+//
+// Checks the tracker against a synthetic game instead: ten heroes (five a team) wander the minimap at 4 Hz with
+// detection noise, 8% missed detections, 0.5-3 s spells in fog or dead and 0-2 false positives a frame, for N frames
+// (default 2400). Every detection carries the hero it came from, so the run reports ID switches (a hero's confirmed
+// track ID changing between its detections), how many true detections a confirmed track carried, and false positives
+// that got a confirmed ID. Exits 1 above --max-switches (default 150) or below --min-coverage (default 97%).
+#include "detection_sidecar.h"
+#include "minimap_tracker.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+constexpr std::string_view kSidecarExt = ".detections.json";
+
+bool is_sidecar(const fs::path& p)
+{
+    std::string name = p.filename().string();
+    return name.size() > kSidecarExt.size() && name.ends_with(kSidecarExt);
+}
+
+std::string stem_of(const fs::path& p)
+{
+    std::string name = p.filename().string();
+    return name.substr(0, name.size() - kSidecarExt.size());
+}
+
+const char* state_name(MinimapTracker::State s)
+{
+    switch (s)
+    {
+    case MinimapTracker::State::Tentative:
+        return "tentative";
+    case MinimapTracker::State::Confirmed:
+        return "confirmed";
+    case MinimapTracker::State::Coasting:
+        return "coasting";
+    }
+    return "?";
+}
+
+std::string tracks_json(const DetectionSidecar& sc, const std::vector<MinimapTracker::Track>& tracks,
+                        const std::vector<int>& objectIndex)
+{
+    std::string out = "{\"version\": 1, \"frame\": \"";
+    for (char c : sc.frame)
+    {
+        if (c == '"' || c == '\\')
+            out += '\\';
+        out += c;
+    }
+    char buf[320];
+    snprintf(buf, sizeof(buf), "\", \"ts\": %.3f, \"tracks\": [", sc.ts);
+    out += buf;
+
+    for (size_t i = 0; i < tracks.size(); ++i)
+    {
+        const auto& t = tracks[i];
+        int object = t.detection >= 0 ? objectIndex[t.detection] : -1;
+        snprintf(buf, sizeof(buf),
+                 "%s{\"id\": %u, \"class_id\": %d, \"state\": \"%s\", \"x\": %.4f, \"y\": %.4f, \"vx\": %.4f, "
+                 "\"vy\": %.4f, \"sigma\": %.4f, \"hits\": %d, \"misses\": %d, \"object\": %d}",
+                 i ? ", " : "", t.id, t.classId, state_name(t.state), t.x, t.y, t.vx, t.vy, t.sigma, t.hits,
+                 t.misses, object);
+        out += buf;
+    }
+    out += "]}\n";
+    return out;
+}
+
+// Written whole and renamed into place, so a reader never sees a torn file
+bool write_file(const fs::path& path, const std::string& text)
+{
+    auto tmp = path;
+    tmp += ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        out << text;
+        if (!out)
+            return false;
+    }
+    std::error_code ec;
+    fs::rename(tmp, path, ec);
+    if (ec)
+    {
+        fs::remove(path, ec);
+        fs::rename(tmp, path, ec);
+    }
+    return !ec;
+}
+
+bool parse_list(const char* s, std::vector<double>& out)
+{
+    out.clear();
+    while (*s)
+    {
+        char* end;
+        out.push_back(std::strtod(s, &end));
+        if (end == s)
+            return false;
+        s = *end == ',' ? end + 1 : end;
+    }
+    return true;
+}
+
+void print_timing(std::vector<double>& micros)
+{
+    if (micros.empty())
+        return;
+    double sum = 0;
+    for (double m : micros)
+        sum += m;
+    std::sort(micros.begin(), micros.end());
+    printf("tracker update: %.2f us mean, %.2f us p99, %.2f us max\n", sum / static_cast<double>(micros.size()),
+           micros[micros.size() * 99 / 100], micros.back());
+}
+
+struct SimHero
+{
+    int classId;
+    double x, y, vx = 0, vy = 0;
+    double hidden = 0;  // seconds left in fog or dead
+};
+
+int simulate(uint64_t seed, int frames, int maxSwitches, double minCoverage)
+{
+    constexpr double kDt = 0.25;
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    std::normal_distribution<double> accel(0.0, 0.03), noise(0.0, 0.006);
+    auto chance = [&](double p) { return uniform(rng) < p; };
+
+    std::vector<SimHero> heroes;
+    for (int i = 0; i < 10; ++i)
+        heroes.push_back({i < 5 ? 1 : 6, uniform(rng), uniform(rng)});
+
+    MinimapTracker tracker(MinimapTracker::Config::from_env());
+    std::vector<MinimapTracker::Detection> detections;
+    std::vector<int> truth;  // hero index per detection, -1 for a false positive
+    std::map<int, uint32_t> lastId;
+    std::map<int, std::set<uint32_t>> idsPerHero;
+    std::set<uint32_t> falseConfirmed;
+    std::vector<double> micros;
+    size_t switches = 0, trueDetections = 0, carried = 0;
+
+    for (int f = 0; f < frames; ++f)
+    {
+        detections.clear();
+        truth.clear();
+
+        for (size_t i = 0; i < heroes.size(); ++i)
+        {
+            SimHero& h = heroes[i];
+            // Wander: random acceleration, capped speed, the odd stop (fights, recalls), bouncing off the edges
+            h.vx += accel(rng) * std::sqrt(kDt);
+            h.vy += accel(rng) * std::sqrt(kDt);
+            double speed = std::hypot(h.vx, h.vy);
+            if (speed > 0.06)
+            {
+                h.vx *= 0.06 / speed;
+                h.vy *= 0.06 / speed;
+            }
+            if (chance(0.01))
+                h.vx = h.vy = 0;
+            h.x += h.vx * kDt;
+            h.y += h.vy * kDt;
+            for (auto [p, v] : {std::pair{&h.x, &h.vx}, std::pair{&h.y, &h.vy}})
+                if (*p < 0.02 || *p > 0.98)
+                {
+                    *p = std::clamp(*p, 0.02, 0.98);
+                    *v = -*v;
+                }
+
+            if (h.hidden > 0)
+            {
+                h.hidden -= kDt;
+                continue;
+            }
+            if (chance(0.02))
+            {
+                h.hidden = 0.5 + 2.5 * uniform(rng);
+                continue;
+            }
+            if (chance(0.08))
+                continue;
+            detections.push_back({h.x + noise(rng), h.y + noise(rng), h.classId, 0.8});
+            truth.push_back(static_cast<int>(i));
+        }
+
+        static constexpr int kFalsePositives[] = {0, 0, 0, 1, 1, 2};
+        for (int n = kFalsePositives[rng() % 6]; n > 0; --n)
+        {
+            detections.push_back({uniform(rng), uniform(rng), chance(0.5) ? 1 : 6, 0.8});
+            truth.push_back(-1);
+        }
+        // Detectors list objects in no particular order
+        for (size_t i = detections.size(); i > 1; --i)
+        {
+            size_t j = rng() % i;
+            std::swap(detections[i - 1], detections[j]);
+            std::swap(truth[i - 1], truth[j]);
+        }
+
+        auto t0 = std::chrono::steady_clock::now();
+        const auto& tracks = tracker.update(f * kDt, detections);
+        micros.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count());
+
+        for (int gt : truth)
+            trueDetections += gt >= 0;
+        for (const auto& t : tracks)
+        {
+            if (t.detection < 0 || t.state == MinimapTracker::State::Tentative)
+                continue;
+            int gt = truth[t.detection];
+            if (gt < 0)
+            {
+                falseConfirmed.insert(t.id);
+                continue;
+            }
+            ++carried;
+            idsPerHero[gt].insert(t.id);
+            auto last = lastId.find(gt);
+            switches += last != lastId.end() && last->second != t.id;
+            lastId[gt] = t.id;
+        }
+    }
+
+    double coverage = trueDetections ? 100.0 * static_cast<double>(carried) / static_cast<double>(trueDetections) : 0;
+    printf("seed %llu: %d frames, %zu true detections, %.1f%% carried by a confirmed track\n",
+           static_cast<unsigned long long>(seed), frames, trueDetections, coverage);
+    printf("ID switches %zu; track IDs per hero", switches);
+    for (const auto& [hero, ids] : idsPerHero)
+        printf(" %zu", ids.size());
+    printf("; false positives confirmed %zu\n", falseConfirmed.size());
+    print_timing(micros);
+
+    bool ok = switches <= static_cast<size_t>(maxSwitches) && coverage >= minCoverage;
+    printf("%s (at most %d switches, at least %.1f%% carried)\n", ok ? "ok" : "FAIL", maxSwitches, minCoverage);
+    return ok ? 0 : 1;
+}
+
+int usage()
+{
+    fprintf(stderr, "usage: hots_track [--classes 1,6|all] [--minimap X,Y,W,H] [--out DIR] [--follow] [--quiet] "
+                    "<dir|file.detections.json>...\n"
+                    "       hots_track --simulate SEED [--frames N] [--max-switches N] [--min-coverage PCT]\n");
+    return 2;
+}
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    std::vector<int> classes = {1, 6};
+    FrameRect minimap;
+    bool hasMinimap = false, follow = false, quiet = false;
+    fs::path outDir;
+    std::vector<fs::path> dirs, files;
+    bool sim = false;
+    uint64_t seed = 0;
+    int simFrames = 2400, maxSwitches = 150;
+    double minCoverage = 97;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string a = argv[i];
+        bool hasValue = i + 1 < argc;
+        std::vector<double> values;
+
+        if (a == "--classes" && hasValue)
+        {
+            classes.clear();
+            if (std::string(argv[++i]) != "all")
+            {
+                if (!parse_list(argv[i], values) || values.empty())
+                    return usage();
+                for (double v : values)
+                    classes.push_back(static_cast<int>(v));
+            }
+        }
+        else if (a == "--minimap" && hasValue)
+        {
+            if (!parse_list(argv[++i], values) || values.size() != 4 || values[2] <= 0 || values[3] <= 0)
+                return usage();
+            minimap = {values[0], values[1], values[2], values[3]};
+            hasMinimap = true;
+        }
+        else if (a == "--out" && hasValue)
+            outDir = argv[++i];
+        else if (a == "--simulate" && hasValue)
+        {
+            sim = true;
+            seed = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (a == "--frames" && hasValue)
+            simFrames = std::max(1, std::atoi(argv[++i]));
+        else if (a == "--max-switches" && hasValue)
+            maxSwitches = std::atoi(argv[++i]);
+        else if (a == "--min-coverage" && hasValue)
+            minCoverage = std::atof(argv[++i]);
+        else if (a == "--follow")
+            follow = true;
+        else if (a == "--quiet")
+            quiet = true;
+        else if (a.rfind("--", 0) == 0)
+            return usage();
+        else if (fs::is_directory(a))
+            dirs.push_back(a);
+        else
+            files.push_back(a);
+    }
+    if (sim)
+        return dirs.empty() && files.empty() ? simulate(seed, simFrames, maxSwitches, minCoverage) : usage();
+    if (dirs.empty() && files.empty())
+        return usage();
+    if (!outDir.empty())
+    {
+        std::error_code ec;
+        fs::create_directories(outDir, ec);
+    }
+
+    MinimapTracker tracker(MinimapTracker::Config::from_env());
+    std::vector<MinimapTracker::Detection> detections;
+    std::vector<int> objectIndex;
+    std::set<fs::path> done;
+    std::vector<double> micros;
+    size_t unreadable = 0;
+
+    auto run = [&](const fs::path& path)
+    {
+        DetectionSidecar sc;
+        std::string error;
+        if (!read_detection_sidecar(path, sc, error))
+        {
+            fprintf(stderr, "skipping %s: %s\n", path.string().c_str(), error.c_str());
+            ++unreadable;
+            return;
+        }
+        if (sc.frame.empty())
+            sc.frame = stem_of(path);
+        minimap_detections(sc, classes, hasMinimap ? &minimap : nullptr, detections, &objectIndex);
+
+        auto t0 = std::chrono::steady_clock::now();
+        const auto& tracks = tracker.update(sc.ts, detections);
+        micros.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count());
+
+        if (!quiet)
+        {
+            printf("%s  %zu detections:", sc.frame.c_str(), detections.size());
+            // ? tentative, ~ coasting
+            for (const auto& t : tracks)
+                printf("  #%u%s (%.3f,%.3f) v=(%+.3f,%+.3f)", t.id,
+                       t.state == MinimapTracker::State::Tentative  ? "?"
+                       : t.state == MinimapTracker::State::Coasting ? "~"
+                                                                    : "",
+                       t.x, t.y, t.vx, t.vy);
+            printf("\n");
+        }
+        if (!outDir.empty())
+        {
+            std::string json = tracks_json(sc, tracks, objectIndex);
+            if (!write_file(outDir / (sc.frame + ".tracks.json"), json) ||
+                !write_file(outDir / "latest.tracks.json", json))
+                fprintf(stderr, "cannot write tracks for %s under %s\n", sc.frame.c_str(), outDir.string().c_str());
+        }
+    };
+
+    auto scan = [&]
+    {
+        std::vector<fs::path> fresh;
+        for (const auto& f : files)
+            if (!done.count(f))
+                fresh.push_back(f);
+        for (const auto& d : dirs)
+        {
+            std::error_code ec;
+            for (const auto& e : fs::directory_iterator(d, ec))
+                if (e.is_regular_file() && is_sidecar(e.path()) && !done.count(e.path()))
+                    fresh.push_back(e.path());
+        }
+        std::sort(fresh.begin(), fresh.end(), [](const fs::path& a, const fs::path& b)
+                  { return a.filename() < b.filename(); });
+        for (const auto& p : fresh)
+        {
+            done.insert(p);
+            run(p);
+        }
+        fflush(stdout);
+    };
+
+    scan();
+    while (follow)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        scan();
+    }
+
+    const auto& s = tracker.stats();
+    printf("%llu frames  %llu detections  %llu matched  tracks: %llu started, %llu confirmed, %llu recovered after "
+           "coasting, %llu IDs reclaimed, %llu dropped  %zu unreadable\n",
+           static_cast<unsigned long long>(s.updates), static_cast<unsigned long long>(s.detections),
+           static_cast<unsigned long long>(s.matched), static_cast<unsigned long long>(s.created),
+           static_cast<unsigned long long>(s.confirmed), static_cast<unsigned long long>(s.recovered),
+           static_cast<unsigned long long>(s.reclaimed), static_cast<unsigned long long>(s.dropped), unreadable);
+    print_timing(micros);
+    return 0;
+}
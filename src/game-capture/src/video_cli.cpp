@@ -0,0 +1,130 @@
+// hots_video: plays saved frames into the video sink (video_sink.h) as capture would, and reports what the encoder
+// was sent against what it should have been: frames written, repeated, dropped and skipped, and how long submit()
+// held up the capture side.
+//
+//   hots_video --cmd COMMAND [--fps F] [--capture-fps C] [--seconds S] [--format nv12|i420] <dir|file.bmp>...
+//
+// Frames are submitted C times a second (default 60) in name order, looping, for S seconds (default 10), and the sink
+// sends F a second (default 30) to COMMAND, which takes the same {width}/{height}/{fps}/{pix_fmt} placeholders as
+// CAPTURE_VIDEO_CMD. Exits 1 if the stream ended early (the encoder failed or stopped reading) or fell short of the
+// expected frame count by more than the sink's catch-up allowance (the encoder stalled).
+#include "bmp_reader.h"
+#include "video_sink.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+static int usage()
+{
+    fprintf(stderr, "usage: hots_video --cmd COMMAND [--fps F] [--capture-fps C] [--seconds S] [--format nv12|i420] "
+                    "<dir|file.bmp>...\n");
+    return 2;
+}
+
+int main(int argc, char** argv)
+{
+    VideoSink::Config cfg;
+    cfg.log = false;
+    double captureFps = 60, seconds = 10;
+    std::vector<fs::path> files;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string a = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (a == "--cmd" && hasValue)
+            cfg.command = argv[++i];
+        else if (a == "--fps" && hasValue)
+            cfg.fps = std::atof(argv[++i]);
+        else if (a == "--capture-fps" && hasValue)
+            captureFps = std::atof(argv[++i]);
+        else if (a == "--seconds" && hasValue)
+            seconds = std::atof(argv[++i]);
+        else if (a == "--format" && hasValue)
+        {
+            std::string f = argv[++i];
+            if (f != "nv12" && f != "i420")
+                return usage();
+            cfg.layout = f == "nv12" ? YuvLayout::Nv12 : YuvLayout::I420;
+        }
+        else if (a.rfind("--", 0) == 0)
+            return usage();
+        else if (fs::is_directory(a))
+        {
+            for (const auto& e : fs::directory_iterator(a))
+                if (e.is_regular_file() && e.path().extension() == ".bmp")
+                    files.push_back(e.path());
+        }
+        else
+            files.push_back(a);
+    }
+
+    if (files.empty() || cfg.command.empty() || cfg.fps <= 0 || captureFps <= 0 || seconds <= 0)
+        return usage();
+
+    std::sort(files.begin(), files.end());
+    std::vector<BmpImage> frames;
+    for (const auto& p : files)
+    {
+        BmpImage img;
+        if (load_bmp(p, img))
+            frames.push_back(std::move(img));
+        else
+            fprintf(stderr, "skipping %s: not a readable 24/32-bit BMP\n", p.string().c_str());
+    }
+    if (frames.empty())
+        return 1;
+
+    using Clock = VideoSink::Clock;
+    const auto step = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / captureFps));
+    const auto start = Clock::now();
+    const auto end = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+
+    VideoSink sink(cfg);
+    double submitMs = 0, maxSubmitMs = 0;
+    size_t submits = 0;
+
+    for (auto at = start; at < end && !sink.ended(); at += step)
+    {
+        std::this_thread::sleep_until(at);
+        const BmpImage& img = frames[submits % frames.size()];
+
+        auto t0 = Clock::now();
+        sink.submit(img.bgra.data(), img.width, img.height, static_cast<size_t>(img.width) * 4);
+        double ms = std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+        submitMs += ms;
+        maxSubmitMs = std::max(maxSubmitMs, ms);
+        ++submits;
+    }
+
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    bool endedEarly = sink.ended();
+    sink.stop();
+    auto c = sink.counters();
+
+    // A healthy encoder is never further behind than maxCatchUp, plus the frame in flight
+    double expected = elapsed * cfg.fps;
+    double allowance = std::chrono::duration<double>(cfg.maxCatchUp).count() * cfg.fps + 1;
+    bool stalled = static_cast<double>(c.written) + allowance < expected;
+
+    printf("%zu frames submitted in %.1f s  submit %.2f ms mean, %.2f ms max\n", submits, elapsed,
+           submits ? submitMs / static_cast<double>(submits) : 0.0, maxSubmitMs);
+    printf("written %llu (%.0f expected at %g fps)  duplicated %llu  dropped %llu  skipped %llu  mismatched %llu  "
+           "%.1f MB\n",
+           static_cast<unsigned long long>(c.written), expected, cfg.fps,
+           static_cast<unsigned long long>(c.duplicated), static_cast<unsigned long long>(c.dropped),
+           static_cast<unsigned long long>(c.skipped), static_cast<unsigned long long>(c.mismatched),
+           static_cast<double>(c.bytes) / 1e6);
+    printf("encoder exit code %d%s%s\n", sink.exit_code(), endedEarly ? "  (stream ended early)" : "",
+           stalled ? "  (encoder fell behind by more than the catch-up allowance)" : "");
+    return endedEarly || stalled ? 1 : 0;
+}
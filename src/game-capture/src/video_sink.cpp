@@ -0,0 +1,456 @@
+#include "video_sink.h"
+
+#include "log.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+// How long stop() lets a frame already being written finish before giving up on an encoder that stopped reading
+constexpr auto kWriteWait = std::chrono::seconds(2);
+// How long stop() waits for the encoder to finish its output before killing it
+constexpr auto kExitWait = std::chrono::seconds(10);
+
+const char* pix_fmt(YuvLayout layout)
+{
+    return layout == YuvLayout::Nv12 ? "nv12" : "yuv420p";
+}
+
+std::string format_fps(double fps)
+{
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%g", fps);
+    return buf;
+}
+
+std::string expand_command(std::string cmd, int width, int height, const VideoSink::Config& cfg)
+{
+    // ffmpeg's names: BT.601 is smpte170m, and tv/pc stand for limited/full range
+    const std::pair<const char*, std::string> vars[] = {
+        {"{width}", std::to_string(width)},
+        {"{height}", std::to_string(height)},
+        {"{fps}", format_fps(cfg.fps)},
+        {"{pix_fmt}", pix_fmt(cfg.layout)},
+        {"{colorspace}", cfg.yuv.matrix == YuvMatrix::Bt709 ? "bt709" : "smpte170m"},
+        {"{color_range}", cfg.yuv.range == YuvRange::Full ? "pc" : "tv"},
+    };
+
+    for (const auto& [name, value] : vars)
+    {
+        for (size_t at = cmd.find(name); at != std::string::npos; at = cmd.find(name, at + value.size()))
+            cmd.replace(at, std::strlen(name), value);
+    }
+    return cmd;
+}
+}  // namespace
+
+#ifdef _WIN32
+struct VideoSink::Process
+{
+    HANDLE process = nullptr;
+    HANDLE input = nullptr;  // write end of the encoder's stdin
+
+    bool start(const std::string& command)
+    {
+        SECURITY_ATTRIBUTES sa{sizeof(sa), nullptr, TRUE};
+        HANDLE readEnd = nullptr;
+        if (!CreatePipe(&readEnd, &input, &sa, 1 << 20))
+            return false;
+        SetHandleInformation(input, HANDLE_FLAG_INHERIT, 0);
+
+        STARTUPINFOA si{};
+        si.cb = sizeof(si);
+        si.dwFlags = STARTF_USESTDHANDLES;
+        si.hStdInput = readEnd;
+        si.hStdOutput = GetStdHandle(STD_OUTPUT_HANDLE);
+        si.hStdError = GetStdHandle(STD_ERROR_HANDLE);
+
+        std::string line = "cmd.exe /c " + command;
+        PROCESS_INFORMATION pi{};
+        BOOL ok = CreateProcessA(nullptr, line.data(), nullptr, nullptr, TRUE, CREATE_NO_WINDOW, nullptr, nullptr,
+                                 &si, &pi);
+        CloseHandle(readEnd);
+        if (!ok)
+        {
+            CloseHandle(input);
+            input = nullptr;
+            return false;
+        }
+        CloseHandle(pi.hThread);
+        process = pi.hProcess;
+        return true;
+    }
+
+    // Blocks in WriteFile; cancel_write() from another thread gets it out
+    bool write(const uint8_t* p, size_t n, const std::atomic<bool>& abandon)
+    {
+        while (n)
+        {
+            DWORD chunk = static_cast<DWORD>(std::min<size_t>(n, 1u << 30)), done = 0;
+            if (abandon || !WriteFile(input, p, chunk, &done, nullptr))
+                return false;
+            p += done;
+            n -= done;
+        }
+        return true;
+    }
+
+    void cancel_write(std::thread& writer) { CancelSynchronousIo(writer.native_handle()); }
+
+    void close_input()
+    {
+        if (input)
+            CloseHandle(input);
+        input = nullptr;
+    }
+
+    int wait(std::chrono::milliseconds timeout)
+    {
+        DWORD code = 0;
+        auto waitMs = timeout.count();
+        if (WaitForSingleObject(process, static_cast<DWORD>(waitMs)) != WAIT_OBJECT_0)
+        {
+            TerminateProcess(process, 1);
+            WaitForSingleObject(process, INFINITE);
+            CloseHandle(process);
+            return -1;
+        }
+        GetExitCodeProcess(process, &code);
+        CloseHandle(process);
+        return static_cast<int>(code);
+    }
+
+    int id() const { return static_cast<int>(GetProcessId(process)); }
+};
+#else
+struct VideoSink::Process
+{
+    pid_t pid = -1;
+    int input = -1;  // write end of the encoder's stdin
+
+    bool start(const std::string& command)
+    {
+        int fds[2];
+        if (pipe(fds) != 0)
+            return false;
+        // Only the child's copy of the read end survives exec
+        fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+
+        pid = fork();
+        if (pid == 0)
+        {
+            // The writer thread blocks SIGPIPE (see run()); the encoder gets the default mask back
+            sigset_t none;
+            sigemptyset(&none);
+            sigprocmask(SIG_SETMASK, &none, nullptr);
+            dup2(fds[0], STDIN_FILENO);
+            if (fds[0] != STDIN_FILENO)
+                close(fds[0]);
+            execl("/bin/sh", "sh", "-c", command.c_str(), static_cast<char*>(nullptr));
+            _exit(127);
+        }
+
+        close(fds[0]);
+        if (pid < 0)
+        {
+            close(fds[1]);
+            return false;
+        }
+        input = fds[1];
+        // Writes wait in poll(), so one into a pipe the encoder stopped reading can be given up
+        fcntl(input, F_SETFL, fcntl(input, F_GETFL) | O_NONBLOCK);
+        return true;
+    }
+
+    bool write(const uint8_t* p, size_t n, const std::atomic<bool>& abandon)
+    {
+        while (n)
+        {
+            ssize_t done = ::write(input, p, n);
+            if (done < 0 && errno == EINTR)
+                continue;
+            if (done < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            {
+                if (abandon)
+                    return false;
+                pollfd pfd{input, POLLOUT, 0};
+                poll(&pfd, 1, 50);
+                continue;
+            }
+            if (done <= 0)
+                return false;
+            p += done;
+            n -= static_cast<size_t>(done);
+        }
+        return true;
+    }
+
+    // The poll() in write() sees `abandon` within 50 ms
+    void cancel_write(std::thread&) {}
+
+    void close_input()
+    {
+        if (input >= 0)
+            close(input);
+        input = -1;
+    }
+
+    int wait(std::chrono::milliseconds timeout)
+    {
+        int status = 0;
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        pid_t r;
+        while ((r = waitpid(pid, &status, WNOHANG)) == 0 && std::chrono::steady_clock::now() < deadline)
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        if (r == 0)
+        {
+            kill(pid, SIGKILL);
+            waitpid(pid, &status, 0);
+            return -1;
+        }
+        return r == pid && WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+    }
+
+    int id() const { return static_cast<int>(pid); }
+};
+#endif
+
+std::chrono::nanoseconds VideoSink::Config::interval() const
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::duration<double>(1.0 / fps));
+}
+
+VideoSink::Config VideoSink::Config::from_env()
+{
+    Config c;
+
+    if (const char* v = std::getenv("CAPTURE_VIDEO_CMD"))
+        c.command = v;
+    if (const char* v = std::getenv("CAPTURE_VIDEO_FPS"))
+        c.fps = std::clamp(std::atof(v), 1.0, 240.0);
+    if (const char* v = std::getenv("CAPTURE_VIDEO_FORMAT"))
+        c.layout = std::string(v) == "i420" ? YuvLayout::I420 : YuvLayout::Nv12;
+    if (const char* v = std::getenv("CAPTURE_VIDEO_MATRIX"))
+        c.yuv.matrix = std::string(v) == "bt601" ? YuvMatrix::Bt601 : YuvMatrix::Bt709;
+    if (const char* v = std::getenv("CAPTURE_VIDEO_RANGE"))
+        c.yuv.range = std::string(v) == "full" ? YuvRange::Full : YuvRange::Limited;
+    if (const char* v = std::getenv("CAPTURE_VIDEO_CATCHUP_MS"))
+        c.maxCatchUp = std::chrono::milliseconds(std::clamp(std::atoi(v), 0, 10000));
+
+    return c;
+}
+
+VideoSink::VideoSink(Config cfg) : cfg_(std::move(cfg))
+{
+    cfg_.fps = std::clamp(cfg_.fps, 1.0, 240.0);
+    if (cfg_.enabled())
+        thread_ = std::thread([this] { run(); });
+    else
+        ended_ = true;
+}
+
+VideoSink::~VideoSink()
+{
+    stop();
+}
+
+bool VideoSink::submit(const uint8_t* bgra, int width, int height, size_t stride)
+{
+    if (ended_.load(std::memory_order_relaxed))
+        return false;
+
+    // Encoders take even sizes only
+    width &= ~1;
+    height &= ~1;
+    if (width <= 0 || height <= 0)
+        return false;
+
+    if (!width_)
+    {
+        std::lock_guard<std::mutex> lock(m_);
+        width_ = width;
+        height_ = height;
+        frameBytes_ = yuv_bytes(width, height, cfg_.layout);
+    }
+    else if (width != width_ || height != height_)
+    {
+        std::lock_guard<std::mutex> lock(m_);
+        ++counters_.mismatched;
+        return false;
+    }
+
+    spare_.resize(frameBytes_);
+    bgra_to_yuv(bgra, width, height, stride, cfg_.layout, spare_.data(), cfg_.yuv);
+
+    bool first;
+    {
+        std::lock_guard<std::mutex> lock(m_);
+        std::swap(spare_, newest_);
+        counters_.dropped += fresh_;
+        first = counters_.submitted++ == 0;
+        fresh_ = true;
+    }
+    if (first)
+        cv_.notify_one();
+    return true;
+}
+
+void VideoSink::stop()
+{
+    if (!thread_.joinable())
+        return;
+
+    {
+        std::unique_lock<std::mutex> lock(m_);
+        stop_ = true;
+        cv_.notify_one();
+
+        // A frame already going out may finish, so a healthy encoder gets whole frames. One that has stopped reading
+        // (a stalled push, a hung process) would keep the writer in write() forever: the write is abandoned instead.
+        if (!idle_.wait_for(lock, kWriteWait, [this] { return !writing_; }))
+        {
+            abandon_ = true;
+            while (!idle_.wait_for(lock, std::chrono::milliseconds(50), [this] { return !writing_; }))
+                process_->cancel_write(thread_);
+        }
+    }
+    thread_.join();
+    end_stream();
+}
+
+VideoSink::Counters VideoSink::counters() const
+{
+    std::lock_guard<std::mutex> lock(m_);
+    return counters_;
+}
+
+bool VideoSink::start_encoder()
+{
+    auto command = expand_command(cfg_.command, width_, height_, cfg_);
+    auto p = std::make_unique<Process>();
+
+    if (!p->start(command))
+    {
+        if (cfg_.log)
+            log_event<Ev::VideoSinkFailed>(command);
+        return false;
+    }
+
+    if (cfg_.log)
+        log_event<Ev::VideoSink>(width_, height_, cfg_.fps, pix_fmt(cfg_.layout), p->id());
+    process_ = std::move(p);
+    return true;
+}
+
+bool VideoSink::write_frame(const std::vector<uint8_t>& frame)
+{
+    return process_->write(frame.data(), frame.size(), abandon_);
+}
+
+void VideoSink::end_stream()
+{
+    ended_ = true;
+    if (!process_)
+        return;
+
+    process_->close_input();
+    // An encoder that stopped reading is not going to finish its output either
+    exitCode_ = process_->wait(abandon_ ? std::chrono::milliseconds(0) : kExitWait);
+    process_.reset();
+
+    if (cfg_.log)
+    {
+        Counters c = counters();
+        log_event<Ev::VideoSinkEnded>(c.written, c.duplicated, c.dropped, c.skipped, c.mismatched, exitCode_);
+    }
+}
+
+void VideoSink::run()
+{
+#ifndef _WIN32
+    // An encoder that exits closes the pipe: the write fails with EPIPE instead of the signal ending the process
+    sigset_t pipeSignal;
+    sigemptyset(&pipeSignal);
+    sigaddset(&pipeSignal, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &pipeSignal, nullptr);
+#endif
+
+    std::unique_lock<std::mutex> lock(m_);
+
+    // Nothing goes out before the first frame, which also fixes the size the encoder is started with
+    cv_.wait(lock, [this] { return stop_ || fresh_; });
+    if (stop_)
+        return;
+    lock.unlock();
+    bool started = start_encoder();
+    lock.lock();
+    if (!started)
+    {
+        ended_ = true;
+        return;
+    }
+
+    const auto interval = cfg_.interval();
+    auto tick = Clock::now();
+
+    while (!stop_)
+    {
+        if (fresh_)
+        {
+            std::swap(newest_, sending_);
+            fresh_ = false;
+        }
+        else
+        {
+            ++counters_.duplicated;
+        }
+
+        writing_ = true;
+        lock.unlock();
+        bool ok = write_frame(sending_);
+        lock.lock();
+        writing_ = false;
+        idle_.notify_all();
+
+        if (!ok)
+            break;
+        ++counters_.written;
+        counters_.bytes += sending_.size();
+
+        // Behind by more than the catch-up allowance: give up the ticks beyond it
+        tick += interval;
+        auto late = Clock::now() - cfg_.maxCatchUp - tick;
+        if (late > Clock::duration::zero())
+        {
+            auto lost = late / interval + 1;
+            counters_.skipped += static_cast<uint64_t>(lost);
+            tick += lost * interval;
+        }
+
+        cv_.wait_until(lock, tick, [this] { return stop_.load(); });
+    }
+
+    ended_ = true;
+
+#ifndef _WIN32
+    // Drop a SIGPIPE left pending by the failed write, so it is not delivered once unblocked
+    timespec zero{};
+    while (sigtimedwait(&pipeSignal, nullptr, &zero) > 0)
+    {
+    }
+#endif
+}
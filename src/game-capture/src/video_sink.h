@@ -0,0 +1,119 @@
+// Raw video out: captured frames converted to NV12 or I420 (yuv_convert.h) and written to the stdin of a local
+// encoder process, so a stream (or a recording) comes from the same readback as the saved frames instead of a second
+// capture in OBS.
+//
+// The encoder is any command that reads raw frames from stdin, started through the shell (cmd.exe on Windows) once
+// the first frame fixes the stream's size. {width}, {height}, {fps}, {pix_fmt} (nv12 or yuv420p), {colorspace} (bt709
+// or smpte170m) and {color_range} (tv or pc) in the command are replaced by the stream's values, e.g.
+//   ffmpeg -f rawvideo -pix_fmt {pix_fmt} -s {width}x{height} -r {fps} -i - -c:v libx264 -preset veryfast out.mkv
+// The stream keeps the first frame's size (odd dimensions are cropped by one pixel); frames of another size are
+// counted and not sent.
+//
+// Constant frame rate: the writer thread sends one frame every 1/fps s, the newest converted one. When capture
+// delivered nothing new since the last tick the previous frame goes out again (duplicated); when it delivered several,
+// all but the newest are replaced before they are sent (dropped). Ticks the writer misses because the encoder is slow
+// to read are made up with repeats, up to maxCatchUp behind; beyond that they are skipped and the stream runs short
+// of wall time.
+//
+// Capture never waits for the encoder. submit() converts into a buffer only it uses and swaps it with the newest
+// frame under a short lock; the writer swaps the newest frame with the one it sends. Three buffers, no queue: a
+// stalled encoder blocks only the writer thread. A write that fails (the encoder exited) ends the stream.
+#pragma once
+
+#include "yuv_convert.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class VideoSink
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Config
+    {
+        std::string command;                        // CAPTURE_VIDEO_CMD; empty leaves the sink off
+        double fps = 30;                            // CAPTURE_VIDEO_FPS (1-240)
+        YuvLayout layout = YuvLayout::Nv12;         // CAPTURE_VIDEO_FORMAT=nv12|i420
+        YuvOptions yuv;                             // CAPTURE_VIDEO_MATRIX=bt709|bt601,
+                                                    // CAPTURE_VIDEO_RANGE=limited|full
+        std::chrono::milliseconds maxCatchUp{500};  // CAPTURE_VIDEO_CATCHUP_MS
+        bool log = true;                            // emit capture log events (hots_video turns this off)
+
+        bool enabled() const { return !command.empty(); }
+        std::chrono::nanoseconds interval() const;
+
+        static Config from_env();
+    };
+
+    struct Counters
+    {
+        uint64_t submitted = 0;   // frames converted
+        uint64_t written = 0;     // frames sent to the encoder, repeats included
+        uint64_t duplicated = 0;  // ticks that repeated the previous frame
+        uint64_t dropped = 0;     // frames replaced by a newer one before their tick
+        uint64_t skipped = 0;     // ticks lost while the encoder was behind by more than maxCatchUp
+        uint64_t mismatched = 0;  // frames not of the stream's size
+        uint64_t bytes = 0;       // written to the encoder
+    };
+
+    explicit VideoSink(Config cfg);
+    ~VideoSink();
+
+    VideoSink(const VideoSink&) = delete;
+    VideoSink& operator=(const VideoSink&) = delete;
+
+    // Converts a frame whose rows are `stride` bytes apart and makes it the newest. Never waits for the encoder;
+    // call from one thread at a time. False if the frame was not taken (other size, or the stream has ended).
+    bool submit(const uint8_t* bgra, int width, int height, size_t stride);
+
+    // Closes the encoder's stdin, so it can finish its output, and waits for it to exit. Also run on destruction.
+    // Bounded even if the encoder stopped reading: a frame still not written after 2 s is abandoned and the encoder
+    // killed.
+    void stop();
+
+    // The stream has ended: the encoder could not be started or stopped reading
+    bool ended() const { return ended_.load(); }
+    // The encoder's exit code once stopped (-1 if it did not exit normally)
+    int exit_code() const { return exitCode_; }
+    Counters counters() const;
+    const Config& config() const { return cfg_; }
+
+private:
+    struct Process;
+
+    void run();
+    bool start_encoder();
+    bool write_frame(const std::vector<uint8_t>& frame);
+    void end_stream();
+
+    Config cfg_;
+    int width_ = 0;   // stream size, fixed by the first frame; 0 before it
+    int height_ = 0;
+    size_t frameBytes_ = 0;
+
+    // spare_ belongs to submit(), sending_ to the writer; newest_ changes hands under m_
+    std::vector<uint8_t> spare_;
+    std::vector<uint8_t> newest_;
+    std::vector<uint8_t> sending_;
+    bool fresh_ = false;  // newest_ holds a frame not yet swapped out for sending
+
+    mutable std::mutex m_;
+    std::condition_variable cv_;
+    std::condition_variable idle_;  // writing_ went false
+    bool writing_ = false;          // the writer is in write_frame(); process_ is set while it is
+    Counters counters_;
+    std::unique_ptr<Process> process_;
+    int exitCode_ = -1;
+    std::atomic<bool> ended_{false};
+    std::atomic<bool> stop_{false};
+    std::atomic<bool> abandon_{false};  // stop() gave up on the frame being written
+    std::thread thread_;
+};
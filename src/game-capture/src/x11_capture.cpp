@@ -0,0 +1,554 @@
+#include "x11_capture.h"
+
+#include "checksum.h"
+
+#include <X11/Xatom.h>
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/extensions/XShm.h>
+#include <X11/extensions/Xcomposite.h>
+#if HOTS_X11_DAMAGE
+#include <X11/extensions/Xdamage.h>
+#endif
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <poll.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+
+namespace
+{
+// The last X error, for the request that just went out. Xlib reports errors to one process-wide handler; its default
+// prints and exits, which a capture box cannot afford over a window closing under it.
+struct XErrorSeen
+{
+    unsigned char code = 0;
+    XID resource = 0;
+};
+XErrorSeen g_xerror;
+
+int record_x_error(Display*, XErrorEvent* e)
+{
+    g_xerror.code = e->error_code;
+    g_xerror.resource = e->resourceid;
+    return 0;
+}
+
+std::string lower(std::string s)
+{
+    for (auto& ch : s)
+        ch = static_cast<char>(std::tolower(static_cast<unsigned char>(ch)));
+    return s;
+}
+
+bool viewable(Display* dpy, Window w)
+{
+    XWindowAttributes a;
+    return XGetWindowAttributes(dpy, w, &a) && a.map_state == IsViewable;
+}
+
+bool window_pid(Display* dpy, Window w, unsigned long& pid)
+{
+    Atom type;
+    int format;
+    unsigned long count, after;
+    unsigned char* data = nullptr;
+    Atom netWmPid = XInternAtom(dpy, "_NET_WM_PID", True);
+
+    if (netWmPid == None || XGetWindowProperty(dpy, w, netWmPid, 0, 1, False, XA_CARDINAL, &type, &format, &count,
+                                               &after, &data) != Success)
+        return false;
+
+    bool ok = data && type == XA_CARDINAL && format == 32 && count == 1;
+    if (ok)
+        pid = *reinterpret_cast<unsigned long*>(data);  // format 32 properties come back as longs
+    if (data)
+        XFree(data);
+    return ok;
+}
+
+std::string window_title(Display* dpy, Window w)
+{
+    std::string title;
+    Atom type;
+    int format;
+    unsigned long count, after;
+    unsigned char* data = nullptr;
+    Atom netWmName = XInternAtom(dpy, "_NET_WM_NAME", True);
+    Atom utf8 = XInternAtom(dpy, "UTF8_STRING", True);
+
+    if (netWmName != None && utf8 != None &&
+        XGetWindowProperty(dpy, w, netWmName, 0, 1024, False, utf8, &type, &format, &count, &after, &data) == Success &&
+        data)
+    {
+        if (type == utf8 && format == 8)
+            title.assign(reinterpret_cast<const char*>(data), count);
+        XFree(data);
+    }
+
+    if (title.empty())
+    {
+        char* name = nullptr;
+        if (XFetchName(dpy, w, &name) && name)
+        {
+            title = name;
+            XFree(name);
+        }
+    }
+
+    return title;
+}
+
+// Depth-first over the window tree below `w`, children in stacking order
+template <typename Match>
+Window find_window(Display* dpy, Window w, const Match& match)
+{
+    if (w != DefaultRootWindow(dpy) && viewable(dpy, w) && match(w))
+        return w;
+
+    Window root, parent;
+    Window* children = nullptr;
+    unsigned int count = 0;
+
+    if (!XQueryTree(dpy, w, &root, &parent, &children, &count))
+        return 0;
+
+    Window found = 0;
+    for (unsigned int i = 0; i < count && !found; ++i)
+        found = find_window(dpy, children[i], match);
+
+    if (children)
+        XFree(children);
+    return found;
+}
+}  // namespace
+
+X11Window find_x11_window_by_pid(_XDisplay* dpy, unsigned long pid)
+{
+    if (!dpy)
+        return 0;
+
+    return find_window(dpy, DefaultRootWindow(dpy),
+                       [&](Window w)
+                       {
+                           unsigned long wpid = 0;
+                           return window_pid(dpy, w, wpid) && wpid == pid;
+                       });
+}
+
+X11Window find_x11_window_by_title_substring(_XDisplay* dpy, const std::string& needleLower)
+{
+    if (!dpy)
+        return 0;
+
+    return find_window(dpy, DefaultRootWindow(dpy),
+                       [&](Window w)
+                       {
+                           std::string t = window_title(dpy, w);
+                           return !t.empty() && lower(t).find(needleLower) != std::string::npos;
+                       });
+}
+
+struct X11WindowSource::ShmBuffer
+{
+    XImage* image = nullptr;
+    XShmSegmentInfo shm{};
+    bool attached = false;
+};
+
+X11WindowSource::Config X11WindowSource::Config::from_env()
+{
+    Config c;
+
+    if (const char* v = std::getenv("CAPTURE_X11_BUFFERS"))
+        c.buffers = std::clamp(std::atoi(v), 2, 8);
+
+    return c;
+}
+
+X11WindowSource::X11WindowSource(Config cfg, const char* display) : cfg_(cfg)
+{
+    cfg_.buffers = std::clamp(cfg_.buffers, 2, 8);
+    XSetErrorHandler(record_x_error);
+
+    dpy_ = XOpenDisplay(display);
+    if (!dpy_)
+        error_ = "cannot open display";
+}
+
+X11WindowSource::~X11WindowSource()
+{
+    close();
+    if (dpy_)
+        XCloseDisplay(dpy_);
+}
+
+bool X11WindowSource::open(X11Window window)
+{
+    if (!dpy_)
+        return false;
+
+    close();
+
+    int major = 0, minor = 0;
+    Bool pixmaps = False;
+    if (!XShmQueryVersion(dpy_, &major, &minor, &pixmaps))
+    {
+        error_ = "X server has no MIT-SHM";
+        return false;
+    }
+
+    int eventBase = 0, errorBase = 0;
+    major = 0;
+    minor = 2;
+    if (!XCompositeQueryExtension(dpy_, &eventBase, &errorBase) || !XCompositeQueryVersion(dpy_, &major, &minor) ||
+        (major == 0 && minor < 2))
+    {
+        error_ = "X server has no Composite 0.2";
+        return false;
+    }
+
+    XWindowAttributes a;
+    if (!XGetWindowAttributes(dpy_, window, &a))
+    {
+        error_ = "window not found";
+        return false;
+    }
+    if (a.c_class != InputOutput || (a.depth != 24 && a.depth != 32) || a.visual->c_class != TrueColor)
+    {
+        error_ = "window is not a 24/32-bit TrueColor window";
+        return false;
+    }
+
+    window_ = window;
+    visual_ = a.visual;
+    depth_ = a.depth;
+    width_ = a.width;
+    height_ = a.height;
+    border_ = a.border_width;
+    mapped_ = a.map_state == IsViewable;
+    lost_ = false;
+
+    // Automatic redirection leaves the window on screen as before (the server composites it), and is allowed
+    // alongside a compositing manager's manual redirection
+    XSelectInput(dpy_, window_, StructureNotifyMask);
+    XCompositeRedirectWindow(dpy_, window_, CompositeRedirectAutomatic);
+
+#if HOTS_X11_DAMAGE
+    int damageError = 0;
+    if (XDamageQueryExtension(dpy_, &damageEvent_, &damageError))
+        damage_ = XDamageCreate(dpy_, window_, XDamageReportNonEmpty);
+#endif
+
+    if (!allocate(width_, height_))
+    {
+        close();
+        return false;
+    }
+
+    renamed_ = mapped_;
+    if (mapped_ && !name_pixmap())
+    {
+        close();
+        return false;
+    }
+
+    dirty_ = true;
+    haveHash_ = false;
+    error_.clear();
+    return true;
+}
+
+void X11WindowSource::close()
+{
+    if (!dpy_ || !window_)
+        return;
+
+#if HOTS_X11_DAMAGE
+    if (damage_)
+        XDamageDestroy(dpy_, damage_);
+#endif
+    damage_ = 0;
+    damageEvent_ = -1;
+
+    if (pixmap_)
+        XFreePixmap(dpy_, pixmap_);
+    pixmap_ = 0;
+
+    release_buffers();
+
+    if (!lost_)
+    {
+        XCompositeUnredirectWindow(dpy_, window_, CompositeRedirectAutomatic);
+        XSelectInput(dpy_, window_, NoEventMask);
+    }
+    XSync(dpy_, False);
+    g_xerror = {};
+    window_ = 0;
+}
+
+bool X11WindowSource::name_pixmap()
+{
+    if (pixmap_)
+        XFreePixmap(dpy_, pixmap_);
+
+    // The pixmap only exists while the window is mapped, and is replaced when it is resized
+    g_xerror = {};
+    pixmap_ = XCompositeNameWindowPixmap(dpy_, window_);
+    XSync(dpy_, False);
+
+    if (g_xerror.code)
+    {
+        pixmap_ = 0;
+        error_ = "cannot name the window's pixmap";
+        return false;
+    }
+
+    renamed_ = false;
+    return true;
+}
+
+bool X11WindowSource::allocate(int width, int height)
+{
+    release_buffers();
+
+    for (int i = 0; i < cfg_.buffers; ++i)
+    {
+        auto b = std::make_unique<ShmBuffer>();
+        b->image = XShmCreateImage(dpy_, static_cast<Visual*>(visual_), depth_, ZPixmap, nullptr, &b->shm, width,
+                                   height);
+        if (!b->image)
+        {
+            error_ = "XShmCreateImage failed";
+            return false;
+        }
+        if (b->image->bits_per_pixel != 32 || b->image->byte_order != LSBFirst || b->image->red_mask != 0xff0000)
+        {
+            XDestroyImage(b->image);
+            error_ = "window pixels are not 32-bit BGRX";
+            return false;
+        }
+
+        size_t bytes = static_cast<size_t>(b->image->bytes_per_line) * height;
+        b->shm.shmid = shmget(IPC_PRIVATE, bytes, IPC_CREAT | 0600);
+        b->shm.shmaddr = b->shm.shmid >= 0 ? static_cast<char*>(shmat(b->shm.shmid, nullptr, 0)) : nullptr;
+        if (b->shm.shmaddr == reinterpret_cast<char*>(-1))
+            b->shm.shmaddr = nullptr;
+        b->image->data = b->shm.shmaddr;
+        b->shm.readOnly = False;
+
+        if (b->shm.shmaddr)
+        {
+            g_xerror = {};
+            b->attached = XShmAttach(dpy_, &b->shm);
+            XSync(dpy_, False);
+            b->attached = b->attached && !g_xerror.code;
+        }
+        // Marked for removal now that both sides have it mapped, so a crash cannot leak the segment
+        if (b->shm.shmid >= 0)
+            shmctl(b->shm.shmid, IPC_RMID, nullptr);
+
+        bool ok = b->attached;
+        buffers_.push_back(std::move(b));
+        if (!ok)
+        {
+            error_ = "cannot share memory with the X server (remote display?)";
+            return false;
+        }
+    }
+
+    width_ = width;
+    height_ = height;
+    next_ = 0;
+    return true;
+}
+
+void X11WindowSource::release_buffers()
+{
+    for (auto& b : buffers_)
+    {
+        if (b->attached)
+            XShmDetach(dpy_, &b->shm);
+        if (b->image)
+        {
+            b->image->data = nullptr;  // shared memory, not Xlib's to free
+            XDestroyImage(b->image);
+        }
+        if (b->shm.shmaddr)
+            shmdt(b->shm.shmaddr);
+    }
+    if (!buffers_.empty())
+        XSync(dpy_, False);
+    buffers_.clear();
+}
+
+void X11WindowSource::drain_events()
+{
+    while (XPending(dpy_))
+    {
+        XEvent ev;
+        XNextEvent(dpy_, &ev);
+
+#if HOTS_X11_DAMAGE
+        if (damage_ && ev.type == damageEvent_ + XDamageNotify)
+        {
+            dirty_ = true;
+            continue;
+        }
+#endif
+        if (ev.xany.window != window_)
+            continue;
+
+        switch (ev.type)
+        {
+        case ConfigureNotify:
+            if (ev.xconfigure.width != width_ || ev.xconfigure.height != height_ ||
+                ev.xconfigure.border_width != border_)
+            {
+                border_ = ev.xconfigure.border_width;
+                pendingWidth_ = ev.xconfigure.width;
+                pendingHeight_ = ev.xconfigure.height;
+                renamed_ = true;
+                dirty_ = true;
+            }
+            break;
+        case MapNotify:
+            mapped_ = true;
+            renamed_ = true;
+            dirty_ = true;
+            break;
+        case UnmapNotify:
+            mapped_ = false;
+            break;
+        case DestroyNotify:
+            lost_ = true;
+            break;
+        default:
+            break;
+        }
+    }
+
+    if (g_xerror.code == BadWindow && g_xerror.resource == window_)
+        lost_ = true;
+}
+
+FrameSource::Grab X11WindowSource::grab(Frame& out)
+{
+    if (!dpy_ || !window_)
+        return Grab::Lost;
+
+    ++stats_.grabs;
+    drain_events();
+    if (lost_)
+        return Grab::Lost;
+
+    if (!mapped_)
+    {
+        ++stats_.unchanged;
+        return Grab::Unchanged;
+    }
+
+    if (renamed_)
+    {
+        if (pendingWidth_ && (pendingWidth_ != width_ || pendingHeight_ != height_))
+        {
+            if (!allocate(pendingWidth_, pendingHeight_))
+            {
+                lost_ = true;
+                return Grab::Lost;
+            }
+            ++stats_.resizes;
+            haveHash_ = false;
+        }
+        pendingWidth_ = pendingHeight_ = 0;
+
+        if (!name_pixmap())
+        {
+            drain_events();
+            if (lost_)
+                return Grab::Lost;
+            ++stats_.unchanged;
+            return Grab::Unchanged;
+        }
+    }
+
+    if (damage_)
+    {
+        if (!dirty_)
+        {
+            ++stats_.unchanged;
+            return Grab::Unchanged;
+        }
+#if HOTS_X11_DAMAGE
+        // Cleared before the read, so drawing that lands during it is reported again
+        XDamageSubtract(dpy_, damage_, None, None);
+#endif
+        dirty_ = false;
+    }
+
+    ShmBuffer& b = *buffers_[next_];
+    g_xerror = {};
+    if (!XShmGetImage(dpy_, pixmap_, b.image, border_, border_, AllPlanes))
+    {
+        // Resized or unmapped between the last events and the read; the events explain which
+        drain_events();
+        if (lost_)
+            return Grab::Lost;
+        renamed_ = true;
+        dirty_ = true;
+        ++stats_.unchanged;
+        return Grab::Unchanged;
+    }
+
+    const uint8_t* pixels = reinterpret_cast<const uint8_t*>(b.image->data);
+    size_t stride = static_cast<size_t>(b.image->bytes_per_line);
+
+    if (!damage_)
+    {
+        Hash128 h = hash128(pixels, stride * height_);
+        if (haveHash_ && h == lastHash_)
+        {
+            ++stats_.unchanged;
+            return Grab::Unchanged;
+        }
+        lastHash_ = h;
+        haveHash_ = true;
+    }
+
+    out.bgra = pixels;
+    out.width = width_;
+    out.height = height_;
+    out.stride = stride;
+    out.serial = ++serial_;
+    out.at = Clock::now();
+
+    next_ = (next_ + 1) % buffers_.size();
+    ++stats_.frames;
+    return Grab::Frame;
+}
+
+bool X11WindowSource::wait(std::chrono::milliseconds timeout)
+{
+    if (!dpy_ || !window_)
+        return true;
+
+    auto deadline = Clock::now() + timeout;
+
+    for (;;)
+    {
+        drain_events();
+        if (lost_ || renamed_ || (mapped_ && dirty_ && damage_))
+            return true;
+
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now());
+        if (left.count() <= 0)
+            return !damage_;  // without damage tracking any moment may have brought a change
+
+        XFlush(dpy_);
+        pollfd p{ConnectionNumber(dpy_), POLLIN, 0};
+        poll(&p, 1, static_cast<int>(left.count()));
+    }
+}
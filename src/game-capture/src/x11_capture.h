@@ -0,0 +1,112 @@
+// X11 window capture (a FrameSource) for the game running under Wine/Proton on Linux capture boxes.
+//
+// XComposite redirects the window so the server keeps its contents in an offscreen pixmap, whole even while other
+// windows cover it. MIT-SHM copies that pixmap straight into shared memory segments, and those segments are the frame
+// buffers handed out: the server writes each frame once and the client never copies it. Segments rotate, so a frame
+// stays readable while the following ones are captured (the save loop's sharpness gate holds one back).
+//
+// With XDamage (when the build found libXdamage) the server reports every drawing operation, and a grab with nothing
+// drawn since the previous frame returns Unchanged without touching the pixels; wait() wakes on damage. Without it
+// every grab reads the window and a content hash decides whether it changed.
+//
+// Pixels: the window must be a 24- or 32-bit TrueColor window stored at 32 bits per pixel, least significant byte
+// first, red in 0xff0000 (what X servers on x86 use), so each pixel is B, G, R, X in memory. The fourth byte is
+// alpha only for 32-bit windows; treat it as undefined.
+//
+// X errors are recorded by a process-wide handler that X11WindowSource installs, instead of Xlib's default one
+// exiting the process; a destroyed window makes grab() return Lost.
+#pragma once
+
+#include "checksum.h"
+#include "frame_source.h"
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct _XDisplay;
+using X11Window = unsigned long;
+
+// Mirror find_main_hwnd / find_window_by_title_substring on Windows: the first viewable window whose _NET_WM_PID is
+// `pid`, or whose title (_NET_WM_NAME, else WM_NAME) contains `needleLower` ignoring ASCII case. Client windows are
+// found below window manager frames too. 0 if none.
+X11Window find_x11_window_by_pid(_XDisplay* dpy, unsigned long pid);
+X11Window find_x11_window_by_title_substring(_XDisplay* dpy, const std::string& needleLower);
+
+class X11WindowSource final : public FrameSource
+{
+public:
+    struct Config
+    {
+        int buffers = 2;  // shared memory frames in rotation (2-8); CAPTURE_X11_BUFFERS
+
+        static Config from_env();
+    };
+
+    struct Stats
+    {
+        uint64_t grabs = 0;
+        uint64_t frames = 0;
+        uint64_t unchanged = 0;  // grabs answered without reading the window (damage) or found identical (hash)
+        uint64_t resizes = 0;    // shared memory frames reallocated for a new window size
+    };
+
+    // Connects to `display` (nullptr: $DISPLAY); open() then picks the window.
+    explicit X11WindowSource(Config cfg, const char* display = nullptr);
+    ~X11WindowSource() override;
+
+    X11WindowSource(const X11WindowSource&) = delete;
+    X11WindowSource& operator=(const X11WindowSource&) = delete;
+
+    // Starts capturing `window`. False, with the reason in error(), if there is no display, the server lacks
+    // Composite or MIT-SHM, or the window is gone or in a pixel format other than the one above.
+    bool open(X11Window window);
+
+    // A Frame's pixels stay valid until `buffers` - 1 further Frames have been returned, or the window is resized.
+    Grab grab(Frame& out) override;
+    bool wait(std::chrono::milliseconds timeout) override;
+
+    // The connection, for the window searches above; null if it could not be opened.
+    _XDisplay* display() const { return dpy_; }
+    X11Window window() const { return window_; }
+    // Drawing is tracked by XDamage (otherwise unchanged frames are found by hashing)
+    bool damage_tracked() const { return damage_ != 0; }
+    const std::string& error() const { return error_; }
+    const Stats& stats() const { return stats_; }
+
+private:
+    struct ShmBuffer;
+
+    void close();
+    bool name_pixmap();
+    bool allocate(int width, int height);
+    void release_buffers();
+    void drain_events();
+
+    Config cfg_;
+    _XDisplay* dpy_ = nullptr;
+    X11Window window_ = 0;
+    unsigned long pixmap_ = 0;
+    unsigned long damage_ = 0;
+    int damageEvent_ = -1;
+    void* visual_ = nullptr;
+    int depth_ = 0;
+    int width_ = 0;
+    int height_ = 0;
+    int border_ = 0;         // the named pixmap includes the window border
+    int pendingWidth_ = 0;   // size from the last ConfigureNotify, applied at the next grab
+    int pendingHeight_ = 0;
+    bool dirty_ = true;      // drawn since the last frame (only tracked with XDamage)
+    bool lost_ = false;
+    bool mapped_ = true;
+    bool renamed_ = false;   // size or mapping changed: name the window's pixmap again before the next grab
+    std::vector<std::unique_ptr<ShmBuffer>> buffers_;
+    size_t next_ = 0;
+    uint64_t serial_ = 0;
+    Hash128 lastHash_;       // of the last frame, when unchanged frames are found by hashing
+    bool haveHash_ = false;
+    std::string error_;
+    Stats stats_;
+};
@@ -0,0 +1,189 @@
+// hots_x11_testclient: a stand-in game window for exercising X11 capture (x11_capture.h) headless under Xvfb. It
+// draws full frames like a game would, stamps each with its frame number, and goes still now and then so damage
+// tracking has something to skip.
+//
+//   hots_x11_testclient [--size WxH] [--fps F] [--frames N] [--still-every K] [--still-ms M] [--resize-at K]
+//                       [--title T]
+//
+// The window is titled "Heroes of the Storm (x11 test client)" by default and carries _NET_WM_PID, so both window
+// searches find it. Frame n has n in its first four pixels, one byte each (least significant first) as grey, which
+// hots_x11cap --marker reads back. Every K frames (default 60) drawing stops for M ms (default 500); --resize-at
+// halves the window at frame K. Draws F frames a second (default 30) until N have been drawn (default 0: forever),
+// printing the window id first.
+#include <X11/Xatom.h>
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+static int usage()
+{
+    fprintf(stderr, "usage: hots_x11_testclient [--size WxH] [--fps F] [--frames N] [--still-every K] [--still-ms M] "
+                    "[--resize-at K] [--title T]\n");
+    return 2;
+}
+
+// A scrolling gradient with a bouncing block: every pixel changes every frame, as in a game
+static void draw(std::vector<uint32_t>& px, int w, int h, uint32_t n)
+{
+    int bx = static_cast<int>(n * 7 % static_cast<uint32_t>(w > 64 ? w - 64 : 1));
+    int by = static_cast<int>(n * 5 % static_cast<uint32_t>(h > 64 ? h - 64 : 1));
+
+    for (int y = 0; y < h; ++y)
+    {
+        uint32_t* row = px.data() + static_cast<size_t>(y) * w;
+        for (int x = 0; x < w; ++x)
+        {
+            uint32_t r = (x + n * 3) & 0xff, g = (y + n) & 0xff, b = (x + y) & 0xff;
+            if (x >= bx && x < bx + 64 && y >= by && y < by + 64)
+                r = g = b = 0xff;
+            row[x] = (r << 16) | (g << 8) | b;
+        }
+    }
+
+    for (int i = 0; i < 4 && i < w; ++i)
+    {
+        uint32_t v = (n >> (8 * i)) & 0xff;
+        px[i] = (v << 16) | (v << 8) | v;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    int width = 640, height = 360, stillEvery = 60, stillMs = 500;
+    double fps = 30;
+    long frames = 0, resizeAt = 0;
+    std::string title = "Heroes of the Storm (x11 test client)";
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string a = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (a == "--size" && hasValue)
+        {
+            if (sscanf(argv[++i], "%dx%d", &width, &height) != 2)
+                return usage();
+        }
+        else if (a == "--fps" && hasValue)
+            fps = std::atof(argv[++i]);
+        else if (a == "--frames" && hasValue)
+            frames = std::atol(argv[++i]);
+        else if (a == "--still-every" && hasValue)
+            stillEvery = std::atoi(argv[++i]);
+        else if (a == "--still-ms" && hasValue)
+            stillMs = std::atoi(argv[++i]);
+        else if (a == "--resize-at" && hasValue)
+            resizeAt = std::atol(argv[++i]);
+        else if (a == "--title" && hasValue)
+            title = argv[++i];
+        else
+            return usage();
+    }
+
+    if (width < 4 || height < 1 || fps <= 0)
+        return usage();
+
+    Display* dpy = XOpenDisplay(nullptr);
+    if (!dpy)
+    {
+        fprintf(stderr, "cannot open display\n");
+        return 1;
+    }
+
+    int screen = DefaultScreen(dpy);
+    XVisualInfo vi;
+    if (!XMatchVisualInfo(dpy, screen, 24, TrueColor, &vi))
+    {
+        fprintf(stderr, "no 24-bit TrueColor visual\n");
+        return 1;
+    }
+
+    XSetWindowAttributes swa{};
+    swa.colormap = XCreateColormap(dpy, RootWindow(dpy, screen), vi.visual, AllocNone);
+    swa.background_pixel = 0;
+    Window win = XCreateWindow(dpy, RootWindow(dpy, screen), 0, 0, width, height, 0, vi.depth, InputOutput, vi.visual,
+                               CWColormap | CWBackPixel, &swa);
+
+    XStoreName(dpy, win, title.c_str());
+    XChangeProperty(dpy, win, XInternAtom(dpy, "_NET_WM_NAME", False), XInternAtom(dpy, "UTF8_STRING", False), 8,
+                    PropModeReplace, reinterpret_cast<const unsigned char*>(title.data()),
+                    static_cast<int>(title.size()));
+    long pid = static_cast<long>(getpid());
+    XChangeProperty(dpy, win, XInternAtom(dpy, "_NET_WM_PID", False), XA_CARDINAL, 32, PropModeReplace,
+                    reinterpret_cast<const unsigned char*>(&pid), 1);
+
+    XSelectInput(dpy, win, StructureNotifyMask);
+    XMapWindow(dpy, win);
+    for (XEvent ev;;)
+    {
+        XNextEvent(dpy, &ev);
+        if (ev.type == MapNotify)
+            break;
+    }
+
+    printf("window 0x%lx pid %ld\n", win, pid);
+    fflush(stdout);
+
+    GC gc = XCreateGC(dpy, win, 0, nullptr);
+    std::vector<uint32_t> px;
+    XImage* img = nullptr;
+    auto make_image = [&]
+    {
+        if (img)
+        {
+            img->data = nullptr;
+            XDestroyImage(img);
+        }
+        px.assign(static_cast<size_t>(width) * height, 0);
+        img = XCreateImage(dpy, vi.visual, vi.depth, ZPixmap, 0, reinterpret_cast<char*>(px.data()), width, height,
+                           32, width * 4);
+    };
+    make_image();
+
+    const auto period =
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / fps));
+    auto next = std::chrono::steady_clock::now();
+
+    for (uint32_t n = 1; frames <= 0 || n <= static_cast<uint32_t>(frames); ++n)
+    {
+        if (resizeAt > 0 && n == static_cast<uint32_t>(resizeAt))
+        {
+            width = std::max(width / 2, 4);
+            height = std::max(height / 2, 1);
+            XResizeWindow(dpy, win, width, height);
+            make_image();
+        }
+
+        draw(px, width, height, n);
+        XPutImage(dpy, win, gc, img, 0, 0, 0, 0, width, height);
+        XSync(dpy, False);
+
+        while (XPending(dpy))
+        {
+            XEvent ev;
+            XNextEvent(dpy, &ev);
+        }
+
+        next += period;
+        if (stillEvery > 0 && n % static_cast<uint32_t>(stillEvery) == 0)
+            next += std::chrono::milliseconds(stillMs);
+        std::this_thread::sleep_until(next);
+    }
+
+    img->data = nullptr;
+    XDestroyImage(img);
+    XFreeGC(dpy, gc);
+    XDestroyWindow(dpy, win);
+    XCloseDisplay(dpy);
+    return 0;
+}
@@ -0,0 +1,193 @@
+// hots_x11cap: captures one X11 window through X11WindowSource (x11_capture.h) and reports what the capture loop
+// would see: grabs, new frames, grabs skipped as unchanged, reallocations for resizes, and the time a grab takes.
+//
+//   hots_x11cap [--pid P | --title T | --window ID] [--frames N] [--seconds S] [--interval-ms M] [--out DIR]
+//               [--marker]
+//
+// The window defaults to the first whose title contains "heroes of the storm". Grabs run every M ms (default 100);
+// M = 0 grabs whenever the source reports the window may have changed. Stops after N frames or S seconds (default
+// 10), or when the window goes away. --out writes the frames as JPEGs. --marker reads the frame number
+// hots_x11_testclient stamps into each frame and also reports frames returned twice, numbers going backwards, and
+// frames whose pixels changed while still within the source's buffer rotation. Exits 1 if no frame was captured, or
+// on either of the last two.
+#include "jpeg_encoder.h"
+#include "x11_capture.h"
+
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+static int usage()
+{
+    fprintf(stderr, "usage: hots_x11cap [--pid P | --title T | --window ID] [--frames N] [--seconds S] "
+                    "[--interval-ms M] [--out DIR] [--marker]\n");
+    return 2;
+}
+
+// The frame number hots_x11_testclient writes into the first four pixels (one byte each, as grey)
+static uint32_t read_marker(const FrameSource::Frame& f)
+{
+    uint32_t n = 0;
+    for (int i = 0; i < 4 && i < f.width; ++i)
+        n |= static_cast<uint32_t>(f.bgra[i * 4]) << (8 * i);
+    return n;
+}
+
+int main(int argc, char** argv)
+{
+    unsigned long pid = 0;
+    X11Window window = 0;
+    std::string title = "heroes of the storm";
+    long maxFrames = 0;
+    double seconds = 10;
+    int intervalMs = 100;
+    bool marker = false;
+    fs::path outDir;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string a = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (a == "--pid" && hasValue)
+            pid = std::strtoul(argv[++i], nullptr, 10);
+        else if (a == "--title" && hasValue)
+        {
+            title = argv[++i];
+            for (auto& ch : title)
+                ch = static_cast<char>(std::tolower(static_cast<unsigned char>(ch)));
+        }
+        else if (a == "--window" && hasValue)
+            window = std::strtoul(argv[++i], nullptr, 0);
+        else if (a == "--frames" && hasValue)
+            maxFrames = std::atol(argv[++i]);
+        else if (a == "--seconds" && hasValue)
+            seconds = std::atof(argv[++i]);
+        else if (a == "--interval-ms" && hasValue)
+            intervalMs = std::atoi(argv[++i]);
+        else if (a == "--out" && hasValue)
+            outDir = argv[++i];
+        else if (a == "--marker")
+            marker = true;
+        else
+            return usage();
+    }
+
+    if (intervalMs < 0 || seconds <= 0)
+        return usage();
+
+    auto cfg = X11WindowSource::Config::from_env();
+    X11WindowSource src(cfg);
+    if (!src.display())
+    {
+        fprintf(stderr, "%s\n", src.error().c_str());
+        return 1;
+    }
+
+    if (!window)
+        window = pid ? find_x11_window_by_pid(src.display(), pid)
+                     : find_x11_window_by_title_substring(src.display(), title);
+    if (!window)
+    {
+        fprintf(stderr, "window not found\n");
+        return 1;
+    }
+    if (!src.open(window))
+    {
+        fprintf(stderr, "cannot capture window 0x%lx: %s\n", window, src.error().c_str());
+        return 1;
+    }
+    printf("window 0x%lx  %d buffers  unchanged frames found by %s\n", window, cfg.buffers,
+           src.damage_tracked() ? "XDamage" : "hashing");
+
+    if (!outDir.empty())
+        fs::create_directories(outDir);
+
+    using Clock = FrameSource::Clock;
+    const auto interval = std::chrono::milliseconds(intervalMs);
+    const auto end = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+    auto next = Clock::now();
+
+    double grabMs = 0;
+    bool lost = false;
+    std::vector<uint8_t> jpeg;
+    // Frames still inside the buffer rotation, with the marker each had when returned
+    std::vector<std::pair<FrameSource::Frame, uint32_t>> held;
+    uint32_t lastMarker = 0;
+    size_t repeats = 0, backwards = 0, overwritten = 0, skipped = 0;
+
+    while ((maxFrames <= 0 || static_cast<long>(src.stats().frames) < maxFrames) && Clock::now() < end)
+    {
+        if (intervalMs)
+        {
+            std::this_thread::sleep_until(next);
+            next += interval;
+        }
+        else if (!src.wait(std::chrono::duration_cast<std::chrono::milliseconds>(end - Clock::now())))
+            continue;
+
+        FrameSource::Frame f;
+        auto t0 = Clock::now();
+        auto r = src.grab(f);
+        grabMs += std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+
+        if (r == FrameSource::Grab::Lost)
+        {
+            lost = true;
+            break;
+        }
+        if (r != FrameSource::Grab::Frame)
+            continue;
+
+        if (marker)
+        {
+            // A resize reallocates the buffers, so earlier frames are no longer held
+            if (!held.empty() && (held.back().first.width != f.width || held.back().first.height != f.height))
+                held.clear();
+            for (const auto& [h, m] : held)
+                overwritten += read_marker(h) != m;
+
+            uint32_t m = read_marker(f);
+            if (src.stats().frames > 1)
+            {
+                repeats += m == lastMarker;
+                backwards += m < lastMarker;
+                skipped += m > lastMarker + 1 ? m - lastMarker - 1 : 0;
+            }
+            lastMarker = m;
+
+            held.emplace_back(f, m);
+            if (held.size() >= static_cast<size_t>(cfg.buffers))
+                held.erase(held.begin());
+        }
+
+        if (!outDir.empty() && encode_jpeg(f.bgra, f.width, f.height, f.stride, 85, jpeg))
+        {
+            char name[64];
+            snprintf(name, sizeof(name), "frame_%06llu.jpg", static_cast<unsigned long long>(f.serial));
+            if (FILE* out = fopen((outDir / name).string().c_str(), "wb"))
+            {
+                fwrite(jpeg.data(), 1, jpeg.size(), out);
+                fclose(out);
+            }
+        }
+    }
+
+    const auto& s = src.stats();
+    printf("grabs %llu  frames %llu  unchanged %llu  resizes %llu  %.3f ms/grab%s\n",
+           static_cast<unsigned long long>(s.grabs), static_cast<unsigned long long>(s.frames),
+           static_cast<unsigned long long>(s.unchanged), static_cast<unsigned long long>(s.resizes),
+           s.grabs ? grabMs / static_cast<double>(s.grabs) : 0.0, lost ? "  (window lost)" : "");
+    if (marker)
+        printf("marker: last %u  repeated %zu  skipped %zu  backwards %zu  overwritten while held %zu\n", lastMarker,
+               repeats, skipped, backwards, overwritten);
+
+    return !s.frames || (marker && (backwards || overwritten)) ? 1 : 0;
+}
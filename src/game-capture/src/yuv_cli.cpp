@@ -0,0 +1,450 @@
+// hots_yuv: checks the BGRA -> YUV kernels (yuv_convert.h) against a floating-point reference and measures their
+// throughput.
+//
+//   hots_yuv [--size WxH] [--seconds S] [--band ROWS] [--pages small,transparent,large] [--no-bench]
+//            <dir|file.bmp>...
+//
+// Accuracy: every kernel this CPU runs, for both matrices, both ranges and all three layouts, on the given frames (a
+// generated WxH one if none) and on random images of odd and tiny sizes with padded source and plane pitches,
+// converted in random bands. Each sample is compared with the real-valued formula on the same pixels rounded to a
+// level (more than one level off fails) and with the scalar kernel (any difference fails); plane padding must be left
+// untouched.
+// Speed: each kernel and layout converting the first frame for S seconds (default 1), whole and in bands of ROWS rows
+// (default 16), as GB/s of BGRA read and ms per frame. The frame and its planes are page_buffer.h buffers, and the
+// speed runs are repeated for each page kind --pages lists (default: CAPTURE_LARGE_PAGES), each printing the kind it
+// got. Exits 1 if any check fails.
+#include "bmp_reader.h"
+#include "page_buffer.h"
+#include "yuv_convert.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+constexpr uint8_t kGuard = 0xA5;  // plane padding, which no conversion may write
+
+struct Image
+{
+    int width = 0;
+    int height = 0;
+    size_t stride = 0;
+    std::vector<uint8_t> bgra;
+
+    const uint8_t* px(int x, int y) const { return bgra.data() + static_cast<size_t>(y) * stride + x * 4; }
+};
+
+// Planes with their own pitches (padding filled with kGuard) in one buffer
+struct Planes
+{
+    std::vector<uint8_t> buf;
+    YuvPlanes p;
+    int chromaWidth = 0;
+    int chromaHeight = 0;
+    YuvLayout layout = YuvLayout::Nv12;
+
+    Planes(int width, int height, YuvLayout l, size_t pad) : layout(l)
+    {
+        chromaWidth = (width + 1) / 2;
+        chromaHeight = (height + 1) / 2;
+        p.yPitch = width + pad;
+        size_t ySize = p.yPitch * height;
+        size_t uSize = 0, vSize = 0;
+        if (layout == YuvLayout::Nv12)
+        {
+            p.uPitch = chromaWidth * 2 + pad;
+            uSize = p.uPitch * chromaHeight;
+        }
+        else if (layout == YuvLayout::I420)
+        {
+            p.uPitch = p.vPitch = chromaWidth + pad;
+            uSize = vSize = p.uPitch * chromaHeight;
+        }
+        buf.assign(ySize + uSize + vSize, kGuard);
+        p.y = buf.data();
+        p.u = uSize ? buf.data() + ySize : nullptr;
+        p.v = vSize ? buf.data() + ySize + uSize : nullptr;
+    }
+
+    uint8_t y(int x, int row) const { return p.y[row * p.yPitch + x]; }
+    uint8_t u(int x, int row) const
+    {
+        return layout == YuvLayout::Nv12 ? p.u[row * p.uPitch + 2 * x] : p.u[row * p.uPitch + x];
+    }
+    uint8_t v(int x, int row) const
+    {
+        return layout == YuvLayout::Nv12 ? p.u[row * p.uPitch + 2 * x + 1] : p.v[row * p.vPitch + x];
+    }
+
+    // Bytes past each row's samples still hold kGuard
+    bool guards_intact(int width, int height) const
+    {
+        auto rowsOk = [](const uint8_t* plane, size_t pitch, size_t used, int rows)
+        {
+            for (int r = 0; r < rows; ++r)
+                for (size_t i = used; i < pitch; ++i)
+                    if (plane[r * pitch + i] != kGuard)
+                        return false;
+            return true;
+        };
+        bool ok = rowsOk(p.y, p.yPitch, width, height);
+        if (layout == YuvLayout::Nv12)
+            ok = ok && rowsOk(p.u, p.uPitch, chromaWidth * 2, chromaHeight);
+        else if (layout == YuvLayout::I420)
+            ok = ok && rowsOk(p.u, p.uPitch, chromaWidth, chromaHeight) &&
+                 rowsOk(p.v, p.vPitch, chromaWidth, chromaHeight);
+        return ok;
+    }
+};
+
+struct Error
+{
+    int max = 0;
+    uint64_t samples = 0;
+    uint64_t off = 0;  // samples not equal to the rounded reference
+    uint64_t sum = 0;
+
+    void add(int got, double want)
+    {
+        int e = std::abs(got - static_cast<int>(std::lround(std::clamp(want, 0.0, 255.0))));
+        max = std::max(max, e);
+        sum += e;
+        off += e != 0;
+        ++samples;
+    }
+};
+
+// The real-valued formula the integer kernels approximate
+void reference(const Image& img, const Planes& out, const YuvOptions& opt, Error& err)
+{
+    const double kr = opt.matrix == YuvMatrix::Bt709 ? 0.2126 : 0.299;
+    const double kb = opt.matrix == YuvMatrix::Bt709 ? 0.0722 : 0.114;
+    const double kg = 1.0 - kr - kb;
+    const bool full = opt.range == YuvRange::Full;
+    const double ys = full ? 1.0 : 219.0 / 255.0, yo = full ? 0.0 : 16.0;
+    const double cs = full ? 1.0 : 224.0 / 255.0;
+
+    for (int y = 0; y < img.height; ++y)
+        for (int x = 0; x < img.width; ++x)
+        {
+            const uint8_t* p = img.px(x, y);
+            err.add(out.y(x, y), yo + ys * (kb * p[0] + kg * p[1] + kr * p[2]));
+        }
+
+    if (out.layout == YuvLayout::Y)
+        return;
+
+    for (int cy = 0; cy < out.chromaHeight; ++cy)
+        for (int cx = 0; cx < out.chromaWidth; ++cx)
+        {
+            // Block average, an odd last row or column pairing with itself
+            double b = 0, g = 0, r = 0;
+            for (int dy = 0; dy < 2; ++dy)
+                for (int dx = 0; dx < 2; ++dx)
+                {
+                    const uint8_t* p =
+                        img.px(std::min(cx * 2 + dx, img.width - 1), std::min(cy * 2 + dy, img.height - 1));
+                    b += p[0] / 4.0;
+                    g += p[1] / 4.0;
+                    r += p[2] / 4.0;
+                }
+            double luma = kb * b + kg * g + kr * r;
+            err.add(out.u(cx, cy), 128.0 + cs * (b - luma) / (2.0 * (1.0 - kb)));
+            err.add(out.v(cx, cy), 128.0 + cs * (r - luma) / (2.0 * (1.0 - kr)));
+        }
+}
+
+bool same_samples(const Planes& a, const Planes& b, int width, int height)
+{
+    for (int y = 0; y < height; ++y)
+        for (int x = 0; x < width; ++x)
+            if (a.y(x, y) != b.y(x, y))
+                return false;
+    if (a.layout == YuvLayout::Y)
+        return true;
+    for (int y = 0; y < a.chromaHeight; ++y)
+        for (int x = 0; x < a.chromaWidth; ++x)
+            if (a.u(x, y) != b.u(x, y) || a.v(x, y) != b.v(x, y))
+                return false;
+    return true;
+}
+
+// Converts in random bands; the 4:2:0 layouts cut at even rows
+void convert_banded(const Image& img, YuvLayout layout, const YuvPlanes& planes, const YuvOptions& opt,
+                    std::mt19937& rng)
+{
+    for (int y = 0; y < img.height;)
+    {
+        int rows = std::uniform_int_distribution<int>(1, 9)(rng);
+        if (layout != YuvLayout::Y)
+            rows += rows & 1;
+        int end = std::min(img.height, y + rows);
+        bgra_to_yuv_rows(img.bgra.data(), img.stride, img.width, y, end, layout, planes, opt);
+        y = end;
+    }
+}
+
+Image random_image(int width, int height, size_t pad, std::mt19937& rng)
+{
+    Image img{width, height, static_cast<size_t>(width) * 4 + pad, {}};
+    img.bgra.resize(img.stride * height);
+    std::uniform_int_distribution<int> byte(0, 255), pick(0, 9);
+    // Extremes (0 and 255) a fifth of the time, where clamping and saturation matter
+    for (auto& b : img.bgra)
+    {
+        int k = pick(rng);
+        b = static_cast<uint8_t>(k == 0 ? 0 : k == 1 ? 255 : byte(rng));
+    }
+    return img;
+}
+
+// A frame-like image: smooth gradients with hard-edged blocks of colour
+Image generated_frame(int width, int height)
+{
+    Image img{width, height, static_cast<size_t>(width) * 4, {}};
+    img.bgra.resize(img.stride * height);
+    for (int y = 0; y < height; ++y)
+        for (int x = 0; x < width; ++x)
+        {
+            uint8_t* p = img.bgra.data() + img.stride * y + x * 4;
+            bool block = ((x / 64) + (y / 48)) % 5 == 0;
+            p[0] = static_cast<uint8_t>(block ? 230 : x * 255 / width);
+            p[1] = static_cast<uint8_t>(block ? 40 : y * 255 / height);
+            p[2] = static_cast<uint8_t>(block ? 20 : (x + y) & 255);
+            p[3] = 255;
+        }
+    return img;
+}
+
+const YuvLayout kLayouts[] = {YuvLayout::Nv12, YuvLayout::I420, YuvLayout::Y};
+const YuvKernel kKernels[] = {YuvKernel::Scalar, YuvKernel::Sse2, YuvKernel::Sse41, YuvKernel::Avx2};
+
+const char* layout_name(YuvLayout l)
+{
+    return l == YuvLayout::Nv12 ? "nv12" : l == YuvLayout::I420 ? "i420" : "y";
+}
+
+std::vector<YuvKernel> supported_kernels()
+{
+    std::vector<YuvKernel> out;
+    for (YuvKernel k : kKernels)
+        if (yuv_kernel_supported(k))
+            out.push_back(k);
+    return out;
+}
+
+bool check(const std::vector<Image>& frames)
+{
+    std::mt19937 rng(1234);
+    std::vector<Image> images = frames;
+    const int sizes[][2] = {{1, 1}, {2, 2}, {3, 5}, {7, 3}, {15, 9}, {16, 16}, {17, 11}, {31, 7}, {33, 33}, {64, 6},
+                            {65, 13}, {127, 21}, {200, 2}, {333, 17}};
+    for (const auto& s : sizes)
+        images.push_back(random_image(s[0], s[1], std::uniform_int_distribution<size_t>(0, 37)(rng), rng));
+
+    bool ok = true;
+    for (YuvMatrix matrix : {YuvMatrix::Bt601, YuvMatrix::Bt709})
+        for (YuvRange range : {YuvRange::Limited, YuvRange::Full})
+            for (YuvLayout layout : kLayouts)
+                for (YuvKernel kernel : supported_kernels())
+                {
+                    YuvOptions opt{matrix, range, kernel};
+                    YuvOptions scalarOpt{matrix, range, YuvKernel::Scalar};
+                    Error err;
+                    bool exact = true, guards = true;
+
+                    for (size_t i = 0; i < images.size(); ++i)
+                    {
+                        const Image& img = images[i];
+                        size_t pad = i % 3 == 0 ? 0 : 1 + i * 7 % 29;
+                        Planes got(img.width, img.height, layout, pad), want(img.width, img.height, layout, 0);
+
+                        convert_banded(img, layout, got.p, opt, rng);
+                        bgra_to_yuv_rows(img.bgra.data(), img.stride, img.width, 0, img.height, layout, want.p,
+                                         scalarOpt);
+                        reference(img, got, opt, err);
+                        exact = exact && same_samples(got, want, img.width, img.height);
+                        guards = guards && got.guards_intact(img.width, img.height);
+                    }
+
+                    bool pass = err.max <= 1 && exact && guards;
+                    ok = ok && pass;
+                    printf("%-6s %-5s %-7s %-4s  max %d  mean %.4f  off-by-one %.3f%%  %s%s%s\n",
+                           yuv_kernel_name(kernel), matrix == YuvMatrix::Bt709 ? "bt709" : "bt601",
+                           range == YuvRange::Full ? "full" : "limited", layout_name(layout), err.max,
+                           static_cast<double>(err.sum) / static_cast<double>(err.samples),
+                           100.0 * static_cast<double>(err.off) / static_cast<double>(err.samples),
+                           pass ? "ok" : "FAIL", exact ? "" : " (differs from scalar)",
+                           guards ? "" : " (wrote into padding)");
+                }
+    return ok;
+}
+
+const char* policy_name(PagePolicy policy)
+{
+    switch (policy)
+    {
+    case PagePolicy::Small:
+        return "small";
+    case PagePolicy::Transparent:
+        return "transparent";
+    case PagePolicy::Large:
+        return "large";
+    }
+    return "?";
+}
+
+bool parse_pages(const char* s, std::vector<PagePolicy>& out)
+{
+    out.clear();
+    std::string list = s;
+    for (size_t pos = 0; pos <= list.size();)
+    {
+        size_t comma = std::min(list.find(',', pos), list.size());
+        std::string name = list.substr(pos, comma - pos);
+        if (name == "small")
+            out.push_back(PagePolicy::Small);
+        else if (name == "transparent")
+            out.push_back(PagePolicy::Transparent);
+        else if (name == "large")
+            out.push_back(PagePolicy::Large);
+        else
+            return false;
+        pos = comma + 1;
+    }
+    return !out.empty();
+}
+
+bool bench(const Image& frame, double seconds, int band, PagePolicy policy)
+{
+    using Clock = std::chrono::steady_clock;
+
+    // The frame, and below its planes, in the kind of buffer capture's workers use
+    PageBuffer source, output;
+    source.reserve(frame.bgra.size(), policy);
+    output.reserve(yuv_bytes(frame.width, frame.height, YuvLayout::Nv12), policy);
+    if (!source.data() || !output.data())
+    {
+        fprintf(stderr, "cannot allocate %s-page buffers\n", policy_name(policy));
+        return false;
+    }
+    memcpy(source.data(), frame.bgra.data(), frame.bgra.size());
+
+    printf("\n%dx%d, %.1f s per run, bands of %d rows, %s pages asked, got %s (%zu MB on huge pages)\n", frame.width,
+           frame.height, seconds, band, policy_name(policy), page_kind_name(source.kind()),
+           (source.huge_bytes() + output.huge_bytes()) >> 20);
+    printf("%-6s %-4s  %10s %10s  %10s\n", "kernel", "", "GB/s", "ms/frame", "banded GB/s");
+
+    const double frameBytes = static_cast<double>(frame.width) * frame.height * 4;
+    const uint8_t* bgra = source.data();
+    for (YuvKernel kernel : supported_kernels())
+        for (YuvLayout layout : kLayouts)
+        {
+            YuvOptions opt{YuvMatrix::Bt709, YuvRange::Limited, kernel};
+            YuvPlanes planes = yuv_packed_planes(output.data(), frame.width, frame.height, layout);
+
+            auto run = [&](int rows)
+            {
+                size_t frames = 0;
+                auto start = Clock::now();
+                auto end = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+                do
+                {
+                    for (int y = 0; y < frame.height; y += rows)
+                        bgra_to_yuv_rows(bgra, frame.stride, frame.width, y, std::min(frame.height, y + rows), layout,
+                                         planes, opt);
+                    ++frames;
+                } while (Clock::now() < end);
+                return std::chrono::duration<double>(Clock::now() - start).count() / static_cast<double>(frames);
+            };
+
+            double whole = run(frame.height);
+            double banded = run(band);
+            printf("%-6s %-4s  %10.2f %10.3f  %10.2f\n", yuv_kernel_name(kernel), layout_name(layout),
+                   frameBytes / whole / 1e9, whole * 1e3, frameBytes / banded / 1e9);
+        }
+    return true;
+}
+
+int usage()
+{
+    fprintf(stderr, "usage: hots_yuv [--size WxH] [--seconds S] [--band ROWS] [--pages small,transparent,large] "
+                    "[--no-bench] <dir|file.bmp>...\n");
+    return 2;
+}
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    int width = 1920, height = 1080, band = 16;
+    double seconds = 1;
+    bool runBench = true;
+    std::vector<PagePolicy> pages = {page_policy_from_env()};
+    std::vector<fs::path> files;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string a = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (a == "--size" && hasValue)
+        {
+            if (sscanf(argv[++i], "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0)
+                return usage();
+        }
+        else if (a == "--seconds" && hasValue)
+            seconds = std::atof(argv[++i]);
+        else if (a == "--band" && hasValue)
+            band = std::atoi(argv[++i]);
+        else if (a == "--pages" && hasValue)
+        {
+            if (!parse_pages(argv[++i], pages))
+                return usage();
+        }
+        else if (a == "--no-bench")
+            runBench = false;
+        else if (a.rfind("--", 0) == 0)
+            return usage();
+        else if (fs::is_directory(a))
+        {
+            for (const auto& e : fs::directory_iterator(a))
+                if (e.is_regular_file() && e.path().extension() == ".bmp")
+                    files.push_back(e.path());
+        }
+        else
+            files.push_back(a);
+    }
+    // Bands of the 4:2:0 layouts start at even rows
+    if (seconds <= 0 || band < 2 || band % 2)
+        return usage();
+
+    std::sort(files.begin(), files.end());
+    std::vector<Image> frames;
+    for (const auto& p : files)
+    {
+        BmpImage bmp;
+        if (load_bmp(p, bmp))
+            frames.push_back({bmp.width, bmp.height, static_cast<size_t>(bmp.width) * 4, std::move(bmp.bgra)});
+        else
+            fprintf(stderr, "skipping %s: not a readable 24/32-bit BMP\n", p.string().c_str());
+    }
+    if (frames.empty())
+        frames.push_back(generated_frame(width, height));
+
+    printf("auto kernel on this CPU: %s\n", yuv_kernel_name(yuv_kernel()));
+    bool ok = check(frames);
+    if (runBench)
+        for (PagePolicy policy : pages)
+            ok = bench(frames.front(), seconds, band, policy) && ok;
+    return ok ? 0 : 1;
+}
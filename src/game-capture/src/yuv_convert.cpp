@@ -0,0 +1,659 @@
+#include "yuv_convert.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HOTS_YUV_SSE2 1
+#include <emmintrin.h>
+#endif
+
+// The wider kernels are compiled per function (no /arch or -m flags) and only called after the CPU check
+#if defined(HOTS_YUV_SSE2) && (defined(__GNUC__) || defined(__clang__) || defined(_MSC_VER))
+#define HOTS_YUV_AVX2 1
+#include <immintrin.h>
+#if defined(__GNUC__) || defined(__clang__)
+#define HOTS_YUV_TARGET(isa) __attribute__((target(isa)))
+#else
+#include <intrin.h>
+#define HOTS_YUV_TARGET(isa)
+#endif
+#endif
+
+namespace
+{
+// Weights in 1/2^14 for B, G, R. Luma is taken per pixel; chroma from the sum of a 2x2 block, hence 2 more bits.
+// Offsets are added after the shift, which is the same as adding them (scaled) before it.
+constexpr int kShift = 14;
+constexpr int kYRound = 1 << (kShift - 1);
+constexpr int kCRound = 1 << (kShift + 1);
+constexpr int kCOffset = 128;
+
+struct Coefficients
+{
+    int16_t y[3];
+    int16_t u[3];
+    int16_t v[3];
+    int16_t yOffset;
+};
+
+constexpr int16_t fixed(double w)
+{
+    return static_cast<int16_t>(w * (1 << kShift) + (w < 0 ? -0.5 : 0.5));
+}
+
+constexpr Coefficients make_coefficients(double kr, double kb, YuvRange range)
+{
+    // Limited range: luma spans 219 of 255 levels from 16, chroma 224
+    const bool full = range == YuvRange::Full;
+    const double kg = 1.0 - kr - kb;
+    const double ys = full ? 1.0 : 219.0 / 255.0;
+    const double cs = full ? 1.0 : 224.0 / 255.0;
+    const double ud = 2.0 * (1.0 - kb);
+    const double vd = 2.0 * (1.0 - kr);
+
+    return {{fixed(kb * ys), fixed(kg * ys), fixed(kr * ys)},
+            {fixed(0.5 * cs), fixed(-kg / ud * cs), fixed(-kr / ud * cs)},
+            {fixed(-kb / vd * cs), fixed(-kg / vd * cs), fixed(0.5 * cs)},
+            static_cast<int16_t>(full ? 0 : 16)};
+}
+
+// [matrix][range]
+constexpr Coefficients kCoefficients[2][2] = {
+    {make_coefficients(0.299, 0.114, YuvRange::Limited), make_coefficients(0.299, 0.114, YuvRange::Full)},
+    {make_coefficients(0.2126, 0.0722, YuvRange::Limited), make_coefficients(0.2126, 0.0722, YuvRange::Full)},
+};
+
+// Two 16-bit weights as one pmaddwd lane
+constexpr int32_t pair(int lo, int hi)
+{
+    return static_cast<int32_t>(static_cast<uint16_t>(lo) | static_cast<uint32_t>(static_cast<uint16_t>(hi)) << 16);
+}
+
+uint8_t clamp_byte(int v)
+{
+    return static_cast<uint8_t>(std::clamp(v, 0, 255));
+}
+
+uint8_t luma(const Coefficients& c, const uint8_t* p)
+{
+    return clamp_byte(((c.y[0] * p[0] + c.y[1] * p[1] + c.y[2] * p[2] + kYRound) >> kShift) + c.yOffset);
+}
+
+uint8_t chroma(const int16_t w[3], int sb, int sg, int sr)
+{
+    return clamp_byte(((w[0] * sb + w[1] * sg + w[2] * sr + kCRound) >> (kShift + 2)) + kCOffset);
+}
+
+void luma_row_scalar(const Coefficients& c, const uint8_t* r, int x0, int width, uint8_t* y)
+{
+    for (int x = x0; x < width; ++x)
+        y[x] = luma(c, r + static_cast<size_t>(x) * 4);
+}
+
+// Rows r0 and r1 (the same row for an odd last one), pixels [x0, width) with x0 even; an odd last column pairs with
+// itself
+void convert_rows_scalar(const Coefficients& c, const uint8_t* r0, const uint8_t* r1, int x0, int width, uint8_t* y0,
+                         uint8_t* y1, uint8_t* u, uint8_t* v, int chromaStep)
+{
+    for (int x = x0; x < width; x += 2)
+    {
+        const int x1 = std::min(x + 1, width - 1);
+        const uint8_t* a = r0 + static_cast<size_t>(x) * 4;
+        const uint8_t* a1 = r0 + static_cast<size_t>(x1) * 4;
+        const uint8_t* b = r1 + static_cast<size_t>(x) * 4;
+        const uint8_t* b1 = r1 + static_cast<size_t>(x1) * 4;
+
+        y0[x] = luma(c, a);
+        y0[x1] = luma(c, a1);
+        y1[x] = luma(c, b);
+        y1[x1] = luma(c, b1);
+
+        int sb = a[0] + a1[0] + b[0] + b1[0];
+        int sg = a[1] + a1[1] + b[1] + b1[1];
+        int sr = a[2] + a1[2] + b[2] + b1[2];
+        size_t i = static_cast<size_t>(x / 2) * chromaStep;
+        u[i] = chroma(c.u, sb, sg, sr);
+        v[i] = chroma(c.v, sb, sg, sr);
+    }
+}
+
+// SIMD kernels convert whole steps from the start of the row and return the first pixel left for the scalar tail
+using RowsFn = int (*)(const Coefficients&, const uint8_t*, const uint8_t*, int, uint8_t*, uint8_t*, uint8_t*,
+                       uint8_t*, YuvLayout);
+using LumaFn = int (*)(const Coefficients&, const uint8_t*, int, uint8_t*);
+
+int convert_rows_none(const Coefficients&, const uint8_t*, const uint8_t*, int, uint8_t*, uint8_t*, uint8_t*, uint8_t*,
+                      YuvLayout)
+{
+    return 0;
+}
+
+int luma_row_none(const Coefficients&, const uint8_t*, int, uint8_t*)
+{
+    return 0;
+}
+
+#ifdef HOTS_YUV_SSE2
+// Weighted sums of 4 pixels (BGRA widened to 16 bits, two pixels per register): pmaddwd gives each pixel's B+G and
+// R halves in adjacent lanes, which the even/odd split adds up
+inline __m128i weigh4(__m128i p01, __m128i p23, __m128i w)
+{
+    __m128 m01 = _mm_castsi128_ps(_mm_madd_epi16(p01, w));
+    __m128 m23 = _mm_castsi128_ps(_mm_madd_epi16(p23, w));
+    __m128i even = _mm_castps_si128(_mm_shuffle_ps(m01, m23, _MM_SHUFFLE(2, 0, 2, 0)));
+    __m128i odd = _mm_castps_si128(_mm_shuffle_ps(m01, m23, _MM_SHUFFLE(3, 1, 3, 1)));
+    return _mm_add_epi32(even, odd);
+}
+
+inline __m128i weights(const int16_t w[3])
+{
+    return _mm_setr_epi16(w[0], w[1], w[2], 0, w[0], w[1], w[2], 0);
+}
+
+// 8 luma samples of one row from its two 4-pixel registers
+inline __m128i luma8(__m128i a, __m128i b, __m128i w, __m128i offset, __m128i zero)
+{
+    const __m128i round = _mm_set1_epi32(kYRound);
+    __m128i lo = _mm_srai_epi32(_mm_add_epi32(weigh4(_mm_unpacklo_epi8(a, zero), _mm_unpackhi_epi8(a, zero), w), round),
+                                kShift);
+    __m128i hi = _mm_srai_epi32(_mm_add_epi32(weigh4(_mm_unpacklo_epi8(b, zero), _mm_unpackhi_epi8(b, zero), w), round),
+                                kShift);
+    return _mm_packus_epi16(_mm_add_epi16(_mm_packs_epi32(lo, hi), offset), zero);
+}
+
+// Per-channel sums of two 2x2 blocks, one block per 64-bit half: top row pixels in `t`, bottom row in `b`
+inline __m128i block_sums(__m128i t, __m128i b, __m128i zero)
+{
+    __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(t, zero), _mm_unpacklo_epi8(b, zero));
+    __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(t, zero), _mm_unpackhi_epi8(b, zero));
+    return _mm_add_epi16(_mm_unpacklo_epi64(lo, hi), _mm_unpackhi_epi64(lo, hi));
+}
+
+int luma_row_sse2(const Coefficients& c, const uint8_t* r, int width, uint8_t* y)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i wy = weights(c.y);
+    const __m128i yOffset = _mm_set1_epi16(c.yOffset);
+
+    int x = 0;
+    for (; x + 8 <= width; x += 8)
+    {
+        const uint8_t* p = r + static_cast<size_t>(x) * 4;
+        __m128i a0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i a1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(y + x), luma8(a0, a1, wy, yOffset, zero));
+    }
+    return x;
+}
+
+int convert_rows_sse2(const Coefficients& c, const uint8_t* r0, const uint8_t* r1, int width, uint8_t* y0,
+                      uint8_t* y1, uint8_t* u, uint8_t* v, YuvLayout layout)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i wy = weights(c.y);
+    const __m128i wu = weights(c.u);
+    const __m128i wv = weights(c.v);
+    const __m128i yOffset = _mm_set1_epi16(c.yOffset);
+    const __m128i cOffset = _mm_set1_epi16(kCOffset);
+    const __m128i cRound = _mm_set1_epi32(kCRound);
+
+    int x = 0;
+    for (; x + 8 <= width; x += 8)
+    {
+        const uint8_t* pa = r0 + static_cast<size_t>(x) * 4;
+        const uint8_t* pb = r1 + static_cast<size_t>(x) * 4;
+        __m128i a0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pa));
+        __m128i a1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pa + 16));
+        __m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pb));
+        __m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pb + 16));
+
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(y0 + x), luma8(a0, a1, wy, yOffset, zero));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(y1 + x), luma8(b0, b1, wy, yOffset, zero));
+
+        // Four blocks: sums of 4 pixels stay under 2^10, well inside pmaddwd's range
+        __m128i s01 = block_sums(a0, b0, zero);
+        __m128i s23 = block_sums(a1, b1, zero);
+        __m128i cu = _mm_srai_epi32(_mm_add_epi32(weigh4(s01, s23, wu), cRound), kShift + 2);
+        __m128i cv = _mm_srai_epi32(_mm_add_epi32(weigh4(s01, s23, wv), cRound), kShift + 2);
+        __m128i u16 = _mm_add_epi16(_mm_packs_epi32(cu, cu), cOffset);
+        __m128i v16 = _mm_add_epi16(_mm_packs_epi32(cv, cv), cOffset);
+
+        if (layout == YuvLayout::Nv12)
+        {
+            __m128i uv = _mm_unpacklo_epi16(u16, v16);
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(u + x), _mm_packus_epi16(uv, uv));
+        }
+        else
+        {
+            int ub = _mm_cvtsi128_si32(_mm_packus_epi16(u16, u16));
+            int vb = _mm_cvtsi128_si32(_mm_packus_epi16(v16, v16));
+            std::memcpy(u + x / 2, &ub, 4);
+            std::memcpy(v + x / 2, &vb, 4);
+        }
+    }
+    return x;
+}
+#endif
+
+#ifdef HOTS_YUV_AVX2
+// SSE4.1 and AVX2 split each 4 pixels with pshufb into B,G pairs and R alone in a 32-bit lane, then set the free half
+// of R's lane to a constant so pmaddwd adds the rounding term with the R weight: two multiply-adds and one add per 4
+// pixels, no horizontal step. Chroma works on the same split registers. Same integer results as the scalar code.
+
+// 16-bit B0 G0 B1 G1 B2 G2 B3 G3
+HOTS_YUV_TARGET("sse4.1") inline __m128i split_bg(__m128i p)
+{
+    return _mm_shuffle_epi8(p, _mm_setr_epi8(0, -1, 1, -1, 4, -1, 5, -1, 8, -1, 9, -1, 12, -1, 13, -1));
+}
+
+// 32-bit R0 R1 R2 R3
+HOTS_YUV_TARGET("sse4.1") inline __m128i split_r(__m128i p)
+{
+    return _mm_shuffle_epi8(p, _mm_setr_epi8(2, -1, -1, -1, 6, -1, -1, -1, 10, -1, -1, -1, 14, -1, -1, -1));
+}
+
+// Luma of 4 pixels, before the offset; R's free half is 1, weighted by the rounding term
+HOTS_YUV_TARGET("sse4.1") inline __m128i luma4(__m128i bg, __m128i r, __m128i wBg, __m128i wR)
+{
+    __m128i r1 = _mm_or_si128(r, _mm_set1_epi32(1 << 16));
+    return _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(bg, wBg), _mm_madd_epi16(r1, wR)), kShift);
+}
+
+// Channel sums of the two 2x2 blocks over 4 columns of a split top and bottom row, in 32-bit lanes 0 and 2
+HOTS_YUV_TARGET("sse4.1") inline __m128i pair_sums(__m128i top, __m128i bottom)
+{
+    __m128i s = _mm_add_epi16(top, bottom);
+    return _mm_add_epi16(s, _mm_srli_epi64(s, 32));
+}
+
+// 32-bit lanes 0 and 2 of `a`, then of `b`
+HOTS_YUV_TARGET("sse4.1") inline __m128i even_lanes(__m128i a, __m128i b)
+{
+    return _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(a), _mm_castsi128_ps(b), _MM_SHUFFLE(2, 0, 2, 0)));
+}
+
+// Chroma of 4 blocks, before the offset; R's free half is 2, weighted by half the rounding term
+HOTS_YUV_TARGET("sse4.1") inline __m128i chroma4(__m128i bg, __m128i r, __m128i wBg, __m128i wR)
+{
+    __m128i r2 = _mm_or_si128(r, _mm_set1_epi32(2 << 16));
+    return _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(bg, wBg), _mm_madd_epi16(r2, wR)), kShift + 2);
+}
+
+HOTS_YUV_TARGET("sse4.1") inline __m128i luma8_sse41(__m128i a0, __m128i a1, __m128i wBg, __m128i wR, __m128i offset)
+{
+    __m128i y = _mm_packus_epi32(luma4(split_bg(a0), split_r(a0), wBg, wR), luma4(split_bg(a1), split_r(a1), wBg, wR));
+    y = _mm_add_epi16(y, offset);
+    return _mm_packus_epi16(y, y);
+}
+
+HOTS_YUV_TARGET("sse4.1") int luma_row_sse41(const Coefficients& c, const uint8_t* r, int width, uint8_t* y)
+{
+    const __m128i wyBg = _mm_set1_epi32(pair(c.y[0], c.y[1]));
+    const __m128i wyR = _mm_set1_epi32(pair(c.y[2], kYRound));
+    const __m128i yOffset = _mm_set1_epi16(c.yOffset);
+
+    int x = 0;
+    for (; x + 8 <= width; x += 8)
+    {
+        const uint8_t* p = r + static_cast<size_t>(x) * 4;
+        __m128i a0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i a1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(y + x), luma8_sse41(a0, a1, wyBg, wyR, yOffset));
+    }
+    return x;
+}
+
+HOTS_YUV_TARGET("sse4.1")
+int convert_rows_sse41(const Coefficients& c, const uint8_t* r0, const uint8_t* r1, int width, uint8_t* y0,
+                       uint8_t* y1, uint8_t* u, uint8_t* v, YuvLayout layout)
+{
+    const __m128i wyBg = _mm_set1_epi32(pair(c.y[0], c.y[1]));
+    const __m128i wyR = _mm_set1_epi32(pair(c.y[2], kYRound));
+    const __m128i wuBg = _mm_set1_epi32(pair(c.u[0], c.u[1]));
+    const __m128i wuR = _mm_set1_epi32(pair(c.u[2], kCRound / 2));
+    const __m128i wvBg = _mm_set1_epi32(pair(c.v[0], c.v[1]));
+    const __m128i wvR = _mm_set1_epi32(pair(c.v[2], kCRound / 2));
+    const __m128i yOffset = _mm_set1_epi16(c.yOffset);
+    const __m128i cOffset = _mm_set1_epi16(kCOffset);
+
+    int x = 0;
+    for (; x + 8 <= width; x += 8)
+    {
+        const uint8_t* pa = r0 + static_cast<size_t>(x) * 4;
+        const uint8_t* pb = r1 + static_cast<size_t>(x) * 4;
+        __m128i a0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pa));
+        __m128i a1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pa + 16));
+        __m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pb));
+        __m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pb + 16));
+        __m128i bgA0 = split_bg(a0), bgA1 = split_bg(a1), bgB0 = split_bg(b0), bgB1 = split_bg(b1);
+        __m128i rA0 = split_r(a0), rA1 = split_r(a1), rB0 = split_r(b0), rB1 = split_r(b1);
+
+        __m128i ya = _mm_packus_epi32(luma4(bgA0, rA0, wyBg, wyR), luma4(bgA1, rA1, wyBg, wyR));
+        __m128i yb = _mm_packus_epi32(luma4(bgB0, rB0, wyBg, wyR), luma4(bgB1, rB1, wyBg, wyR));
+        ya = _mm_add_epi16(ya, yOffset);
+        yb = _mm_add_epi16(yb, yOffset);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(y0 + x), _mm_packus_epi16(ya, ya));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(y1 + x), _mm_packus_epi16(yb, yb));
+
+        // Blocks 0-3 in order: B,G sums as pairs, R sums alone with a free upper half
+        __m128i sbg = even_lanes(pair_sums(bgA0, bgB0), pair_sums(bgA1, bgB1));
+        __m128i sr = even_lanes(pair_sums(rA0, rB0), pair_sums(rA1, rB1));
+        // U0-3 then V0-3
+        __m128i uv = _mm_add_epi16(_mm_packs_epi32(chroma4(sbg, sr, wuBg, wuR), chroma4(sbg, sr, wvBg, wvR)),
+                                   cOffset);
+
+        if (layout == YuvLayout::Nv12)
+        {
+            __m128i pairs = _mm_unpacklo_epi16(uv, _mm_srli_si128(uv, 8));
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(u + x), _mm_packus_epi16(pairs, pairs));
+        }
+        else
+        {
+            __m128i bytes = _mm_packus_epi16(uv, uv);
+            int ub = _mm_cvtsi128_si32(bytes);
+            int vb = _mm_extract_epi32(bytes, 1);
+            std::memcpy(u + x / 2, &ub, 4);
+            std::memcpy(v + x / 2, &vb, 4);
+        }
+    }
+    return x;
+}
+
+// AVX2: the same per 128-bit lane, 8 pixels per register. Results come out lane-interleaved and are put back in
+// order with one permute before the stores.
+
+HOTS_YUV_TARGET("avx2") inline __m256i split_bg(__m256i p)
+{
+    return _mm256_shuffle_epi8(p, _mm256_broadcastsi128_si256(_mm_setr_epi8(0, -1, 1, -1, 4, -1, 5, -1, 8, -1, 9, -1,
+                                                                            12, -1, 13, -1)));
+}
+
+HOTS_YUV_TARGET("avx2") inline __m256i split_r(__m256i p)
+{
+    return _mm256_shuffle_epi8(p, _mm256_broadcastsi128_si256(_mm_setr_epi8(2, -1, -1, -1, 6, -1, -1, -1, 10, -1, -1,
+                                                                            -1, 14, -1, -1, -1)));
+}
+
+HOTS_YUV_TARGET("avx2") inline __m256i luma4(__m256i bg, __m256i r, __m256i wBg, __m256i wR)
+{
+    __m256i r1 = _mm256_or_si256(r, _mm256_set1_epi32(1 << 16));
+    return _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(bg, wBg), _mm256_madd_epi16(r1, wR)), kShift);
+}
+
+HOTS_YUV_TARGET("avx2") inline __m256i pair_sums(__m256i top, __m256i bottom)
+{
+    __m256i s = _mm256_add_epi16(top, bottom);
+    return _mm256_add_epi16(s, _mm256_srli_epi64(s, 32));
+}
+
+HOTS_YUV_TARGET("avx2") inline __m256i even_lanes(__m256i a, __m256i b)
+{
+    __m256 even = _mm256_shuffle_ps(_mm256_castsi256_ps(a), _mm256_castsi256_ps(b), _MM_SHUFFLE(2, 0, 2, 0));
+    return _mm256_castps_si256(even);
+}
+
+HOTS_YUV_TARGET("avx2") inline __m256i chroma4(__m256i bg, __m256i r, __m256i wBg, __m256i wR)
+{
+    __m256i r2 = _mm256_or_si256(r, _mm256_set1_epi32(2 << 16));
+    return _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(bg, wBg), _mm256_madd_epi16(r2, wR)), kShift + 2);
+}
+
+// 16 luma bytes from 32-bit results for pixels [0-3 | 4-7] and [8-11 | 12-15]
+HOTS_YUV_TARGET("avx2") inline __m128i luma_bytes(__m256i lo, __m256i hi, __m256i offset)
+{
+    __m256i y = _mm256_permute4x64_epi64(_mm256_packus_epi32(lo, hi), _MM_SHUFFLE(3, 1, 2, 0));
+    y = _mm256_add_epi16(y, offset);
+    return _mm_packus_epi16(_mm256_castsi256_si128(y), _mm256_extracti128_si256(y, 1));
+}
+
+// 8 chroma samples in order from blocks [0 1 4 5 | 2 3 6 7]
+HOTS_YUV_TARGET("avx2") inline __m128i chroma_words(__m256i c, __m128i offset)
+{
+    c = _mm256_permute4x64_epi64(c, _MM_SHUFFLE(3, 1, 2, 0));
+    return _mm_add_epi16(_mm_packs_epi32(_mm256_castsi256_si128(c), _mm256_extracti128_si256(c, 1)), offset);
+}
+
+HOTS_YUV_TARGET("avx2") int luma_row_avx2(const Coefficients& c, const uint8_t* r, int width, uint8_t* y)
+{
+    const __m256i wyBg = _mm256_set1_epi32(pair(c.y[0], c.y[1]));
+    const __m256i wyR = _mm256_set1_epi32(pair(c.y[2], kYRound));
+    const __m256i yOffset = _mm256_set1_epi16(c.yOffset);
+
+    int x = 0;
+    for (; x + 16 <= width; x += 16)
+    {
+        const uint8_t* p = r + static_cast<size_t>(x) * 4;
+        __m256i a0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i a1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32));
+        __m128i bytes = luma_bytes(luma4(split_bg(a0), split_r(a0), wyBg, wyR),
+                                   luma4(split_bg(a1), split_r(a1), wyBg, wyR), yOffset);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(y + x), bytes);
+    }
+    return x;
+}
+
+HOTS_YUV_TARGET("avx2")
+int convert_rows_avx2(const Coefficients& c, const uint8_t* r0, const uint8_t* r1, int width, uint8_t* y0,
+                      uint8_t* y1, uint8_t* u, uint8_t* v, YuvLayout layout)
+{
+    const __m256i wyBg = _mm256_set1_epi32(pair(c.y[0], c.y[1]));
+    const __m256i wyR = _mm256_set1_epi32(pair(c.y[2], kYRound));
+    const __m256i wuBg = _mm256_set1_epi32(pair(c.u[0], c.u[1]));
+    const __m256i wuR = _mm256_set1_epi32(pair(c.u[2], kCRound / 2));
+    const __m256i wvBg = _mm256_set1_epi32(pair(c.v[0], c.v[1]));
+    const __m256i wvR = _mm256_set1_epi32(pair(c.v[2], kCRound / 2));
+    const __m256i yOffset = _mm256_set1_epi16(c.yOffset);
+    const __m128i cOffset = _mm_set1_epi16(kCOffset);
+
+    int x = 0;
+    for (; x + 16 <= width; x += 16)
+    {
+        const uint8_t* pa = r0 + static_cast<size_t>(x) * 4;
+        const uint8_t* pb = r1 + static_cast<size_t>(x) * 4;
+        __m256i a0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pa));
+        __m256i a1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pa + 32));
+        __m256i b0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pb));
+        __m256i b1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pb + 32));
+        __m256i bgA0 = split_bg(a0), bgA1 = split_bg(a1), bgB0 = split_bg(b0), bgB1 = split_bg(b1);
+        __m256i rA0 = split_r(a0), rA1 = split_r(a1), rB0 = split_r(b0), rB1 = split_r(b1);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(y0 + x),
+                         luma_bytes(luma4(bgA0, rA0, wyBg, wyR), luma4(bgA1, rA1, wyBg, wyR), yOffset));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(y1 + x),
+                         luma_bytes(luma4(bgB0, rB0, wyBg, wyR), luma4(bgB1, rB1, wyBg, wyR), yOffset));
+
+        // Blocks [0 1 4 5 | 2 3 6 7]
+        __m256i sbg = even_lanes(pair_sums(bgA0, bgB0), pair_sums(bgA1, bgB1));
+        __m256i sr = even_lanes(pair_sums(rA0, rB0), pair_sums(rA1, rB1));
+        __m128i u16 = chroma_words(chroma4(sbg, sr, wuBg, wuR), cOffset);
+        __m128i v16 = chroma_words(chroma4(sbg, sr, wvBg, wvR), cOffset);
+
+        if (layout == YuvLayout::Nv12)
+        {
+            __m128i uv = _mm_packus_epi16(_mm_unpacklo_epi16(u16, v16), _mm_unpackhi_epi16(u16, v16));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(u + x), uv);
+        }
+        else
+        {
+            __m128i bytes = _mm_packus_epi16(u16, v16);
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(u + x / 2), bytes);
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(v + x / 2), _mm_unpackhi_epi64(bytes, bytes));
+        }
+    }
+    return x;
+}
+
+bool cpu_has(YuvKernel kernel)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_cpu_init();
+    if (kernel == YuvKernel::Avx2)
+        return __builtin_cpu_supports("avx2");
+    return __builtin_cpu_supports("sse4.1");
+#else
+    int r[4];
+    __cpuid(r, 1);
+    if (kernel == YuvKernel::Sse41)
+        return (r[2] & (1 << 19)) != 0;
+    // AVX2 needs the OS to save the YMM registers as well as the CPU flag
+    const bool osYmm = (r[2] & (1 << 27)) && (r[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+    __cpuidex(r, 7, 0);
+    return osYmm && (r[1] & (1 << 5));
+#endif
+}
+#endif
+
+struct Kernel
+{
+    RowsFn rows;
+    LumaFn luma;
+};
+
+Kernel kernel_fns(YuvKernel kernel)
+{
+    switch (kernel)
+    {
+#ifdef HOTS_YUV_AVX2
+    case YuvKernel::Avx2:
+        return {convert_rows_avx2, luma_row_avx2};
+    case YuvKernel::Sse41:
+        return {convert_rows_sse41, luma_row_sse41};
+#endif
+#ifdef HOTS_YUV_SSE2
+    case YuvKernel::Sse2:
+        return {convert_rows_sse2, luma_row_sse2};
+#endif
+    default:
+        return {convert_rows_none, luma_row_none};
+    }
+}
+}  // namespace
+
+size_t yuv_bytes(int width, int height, YuvLayout layout)
+{
+    size_t luma = static_cast<size_t>(width) * height;
+    if (layout == YuvLayout::Y)
+        return luma;
+    return luma + 2 * static_cast<size_t>((width + 1) / 2) * ((height + 1) / 2);
+}
+
+YuvPlanes yuv_packed_planes(uint8_t* out, int width, int height, YuvLayout layout)
+{
+    YuvPlanes p;
+    p.y = out;
+    p.yPitch = static_cast<size_t>(width);
+    if (layout == YuvLayout::Y)
+        return p;
+
+    const size_t chromaWidth = static_cast<size_t>((width + 1) / 2);
+    p.u = out + static_cast<size_t>(width) * height;
+    if (layout == YuvLayout::Nv12)
+    {
+        p.uPitch = chromaWidth * 2;
+    }
+    else
+    {
+        p.uPitch = chromaWidth;
+        p.v = p.u + chromaWidth * ((height + 1) / 2);
+        p.vPitch = chromaWidth;
+    }
+    return p;
+}
+
+void bgra_to_yuv_rows(const uint8_t* bgra, size_t stride, int width, int rowBegin, int rowEnd, YuvLayout layout,
+                      const YuvPlanes& planes, const YuvOptions& opt)
+{
+    const Coefficients& c = kCoefficients[opt.matrix == YuvMatrix::Bt709][opt.range == YuvRange::Full];
+    const Kernel k = kernel_fns(yuv_kernel(opt.kernel));
+
+    if (layout == YuvLayout::Y)
+    {
+        for (int y = rowBegin; y < rowEnd; ++y)
+        {
+            const uint8_t* r = bgra + static_cast<size_t>(y) * stride;
+            uint8_t* out = planes.y + static_cast<size_t>(y) * planes.yPitch;
+            luma_row_scalar(c, r, k.luma(c, r, width, out), width, out);
+        }
+        return;
+    }
+
+    // NV12 keeps U and V side by side in one plane
+    const int chromaStep = layout == YuvLayout::Nv12 ? 2 : 1;
+    for (int y = rowBegin; y < rowEnd; y += 2)
+    {
+        // An odd last row pairs with itself, writing its luma twice
+        const bool pairRow = y + 1 < rowEnd;
+        const uint8_t* r0 = bgra + static_cast<size_t>(y) * stride;
+        const uint8_t* r1 = pairRow ? r0 + stride : r0;
+        uint8_t* y0 = planes.y + static_cast<size_t>(y) * planes.yPitch;
+        uint8_t* y1 = pairRow ? y0 + planes.yPitch : y0;
+        uint8_t* u = planes.u + static_cast<size_t>(y / 2) * planes.uPitch;
+        uint8_t* v = layout == YuvLayout::Nv12 ? u + 1 : planes.v + static_cast<size_t>(y / 2) * planes.vPitch;
+
+        int x = k.rows(c, r0, r1, width, y0, y1, u, v, layout);
+        convert_rows_scalar(c, r0, r1, x, width, y0, y1, u, v, chromaStep);
+    }
+}
+
+void bgra_to_yuv(const uint8_t* bgra, int width, int height, size_t stride, YuvLayout layout, uint8_t* out,
+                 const YuvOptions& opt)
+{
+    bgra_to_yuv_rows(bgra, stride, width, 0, height, layout, yuv_packed_planes(out, width, height, layout), opt);
+}
+
+bool yuv_kernel_supported(YuvKernel kernel)
+{
+    switch (kernel)
+    {
+    case YuvKernel::Auto:
+    case YuvKernel::Scalar:
+        return true;
+#ifdef HOTS_YUV_SSE2
+    case YuvKernel::Sse2:
+        return true;
+#endif
+#ifdef HOTS_YUV_AVX2
+    case YuvKernel::Sse41:
+    case YuvKernel::Avx2: {
+        static const bool sse41 = cpu_has(YuvKernel::Sse41);
+        static const bool avx2 = cpu_has(YuvKernel::Avx2);
+        return kernel == YuvKernel::Avx2 ? avx2 : sse41;
+    }
+#endif
+    default:
+        return false;
+    }
+}
+
+YuvKernel yuv_kernel(YuvKernel requested)
+{
+    if (requested != YuvKernel::Auto && yuv_kernel_supported(requested))
+        return requested;
+
+    static const YuvKernel best = [] {
+        for (YuvKernel k : {YuvKernel::Avx2, YuvKernel::Sse41, YuvKernel::Sse2})
+            if (yuv_kernel_supported(k))
+                return k;
+        return YuvKernel::Scalar;
+    }();
+    return best;
+}
+
+const char* yuv_kernel_name(YuvKernel kernel)
+{
+    switch (kernel)
+    {
+    case YuvKernel::Auto:
+        return "auto";
+    case YuvKernel::Scalar:
+        return "scalar";
+    case YuvKernel::Sse2:
+        return "sse2";
+    case YuvKernel::Sse41:
+        return "sse4.1";
+    case YuvKernel::Avx2:
+        return "avx2";
+    }
+    return "?";
+}
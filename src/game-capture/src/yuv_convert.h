@@ -0,0 +1,90 @@
+// BGRA -> YUV conversion for video encoders (video_sink.h) and for analysis stages that only need luma.
+//
+// Matrices BT.601 and BT.709, in limited (Y 16-235, chroma 16-240) or full (0-255) range. 4:2:0 layouts give each 2x2
+// block of pixels one chroma sample from the block's average colour (centre-sited); an odd last row or column pairs
+// with itself. Results are exact integer arithmetic (weights in 1/2^14, rounded), within one level of the real-valued
+// formula, and identical whichever kernel runs:
+//   Scalar  any CPU
+//   Sse2    8 pixels per step (x86/x64 baseline)
+//   Sse41   8 pixels per step, channels split with pshufb so the rounding rides in the multiply-add
+//   Avx2    16 pixels per step, same scheme at twice the width
+// Auto takes the widest the CPU supports, checked once at run time; the build needs no extra compiler flags.
+//
+// Conversion goes by bands of rows, so it can run interleaved with other passes over the same frame while its rows
+// are still in cache. Source rows are `stride` bytes apart (a mapped texture's row pitch) and each destination plane
+// has its own pitch, so planes can be written straight into mapped NV12 textures.
+//
+// Layouts:
+//   Nv12  Y plane, then one plane of interleaved U, V pairs
+//   I420  Y plane, U plane, V plane (yuv420p)
+//   Y     the Y plane alone
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+enum class YuvLayout
+{
+    Nv12,
+    I420,
+    Y,
+};
+
+enum class YuvMatrix
+{
+    Bt601,
+    Bt709,
+};
+
+enum class YuvRange
+{
+    Limited,
+    Full,
+};
+
+enum class YuvKernel
+{
+    Auto,
+    Scalar,
+    Sse2,
+    Sse41,
+    Avx2,
+};
+
+struct YuvOptions
+{
+    YuvMatrix matrix = YuvMatrix::Bt709;
+    YuvRange range = YuvRange::Limited;
+    YuvKernel kernel = YuvKernel::Auto;  // a kernel the CPU lacks falls back to Auto
+};
+
+// Where the planes go. Nv12: `u` is the interleaved UV plane and `v` is unused; Y: only `y` is used. Each chroma plane
+// has (height + 1) / 2 rows of (width + 1) / 2 samples (pairs for Nv12).
+struct YuvPlanes
+{
+    uint8_t* y = nullptr;
+    size_t yPitch = 0;
+    uint8_t* u = nullptr;
+    size_t uPitch = 0;
+    uint8_t* v = nullptr;
+    size_t vPitch = 0;
+};
+
+// Bytes of a width x height frame in `layout`, planes packed with no row padding.
+size_t yuv_bytes(int width, int height, YuvLayout layout);
+// The planes of such a packed frame starting at `out`.
+YuvPlanes yuv_packed_planes(uint8_t* out, int width, int height, YuvLayout layout);
+
+// Converts source rows [rowBegin, rowEnd) of a `width`-pixel-wide BGRA image (the alpha byte is ignored). For the
+// 4:2:0 layouts rowBegin must be even, and rowEnd even unless it is the last row of the image.
+void bgra_to_yuv_rows(const uint8_t* bgra, size_t stride, int width, int rowBegin, int rowEnd, YuvLayout layout,
+                      const YuvPlanes& planes, const YuvOptions& opt = {});
+
+// The whole image, packed into `out` (yuv_bytes(width, height, layout)).
+void bgra_to_yuv(const uint8_t* bgra, int width, int height, size_t stride, YuvLayout layout, uint8_t* out,
+                 const YuvOptions& opt = {});
+
+// The kernel `requested` resolves to on this CPU.
+YuvKernel yuv_kernel(YuvKernel requested = YuvKernel::Auto);
+bool yuv_kernel_supported(YuvKernel kernel);
+const char* yuv_kernel_name(YuvKernel kernel);
@@ -467,6 +467,7 @@ class DetectionBackend:
 # Frame count thresholds for synthetic status classification (still used)
 LOADING_THRESHOLD = 5
 ENDED_THRESHOLD = 120
+FRAME_SUFFIXES = (".bmp", ".jpg")
 
 
 def classify_status(processed: int) -> str:
@@ -783,6 +784,13 @@ def process_frame(ctx: RuntimeContext, frame_path: Path, stats: Stats) -> None:
         )
 
 
+def list_frames(frames_dir: Path) -> list[Path]:
+    """Saved frames in name order: BMPs, or JPEGs when capture runs with CAPTURE_FRAME_FORMAT=jpeg."""
+    if not frames_dir.is_dir():
+        return []
+    return sorted(p for p in frames_dir.iterdir() if p.suffix in FRAME_SUFFIXES)
+
+
 def scan_existing(ctx: RuntimeContext, stats: Stats) -> None:
     """Scan existing frames in the directory, updating stats and sidecars as needed."""
 
@@ -796,7 +804,7 @@ def scan_existing(ctx: RuntimeContext, stats: Stats) -> None:
             path=str(frames_dir),
         )
         return
-    frames = sorted(frames_dir.glob("*.bmp"))
+    frames = list_frames(frames_dir)
     if not frames:
         logger.info(
             "frames.empty",
@@ -919,7 +927,7 @@ def main(argv: Optional[Sequence[str]] = None) -> int:
     write_heartbeat(ctx, stats)
 
     if args.run_once:
-        for frame in sorted(frames_dir.glob("*.bmp")):
+        for frame in list_frames(frames_dir):
             state_sidecar = (
                 ctx.config.paths.detections_dir / f"{frame.stem}.detections.json"
             )
@@ -935,7 +943,7 @@ def main(argv: Optional[Sequence[str]] = None) -> int:
         return 0
 
     while RUNNING:
-        for frame in sorted(frames_dir.glob("*.bmp")):
+        for frame in list_frames(frames_dir):
             state_sidecar = (
                 ctx.config.paths.detections_dir / f"{frame.stem}.detections.json"
             )
@@ -1,7 +1,7 @@
 """Integration-style tests for generating detection sidecars over existing frames.
 
 These tests purposely invoke the same logic as the running detection service but
-without the perpetual loop – we call `process_frame` directly for each BMP in
+without the perpetual loop – we call `process_frame` directly for each frame in
 `sessions/current/frames` and assert a valid sidecar (schema v3) is created.
 
 Assumptions:
@@ -40,7 +40,7 @@ def detection_ctx():
 
 
 def _collect_frames(limit: int | None = None):
-    frames = sorted(FRAMES_DIR.glob("*.bmp"))
+    frames = service.list_frames(FRAMES_DIR)
     if limit is not None:
         frames = frames[:limit]
     return frames